@@ -24,6 +24,8 @@
 #define gen1SIZE          ((size_t)20)
 #define gen2SIZE          ((size_t)85)
 #define avLEN             3
+#define largeSIZE         ((size_t)8192)
+#define largeFREQ         128
 #define exactRootsCOUNT   180
 #define ambigRootsCOUNT   50
 #define genCOUNT          2
@@ -97,11 +99,17 @@ static mps_addr_t make(size_t rootsCount)
 {
   static unsigned long calls = 0;
   size_t length = rnd() % (scale * avLEN);
-  size_t size = (length+2) * sizeof(mps_word_t);
+  size_t size;
   mps_addr_t p;
   mps_res_t res;
   ++ calls;
 
+  /* Make a large object now and then, to test promotion of large
+     segments without copying. */
+  if (calls % largeFREQ == 0)
+    length = largeSIZE / sizeof(mps_word_t);
+  size = (length+2) * sizeof(mps_word_t);
+
   do {
     MPS_RESERVE_BLOCK(res, p, ap, size);
     if (res) {
@@ -165,8 +173,13 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   die(dylan_fmt(&format, arena), "fmt_create");
   die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
 
-  die(mps_pool_create(&pool, arena, pool_class, format, chain),
-      "pool_create(amc)");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_LARGE_SIZE, largeSIZE);
+    die(mps_pool_create_k(&pool, arena, pool_class, args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
 
   die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
@@ -153,7 +153,17 @@ static void *kid_thread(void *arg)
 
   die(mps_ap_create(&ap, cl->pool, mps_rank_exact()), "BufferCreate(fooey)");
   while(mps_collections(arena) < collectionsCOUNT) {
+    mps_addr_t obj;
+    mps_pool_t pool;
     churn(ap, cl->roots_count);
+
+    /* Look up a new object while other threads allocate and collect.
+       It is pinned by the ambiguous reference from this stack. */
+    obj = make(ap, cl->roots_count);
+    Insist(mps_arena_has_addr(arena, obj));
+    Insist(mps_addr_pool(&pool, arena, obj));
+    Insist(pool == cl->pool);
+    Insist(!mps_arena_has_addr(arena, marker));
   }
   mps_ap_destroy(ap);
 
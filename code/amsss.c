@@ -36,11 +36,21 @@ static mps_gen_param_s testChain[1] = { { 160, 0.90 } };
 
 static mps_arena_t arena;
 static mps_ap_t ap;
+static mps_bool_t zeroed;       /* ap was created with MPS_KEY_AP_ZEROED */
 static mps_addr_t exactRoots[exactRootsCOUNT];
 static mps_addr_t ambigRoots[ambigRootsCOUNT];
 static size_t totalSize = 0;
 
 
+/* census -- classify all objects as the same type */
+
+static size_t census(mps_addr_t addr)
+{
+  Insist(addr != NULL);
+  return 0;
+}
+
+
 /* report - report statistics from any messages */
 
 static void report(void)
@@ -59,16 +69,24 @@ static void report(void)
       printf("%s\n", mps_message_gc_start_why(arena, message));
 
     } else if (type == mps_message_type_gc()) {
-      size_t live, condemned, not_condemned;
+      size_t live, condemned, not_condemned, count, size;
 
       live = mps_message_gc_live_size(arena, message);
       condemned = mps_message_gc_condemned_size(arena, message);
       not_condemned = mps_message_gc_not_condemned_size(arena, message);
 
+      /* The census counts the objects that were marked, so it can't
+         exceed the live size. */
+      mps_message_gc_census(&count, &size, arena, message, 0);
+      Insist(size <= live);
+      Insist(count * 2 * sizeof(mps_word_t) <= size);
+
       printf("\nCollection complete %d:\n", ++nComplete);
       printf("live %"PRIuLONGEST"\n", (ulongest_t)live);
       printf("condemned %"PRIuLONGEST"\n", (ulongest_t)condemned);
       printf("not_condemned %"PRIuLONGEST"\n", (ulongest_t)not_condemned);
+      printf("censused %"PRIuLONGEST" objects, %"PRIuLONGEST" bytes\n",
+             (ulongest_t)count, (ulongest_t)size);
 
     } else {
       cdie(0, "unknown message type");
@@ -79,7 +97,11 @@ static void report(void)
 }
 
 
-/* make -- object allocation and init */
+/* make -- object allocation and init
+ *
+ * If the allocation point is zeroed, check that the block is zero,
+ * including when its memory was used by objects that have died.
+ */
 
 static mps_addr_t make(void)
 {
@@ -91,6 +113,8 @@ static mps_addr_t make(void)
     MPS_RESERVE_BLOCK(res, p, ap, size);
     if (res)
       die(res, "MPS_RESERVE_BLOCK");
+    if (zeroed)
+      check_zeroed(p, size);
     res = dylan_init(p, size, exactRoots, exactRootsCOUNT);
     if (res)
       die(res, "dylan_init");
@@ -117,7 +141,12 @@ static void test_pool(mps_pool_class_t pool_class, mps_arg_s args[],
   mps_addr_t busy_init;
 
   die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
-  die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
+  zeroed = rnd() % 2;
+  MPS_ARGS_BEGIN(apArgs) {
+    MPS_ARGS_ADD(apArgs, MPS_KEY_RANK, mps_rank_exact());
+    MPS_ARGS_ADD(apArgs, MPS_KEY_AP_ZEROED, zeroed);
+    die(mps_ap_create_k(&ap, pool, apArgs), "BufferCreate");
+  } MPS_ARGS_END(apArgs);
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
 
   for(i = 0; i < exactRootsCOUNT; ++i)
@@ -213,7 +242,17 @@ int main(int argc, char *argv[])
   mps_message_type_enable(arena, mps_message_type_gc_start());
   mps_message_type_enable(arena, mps_message_type_gc());
   die(mps_thread_reg(&thread, arena), "thread_reg");
-  die(mps_fmt_create_A(&format, arena, dylan_fmt_A()), "fmt_create");
+  MPS_ARGS_BEGIN(args) {
+    mps_fmt_A_s *fmt_A = dylan_fmt_A();
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_ALIGN, fmt_A->align);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SCAN, fmt_A->scan);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SKIP, fmt_A->skip);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_FWD, fmt_A->fwd);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_ISFWD, fmt_A->isfwd);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_PAD, fmt_A->pad);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_CENSUS, census);
+    die(mps_fmt_create_k(&format, arena, args), "fmt_create");
+  } MPS_ARGS_END(args);
   die(mps_chain_create(&chain, arena, 1, testChain), "chain_create");
 
   for (i = 0; i < 8; i++) {
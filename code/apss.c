@@ -17,38 +17,82 @@
 
 #include <stdio.h> /* printf */
 #include <stdlib.h> /* malloc */
+#include <string.h> /* memset */
 
 
 #define testArenaSIZE   ((((size_t)3)<<24) - 4)
 #define testSetSIZE 200
 #define testLOOPS 10
 #define MAX_ALIGN 64 /* TODO: Make this test work up to arena_grain_size? */
+#define sampleINTERVAL ((size_t)4096)
 
+static size_t reserved;         /* bytes reserved, see make */
+static size_t sampledReserved;  /* bytes reserved, up to the interval each */
+static size_t samples;          /* allocation samples taken */
+static mps_bool_t sampling;     /* is allocation sampling on? */
 
-/* make -- allocate one object */
 
-static mps_res_t make(mps_addr_t *p, mps_ap_t ap, size_t size)
+/* sample -- allocation sampling function
+ *
+ * Counts the samples, so that test can check that they are taken at
+ * about the requested interval.
+ */
+
+static void sample(mps_ap_t ap, mps_addr_t p, size_t size, void *closure)
+{
+  Insist(ap != NULL);
+  Insist(p != NULL);
+  Insist(size > 0);
+  Insist(closure == &samples);
+  ++ samples;
+}
+
+
+/* make -- allocate one object
+ *
+ * If zeroed is true, the allocation point was created with
+ * MPS_KEY_AP_ZEROED, so check that the object is zero, and then
+ * scribble over it so that any reuse of its memory would be noticed.
+ */
+
+static mps_res_t make(mps_addr_t *p, mps_ap_t ap, size_t size,
+                      mps_bool_t zeroed)
 {
   mps_res_t res;
 
   do {
+    reserved += size;
+    /* A block can't be sampled more than once. */
+    sampledReserved += size < sampleINTERVAL ? size : sampleINTERVAL;
     MPS_RESERVE_BLOCK(res, *p, ap, size);
     if(res != MPS_RES_OK)
       return res;
+    if (zeroed) {
+      check_zeroed(*p, size);
+      memset(*p, 0xA5, size);
+    }
   } while(!mps_commit(ap, *p, size));
 
   return MPS_RES_OK;
 }
 
 
-/* check_allocated_size -- check the allocated size of the pool */
+/* check_allocated_size -- check the allocated size of the pool
+ *
+ * When allocation sampling is on, the allocation point's limit may be
+ * lowered to the next sample point, so the buffer may hold more free
+ * memory than ap_free. See <code/buffer.c#sample>.
+ */
 
 static void check_allocated_size(mps_pool_t pool, mps_ap_t ap, size_t allocated)
 {
   size_t total_size = mps_pool_total_size(pool);
   size_t free_size = mps_pool_free_size(pool);
   size_t ap_free = (size_t)((char *)ap->limit - (char *)ap->init);
-  Insist(total_size - free_size == allocated + ap_free);
+  if (sampling)
+    Insist(total_size - free_size >= allocated + ap_free);
+  else
+    Insist(total_size - free_size == allocated + ap_free);
 }
 
 
@@ -68,17 +112,21 @@ static mps_res_t stress(mps_arena_t arena, mps_pool_debug_option_s *options,
   size_t ss[testSetSIZE];
   size_t allocated = 0;         /* Total allocated memory */
   size_t debugOverhead = options ? 2 * alignUp(options->fence_size, align) : 0;
+  mps_bool_t zeroed = rnd() % 2;
 
-  printf("stress %s\n", name);
+  printf("stress %s%s\n", name, zeroed ? " zeroed" : "");
 
   die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
-  die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
+  MPS_ARGS_BEGIN(apArgs) {
+    MPS_ARGS_ADD(apArgs, MPS_KEY_AP_ZEROED, zeroed);
+    die(mps_ap_create_k(&ap, pool, apArgs), "BufferCreate");
+  } MPS_ARGS_END(apArgs);
 
   /* allocate a load of objects */
   for (i=0; i<testSetSIZE; ++i) {
     mps_addr_t obj;
     ss[i] = (*size)(i, align);
-    res = make(&obj, ap, ss[i]);
+    res = make(&obj, ap, ss[i], zeroed);
     if (res != MPS_RES_OK)
       goto allocFail;
     ps[i] = obj;
@@ -123,7 +171,7 @@ static mps_res_t stress(mps_arena_t arena, mps_pool_debug_option_s *options,
     for (i=testSetSIZE/2; i<testSetSIZE; ++i) {
       mps_addr_t obj;
       ss[i] = (*size)(i, align);
-      res = make(&obj, ap, ss[i]);
+      res = make(&obj, ap, ss[i], zeroed);
       if (res != MPS_RES_OK)
         goto allocFail;
       ps[i] = obj;
@@ -168,15 +216,20 @@ static mps_pool_debug_option_s fenceOptions = {
 
 
 /* test -- create arena using given class and arguments; test all the
- * pool classes in this arena
+ * pool classes in this arena, with allocation sampling if requested
  */
 
 static void test(mps_arena_class_t arena_class, mps_arg_s arena_args[],
                  size_t arena_grain_size,
-                 mps_pool_debug_option_s *options)
+                 mps_pool_debug_option_s *options,
+                 mps_bool_t sample_alloc)
 {
   mps_arena_t arena;
   die(mps_arena_create_k(&arena, arena_class, arena_args), "mps_arena_create");
+  reserved = sampledReserved = samples = 0;
+  sampling = sample_alloc;
+  if (sampling)
+    mps_arena_alloc_sample_set(arena, sampleINTERVAL, sample, &samples);
 
   (void)arena_grain_size; /* TODO: test larger alignments up to this */
 
@@ -204,6 +257,19 @@ static void test(mps_arena_class_t arena_class, mps_arg_s arena_args[],
 
   /* Manual allocation should not cause any garbage collections. */
   Insist(mps_collections(arena) == 0);
+
+  /* The interval between samples is between half and one and a half
+     times sampleINTERVAL, but each allocation point's last interval
+     is incomplete. See <code/buffer.c#sample.random>. */
+  if (sampling) {
+    printf("%lu samples in %lu bytes\n",
+           (unsigned long)samples, (unsigned long)reserved);
+    Insist(samples >= sampledReserved / sampleINTERVAL / 2);
+    Insist(samples <= reserved / sampleINTERVAL * 2 + 2);
+    mps_arena_alloc_sample_set(arena, 0, NULL, NULL);
+  } else {
+    Insist(samples == 0);
+  }
   mps_arena_destroy(arena);
 }
 
@@ -219,7 +285,8 @@ int main(int argc, char *argv[])
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, 2 * testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_COMMIT_LIMIT, testArenaSIZE);
-    test(mps_arena_class_vm(), args, arena_grain_size, &fenceOptions);
+    test(mps_arena_class_vm(), args, arena_grain_size, &fenceOptions,
+         FALSE);
   } MPS_ARGS_END(args);
 
   arena_grain_size = rnd_grain(2 * testArenaSIZE);
@@ -227,7 +294,8 @@ int main(int argc, char *argv[])
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, 2 * testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, FALSE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, arena_grain_size);
-    test(mps_arena_class_vm(), args, arena_grain_size, &bothOptions);
+    test(mps_arena_class_vm(), args, arena_grain_size, &bothOptions,
+         TRUE);
   } MPS_ARGS_END(args);
 
   arena_grain_size = rnd_grain(testArenaSIZE);
@@ -236,7 +304,8 @@ int main(int argc, char *argv[])
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, FALSE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_CL_BASE, malloc(testArenaSIZE));
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, arena_grain_size);
-    test(mps_arena_class_cl(), args, arena_grain_size, &bothOptions);
+    test(mps_arena_class_cl(), args, arena_grain_size, &bothOptions,
+         TRUE);
   } MPS_ARGS_END(args);
 
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
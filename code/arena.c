@@ -90,6 +90,37 @@ static Bool ArenaNoChunkPageMapped(Chunk chunk, Index index)
   return FALSE;
 }
 
+static Res ArenaNoBind(Arena arena, Addr base, Addr limit, Index node)
+{
+  UNUSED(arena);
+  UNUSED(base);
+  UNUSED(limit);
+  UNUSED(node);
+  return ResUNIMPL;
+}
+
+static Index ArenaNoCurrentNode(Arena arena)
+{
+  UNUSED(arena);
+  return NodeNONE;
+}
+
+static Size ArenaNoPrecommit(Arena arena, Addr base, Addr limit)
+{
+  UNUSED(arena);
+  UNUSED(base);
+  UNUSED(limit);
+  return 0;
+}
+
+static Bool ArenaNoZeroed(Arena arena, Addr base, Addr limit)
+{
+  UNUSED(arena);
+  UNUSED(base);
+  UNUSED(limit);
+  return FALSE;
+}
+
 static Res ArenaNoCreate(Arena *arenaReturn, ArgList args)
 {
   UNUSED(arenaReturn);
@@ -132,6 +163,10 @@ DEFINE_CLASS(Arena, AbstractArena, klass)
   klass->compact = ArenaTrivCompact;
   klass->pagesMarkAllocated = ArenaNoPagesMarkAllocated;
   klass->chunkPageMapped = ArenaNoChunkPageMapped;
+  klass->bind = ArenaNoBind;
+  klass->currentNode = ArenaNoCurrentNode;
+  klass->precommit = ArenaNoPrecommit;
+  klass->zeroed = ArenaNoZeroed;
   klass->sig = ArenaClassSig;
   AVERT(ArenaClass, klass);
 }
@@ -156,6 +191,10 @@ Bool ArenaClassCheck(ArenaClass klass)
   CHECKL(FUNCHECK(klass->compact));
   CHECKL(FUNCHECK(klass->pagesMarkAllocated));
   CHECKL(FUNCHECK(klass->chunkPageMapped));
+  CHECKL(FUNCHECK(klass->bind));
+  CHECKL(FUNCHECK(klass->currentNode));
+  CHECKL(FUNCHECK(klass->precommit));
+  CHECKL(FUNCHECK(klass->zeroed));
 
   /* Check that arena classes override sets of related methods. */
   CHECKL((klass->init == ArenaAbsInit)
@@ -193,6 +232,9 @@ Bool ArenaCheck(Arena arena)
   CHECKL(0.0 <= arena->spare);
   CHECKL(arena->spare <= 1.0);
   CHECKL(0.0 <= arena->pauseTime);
+  if (arena->sampleFun != NULL)
+    CHECKL(FUNCHECK(arena->sampleFun));
+  CHECKL(0.0 <= arena->precommitRate);
 
   CHECKL(arena->zoneShift == ZoneShiftUNSET
          || ShiftCheck(arena->zoneShift));
@@ -216,6 +258,8 @@ Bool ArenaCheck(Arena arena)
   CHECKL(TreeCheck(ArenaChunkTree(arena)));
   /* TODO: check that the chunkRing and chunkTree have identical members */
   /* nothing to check for chunkSerial */
+  /* lookupReaders is changed by other threads without the arena lock,
+     and so can't be checked. See .lookup. */
 
   CHECKL(LocusCheck(arena));
 
@@ -234,10 +278,12 @@ Bool ArenaCheck(Arena arena)
 static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
 {
   Res res;
+  Index i;
   Bool zoned = ARENA_DEFAULT_ZONED;
   Size commitLimit = ARENA_DEFAULT_COMMIT_LIMIT;
   double spare = ARENA_SPARE_DEFAULT;
   double pauseTime = ARENA_DEFAULT_PAUSE_TIME;
+  Size precommit = ARENA_PRECOMMIT_DEFAULT;
   mps_arg_s arg;
 
   AVER(arena != NULL);
@@ -258,6 +304,8 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     spare = arg.val.d;
   if (ArgPick(&arg, args, MPS_KEY_PAUSE_TIME))
     pauseTime = arg.val.d;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_PRECOMMIT))
+    precommit = arg.val.size;
 
   /* Superclass init */
   InstInit(CouldBeA(Inst, arena));
@@ -268,6 +316,14 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->spareCommitted = (Size)0;
   arena->spare = spare;
   arena->pauseTime = pauseTime;
+  arena->sampleInterval = 0;
+  arena->sampleFun = NULL;
+  arena->sampleClosure = NULL;
+  arena->precommit = precommit;
+  arena->precommitRate = 0.0;
+  arena->precommitFilled = 0.0;
+  arena->precommitClock = ClockNow();
+  arena->precommitZones = ZoneSetEMPTY;
   arena->grainSize = grainSize;
   /* zoneShift must be overridden by arena class init */
   arena->zoneShift = ZoneShiftUNSET;
@@ -276,12 +332,16 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->lastTractBase = NULL;
   arena->hasFreeLand = FALSE;
   arena->freeZones = ZoneSetUNIV;
+  for (i = 0; i < MPS_WORD_WIDTH; ++i)
+    arena->zoneSize[i] = 0;
   arena->zoned = zoned;
 
   arena->primary = NULL;
   RingInit(ArenaChunkRing(arena));
   arena->chunkTree = TreeEMPTY;
   arena->chunkSerial = (Serial)0;
+  arena->lookupReaders = 0;
+  arena->lookupExcluded = 0;
 
   LocusInit(arena);
 
@@ -339,6 +399,7 @@ ARG_DEFINE_KEY(ARENA_ZONED, Bool);
 ARG_DEFINE_KEY(COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(SPARE_COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(PAUSE_TIME, double);
+ARG_DEFINE_KEY(ARENA_PRECOMMIT, Size);
 
 static Res arenaFreeLandInit(Arena arena)
 {
@@ -564,6 +625,8 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "commitLimit      $W\n", (WriteFW)arena->commitLimit,
                "spareCommitted   $W\n", (WriteFW)arena->spareCommitted,
                "spare            $D\n", (WriteFD)arena->spare,
+               "precommit        $W\n", (WriteFW)arena->precommit,
+               "precommitRate    $D\n", (WriteFD)arena->precommitRate,
                "zoneShift        $U\n", (WriteFU)arena->zoneShift,
                "grainSize        $W\n", (WriteFW)arena->grainSize,
                "lastTract        $P\n", (WriteFP)arena->lastTract,
@@ -746,12 +809,14 @@ void ArenaChunkInsert(Arena arena, Chunk chunk)
   AVERT(Chunk, chunk);
   tree = &chunk->chunkTree;
 
+  ArenaLookupExclude(arena);
   inserted = TreeInsert(&updatedTree, ArenaChunkTree(arena),
                         tree, ChunkKey(tree), ChunkCompare);
   AVER(inserted);
   AVER(updatedTree);
   TreeBalance(&updatedTree);
   arena->chunkTree = updatedTree;
+  ArenaLookupAllow(arena);
   RingAppend(ArenaChunkRing(arena), &chunk->arenaRing);
 
   arena->reserved += ChunkReserved(chunk);
@@ -1057,6 +1122,7 @@ Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
                                  ZoneSetOfRange(arena,
                                                 RangeBase(&range),
                                                 RangeLimit(&range)));
+  ZoneSizeAdd(arena->zoneSize, arena, RangeBase(&range), RangeLimit(&range));
 
   *tractReturn = PageTract(ChunkPage(chunk, baseIndex));
   return ResOK;
@@ -1099,6 +1165,16 @@ Res ArenaAlloc(Addr *baseReturn, LocusPref pref, Size size, Pool pool)
   arena->lastTract = tract;
   arena->lastTractBase = base;
 
+  if (arena->precommit > 0)
+    arena->precommitZones = ZoneSetUnion(arena->precommitZones,
+                                         ZoneSetOfRange(arena, base,
+                                                        AddrAdd(base, size)));
+
+  /* See <code/buffer.c#numa>.  Binding is a preference, so failure is
+     ignored. */
+  if (pref->node != NodeNONE)
+    (void)ArenaBind(arena, base, AddrAdd(base, size), pref->node);
+
   EVENT5(ArenaAlloc, arena, tract, base, size, pool);
 
   *baseReturn = base;
@@ -1117,6 +1193,7 @@ void ArenaFree(Addr base, Size size, Pool pool)
   Arena arena;
   RangeStruct range, oldRange;
   Res res;
+  ZoneSet emptied;
 
   AVERT(Pool, pool);
   AVER(base != NULL);
@@ -1143,6 +1220,14 @@ void ArenaFree(Addr base, Size size, Pool pool)
     if (RangeIsEmpty(&range))
       goto done;
   }
+
+  /* Zones that no longer contain any allocated memory can be handed
+   * out again. See <code/policy.c#zone.recycle>. The part of the
+   * range stolen by LandInsertSteal, if any, remains allocated. */
+  emptied = ZoneSizeSub(arena->zoneSize, arena,
+                        RangeBase(&range), RangeLimit(&range));
+  arena->freeZones = ZoneSetUnion(arena->freeZones, emptied);
+
   Method(Arena, arena, free)(RangeBase(&range), RangeSize(&range), pool);
 
 done:
@@ -1209,6 +1294,36 @@ void ArenaSetPauseTime(Arena arena, double pauseTime)
   EVENT2(PauseTimeSet, arena, pauseTime);
 }
 
+
+/* ArenaSetAllocSample -- set the allocation sampling interval
+ *
+ * Every mutator buffer starts a new countdown, so that the new
+ * interval takes effect at once. See <code/buffer.c#sample>.
+ */
+
+void ArenaSetAllocSample(Arena arena, Size interval,
+                         mps_alloc_sample_t fun, void *closure)
+{
+  Ring nodep, nextp;
+
+  AVERT(Arena, arena);
+  if (fun != NULL)
+    AVER(FUNCHECK(fun));
+  /* Can't check closure */
+
+  arena->sampleInterval = interval;
+  arena->sampleFun = fun;
+  arena->sampleClosure = closure;
+
+  RING_FOR(nodep, &ArenaGlobals(arena)->poolRing, nextp) {
+    Pool pool = RING_ELT(Pool, arenaRing, nodep);
+    Ring nodeb, nextb;
+    RING_FOR(nodeb, &pool->bufferRing, nextb) {
+      BufferSampleReset(RING_ELT(Buffer, poolRing, nodeb));
+    }
+  }
+}
+
 /* Used by arenas which don't use spare committed memory */
 Size ArenaNoPurgeSpare(Arena arena, Size size)
 {
@@ -1354,6 +1469,191 @@ static void ArenaTrivCompact(Arena arena, Trace trace)
 }
 
 
+/* ArenaBind -- ask for a range of arena memory to live on a memory node
+ *
+ * This is only a preference: arena classes that cannot place memory
+ * return ResUNIMPL, and callers should carry on regardless.  Pages
+ * that are already resident stay where they are.  See
+ * <code/buffer.c#numa>.
+ */
+
+Res ArenaBind(Arena arena, Addr base, Addr limit, Index node)
+{
+  AVERT(Arena, arena);
+  AVER(base < limit);
+  AVER(AddrIsArenaGrain(base, arena));
+  AVER(AddrIsArenaGrain(limit, arena));
+  return Method(Arena, arena, bind)(arena, base, limit, node);
+}
+
+
+/* ArenaCurrentNode -- the memory node the current thread runs on
+ *
+ * Returns NodeNONE if the arena can't place memory on nodes, or if
+ * there is only one node, so there is nothing to prefer.  See
+ * <code/buffer.c#numa>.
+ */
+
+Index ArenaCurrentNode(Arena arena)
+{
+  AVERT(Arena, arena);
+  return Method(Arena, arena, currentNode)(arena);
+}
+
+
+/* ArenaZeroed -- take knowledge that a range of arena memory is zero
+ *
+ * Returns TRUE if the arena knows that every byte of the range, which
+ * must have just been allocated, still contains zero because nothing
+ * has written to it since it was mapped.  The arena then forgets
+ * this, since the caller is about to hand the memory out.  Arena
+ * classes that don't keep track return FALSE.  See
+ * <code/buffer.c#zeroed>.
+ */
+
+Bool ArenaZeroed(Arena arena, Addr base, Addr limit)
+{
+  AVERT(Arena, arena);
+  AVER(base < limit);
+  AVER(AddrIsArenaGrain(base, arena));
+  AVER(AddrIsArenaGrain(limit, arena));
+  return Method(Arena, arena, zeroed)(arena, base, limit);
+}
+
+
+/* ArenaPrecommit -- keep some mapped memory ready for allocation
+ *
+ * Called from ArenaStep, in the client's idle time.  Samples the rate
+ * at which buffers are being filled, and if the spare committed
+ * memory would not last ARENA_PRECOMMIT_HORIZON at that rate, asks
+ * the arena class to map (and fault in) more, up to arena->precommit.
+ * The headroom is only topped up once it falls below half the target,
+ * so that mapping happens in reasonably large pieces.  It stays within
+ * both the commit limit and the spare commit limit, so that the next
+ * ArenaFree doesn't purge it again.  See <design/arena#.precommit>.
+ */
+
+typedef struct ArenaPrecommitClosureStruct {
+  Arena arena;
+  ZoneSet zones;                /* zones to map memory in */
+  Size want;                    /* amount of memory still wanted */
+  Count count;                  /* number of ranges found */
+  RangeStruct range[ARENA_PRECOMMIT_RANGES];
+} ArenaPrecommitClosureStruct, *ArenaPrecommitClosure;
+
+/* arenaPrecommitVisit -- find where the next allocations will go
+ *
+ * The allocator takes the lowest free address in the preferred zones
+ * (see PolicyAlloc), so visit the free land in address order and pick
+ * out the parts of each free range that lie in the zones recently
+ * allocated in.  The ranges are only collected here, because mapping
+ * them may need to modify the free land.
+ */
+
+static Bool arenaPrecommitVisit(Land land, Range range, void *closure)
+{
+  ArenaPrecommitClosure cl = closure;
+  Arena arena = cl->arena;
+  Size stripe = (Size)1 << arena->zoneShift;
+  Addr base = RangeBase(range), limit;
+
+  UNUSED(land);
+
+  while (base < RangeLimit(range) && cl->want > 0) {
+    limit = AddrAdd(AddrAlignDown(base, stripe), stripe);
+    if (limit <= base || limit > RangeLimit(range))
+      limit = RangeLimit(range);
+    if (ZoneSetHasAddr(arena, cl->zones, base)) {
+      if (AddrOffset(base, limit) > cl->want)
+        limit = AddrAdd(base, cl->want);
+      if (cl->count > 0 && RangeLimit(&cl->range[cl->count - 1]) == base) {
+        RangeSetLimit(&cl->range[cl->count - 1], limit);
+      } else {
+        if (cl->count == ARENA_PRECOMMIT_RANGES)
+          return FALSE;
+        RangeInit(&cl->range[cl->count], base, limit);
+        ++cl->count;
+      }
+      cl->want -= AddrOffset(base, limit);
+    }
+    base = limit;
+  }
+  return cl->want > 0;
+}
+
+void ArenaPrecommit(Arena arena)
+{
+  Globals globals;
+  Clock now;
+  double filled, interval, target;
+  Size want, spareMax;
+  ArenaPrecommitClosureStruct closure;
+  Land land;
+  Index i;
+
+  AVERT(Arena, arena);
+
+  if (arena->precommit == 0)
+    return;
+
+  globals = ArenaGlobals(arena);
+  now = ClockNow();
+  if (now <= arena->precommitClock)
+    return;
+  filled = globals->fillMutatorSize + globals->fillInternalSize;
+  interval = (double)(now - arena->precommitClock) / (double)ClocksPerSec();
+  arena->precommitRate += ((filled - arena->precommitFilled) / interval
+                           - arena->precommitRate) * ARENA_PRECOMMIT_WEIGHT;
+  arena->precommitClock = now;
+  arena->precommitFilled = filled;
+  closure.zones = arena->precommitZones;
+  arena->precommitZones = ZoneSetEMPTY;
+
+  target = arena->precommitRate * ARENA_PRECOMMIT_HORIZON;
+  if (target > (double)arena->precommit)
+    target = (double)arena->precommit;
+  want = SizeArenaGrains((Size)target, arena);
+  if (arena->spareCommitted >= want / 2)
+    return;
+  want -= arena->spareCommitted;
+
+  spareMax = ArenaSpareCommitLimit(arena);
+  if (arena->spareCommitted >= spareMax)
+    return;
+  if (want > spareMax - arena->spareCommitted)
+    want = spareMax - arena->spareCommitted;
+  if (arena->committed >= arena->commitLimit)
+    return;
+  if (want > arena->commitLimit - arena->committed)
+    want = arena->commitLimit - arena->committed;
+  want = SizeAlignDown(want, ArenaGrainSize(arena));
+  if (want == 0 || closure.zones == ZoneSetEMPTY || !arena->hasFreeLand)
+    return;
+
+  closure.arena = arena;
+  closure.want = want;
+  closure.count = 0;
+  land = ArenaFreeLand(arena);
+  (void)LandIterate(land, arenaPrecommitVisit, &closure);
+  if (closure.want > 0 && closure.count < ARENA_PRECOMMIT_RANGES) {
+    /* Not enough free memory in those zones, so the next allocations
+       will extend the arena: do that now instead. */
+    LocusPrefStruct pref;
+    LocusPrefInit(&pref);
+    LocusPrefExpress(&pref, LocusPrefZONESET, &closure.zones);
+    if (Method(Arena, arena, grow)(arena, &pref, closure.want) == ResOK) {
+      closure.want = want;
+      closure.count = 0;
+      (void)LandIterate(land, arenaPrecommitVisit, &closure);
+    }
+  }
+  for (i = 0; i < closure.count; ++i)
+    (void)Method(Arena, arena, precommit)(arena,
+                                          RangeBase(&closure.range[i]),
+                                          RangeLimit(&closure.range[i]));
+}
+
+
 /* Has Addr */
 
 Bool ArenaHasAddr(Arena arena, Addr addr)
@@ -1365,6 +1665,128 @@ Bool ArenaHasAddr(Arena arena, Addr addr)
 }
 
 
+/* ArenaLookupExclude, ArenaLookupAllow -- exclude lock-free lookups
+ *
+ * .lookup: <code/mpsi.c#.addr.lockfree> looks up addresses in the
+ * chunk tree and page tables without claiming the arena lock. Code
+ * that changes the chunk tree, or unmaps chunk memory or page
+ * descriptors, must do so between calls to ArenaLookupExclude and
+ * ArenaLookupAllow, while holding the arena lock. These calls nest.
+ *
+ * .lookup.protocol: A lookup increments lookupReaders and then reads
+ * lookupExcluded; the outermost ArenaLookupExclude sets
+ * lookupExcluded and then waits for lookupReaders to fall to zero.
+ * Because the operations are sequentially consistent, either the
+ * lookup sees the exclusion and gives up without reading the tables,
+ * or the exclusion waits for the lookup to finish. A lookup reads a
+ * handful of words, so the wait is short, and new lookups don't
+ * prolong it. The waiting thread yields, in case the lookup's thread
+ * is waiting for the processor.
+ *
+ * .lookup.fork: In the child of a fork, the lookups in progress in
+ * the parent's other threads will never finish, so the counts are
+ * reset. See <code/global.c#arenaReinitLock>.
+ *
+ * .lookup.suspend: The wait would never end if the lookup were in a
+ * thread suspended by the shield, so the shield excludes lookups
+ * before it suspends the mutator, and allows them after resuming it.
+ * See <code/shield.c#.lookup>. Exclusions made while the mutator is
+ * suspended are therefore nested, and don't wait.
+ */
+
+void ArenaLookupExclude(Arena arena)
+{
+  /* The arena may be briefly invalid while a chunk is destroyed. */
+  AVER(TESTT(Arena, arena));
+  if (arena->lookupExcluded > 0) {
+    ++arena->lookupExcluded;
+    AVER(arena->lookupExcluded > 0); /* overflow */
+    return;
+  }
+#if defined(ATOMIC_LOAD)
+  ATOMIC_STORE(&arena->lookupExcluded, 1);
+  while (ATOMIC_LOAD(&arena->lookupReaders) != 0)
+    ThreadYield();
+#else
+  arena->lookupExcluded = 1;
+#endif
+}
+
+void ArenaLookupAllow(Arena arena)
+{
+  /* The arena may be briefly invalid while a chunk is destroyed. */
+  AVER(TESTT(Arena, arena));
+  AVER(arena->lookupExcluded > 0);
+  if (arena->lookupExcluded > 1) {
+    --arena->lookupExcluded;
+    return;
+  }
+#if defined(ATOMIC_LOAD)
+  ATOMIC_STORE(&arena->lookupExcluded, 0);
+#else
+  arena->lookupExcluded = 0;
+#endif
+}
+
+
+/* ArenaLookupPool -- find the pool owning an address, without the lock
+ *
+ * Returns TRUE if the lookup was made, setting *poolReturn to the
+ * pool owning the address, or NULL if it is not in an allocated
+ * tract. Returns FALSE if the lookup could not be made because the
+ * tables are being changed, or because the compiler doesn't provide
+ * atomic operations, in which case the caller must claim the arena
+ * lock and call PoolOfAddr. See .lookup.
+ *
+ * This can't check the arena or use TractOfAddr: other threads may be
+ * changing the arena, so its invariants need not hold.
+ */
+
+Bool ArenaLookupPool(Pool *poolReturn, Arena arena, Addr addr)
+{
+#if defined(ATOMIC_LOAD)
+  Tree tree;
+  Pool pool = NULL;
+
+  AVER_CRITICAL(poolReturn != NULL);
+  AVER_CRITICAL(TESTT(Arena, arena));
+  /* addr is arbitrary */
+
+  ATOMIC_INCREMENT(&arena->lookupReaders);
+  if (ATOMIC_LOAD(&arena->lookupExcluded) != 0) {
+    ATOMIC_DECREMENT(&arena->lookupReaders);
+    return FALSE;
+  }
+
+  tree = ArenaChunkTree(arena);
+  while (tree != TreeEMPTY) {
+    Chunk chunk = ChunkOfTree(tree);
+    if (addr < chunk->base) {
+      tree = TreeLeft(tree);
+    } else if (addr >= chunk->limit) {
+      tree = TreeRight(tree);
+    } else {
+      /* Descriptors of free pages may be unmapped, so only read the
+         descriptor if the page is allocated. */
+      Index i = INDEX_OF_ADDR(chunk, addr);
+      if (BTGet(chunk->allocTable, i))
+        pool = PagePool(ChunkPage(chunk, i));
+      break;
+    }
+  }
+
+  ATOMIC_DECREMENT(&arena->lookupReaders);
+  *poolReturn = pool;
+  return TRUE;
+#else
+  UNUSED(poolReturn);
+  UNUSED(arena);
+  UNUSED(addr);
+  return FALSE;
+#endif
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
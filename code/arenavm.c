@@ -45,6 +45,7 @@ typedef struct VMChunkStruct {
   VMStruct vmStruct;            /* virtual memory descriptor */
   Addr overheadMappedLimit;     /* limit of pages mapped for overhead */
   SparseArrayStruct pages;      /* to manage backing store of page table */
+  BT zeroed;                    /* pages known to contain zeros, .zeroed */
   Sig sig;                      /* <design/sig> */
 } VMChunkStruct;
 
@@ -118,6 +119,9 @@ static Bool VMChunkCheck(VMChunk vmchunk)
   CHECKL(chunk->base < (Addr)vmchunk->pages.pages);
   CHECKL(AddrAdd(vmchunk->pages.pages, BTSize(chunk->pageTablePages)) <=
          vmchunk->overheadMappedLimit);
+  CHECKL(chunk->base < (Addr)vmchunk->zeroed);
+  CHECKL(AddrAdd(vmchunk->zeroed, BTSize(chunk->pages)) <=
+         vmchunk->overheadMappedLimit);
   /* .improve.check-table: Could check the consistency of the tables. */
 
   return TRUE;
@@ -368,7 +372,7 @@ static Res VMChunkInit(Chunk chunk, BootBlock boot)
   Addr overheadLimit;
   void *p;
   Res res;
-  BT saMapped, saPages;
+  BT saMapped, saPages, zeroed;
 
   /* chunk is supposed to be uninitialized, so don't check it. */
   vmChunk = Chunk2VMChunk(chunk);
@@ -386,6 +390,12 @@ static Res VMChunkInit(Chunk chunk, BootBlock boot)
     goto failSaPages;
   saPages = p;
 
+  /* .overhead.zeroed: Chunk overhead for the table of zeroed pages. */
+  res = BootAlloc(&p, boot, BTSize(chunk->pages), MPS_PF_ALIGN);
+  if (res != ResOK)
+    goto failZeroed;
+  zeroed = p;
+
   overheadLimit = AddrAdd(chunk->base, (Size)BootAllocated(boot));
 
   /* .overhead.page-table: Put the page table as late as possible, as
@@ -410,6 +420,8 @@ static Res VMChunkInit(Chunk chunk, BootBlock boot)
                   sizeof(PageUnion),
                   chunk->pages,
                   saMapped, saPages, VMChunkVM(vmChunk));
+  vmChunk->zeroed = zeroed;
+  BTResRange(vmChunk->zeroed, 0, chunk->pages);
 
   return ResOK;
 
@@ -417,6 +429,7 @@ static Res VMChunkInit(Chunk chunk, BootBlock boot)
 failTableMap:
 failSaPages:
 failAllocPageTable:
+failZeroed:
 failSaMapped:
   return res;
 }
@@ -547,6 +560,9 @@ static Res vmArenaChunkSize(Size *chunkSizeReturn, VMArena vmArena, Size size)
     /* See .overhead.sa-mapped. */
     overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
 
+    /* See .overhead.zeroed. */
+    overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
+
     /* See .overhead.sa-pages. */
     pageTableSize = SizeAlignUp(pages * sizeof(PageUnion), grainSize);
     pageTablePages = pageTableSize >> grainShift;
@@ -891,7 +907,9 @@ static void spareRangeRelease(VMChunk vmChunk, Index piBase, Index piLimit)
     /* Range could not be deleted from the spare memory land because
        it splits the containing range and so needs to allocate a
        block but the block pool is full. Use the first grain of the
-       containing range to extend the block pool. */
+       containing range to extend the block pool. The grain is free,
+       so it must also be removed from the arena's free land, as in
+       VMFree, or it would be allocated again. */
     Addr extendBase = RangeBase(&containingRange);
     Index extendBasePI = INDEX_OF_ADDR(chunk, extendBase);
     Addr extendLimit = AddrAdd(extendBase, ArenaGrainSize(arena));
@@ -899,12 +917,24 @@ static void spareRangeRelease(VMChunk vmChunk, Index piBase, Index piLimit)
     AVER(res == ResLIMIT);
     RangeInit(&extendRange, extendBase, extendLimit);
     AVER(!RangesOverlap(&extendRange, &range));
-    res = LandDelete(&containingRange, spareLand, &extendRange);
-    AVER(res == ResOK);
+    res = ArenaFreeLandDelete(arena, extendBase, extendLimit);
+    if (res == ResOK) {
+      res = LandDelete(&containingRange, spareLand, &extendRange);
+      AVER(res == ResOK);
+      PageAlloc(chunk, extendBasePI, VMArenaCBSBlockPool(vmArena));
+      MFSExtend(VMArenaCBSBlockPool(vmArena), extendBase, extendLimit);
+    } else {
+      /* The grain can't be removed from the free land either, so
+         unmap the spare memory below the range instead. Then the
+         range no longer splits the containing range. */
+      RangeInit(&extendRange, extendBase, RangeBase(&range));
+      res = LandDelete(&containingRange, spareLand, &extendRange);
+      AVER(res == ResOK);
+      chunkUnmapRange(chunk, RangeBase(&extendRange),
+                      RangeLimit(&extendRange));
+    }
     AVER(arena->spareCommitted >= RangeSize(&extendRange));
     arena->spareCommitted -= RangeSize(&extendRange);
-    PageAlloc(chunk, extendBasePI, VMArenaCBSBlockPool(vmArena));
-    MFSExtend(VMArenaCBSBlockPool(vmArena), extendBase, extendLimit);
     res = LandDelete(&containingRange, spareLand, &range);
     AVER(res == ResOK);
   }
@@ -929,7 +959,9 @@ static void pageDescUnmap(VMChunk vmChunk, Index basePI, Index limitPI)
   Size size, after;
   Size before = VMMapped(VMChunkVM(vmChunk));
   Arena arena = MustBeA(AbstractArena, VMChunkVMArena(vmChunk));
+  ArenaLookupExclude(arena); /* <code/arena.c#.lookup> */
   SparseArrayUnmap(&vmChunk->pages, basePI, limitPI);
+  ArenaLookupAllow(arena);
   after = VMMapped(VMChunkVM(vmChunk));
   AVER(after <= before);
   size = before - after;
@@ -972,6 +1004,8 @@ static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
       PageInit(chunk, i);
       PageAlloc(chunk, i, pool);
     }
+    if (VMMapZeroes())
+      BTSetRange(vmChunk->zeroed, j, k);
     cursor = k;
     if (cursor == limitPI)
       return ResOK;
@@ -1041,6 +1075,155 @@ static Bool VMChunkPageMapped(Chunk chunk, Index index)
 }
 
 
+/* VMArenaBind -- place a range of memory on a memory node
+ *
+ * The range must lie within one chunk and be mapped, which is true
+ * of the memory of any segment.  See <design/vm#.if.bind>.
+ */
+
+static Res VMArenaBind(Arena arena, Addr base, Addr limit, Index node)
+{
+  Chunk chunk;
+  Bool foundChunk;
+
+  foundChunk = ChunkOfAddr(&chunk, arena, base);
+  AVER(foundChunk);
+  AVER(limit <= chunk->limit);
+  return VMBind(VMChunkVM(Chunk2VMChunk(chunk)), base, limit, node);
+}
+
+
+/* VMArenaCurrentNode -- the memory node of the current thread
+ *
+ * See <design/vm#.if.node.current>.  A single-node machine has
+ * nothing to prefer.
+ */
+
+static Index VMArenaCurrentNode(Arena arena)
+{
+  AVERT(Arena, arena);
+  if (VMNodeCount() <= 1)
+    return NodeNONE;
+  return VMCurrentNode();
+}
+
+
+/* VMArenaZeroed -- take knowledge that allocated pages are zero
+ *
+ * .zeroed: The zeroed table of a chunk has a bit set for each page
+ * that was freshly mapped (or precommitted) and hasn't been freed
+ * since.  Such a page contains zeros unless it has been handed out:
+ * so bits are reset here, when the pages are handed out, and in
+ * VMFree, in case the pages were handed out without asking.  The
+ * range must lie within one chunk, which is true of the memory of any
+ * segment.  See <code/buffer.c#zeroed>.
+ */
+
+static Bool VMArenaZeroed(Arena arena, Addr base, Addr limit)
+{
+  Chunk chunk;
+  VMChunk vmChunk;
+  Index basePI, limitPI;
+  Bool foundChunk, zeroed;
+
+  foundChunk = ChunkOfAddr(&chunk, arena, base);
+  AVER(foundChunk);
+  AVER(limit <= chunk->limit);
+  vmChunk = Chunk2VMChunk(chunk);
+  basePI = INDEX_OF_ADDR(chunk, base);
+  limitPI = INDEX_OF_ADDR(chunk, limit);
+  zeroed = BTIsSetRange(vmChunk->zeroed, basePI, limitPI);
+  BTResRange(vmChunk->zeroed, basePI, limitPI);
+  return zeroed;
+}
+
+
+/* VMArenaPrecommit -- map free memory ahead of allocation
+ *
+ * Maps and faults in the unmapped pages in a free range of the arena,
+ * and adds them to the spare memory land, where pagesMarkAllocated
+ * will find them already mapped.  Stops early if mapping fails.
+ * Returns the amount mapped.  See <design/arena#.precommit>.
+ */
+
+static Size VMArenaPrecommit(Arena arena, Addr base, Addr limit)
+{
+  VMArena vmArena = MustBeA(VMArena, arena);
+  Land spareLand = VMArenaSpareLand(vmArena);
+  Size done = 0;
+
+  AVER(base < limit);
+  AVER(AddrIsArenaGrain(base, arena));
+  AVER(AddrIsArenaGrain(limit, arena));
+
+  while (base < limit) {
+    Chunk chunk = NULL;         /* suppress "may be used uninitialized" */
+    VMChunk vmChunk;
+    Index basePI, limitPI, cursor, chunkLimitPI, i;
+    Bool foundChunk;
+
+    foundChunk = ChunkOfAddr(&chunk, arena, base);
+    AVER(foundChunk);
+    vmChunk = Chunk2VMChunk(chunk);
+    cursor = INDEX_OF_ADDR(chunk, base);
+    chunkLimitPI = limit < chunk->limit ? INDEX_OF_ADDR(chunk, limit)
+                                        : chunk->pages;
+
+    while (cursor < chunkLimitPI
+           && BTFindLongResRange(&basePI, &limitPI, vmChunk->pages.mapped,
+                                 cursor, chunkLimitPI, 1))
+    {
+      RangeStruct range, containingRange;
+      Res res;
+
+      RangeInit(&range, PageIndexBase(chunk, basePI),
+                PageIndexBase(chunk, limitPI));
+      res = pageDescMap(vmChunk, basePI, limitPI);
+      if (res != ResOK)
+        return done;
+      res = vmArenaMap(vmArena, VMChunkVM(vmChunk),
+                       RangeBase(&range), RangeLimit(&range));
+      if (res != ResOK) {
+        pageDescUnmap(vmChunk, basePI, limitPI);
+        return done;
+      }
+      for (i = basePI; i < limitPI; ++i)
+        PageInit(chunk, i);
+      res = LandInsert(&containingRange, spareLand, &range);
+      if (res != ResOK) {
+        /* The spare memory land's block pool is full: use the first
+           grain of the range to extend it, as VMFree does. */
+        Addr extendBase = RangeBase(&range);
+        Addr extendLimit = AddrAdd(extendBase, ArenaGrainSize(arena));
+        res = ArenaFreeLandDelete(arena, extendBase, extendLimit);
+        if (res != ResOK) {
+          chunkUnmapRange(chunk, RangeBase(&range), RangeLimit(&range));
+          return done;
+        }
+        PageAlloc(chunk, basePI, VMArenaCBSBlockPool(vmArena));
+        MFSExtend(VMArenaCBSBlockPool(vmArena), extendBase, extendLimit);
+        RangeSetBase(&range, extendLimit);
+        if (!RangeIsEmpty(&range)) {
+          res = LandInsert(&containingRange, spareLand, &range);
+          AVER(res == ResOK);
+        }
+      }
+      if (!RangeIsEmpty(&range)) {
+        VMPrefault(VMChunkVM(vmChunk), RangeBase(&range), RangeLimit(&range));
+        if (VMMapZeroes())
+          BTSetRange(vmChunk->zeroed, INDEX_OF_ADDR(chunk, RangeBase(&range)),
+                     limitPI);
+        arena->spareCommitted += RangeSize(&range);
+        done += RangeSize(&range);
+      }
+      cursor = limitPI;
+    }
+    base = PageIndexBase(chunk, chunkLimitPI);
+  }
+  return done;
+}
+
+
 /* vmArenaUnmapSpare -- unmap spare memory
  *
  * The size is the desired amount to unmap, and the amount that was
@@ -1155,6 +1338,7 @@ static void VMFree(Addr base, Size size, Pool pool)
     TractFinish(tract);
   }
   BTResRange(chunk->allocTable, piBase, piLimit);
+  BTResRange(Chunk2VMChunk(chunk)->zeroed, piBase, piLimit);
 
   /* Freed range is now spare memory, so add it to spare memory land. */
   RangeInitSize(&range, base, size);
@@ -1257,7 +1441,9 @@ static void VMCompact(Arena arena, Trace trace)
   /* Destroy chunks that are completely free, but not the primary
    * chunk. <design/arena#.chunk.delete>
    * TODO: add hysteresis here. See job003815. */
+  ArenaLookupExclude(arena); /* <code/arena.c#.lookup> */
   TreeTraverseAndDelete(&arena->chunkTree, vmChunkCompact, arena);
+  ArenaLookupAllow(arena);
 
   STATISTIC({
     Size vmem0 = trace->preTraceArenaReserved;
@@ -1313,6 +1499,10 @@ DEFINE_CLASS(Arena, VMArena, klass)
   klass->compact = VMCompact;
   klass->pagesMarkAllocated = VMPagesMarkAllocated;
   klass->chunkPageMapped = VMChunkPageMapped;
+  klass->bind = VMArenaBind;
+  klass->currentNode = VMArenaCurrentNode;
+  klass->precommit = VMArenaPrecommit;
+  klass->zeroed = VMArenaZeroed;
   AVERT(ArenaClass, klass);
 }
 
@@ -142,12 +142,18 @@ static mps_word_t *alloc_table(size_t n, mps_ap_t ap)
 }
 
 
-/* gets the nth slot from a table
+/* gets the nth slot from a table, through the software read barrier
+ * rb if the table pool has one
  * .assume.dylan-obj
  */
-static mps_word_t *table_slot(mps_word_t *table, size_t n)
+static mps_word_t *table_slot(mps_rb_t rb, mps_word_t *table, size_t n)
 {
-  return (mps_word_t *)table[3+n];
+  mps_addr_t ref;
+
+  if (rb == NULL)
+    return (mps_word_t *)table[3+n];
+  MPS_WEAK_REF_GET(&ref, rb, (mps_addr_t *)&table[3+n]);
+  return ref;
 }
 
 
@@ -175,6 +181,7 @@ static void table_link(mps_word_t *t1, mps_word_t *t2)
 
 typedef struct tables_s {
   mps_arena_t arena;
+  mps_rb_t rb;                          /* NULL or software read barrier */
   mps_word_t *weaktable;
   mps_word_t *exacttable;
   mps_word_t *preserve[TABLE_SLOTS];    /* preserves objects in the weak */
@@ -224,7 +231,7 @@ static void *populate(void *state)
   return NULL;
 }
 
-static void test(mps_arena_t arena,
+static void test(mps_arena_t arena, mps_rb_t rb,
                  mps_ap_t leafap, mps_ap_t exactap, mps_ap_t weakap,
                  mps_ap_t bogusap)
 {
@@ -237,6 +244,7 @@ static void test(mps_arena_t arena,
   die(mps_reserve(&p, bogusap, 64), "Reserve bogus");
 
   tables.arena = arena;
+  tables.rb = rb;
   tables.exactap = exactap;
   tables.weakap = weakap;
   tables.leafap = leafap;
@@ -251,6 +259,19 @@ static void test(mps_arena_t arena,
     for(i = 0; i < TABLE_SLOTS; ++i) {
       (void)alloc_string("spong", leafap);
     }
+    /* Read the tables through the barrier just after a flip. */
+    if (j % CHATTER == 0) {
+      die(mps_arena_start_collect(arena), "mps_arena_start_collect");
+      for(i = 0; i < TABLE_SLOTS; ++i) {
+        if (tables.preserve[i] != 0
+            && (table_slot(rb, tables.weaktable, i) != tables.preserve[i]
+                || table_slot(rb, tables.exacttable, i) == 0))
+          error("Preserved weak table entry lost, slot %"PRIuLONGEST".\n",
+                (ulongest_t)i);
+      }
+      mps_arena_park(arena);
+      mps_arena_release(arena);
+    }
   }
 
   die(mps_arena_collect(arena), "mps_arena_collect");
@@ -258,11 +279,11 @@ static void test(mps_arena_t arena,
 
   for(i = 0; i < TABLE_SLOTS; ++i) {
     if (tables.preserve[i] == 0) {
-      if (table_slot(tables.weaktable, i)) {
+      if (table_slot(rb, tables.weaktable, i)) {
         error("Strongly unreachable weak table entry found, "
               "slot %"PRIuLONGEST".\n", (ulongest_t)i);
       } else {
-        if (table_slot(tables.exacttable, i) != 0) {
+        if (table_slot(rb, tables.exacttable, i) != 0) {
           error("Weak table entry deleted, but corresponding "
                 "exact table entry not deleted, slot %"PRIuLONGEST".\n",
                 (ulongest_t)i);
@@ -280,12 +301,14 @@ static void test(mps_arena_t arena,
  * guff serves two purposes:
  *  - a pseudo stack base for the stack root.
  *  - pointer to a guff structure, which packages some values needed
- *   (arena and thr mostly)
+ *   (arena and thr mostly, and whether the table pool has a software
+ *   read barrier)
  */
 
 struct guff_s {
   mps_arena_t arena;
   mps_thr_t thr;
+  mps_bool_t soft;
 };
 
 ATTRIBUTE_NOINLINE
@@ -299,6 +322,7 @@ static void setup(struct guff_s *guff)
   mps_ap_t leafap, exactap, weakap, bogusap;
   mps_root_t stack;
   mps_thr_t thr;
+  mps_rb_t rb;
 
   arena = guff->arena;
   thr = guff->thr;
@@ -314,9 +338,21 @@ static void setup(struct guff_s *guff)
     die(mps_pool_create_k(&leafpool, arena, mps_class_lo(), args),
         "Leaf Pool Create\n");
   } MPS_ARGS_END(args);
-  die(mps_pool_create(&tablepool, arena, mps_class_awl(), dylanweakfmt,
-                      dylan_weak_dependent),
-      "Table Pool Create\n");
+  if (guff->soft) {
+    MPS_ARGS_BEGIN(args) {
+      MPS_ARGS_ADD(args, MPS_KEY_FORMAT, dylanweakfmt);
+      MPS_ARGS_ADD(args, MPS_KEY_AWL_FIND_DEPENDENT, dylan_weak_dependent);
+      MPS_ARGS_ADD(args, MPS_KEY_AWL_SOFTWARE_BARRIER, TRUE);
+      die(mps_pool_create_k(&tablepool, arena, mps_class_awl(), args),
+          "Table Pool Create (software barrier)\n");
+    } MPS_ARGS_END(args);
+    rb = mps_arena_rb(arena);
+  } else {
+    die(mps_pool_create(&tablepool, arena, mps_class_awl(), dylanweakfmt,
+                        dylan_weak_dependent),
+        "Table Pool Create\n");
+    rb = NULL;
+  }
   die(mps_ap_create(&leafap, leafpool, mps_rank_exact()),
       "Leaf AP Create\n");
   die(mps_ap_create(&exactap, tablepool, mps_rank_exact()),
@@ -326,7 +362,7 @@ static void setup(struct guff_s *guff)
   die(mps_ap_create(&bogusap, tablepool, mps_rank_exact()),
       "Bogus AP Create\n");
 
-  test(arena, leafap, exactap, weakap, bogusap);
+  test(arena, rb, leafap, exactap, weakap, bogusap);
 
   mps_ap_destroy(bogusap);
   mps_ap_destroy(weakap);
@@ -357,6 +393,9 @@ int main(int argc, char *argv[])
   die(mps_thread_reg(&thread, arena), "thread_reg");
   guff.arena = arena;
   guff.thr = thread;
+  guff.soft = FALSE;
+  setup(&guff);
+  guff.soft = TRUE;
   setup(&guff);
   mps_thread_dereg(thread);
   mps_arena_destroy(arena);
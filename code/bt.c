@@ -433,14 +433,32 @@ btFindSetLabel:; \
 /* ACTION_FIND_SET_BIT -- Find first set bit in a range
  *
  * Helper macro to find the low bit in a range of a word.
- * Works by first shifting the base of the range to the low
- * bits of the word. Then loops performing a binary chop
+ *
+ * .word.builtin: If the compiler has a builtin to count trailing
+ * zeros (see <code/config.h#WORD_CTZ>), mask the range and use it.
+ *
+ * Otherwise, work by first shifting the base of the range to the low
+ * bits of the word. Then loop performing a binary chop
  * over the data looking to see if a bit is set in the lower
  * half. If not, it must be in the upper half which is then
  * shifted down. The loop completes after using a chop unit
  * of a single single bit.
  */
 
+#if defined(WORD_CTZ)
+
+#define ACTION_FIND_SET_BIT(wi,word,base,limit,label) \
+  BEGIN \
+    Word actionWord = (word) & BTMask((base),(limit)); \
+    if (actionWord != (Word)0) { \
+      *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) | WORD_CTZ(actionWord); \
+      *bfsFoundReturn = TRUE; \
+      goto label; \
+    } \
+  END
+
+#else /* WORD_CTZ not defined */
+
 #define ACTION_FIND_SET_BIT(wi,word,base,limit,label) \
   BEGIN \
     /* no need to mask the low bits which are shifted */ \
@@ -463,6 +481,8 @@ btFindSetLabel:; \
     } \
   END
 
+#endif /* WORD_CTZ */
+
 
 /* BTFindRes -- find the lowest reset bit in a range in a bit table.
  *
@@ -547,9 +567,25 @@ btFindSetHighLabel:; \
 /* ACTION_FIND_SET_BIT_HIGH -- Find highest set bit in a range
  *
  * Helper macro to find the high bit in a range of a word.
- * Essentially a mirror image of ACTION_FIND_SET
+ * Essentially a mirror image of ACTION_FIND_SET, using a builtin to
+ * count leading zeros if there is one (see .word.builtin).
  */
 
+#if defined(WORD_CLZ)
+
+#define ACTION_FIND_SET_BIT_HIGH(wi,word,base,limit,label) \
+  BEGIN \
+    Word actionWord = (word) & BTMask((base),(limit)); \
+    if (actionWord != (Word)0) { \
+      *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) \
+                        | (MPS_WORD_WIDTH - 1 - WORD_CLZ(actionWord)); \
+      *bfsFoundReturn = TRUE; \
+      goto label; \
+    } \
+  END
+
+#else /* WORD_CLZ not defined */
+
 #define ACTION_FIND_SET_BIT_HIGH(wi,word,base,limit,label) \
   BEGIN \
     /* no need to mask the high bits which are shifted */ \
@@ -573,6 +609,8 @@ btFindSetHighLabel:; \
     } \
   END
 
+#endif /* WORD_CLZ */
+
 
 /* BTFindResHigh -- find the highest reset bit in a range
  *
@@ -1017,19 +1055,49 @@ void BTCopyOffsetRange(BT fromBT, BT toBT,
 }
 
 
+/* btWordCountSet -- count the set bits in a word
+ *
+ * Uses a builtin if there is one (see .word.builtin), otherwise
+ * clears the lowest set bit until there are none left.
+ */
+
+#if defined(WORD_POPCOUNT)
+
+#define btWordCountSet(word) WORD_POPCOUNT(word)
+
+#else /* WORD_POPCOUNT not defined */
+
+static Count btWordCountSet(Word word)
+{
+  Count c = 0;
+  while (word != (Word)0) {
+    word &= word - 1;
+    ++c;
+  }
+  return c;
+}
+
+#endif /* WORD_POPCOUNT */
+
+
 /* BTCountResRange -- count number of reset bits in a range */
 
 Count BTCountResRange(BT bt, Index base, Index limit)
 {
   Count c = 0;
-  Index bit;
 
   AVERT(BT, bt);
   AVER(base < limit);
 
-  for (bit = base; bit < limit; ++bit)
-    if (!BTGet(bt, bit))
-      ++c;
+#define SINGLE_COUNT_RES_RANGE(i) \
+  if (!BTGet(bt, (i))) ++c
+#define BITS_COUNT_RES_RANGE(i,base,limit) \
+  c += btWordCountSet(~bt[(i)] & BTMask((base),(limit)))
+#define WORD_COUNT_RES_RANGE(i) \
+  c += btWordCountSet(~bt[(i)])
+
+  ACT_ON_RANGE(base, limit, SINGLE_COUNT_RES_RANGE,
+               BITS_COUNT_RES_RANGE, WORD_COUNT_RES_RANGE);
   return c;
 }
 
@@ -0,0 +1,266 @@
+/* btbench.c -- Benchmark for bit table searches
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This times the bit table searches and counts in <code/bt.c> on a
+ * table in which each bit is reset with a given probability.  Each
+ * iteration of a test finds every reset range of the given length in
+ * the table (or counts the reset bits in it).
+ *
+ * .builtin: To measure the bit-scanning builtins (see
+ * <code/bt.c#.word.builtin>), compare with a build that uses the
+ * portable code instead, for example:
+ *
+ *   make -f lii6gc.gmk VARIETY=hot btbench
+ *   make -f lii6gc.gmk VARIETY=hot CFLAGS=-DCONFIG_BT_PORTABLE clean btbench
+ */
+
+#include "mps.c"
+
+#include "testlib.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, malloc, EXIT_SUCCESS, EXIT_FAILURE */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+static rnd_state_t seed = 0;      /* random number seed */
+static unsigned niter = 20000;    /* iterations */
+static Count size = 4096;         /* bits in table */
+static Count length = 2;          /* length of range to find */
+static double preset = 0.125;     /* probability that a bit is reset */
+
+static BT bt;                     /* the table */
+static Count found;               /* ranges found, so work isn't elided */
+
+
+/* Each test makes one pass over the table.  The search functions
+   require the search range to be at least as long as the range
+   sought. */
+
+static void bt_short(void)
+{
+  Index base = 0, limit;
+  while (size - base >= length
+         && BTFindShortResRange(&base, &limit, bt, base, size, length)) {
+    ++found;
+    base = limit;
+  }
+}
+
+static void bt_short_high(void)
+{
+  Index base, limit = size;
+  while (limit >= length
+         && BTFindShortResRangeHigh(&base, &limit, bt, 0, limit, length)) {
+    ++found;
+    limit = base;
+  }
+}
+
+static void bt_long(void)
+{
+  Index base = 0, limit;
+  while (size - base >= length
+         && BTFindLongResRange(&base, &limit, bt, base, size, length)) {
+    ++found;
+    base = limit;
+  }
+}
+
+static void bt_long_high(void)
+{
+  Index base, limit = size;
+  while (limit >= length
+         && BTFindLongResRangeHigh(&base, &limit, bt, 0, limit, length)) {
+    ++found;
+    limit = base;
+  }
+}
+
+static void bt_count(void)
+{
+  found += BTCountResRange(bt, 0, size);
+}
+
+
+static void watch(void (*bench)(void), const char *name)
+{
+  clock_t start, finish;
+  unsigned i;
+
+  found = 0;
+  start = clock();
+  for (i = 0; i < niter; ++i)
+    bench();
+  finish = clock();
+
+  printf("%s: %g (%lu)\n", name, (double)(finish - start) / CLOCKS_PER_SEC,
+         (unsigned long)found);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"niter",            required_argument, NULL, 'i'},
+  {"size",             required_argument, NULL, 's'},
+  {"length",           required_argument, NULL, 'l'},
+  {"preset",           required_argument, NULL, 'r'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Test definitions. */
+
+static struct {
+  const char *name;
+  void (*bench)(void);
+} benches[] = {
+  {"short",     bt_short},      /* BTFindShortResRange */
+  {"shorthigh", bt_short_high}, /* BTFindShortResRangeHigh */
+  {"long",      bt_long},       /* BTFindLongResRange */
+  {"longhigh",  bt_long_high},  /* BTFindLongResRangeHigh */
+  {"count",     bt_count},      /* BTCountResRange */
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  unsigned i;
+  Index j;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hi:s:l:r:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'i':
+      niter = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      size = (Count)strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      length = (Count)strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      preset = strtod(optarg, NULL);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...] [test...]\n"
+              "Options:\n"
+              "  -i n, --niter=n\n"
+              "    Iterate each test n times (default %u)\n"
+              "  -s n, --size=n\n"
+              "    Number of bits in the table (default %lu)\n"
+              "  -l n, --length=n\n"
+              "    Length of reset range to find (default %lu)\n"
+              "  -r p, --preset=p\n"
+              "    Probability that a bit is reset (default %g)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              niter,
+              (unsigned long)size,
+              (unsigned long)length,
+              preset);
+      fprintf(stderr,
+              "Tests:\n"
+              "  short     BTFindShortResRange\n"
+              "  shorthigh BTFindShortResRangeHigh\n"
+              "  long      BTFindLongResRange\n"
+              "  longhigh  BTFindLongResRangeHigh\n"
+              "  count     BTCountResRange\n");
+      return EXIT_FAILURE;
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (size == 0 || length == 0 || length > size) {
+    fprintf(stderr, "Bad size %lu or length %lu\n",
+            (unsigned long)size, (unsigned long)length);
+    return EXIT_FAILURE;
+  }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  rnd_state_set(seed);
+  bt = malloc(BTSize(size));
+  if (bt == NULL) {
+    fprintf(stderr, "Couldn't allocate table of %lu bits\n",
+            (unsigned long)size);
+    return EXIT_FAILURE;
+  }
+  for (j = 0; j < size; ++j) {
+    if (rnd_double() < preset)
+      BTRes(bt, j);
+    else
+      BTSet(bt, j);
+  }
+
+  while (argc > 0) {
+    for (i = 0; i < NELEMS(benches); ++i)
+      if (strcmp(argv[0], benches[i].name) == 0)
+        goto found;
+    fprintf(stderr, "unknown test \"%s\"\n", argv[0]);
+    return EXIT_FAILURE;
+  found:
+    (void)mps_lib_assert_fail_install(assert_die);
+    watch(benches[i].bench, benches[i].name);
+    --argc;
+    ++argv;
+  }
+
+  free(bt);
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
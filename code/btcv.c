@@ -6,7 +6,8 @@
  * .readership: MPS developers
  *
  * .coverage: Direct coverage of BTFind*ResRange*, BTRangesSame,
- * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange.
+ * BTISResRange, BTIsSetRange, BTCountResRange, BTCopyRange,
+ * BTCopyOffsetRange.
  * Reasonable coverage of BTCopyInvertRange, BTResRange,
  * BTSetRange, BTRes, BTSet, BTCreate, BTDestroy.
  */
@@ -383,7 +384,7 @@ static void btFindRangeTests(BT btlo, BT bthi, Count btSize,
 
 
 
-/* btIsRangeTests -- Test BTIsResRange & BTIsSetRange
+/* btIsRangeTests -- Test BTIsResRange, BTIsSetRange & BTCountResRange
  *
  * Test ranges which are all reset or set apart from single
  * bits near to the base and limit (both inside and outside
@@ -417,12 +418,22 @@ static void btIsRangeTests(BT bt1, BT bt2, Count btSize,
       /* test a table which is all reset apart from a set bit */
       /* near each of the base and limit of the range in question */
       Bool outside; /* true if set bits are both outside test range */
+      Count reset;  /* number of reset bits in test range */
+      Index i;
 
       outside = (b < base) && (l > limit);
       BTResRange(bt1, 0, btSize);
       BTSet(bt1, b);
       BTSet(bt1, l - 1);
 
+      /* Count the reset bits one at a time, and with BTCountResRange */
+      reset = 0;
+      for (i = base; i < limit; ++i)
+        if (!BTGet(bt1, i))
+          ++reset;
+      cdie(BTCountResRange(bt1, base, limit) == reset, "BTCountResRange");
+      cdie((reset == limit - base) == outside, "BTCountResRange outside");
+
       /* invert the table for the inverse test */
       BTCopyInvertRange(bt1, bt2, 0, btSize);
 
@@ -517,7 +528,7 @@ static void btTests(BT btlo, BT bthi, Count btSize)
   /* Perform lots of tests over different subranges */
   for (base = 0; base < MPS_WORD_WIDTH; base++) {
     for (limit = btSize; limit > (btSize-MPS_WORD_WIDTH); limit--) {
-      /* Perform Is*Range tests over those subranges */
+      /* Perform Is*Range and CountResRange tests over those subranges */
       btIsRangeTests(btlo, bthi, btSize, base, limit);
 
       /* Perform Copy*Range tests over those subranges */
@@ -42,6 +42,8 @@ Bool BufferCheck(Buffer buffer)
   CHECKL(buffer->arena == buffer->pool->arena);
   CHECKD_NOSIG(Ring, &buffer->poolRing);
   CHECKL(BoolCheck(buffer->isMutator));
+  CHECKL(BoolCheck(buffer->zeroed));
+  CHECKL(BoolCheck(buffer->sampled));
   CHECKL(buffer->fillSize >= 0.0);
   CHECKL(buffer->emptySize >= 0.0);
   CHECKL(buffer->emptySize <= buffer->fillSize);
@@ -66,6 +68,7 @@ Bool BufferCheck(Buffer buffer)
     CHECKL(buffer->ap_s.limit == (Addr)0);
     /* Nothing reliable to check for lightweight frame state */
     CHECKL(buffer->poolLimit == (Addr)0);
+    CHECKL(buffer->sampleBase == (Addr)0);
   } else {
     /* The buffer is attached to a region of memory.   */
     /* Check consistency. */
@@ -84,9 +87,11 @@ Bool BufferCheck(Buffer buffer)
     CHECKL(AddrIsAligned(buffer->ap_s.alloc, buffer->alignment));
     CHECKL(AddrIsAligned(buffer->ap_s.limit, buffer->alignment));
     CHECKL(AddrIsAligned(buffer->poolLimit, buffer->alignment));
+    CHECKL(buffer->sampleBase <= buffer->poolLimit);
 
     /* If the buffer isn't trapped then "limit" should be the limit */
-    /* set by the owning pool.  Otherwise, "init" is either at the */
+    /* set by the owning pool, or lower if a sample is due (.sample). */
+    /* Otherwise, "init" is either at the */
     /* same place it was at flip (.commit.before) or has been set */
     /* to "alloc" (.commit.after).  Also, when the buffer is */
     /* flipped, initAtFlip should hold the init at flip, which is */
@@ -138,6 +143,7 @@ static Res BufferAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                 "Arena $P\n",       (WriteFP)buffer->arena,
                 "Pool $P\n",        (WriteFP)buffer->pool,
                 buffer->isMutator ? "Mutator" : "Internal", " Buffer\n",
+                buffer->zeroed ? "zeroed\n" : "",
                 "mode $C$C$C$C (TRANSITION, LOGGED, FLIPPED, ATTACHED)\n",
                 (WriteFC)((buffer->mode & BufferModeTRANSITION) ? 't' : '_'),
                 (WriteFC)((buffer->mode & BufferModeLOGGED)     ? 'l' : '_'),
@@ -163,17 +169,108 @@ Res BufferDescribe(Buffer buffer, mps_lib_FILE *stream, Count depth)
 }
 
 
+/* bufferSampleInterval -- choose bytes to allocate before next sample
+ *
+ * .sample: If allocation sampling is enabled (see
+ * ArenaSetAllocSample) then a mutator buffer takes a sample when an
+ * allocation crosses the address sampleBase + sampleRemaining.  The
+ * "limit" of the allocation point is lowered to that address, so that
+ * the allocation goes out of line to BufferFill, which takes the
+ * sample.  The inline reserve is unchanged and costs nothing extra.
+ *
+ * .sample.random: The interval is drawn uniformly from half to
+ * one and a half times the mean, so that samples don't fall into
+ * step with a program that allocates objects in a regular pattern.
+ */
+
+static Size bufferSampleInterval(Arena arena)
+{
+  Size interval = arena->sampleInterval;
+  if (interval == 0)
+    return 0;
+  return interval / 2 + (Size)(RandomWord() % interval);
+}
+
+
+/* bufferSetLimit -- set the limit of an untrapped buffer
+ *
+ * See .sample.
+ */
+
+static void bufferSetLimit(Buffer buffer)
+{
+  Addr limit = buffer->poolLimit;
+
+  if (BufferIsTrapped(buffer))
+    return;
+  if (buffer->isMutator && buffer->arena->sampleInterval != 0
+      && buffer->sampleRemaining < AddrOffset(buffer->sampleBase, limit))
+    limit = AddrAlignDown(AddrAdd(buffer->sampleBase,
+                                  buffer->sampleRemaining),
+                          buffer->alignment);
+  buffer->ap_s.limit = limit;
+}
+
+
+/* bufferSample -- take a sample if an allocation crosses the sample point
+ *
+ * Called by BufferFill after allocating size bytes at p.  See .sample
+ * and <code/mpsi.c#fill.sample>.
+ */
+
+static void bufferSample(Buffer buffer, Addr p, Size size)
+{
+  Addr next = AddrAdd(p, size);
+
+  if (!buffer->isMutator || buffer->arena->sampleInterval == 0)
+    return;
+  if (AddrOffset(buffer->sampleBase, next) > buffer->sampleRemaining) {
+    EVENT3(BufferSample, buffer, p, size);
+    buffer->sampled = TRUE;
+    buffer->sampleBase = next;
+    buffer->sampleRemaining = bufferSampleInterval(buffer->arena);
+  }
+  bufferSetLimit(buffer);
+}
+
+
+/* BufferSampleReset -- start a new sampling countdown */
+
+void BufferSampleReset(Buffer buffer)
+{
+  AVERT(Buffer, buffer);
+  buffer->sampleRemaining = bufferSampleInterval(buffer->arena);
+  if (!BufferIsReset(buffer)) {
+    buffer->sampleBase = buffer->ap_s.alloc;
+    bufferSetLimit(buffer);
+  }
+}
+
+
 /* BufferInit -- initialize an allocation buffer */
 
+ARG_DEFINE_KEY(AP_NUMA, Bool);
+ARG_DEFINE_KEY(AP_ZEROED, Bool);
+
 static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
 {
   Arena arena;
+  Bool numa = FALSE;
+  Bool zeroed = FALSE;
+  ArgStruct arg;
 
   AVER(buffer != NULL);
   AVERT(Pool, pool);
   AVER(BoolCheck(isMutator));
   AVERT(ArgList, args);
 
+  if (ArgPick(&arg, args, MPS_KEY_AP_NUMA))
+    numa = arg.val.b;
+  AVERT(Bool, numa);
+  if (ArgPick(&arg, args, MPS_KEY_AP_ZEROED))
+    zeroed = arg.val.b;
+  AVERT(Bool, zeroed);
+
   /* Superclass init */
   InstInit(CouldBeA(Inst, buffer));
 
@@ -203,6 +300,22 @@ static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
   buffer->ap_s.limit = (mps_addr_t)0;
   buffer->poolLimit = (Addr)0;
   buffer->rampCount = 0;
+  /* .numa: A buffer created with MPS_KEY_AP_NUMA prefers memory on
+   * the node of the thread that created it.  Pools pass the node in
+   * the locus preference when they allocate a segment to fill the
+   * buffer, and ArenaAlloc binds the new segment to the node once, so
+   * that its pages are placed there when they are first touched.
+   * Pages that are already resident are not moved, and segments that
+   * are reused keep the node they were allocated on.
+   * <design/vm#.if.bind> */
+  if (numa && isMutator)
+    buffer->node = ArenaCurrentNode(arena);
+  else
+    buffer->node = NodeNONE;
+  buffer->zeroed = zeroed;
+  buffer->sampleBase = (Addr)0;
+  buffer->sampleRemaining = bufferSampleInterval(arena);
+  buffer->sampled = FALSE;
 
   /* .init.sig-serial: Now the vanilla stuff is initialized, sign the
      buffer and give it a serial number. It can then be safely checked
@@ -278,7 +391,7 @@ void BufferDetach(Buffer buffer, Pool pool)
 
   if (!BufferIsReset(buffer)) {
     Addr init, limit;
-    Size spare;
+    Size spare, sampled;
 
     buffer->mode |= BufferModeTRANSITION;
 
@@ -292,6 +405,13 @@ void BufferDetach(Buffer buffer, Pool pool)
     init = BufferGetInit(buffer);
     limit = BufferLimit(buffer);
     spare = AddrOffset(init, limit);
+
+    /* Carry the sampling countdown over to the next region. */
+    sampled = AddrOffset(buffer->sampleBase, init);
+    if (sampled < buffer->sampleRemaining)
+      buffer->sampleRemaining -= sampled;
+    else
+      buffer->sampleRemaining = 0;
     buffer->emptySize += (double)spare;
     if (buffer->isMutator) {
       ArenaGlobals(buffer->arena)->emptyMutatorSize += (double)spare;
@@ -308,6 +428,7 @@ void BufferDetach(Buffer buffer, Pool pool)
     buffer->ap_s.alloc = (mps_addr_t)0;
     buffer->ap_s.limit = (mps_addr_t)0;
     buffer->poolLimit = (Addr)0;
+    buffer->sampleBase = (Addr)0;
     buffer->mode &=
       ~(BufferModeATTACHED|BufferModeFLIPPED|BufferModeTRANSITION);
 
@@ -414,13 +535,34 @@ static void BufferSetUnflipped(Buffer buffer)
   AVER(buffer->mode & BufferModeFLIPPED);
   buffer->mode &= ~BufferModeFLIPPED;
   /* restore ap_s.limit if appropriate */
-  if (!BufferIsTrapped(buffer)) {
-    buffer->ap_s.limit = buffer->poolLimit;
-  }
+  bufferSetLimit(buffer);
   buffer->initAtFlip = (Addr)0;
 }
 
 
+/* bufferZero -- zero free space in a zeroed buffer
+ *
+ * .zeroed: A buffer created with MPS_KEY_AP_ZEROED only reserves
+ * memory that contains zeros, so that the client needn't zero each
+ * object.  Instead the buffer zeroes all its free space in one go
+ * when memory is attached, which is cheaper, and again if allocation
+ * is rewound over memory the client may have written.  A segment
+ * that has just been allocated from fresh pages is already zero (see
+ * ArenaZeroed), so segBufAttach skips zeroing the first time a buffer
+ * is attached to it.  This relies on pools not writing to segment
+ * memory outside buffers before the first attachment.  A pool that
+ * does (such as a debug pool splatting free space) must clear the
+ * segment's zeroed flag with SegSetZeroed.
+ */
+
+static void bufferZero(Buffer buffer, Addr base, Addr limit)
+{
+  AVER(base <= limit);
+  if (buffer->zeroed && base < limit)
+    (void)AddrSet(base, 0, AddrOffset(base, limit));
+}
+
+
 /* BufferSetAllocAddr
  *
  * Sets the init & alloc pointers of a buffer.  */
@@ -432,9 +574,16 @@ void BufferSetAllocAddr(Buffer buffer, Addr addr)
   AVER(BufferIsReady(buffer));
   AVER(buffer->base <= addr);
   AVER(buffer->poolLimit >= addr);
+  AVER(addr <= (Addr)buffer->ap_s.alloc);
 
+  bufferZero(buffer, addr, buffer->ap_s.alloc);
   buffer->ap_s.init = addr;
   buffer->ap_s.alloc = addr;
+  /* Memory given back is counted again when it is reallocated. */
+  if (buffer->sampleBase > addr) {
+    buffer->sampleBase = addr;
+    bufferSetLimit(buffer);
+  }
 }
 
 
@@ -531,14 +680,15 @@ void BufferAttach(Buffer buffer, Addr base, Addr limit,
   buffer->base = base;
   buffer->ap_s.init = init;
   buffer->ap_s.alloc = AddrAdd(init, size);
+  AVER(buffer->initAtFlip == (Addr)0);
+  buffer->poolLimit = limit;
+  buffer->sampleBase = init;
   /* only set limit if not logged */
   if ((buffer->mode & BufferModeLOGGED) == 0) {
-    buffer->ap_s.limit = limit;
+    bufferSetLimit(buffer);
   } else {
     AVER(buffer->ap_s.limit == (Addr)0);
   }
-  AVER(buffer->initAtFlip == (Addr)0);
-  buffer->poolLimit = limit;
 
   filled = AddrOffset(init, limit);
   buffer->fillSize += (double)filled;
@@ -565,7 +715,8 @@ void BufferAttach(Buffer buffer, Addr base, Addr limit,
  * BufferFill is entered by the "reserve" operation on a buffer if there
  * isn't enough room between "alloc" and "limit" to satisfy an
  * allocation request.  This might be because the buffer has been
- * trapped and "limit" has been set to zero.  */
+ * trapped and "limit" has been set to zero, or because "limit" has
+ * been lowered to take a sample (.sample).  */
 
 Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
 {
@@ -581,9 +732,10 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
 
   pool = BufferPool(buffer);
 
-  /* If we're here because the buffer was trapped, then we attempt */
-  /* the allocation here. */
-  if (!BufferIsReset(buffer) && buffer->ap_s.limit == (Addr)0) {
+  /* If we're here because the buffer was trapped or a sample is */
+  /* due, then we attempt the allocation here. */
+  if (!BufferIsReset(buffer)
+      && (Addr)buffer->ap_s.limit < buffer->poolLimit) {
     /* .fill.unflip: If the buffer is flipped then we unflip the buffer. */
     if (buffer->mode & BufferModeFLIPPED) {
       BufferSetUnflipped(buffer);
@@ -597,6 +749,7 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
       if (buffer->mode & BufferModeLOGGED) {
         EVENT3(BufferReserve, buffer, buffer->ap_s.init, size);
       }
+      bufferSample(buffer, buffer->ap_s.init, size);
       *pReturn = buffer->ap_s.init;
       return ResOK;
     }
@@ -607,6 +760,7 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
        AddrAdd(buffer->ap_s.alloc, size) < (Addr)buffer->ap_s.alloc);
 
   BufferDetach(buffer, pool);
+  ++PoolArena(pool)->fillCount;
 
   /* Ask the pool for some memory. */
   res = Method(Pool, pool, bufferFill)(&base, &limit, pool, buffer, size);
@@ -620,6 +774,7 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
   if (buffer->mode & BufferModeLOGGED) {
     EVENT3(BufferReserve, buffer, buffer->ap_s.init, size);
   }
+  bufferSample(buffer, base, size);
 
   *pReturn = base;
   return res;
@@ -717,6 +872,7 @@ Bool BufferTrip(Buffer buffer, Addr p, Size size)
     /* The buffer is left trapped and we leave the untrapping */
     /* for the next reserve (which goes out of line to Fill */
     /* (.fill.unflip) because the buffer is still trapped) */
+    bufferZero(buffer, p, buffer->ap_s.init);
     buffer->ap_s.init = p;
     buffer->ap_s.alloc = p;
     return FALSE;
@@ -934,14 +1090,13 @@ void BufferRampReset(Buffer buffer)
 static void bufferTrivAttach(Buffer buffer, Addr base, Addr limit,
                              Addr init, Size size)
 {
-  /* No special attach method for simple buffers */
+  /* No special attach method for simple buffers, apart from
+     zeroing.  See .zeroed. */
   AVERT(Buffer, buffer);
   /* Other parameters are consistency checked in BufferAttach */
   UNUSED(base);
-  UNUSED(limit);
-  UNUSED(init);
   UNUSED(size);
-  NOOP;
+  bufferZero(buffer, init, limit);
 }
 
 
@@ -1143,7 +1298,6 @@ static void segBufAttach(Buffer buffer, Addr base, Addr limit,
   Bool found;
 
   /* Other parameters are consistency checked in BufferAttach */
-  UNUSED(init);
   UNUSED(size);
 
   arena = BufferArena(buffer);
@@ -1158,6 +1312,12 @@ static void segBufAttach(Buffer buffer, Addr base, Addr limit,
   SegSetBuffer(seg, buffer);
   segbuf->seg = seg;
 
+  /* See .zeroed.  Once a buffer has been attached, the segment can't
+     be known to be zero. */
+  if (!seg->zeroed)
+    bufferZero(buffer, init, limit);
+  seg->zeroed = FALSE;
+
   AVERT(SegBuf, segbuf);
 }
 
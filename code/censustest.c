@@ -0,0 +1,232 @@
+/* censustest.c: LIVE-HEAP CENSUS TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Allocates objects of known sizes in a pool whose format
+ * has a census method, keeps a known subset of them alive, collects
+ * the world, and checks that the census in the garbage collection
+ * message counts exactly the surviving objects of each type. See
+ * <code/traceanc.c#census>.
+ *
+ * .types: The census method classifies an object by the log2 of its
+ * size in words.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpscams.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define objectsCOUNT      10000
+#define maxWORDS          300
+#define survivorFREQ      3
+
+/* objNULL needs to be odd so that it's ignored in roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_addr_t roots[objectsCOUNT];
+static mps_addr_t survivors[objectsCOUNT]; /* not a root */
+static size_t expectedCount[MPS_CENSUS_TYPES];
+static size_t expectedSize[MPS_CENSUS_TYPES];
+
+
+/* type_of_words -- census type of an object of a number of words */
+
+static size_t type_of_words(size_t words)
+{
+  size_t type = 0;
+  Insist(words > 0);
+  while (words >>= 1)
+    ++ type;
+  return type;
+}
+
+
+/* census -- census method for the format, see .types */
+
+static size_t census(mps_addr_t addr)
+{
+  size_t size = (size_t)((char *)dylan_skip(addr) - (char *)addr);
+  return type_of_words(size / sizeof(mps_word_t));
+}
+
+
+/* test -- check the census of a collection of a pool
+ *
+ * If withCensus is false, the format has no census method, and the
+ * census must be empty.
+ */
+
+static void test(mps_arena_t arena, mps_pool_class_t pool_class,
+                 mps_bool_t scanned, mps_bool_t withCensus)
+{
+  mps_fmt_t format;
+  mps_pool_t pool;
+  mps_root_t root;
+  mps_ap_t ap;
+  mps_message_t message;
+  size_t i, type, collections, live, nSurvivors;
+  size_t censusCount[MPS_CENSUS_TYPES], censusSize[MPS_CENSUS_TYPES];
+
+  MPS_ARGS_BEGIN(args) {
+    mps_fmt_A_s *fmt_A = dylan_fmt_A();
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_ALIGN, fmt_A->align);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SCAN, fmt_A->scan);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SKIP, fmt_A->skip);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_FWD, fmt_A->fwd);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_ISFWD, fmt_A->isfwd);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_PAD, fmt_A->pad);
+    if (withCensus)
+      MPS_ARGS_ADD(args, MPS_KEY_FMT_CENSUS, census);
+    die(mps_fmt_create_k(&format, arena, args), "fmt_create");
+  } MPS_ARGS_END(args);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_root_create_table_masked(&root, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, roots, objectsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table");
+
+  for (i = 0; i < MPS_CENSUS_TYPES; ++i)
+    expectedCount[i] = expectedSize[i] = 0;
+
+  /* The arena is parked, so nothing dies until it is collected. Every
+     object refers only to survivors, so the survivors are exactly the
+     objects left in the roots. */
+  mps_arena_park(arena);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  nSurvivors = 0;
+  for (i = 0; i < objectsCOUNT; ++i) {
+    size_t words = rnd() % (maxWORDS - 2) + 2;
+    size_t size = words * sizeof(mps_word_t);
+    die(dylan_alloc(&roots[i], ap, size, survivors,
+                    scanned ? nSurvivors : 0),
+        "dylan_alloc");
+    if (i % survivorFREQ == 0) {
+      survivors[nSurvivors++] = roots[i];
+      type = type_of_words(words);
+      ++ expectedCount[type];
+      expectedSize[type] += size;
+    }
+  }
+  /* So that all the objects are in the condemned set. */
+  mps_ap_destroy(ap);
+  for (i = 0; i < objectsCOUNT; ++i)
+    if (i % survivorFREQ != 0)
+      roots[i] = objNULL;
+
+  die(mps_arena_collect(arena), "collect");
+
+  for (i = 0; i < MPS_CENSUS_TYPES; ++i)
+    censusCount[i] = censusSize[i] = 0;
+  collections = 0;
+  live = 0;
+  while (mps_message_get(&message, arena, mps_message_type_gc())) {
+    ++ collections;
+    live += mps_message_gc_live_size(arena, message);
+    for (i = 0; i < MPS_CENSUS_TYPES; ++i) {
+      size_t count, size;
+      mps_message_gc_census(&count, &size, arena, message, i);
+      censusCount[i] += count;
+      censusSize[i] += size;
+    }
+    mps_message_discard(arena, message);
+  }
+  Insist(collections == 1);
+
+  for (i = 0; i < MPS_CENSUS_TYPES; ++i) {
+    if (withCensus) {
+      if (expectedCount[i] > 0)
+        printf("type %2lu: %5lu objects, %8lu bytes\n", (unsigned long)i,
+               (unsigned long)censusCount[i], (unsigned long)censusSize[i]);
+      Insist(censusCount[i] == expectedCount[i]);
+      Insist(censusSize[i] == expectedSize[i]);
+    } else {
+      Insist(censusCount[i] == 0);
+      Insist(censusSize[i] == 0);
+    }
+  }
+
+  /* Every live object belongs to this pool, so the census covers the
+     whole live size. */
+  if (withCensus) {
+    size_t censused = 0;
+    for (i = 0; i < MPS_CENSUS_TYPES; ++i)
+      censused += censusSize[i];
+    Insist(censused == live);
+  }
+
+  for (i = 0; i < objectsCOUNT; ++i)
+    cdie(roots[i] == objNULL || dylan_check(roots[i]), "root check");
+
+  mps_root_destroy(root);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+      "arena_create");
+  mps_message_type_enable(arena, mps_message_type_gc());
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  test(arena, mps_class_amc(), TRUE, TRUE);
+  test(arena, mps_class_amcz(), FALSE, TRUE);
+  test(arena, mps_class_ams(), TRUE, TRUE);
+  test(arena, mps_class_amc(), TRUE, FALSE);
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -152,6 +152,26 @@
 #endif
 
 
+/* CONFIG_IO_RING -- write telemetry to a memory-mapped ring file
+ *
+ * <a id="io.ring">CONFIG_IO_RING tells mps.c to use the POSIX ring
+ * file I/O implementation <code/mpsioix.c> instead of the ANSI one
+ * <code/mpsioan.c>.  The telemetry stream is then written into a
+ * fixed-size shared mapping, which is cheap enough for telemetry to
+ * be left on in production, and which can be read while the program
+ * runs with "mpseventcnv -r".  e.g.
+ *
+ *     cc -O2 -c -DCONFIG_IO_RING mps.c
+ */
+
+#if defined(CONFIG_IO_RING)
+#if defined(PLINTH_NONE)
+#error "CONFIG_IO_RING is incompatible with CONFIG_PLINTH_NONE"
+#endif
+#define IO_RING
+#endif
+
+
 /* CONFIG_PF_ANSI -- use the ANSI platform
  *
  * This symbol tells mps.c to exclude the sources for the
@@ -331,6 +351,53 @@
 #endif
 
 
+/* WORD_CTZ, WORD_CLZ, WORD_POPCOUNT -- bit-scanning builtins
+ *
+ * Count the trailing zero bits, leading zero bits, and set bits of a
+ * word. These compile to single instructions on most processors. The
+ * word must not be zero for WORD_CTZ and WORD_CLZ. Where the compiler
+ * lacks them, they are not defined, and the bit tables use portable
+ * code instead. See <code/bt.c#.word.builtin>.
+ *
+ * MPS_T_WORD is unsigned long on all GC and LL platforms.
+ *
+ * Defining CONFIG_BT_PORTABLE selects the portable code anyway, so
+ * that the two can be compared. See <code/btbench.c#.builtin>.
+ */
+
+#if (defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)) \
+  && !defined(CONFIG_BT_PORTABLE)
+#define WORD_CTZ(w) ((Index)__builtin_ctzl(w))
+#define WORD_CLZ(w) ((Index)__builtin_clzl(w))
+#define WORD_POPCOUNT(w) ((Count)__builtin_popcountl(w))
+#endif
+
+
+/* ATOMIC_INCREMENT, ATOMIC_DECREMENT, ATOMIC_LOAD, ATOMIC_STORE --
+ * atomic operations on words shared between threads
+ *
+ * All are sequentially consistent except ATOMIC_DECREMENT, which
+ * need only release the reads before it. They are used by the
+ * lock-free address lookups; where the compiler lacks them, they are
+ * not defined, and the lookups claim the arena lock instead. See
+ * <code/arena.c#.lookup>.
+ *
+ * ATOMIC_STORE_RELEASE stores a word after all the memory accesses
+ * before it, and ATOMIC_FENCE_RELEASE orders the stores before it
+ * ahead of the stores after it. They are used to publish records in
+ * the telemetry ring file. See <code/mpsioix.c#.overwrite>.
+ */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define ATOMIC_INCREMENT(p) ((void)__atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST))
+#define ATOMIC_DECREMENT(p) ((void)__atomic_sub_fetch(p, 1, __ATOMIC_RELEASE))
+#define ATOMIC_LOAD(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define ATOMIC_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+
 /* Buffer Configuration -- see <code/buffer.c> */
 
 #define BUFFER_RANK_DEFAULT (mps_rank_exact())
@@ -346,6 +413,15 @@
 #define FMT_ISFWD_DEFAULT (&FormatNoIsMoved)
 #define FMT_PAD_DEFAULT (&FormatNoPad)
 #define FMT_CLASS_DEFAULT (&FormatDefaultClass)
+#define FMT_CENSUS_DEFAULT NULL
+
+
+/* Census Configuration -- see <code/traceanc.c> */
+
+/* CensusTYPES is the number of object types counted by the live-heap
+ * census.  It must be the same as MPS_CENSUS_TYPES in <code/mps.h>. */
+
+#define CensusTYPES 64
 
 
 /* Pool AMC Configuration -- see <code/poolamc.c> */
@@ -354,6 +430,12 @@
 /* AMC treats objects larger than or equal to this as "Large" */
 #define AMC_LARGE_SIZE_DEFAULT ((Size)32768)
 #define AMC_EXTEND_BY_DEFAULT  ((Size)8192)
+#define AMC_DEPTH_FIRST_DEFAULT FALSE
+/* AMC preserves a segment in place if it expects this fraction of it
+   to survive, or never if zero -- see <code/poolamc.c#dense> */
+#define AMC_DENSE_DEFAULT      0.0
+/* Number of copied objects remembered for depth-first scanning */
+#define AMC_SCAN_STACK_DEPTH   64
 
 
 /* Pool AMS Configuration -- see <code/poolams.c> */
@@ -376,6 +458,44 @@
 #define LO_GEN_DEFAULT       0
 
 
+/* TLSF Configuration -- see <code/tlsf.c> */
+
+/* TLSF_SL_SHIFT is the log2 of the number of second-level size
+ * classes into which each power-of-two first-level class is divided.
+ * TLSF_FL_COUNT first-level classes cover every size that fits in a
+ * word. */
+
+#define TLSF_SL_SHIFT            3
+#define TLSF_SL_COUNT            ((Count)1 << TLSF_SL_SHIFT)
+#define TLSF_FL_COUNT            MPS_WORD_WIDTH
+#define TLSF_BUCKETS_DEFAULT     ((Count)64)
+
+
+/* Magazine cache configuration -- see <code/mag.c> */
+
+/* MAG_CLASSES size classes, each one pool alignment wide, are cached;
+ * larger blocks go straight to the pool.  A magazine holds MAG_ROUNDS
+ * blocks.  MAG_STRIPES is the number of stripes that threads are
+ * spread over by stack address (a stripe is selected by address bits
+ * from MAG_STRIPE_SHIFT up), and MAG_LIMIT bounds the number of
+ * magazines a cache may allocate, and so the memory it can hold. */
+
+#define MAG_CLASSES             16
+#define MAG_ROUNDS              30
+#define MAG_STRIPES             8
+#define MAG_STRIPE_SHIFT        16
+#define MAG_LIMIT               ((Count)256)
+
+
+/* Segregated allocation cache configuration -- see <code/sac.c> */
+
+/* SAC_LOOKUP_MAX bounds the number of entries in the size-to-class
+ * lookup table requested by MPS_KEY_SAC_LOOKUP_LIMIT, so that a large
+ * limit on a finely aligned pool can't make the table huge. */
+
+#define SAC_LOOKUP_MAX          ((Count)4096)
+
+
 /* Pool MFS Configuration -- see <code/poolmfs.c> */
 
 #define MFS_EXTEND_BY_DEFAULT ((Size)65536)
@@ -390,6 +510,13 @@
 #define MVFF_ARENA_HIGH_DEFAULT  FALSE
 #define MVFF_FIRST_FIT_DEFAULT   TRUE
 #define MVFF_SPARE_DEFAULT       0.75
+#define MVFF_TLSF_DEFAULT        FALSE
+
+
+/* Pool RGN Configuration -- see <code/poolrgn.c> */
+
+#define RGN_EXTEND_BY_DEFAULT    ((Size)65536)
+#define RGN_ALIGN_DEFAULT        MPS_PF_ALIGN
 
 
 /* Pool MVT Configuration -- see <code/poolmv2.c> */
@@ -403,6 +530,16 @@
 #define MVT_FRAG_LIMIT_DEFAULT    30
 
 
+/* Histogram Configuration -- see <code/meter.c> */
+
+/* HistogramBUCKETS is the number of buckets in each histogram.  It
+ * must be the same as MPS_HISTOGRAM_BUCKETS in <code/mps.h>.  With
+ * four buckets per power of two, 128 buckets cover intervals up to
+ * 2^33 clocks. */
+
+#define HistogramBUCKETS 128
+
+
 /* Arena Configuration -- see <code/arena.c> */
 
 #define ArenaPollALLOCTIME (65536.0)
@@ -417,6 +554,18 @@
 
 #define ARENA_SPARE_DEFAULT     0.75
 
+/* ARENA_PRECOMMIT_HORIZON is how far ahead (in seconds) the arena
+ * keeps mapped memory for, at the smoothed allocation rate, when the
+ * client asks for headroom with MPS_KEY_ARENA_PRECOMMIT.  Each sample
+ * of the rate moves the estimate ARENA_PRECOMMIT_WEIGHT of the way
+ * towards it.  ARENA_PRECOMMIT_RANGES bounds the number of separate
+ * free ranges mapped at once.  See ArenaPrecommit. */
+
+#define ARENA_PRECOMMIT_DEFAULT ((Size)0)
+#define ARENA_PRECOMMIT_HORIZON 0.01
+#define ARENA_PRECOMMIT_WEIGHT  0.25
+#define ARENA_PRECOMMIT_RANGES  8
+
 /* ARENA_DEFAULT_PAUSE_TIME is the maximum time (in seconds) that
  * operations within the arena may pause the mutator for.  The default
  * is set for typical human interaction.  See mps_arena_pause_time_set
@@ -466,6 +615,7 @@
   FALSE,               /* high */ \
   ArenaDefaultZONESET, /* zoneSet */ \
   ZoneSetEMPTY,        /* avoid */ \
+  NodeNONE,            /* node */ \
 }
 
 #define LDHistoryLENGTH ((Size)4)
@@ -483,6 +633,17 @@
 #define LocusMortalityALPHA (0.4)
 
 
+/* Root configuration -- see <code/root.c> */
+
+/* ROOT_CHUNK_SIZE is the size (in bytes, before rounding up to the
+ * arena grain size) of the chunks into which protectable area roots
+ * are divided. Each chunk has its own summary and write barrier, so
+ * that a chunk that has not been written since it was last scanned
+ * need not be scanned again unless it refers to the white set. See
+ * <design/root#.chunk>. */
+#define ROOT_CHUNK_SIZE ((Size)65536)
+
+
 /* Stack probe configuration -- see <code/sp*.c> */
 
 /* Currently StackProbe has a useful implementation only on Windows. */
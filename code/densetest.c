@@ -0,0 +1,175 @@
+/* densetest.c: AMC DENSE SEGMENT PRESERVATION TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Checks that when a pool is created with MPS_KEY_AMC_DENSE,
+ * segments whose objects mostly survive are preserved in place, and
+ * that their survivors are copied out once the segments have become
+ * sparse. See <design/poolamc#.dense>.
+ *
+ * Objects are copied into a generation with no predicted mortality,
+ * so that its segments are dense. Then every other object dies, and
+ * the survivors should mostly be preserved in place, and their
+ * segments promoted to the next generation. After that the segments
+ * are half empty, and so the survivors are copied out of them by the
+ * next collection.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define objectsCOUNT      4096
+#define objectSIZE        (4 * sizeof(mps_word_t))
+#define genCOUNT          3
+
+/* objNULL needs to be odd so that it's ignored in roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 1024, 0.5 }, { 1024, 0.0 }, { 1024, 0.0 } };
+
+static mps_addr_t roots[objectsCOUNT];
+static mps_addr_t survivors[objectsCOUNT / 2]; /* not a root */
+
+
+/* test -- check preservation of dense segments in place
+ *
+ * If dense is zero, the pool uses the default, and all the survivors
+ * should be copied.
+ */
+
+static void test(mps_arena_t arena, mps_pool_class_t pool_class,
+                 mps_bool_t scanned, double dense)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  size_t i, stayed;
+
+  mps_arena_park(arena);
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    if (dense > 0.0)
+      MPS_ARGS_ADD(args, MPS_KEY_AMC_DENSE, dense);
+    die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  die(mps_root_create_table_masked(&root, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, roots, objectsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table");
+
+  /* Objects with even indexes survive, and refer only to each other. */
+  for (i = 0; i < objectsCOUNT; ++i) {
+    size_t refs = !scanned || i % 2 != 0 ? 0 : i / 2;
+    die(dylan_alloc(&roots[i], ap, objectSIZE, survivors, refs),
+        "dylan_alloc");
+    if (i % 2 == 0)
+      survivors[i / 2] = roots[i];
+  }
+  die(mps_arena_collect(arena), "collect 1");
+
+  for (i = 0; i < objectsCOUNT; i += 2) {
+    survivors[i / 2] = roots[i];
+    roots[i + 1] = objNULL;
+  }
+  die(mps_arena_collect(arena), "collect 2");
+  stayed = 0;
+  for (i = 0; i < objectsCOUNT; i += 2) {
+    cdie(dylan_check(roots[i]), "check 2");
+    if (roots[i] == survivors[i / 2])
+      ++stayed;
+  }
+  printf("%lu of %lu survivors preserved in place\n",
+         (unsigned long)stayed, (unsigned long)(objectsCOUNT / 2));
+  if (dense > 0.0)
+    Insist(stayed >= objectsCOUNT / 4);
+  else
+    Insist(stayed == 0);
+
+  die(mps_arena_collect(arena), "collect 3");
+  stayed = 0;
+  for (i = 0; i < objectsCOUNT; i += 2) {
+    cdie(dylan_check(roots[i]), "check 3");
+    if (roots[i] == survivors[i / 2])
+      ++stayed;
+  }
+  printf("%lu of %lu survivors still in place\n",
+         (unsigned long)stayed, (unsigned long)(objectsCOUNT / 2));
+  Insist(stayed < objectsCOUNT / 4);
+
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+      "arena_create");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  test(arena, mps_class_amc(), TRUE, 0.9);
+  test(arena, mps_class_amcz(), FALSE, 0.9);
+  test(arena, mps_class_amc(), TRUE, 0.0);
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,230 @@
+/* depthtest.c: AMC DEPTH-FIRST COPYING TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Builds binary trees in an AMC pool, in breadth-first
+ * order, and collects them, with and without MPS_KEY_AMC_DEPTH_FIRST.
+ * Checks that the trees survive intact, and that depth-first copying
+ * places many more objects next to their first child than
+ * breadth-first copying does. See <design/poolamc#.depth-first>.
+ * Then allocates garbage so that the trees are copied by incremental
+ * collections too.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define treesCOUNT        8
+#define treeDEPTH         12
+#define nodesCOUNT        (((size_t)1 << treeDEPTH) - 1)
+#define nodeSIZE          (4 * sizeof(mps_word_t))
+#define nearNODES         4
+#define churnCOUNT        200000
+#define genCOUNT          2
+
+/* objNULL needs to be odd so that it's ignored in roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 1024, 0.85 }, { 2048, 0.45 } };
+
+static mps_addr_t roots[treesCOUNT];
+static mps_addr_t nodes[nodesCOUNT]; /* not a root */
+
+
+/* make_tree -- make a tree in breadth-first order
+ *
+ * Each internal node is a vector whose two slots refer to its
+ * children, and each leaf is a vector of two integers. The arena is
+ * parked, so the nodes don't move while they are linked.
+ */
+
+static mps_addr_t make_tree(mps_ap_t ap)
+{
+  size_t i;
+
+  for (i = 0; i < nodesCOUNT; ++i)
+    die(dylan_alloc(&nodes[i], ap, nodeSIZE, NULL, 0), "dylan_alloc");
+  for (i = 0; 2 * i + 2 < nodesCOUNT; ++i) {
+    DYLAN_VECTOR_SLOT(nodes[i], 0) = (mps_word_t)nodes[2 * i + 1];
+    DYLAN_VECTOR_SLOT(nodes[i], 1) = (mps_word_t)nodes[2 * i + 2];
+  }
+  return nodes[0];
+}
+
+
+/* is_leaf -- is the node a leaf? Leaves contain tagged integers. */
+
+static mps_bool_t is_leaf(mps_addr_t node)
+{
+  return (DYLAN_VECTOR_SLOT(node, 0) & 1) != 0;
+}
+
+
+/* check_tree -- check a tree, and count nodes next to their first child
+ *
+ * Returns the number of nodes in the tree, which must be nodesCOUNT.
+ */
+
+static size_t check_tree(mps_addr_t node, size_t depth, size_t *nearReturn)
+{
+  mps_addr_t left, right;
+  size_t count;
+
+  cdie(dylan_check(node), "node check");
+  if (is_leaf(node)) {
+    Insist(depth == treeDEPTH);
+    return 1;
+  }
+  left = (mps_addr_t)DYLAN_VECTOR_SLOT(node, 0);
+  right = (mps_addr_t)DYLAN_VECTOR_SLOT(node, 1);
+  if ((char *)left > (char *)node
+      && (char *)left <= (char *)node + nearNODES * nodeSIZE)
+    ++ *nearReturn;
+  count = check_tree(left, depth + 1, nearReturn);
+  count += check_tree(right, depth + 1, nearReturn);
+  return count + 1;
+}
+
+
+/* check_trees -- check all the trees, and return how many nodes are
+ * next to their first child
+ */
+
+static size_t check_trees(void)
+{
+  size_t i, near = 0;
+  for (i = 0; i < treesCOUNT; ++i)
+    Insist(check_tree(roots[i], 1, &near) == nodesCOUNT);
+  return near;
+}
+
+
+/* test -- build and collect trees in a pool; returns the number of
+ * nodes next to their first child after the first collection
+ */
+
+static size_t test(mps_arena_t arena, mps_bool_t depthFirst)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  mps_ap_t ap;
+  size_t i, near;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_AMC_DEPTH_FIRST, depthFirst);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+
+  for (i = 0; i < treesCOUNT; ++i)
+    roots[i] = objNULL;
+  die(mps_root_create_table_masked(&root, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, roots, treesCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table");
+
+  mps_arena_park(arena);
+  for (i = 0; i < treesCOUNT; ++i)
+    roots[i] = make_tree(ap);
+  (void)check_trees();
+
+  die(mps_arena_collect(arena), "collect");
+  near = check_trees();
+  printf("depth-first %d: %lu of %lu nodes near their first child\n",
+         (int)depthFirst, (unsigned long)near,
+         (unsigned long)(treesCOUNT * (nodesCOUNT / 2)));
+
+  /* Keep the trees alive while incremental collections copy them. */
+  mps_arena_release(arena);
+  for (i = 0; i < churnCOUNT; ++i) {
+    mps_addr_t p;
+    die(dylan_alloc(&p, ap, nodeSIZE, roots, treesCOUNT), "dylan_alloc");
+  }
+  mps_arena_park(arena);
+  (void)check_trees();
+
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+  return near;
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+  size_t breadthNear, depthNear;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+      "arena_create");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  breadthNear = test(arena, FALSE);
+  depthNear = test(arena, TRUE);
+
+  /* Depth-first copying puts the children of each first child just
+     after it, and often those of the second child too. Breadth-first
+     copying only does this near the top of each tree. */
+  Insist(depthNear >= treesCOUNT * (nodesCOUNT / 2) / 4);
+  Insist(depthNear > 2 * breadthNear);
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
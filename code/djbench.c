@@ -56,9 +56,36 @@ static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
 static size_t arena_grain_size = 1; /* arena grain size */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
+static mps_bool_t fragmentation = FALSE; /* sample pool free size */
 
-#define DJRUN(fname, alloc, free) \
-  static unsigned fname##_inner(mps_ap_t ap, unsigned depth, unsigned r) { \
+
+/* Fragmentation statistics, kept per thread.  When fragmentation is
+   set, the pool's total and free sizes are sampled after every pass,
+   so that pool configurations (for example MVFF with a CBS or with
+   TLSF) can be compared for the memory they waste as well as for
+   speed.  Sampling claims the arena lock, so it is off by default. */
+
+typedef struct dj_frag_s {
+  size_t peak_total;            /* largest total size sampled */
+  double free_sum;              /* sum of sampled free fractions */
+  unsigned long samples;        /* number of samples */
+} dj_frag_s;
+
+static void frag_sample(dj_frag_s *frag)
+{
+  size_t total = mps_pool_total_size(pool);
+  size_t free_size = mps_pool_free_size(pool);
+  if (total > frag->peak_total)
+    frag->peak_total = total;
+  if (total > 0) {
+    frag->free_sum += (double)free_size / (double)total;
+    ++frag->samples;
+  }
+}
+
+#define DJRUN(fname, alloc, free, reset) \
+  static unsigned fname##_inner(mps_ap_t ap, unsigned depth, unsigned r, \
+                                dj_frag_s *frag) { \
     struct {void *p; size_t s;} *blocks = alloca(sizeof(blocks[0]) * nblocks); \
     unsigned j, k; \
     \
@@ -83,9 +110,11 @@ static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
           } \
         } \
       } \
+      if (fragmentation && pool != NULL) \
+        frag_sample(frag); \
       if (rinter > 0 && depth > 0 && ++r % rinter == 0) { \
         /* putchar('>'); fflush(stdout); */ \
-        r = fname##_inner(ap, depth - 1, r); \
+        r = fname##_inner(ap, depth - 1, r, frag); \
         /* putchar('<'); fflush(stdout); */ \
       } \
     } \
@@ -104,20 +133,27 @@ static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
     mps_ap_t ap = NULL; \
     if (pool != NULL) \
       DJMUST(mps_ap_create_k(&ap, pool, mps_args_none)); \
-    for (i = 0; i < niter; ++i) \
-      (void)fname##_inner(ap, rmax, 0); \
+    for (i = 0; i < niter; ++i) { \
+      (void)fname##_inner(ap, rmax, 0, p); \
+      reset(ap); \
+    } \
     if (ap != NULL) \
       mps_ap_destroy(ap); \
     return p; \
   }
 
 
+/* Benchmarks other than the region benchmark free every block. */
+
+#define NO_RESET(ap) UNUSED(ap)
+
+
 /* malloc/free benchmark */
 
 #define MALLOC_ALLOC(p, s) do { p = malloc(s); } while(0)
 #define MALLOC_FREE(p, s)  do { free(p); } while(0)
 
-DJRUN(dj_malloc, MALLOC_ALLOC, MALLOC_FREE)
+DJRUN(dj_malloc, MALLOC_ALLOC, MALLOC_FREE, NO_RESET)
 
 
 /* mps_alloc/mps_free benchmark */
@@ -125,7 +161,7 @@ DJRUN(dj_malloc, MALLOC_ALLOC, MALLOC_FREE)
 #define MPS_ALLOC(p, s) do { mps_alloc(&p, pool, s); } while(0)
 #define MPS_FREE(p, s)  do { mps_free(pool, p, s); } while(0)
 
-DJRUN(dj_alloc, MPS_ALLOC, MPS_FREE)
+DJRUN(dj_alloc, MPS_ALLOC, MPS_FREE, NO_RESET)
 
 
 /* reserve/free benchmark */
@@ -139,35 +175,93 @@ DJRUN(dj_alloc, MPS_ALLOC, MPS_FREE)
   } while(0)
 #define RESERVE_FREE(p, s)  do { mps_free(pool, p, s); } while(0)
 
-DJRUN(dj_reserve, RESERVE_ALLOC, RESERVE_FREE)
+DJRUN(dj_reserve, RESERVE_ALLOC, RESERVE_FREE, NO_RESET)
+
+
+/* reserve/free benchmark with address lookups
+ *
+ * Each block is looked up when it is allocated and when it is freed,
+ * as a runtime dispatching on the type of a pointer might.
+ */
+
+#define LOOKUP(p) \
+  do { \
+    mps_pool_t _pool; \
+    if (!mps_arena_has_addr(arena, p) \
+        || !mps_addr_pool(&_pool, arena, p) || _pool != pool) { \
+      fprintf(stderr, "lookup of %p failed\n", p); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+#define LOOKUP_ALLOC(p, s) \
+  do { \
+    RESERVE_ALLOC(p, s); \
+    LOOKUP(p); \
+  } while(0)
+#define LOOKUP_FREE(p, s) \
+  do { \
+    LOOKUP(p); \
+    RESERVE_FREE(p, s); \
+  } while(0)
+
+DJRUN(dj_lookup, LOOKUP_ALLOC, LOOKUP_FREE, NO_RESET)
+
+
+/* region benchmark
+ *
+ * Each iteration is a request: blocks are not freed individually, but
+ * all together by resetting the region at the end of the iteration.
+ */
+
+#define REGION_FREE(p, s) do { UNUSED(p); UNUSED(s); } while(0)
+#define REGION_RESET(ap) DJMUST(mps_rgn_reset(ap))
+
+DJRUN(dj_region, RESERVE_ALLOC, REGION_FREE, REGION_RESET)
 
 typedef void *(*dj_t)(void *);
 
-static void weave(dj_t dj)
+static void weave(dj_t dj, dj_frag_s *frag)
 {
   testthr_t *threads = alloca(sizeof(threads[0]) * nthreads);
+  dj_frag_s *frags = alloca(sizeof(frags[0]) * nthreads);
   unsigned t;
 
-  for (t = 0; t < nthreads; ++t)
-    testthr_create(&threads[t], dj, NULL);
+  for (t = 0; t < nthreads; ++t) {
+    frags[t].peak_total = 0;
+    frags[t].free_sum = 0.0;
+    frags[t].samples = 0;
+    testthr_create(&threads[t], dj, &frags[t]);
+  }
 
-  for (t = 0; t < nthreads; ++t)
+  for (t = 0; t < nthreads; ++t) {
     testthr_join(&threads[t], NULL);
+    if (frags[t].peak_total > frag->peak_total)
+      frag->peak_total = frags[t].peak_total;
+    frag->free_sum += frags[t].free_sum;
+    frag->samples += frags[t].samples;
+  }
 }
 
 
 static void watch(dj_t dj, const char *name)
 {
   clock_t start, finish;
+  dj_frag_s frag = {0, 0.0, 0};
 
   start = clock();
   if (nthreads == 1)
-    dj(NULL);
+    dj(&frag);
   else
-    weave(dj);
+    weave(dj, &frag);
   finish = clock();
 
-  printf("%s: %g\n", name, (double)(finish - start) / CLOCKS_PER_SEC);
+  if (frag.samples > 0)
+    printf("%s: %g peak total %lu mean free %.1f%%\n", name,
+           (double)(finish - start) / CLOCKS_PER_SEC,
+           (unsigned long)frag.peak_total,
+           100.0 * frag.free_sum / (double)frag.samples);
+  else
+    printf("%s: %g\n", name, (double)(finish - start) / CLOCKS_PER_SEC);
 }
 
 
@@ -183,7 +277,8 @@ static void wrap(dj_t dj, mps_pool_class_t dummy, const char *name)
 
 /* Wrap a call to a dj benchmark that requires MPS setup */
 
-static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
+static void pool_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name,
+                      mps_arg_s pool_args[])
 {
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arena_size);
@@ -192,12 +287,39 @@ static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, spare);
     DJMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
-  DJMUST(mps_pool_create_k(&pool, arena, pool_class, mps_args_none));
+  DJMUST(mps_pool_create_k(&pool, arena, pool_class, pool_args));
   watch(dj, name);
   mps_pool_destroy(pool);
   mps_arena_destroy(arena);
 }
 
+static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
+{
+  pool_wrap(dj, pool_class, name, mps_args_none);
+}
+
+
+/* Wrap a call to a dj benchmark on an MVFF pool using TLSF */
+
+static void tlsf_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
+{
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_TLSF, TRUE);
+    pool_wrap(dj, pool_class, name, args);
+  } MPS_ARGS_END(args);
+}
+
+
+/* Wrap a call to a dj benchmark on a pool with a magazine cache */
+
+static void cache_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
+{
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_CACHE, TRUE);
+    pool_wrap(dj, pool_class, name, args);
+  } MPS_ARGS_END(args);
+}
+
 
 /* Command-line options definitions.  See getopt_long(3). */
 
@@ -216,6 +338,7 @@ static struct option longopts[] = {
   {"arena-grain-size", required_argument, NULL, 'a'},
   {"arena-unzoned",    no_argument,       NULL, 'z'},
   {"spare",            required_argument, NULL, 'S'},
+  {"fragmentation",    no_argument,       NULL, 'f'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -236,6 +359,11 @@ static struct {
   {"mvt",   arena_wrap, dj_reserve, mps_class_mvt},
   {"mvff",  arena_wrap, dj_reserve, mps_class_mvff},
   {"mvffa", arena_wrap, dj_alloc,   mps_class_mvff}, /* mvff with alloc */
+  {"mvfft", tlsf_wrap,  dj_reserve, mps_class_mvff}, /* mvff with TLSF */
+  {"mvffta", tlsf_wrap, dj_alloc,   mps_class_mvff}, /* ... and alloc */
+  {"mvffc", cache_wrap, dj_alloc,   mps_class_mvff}, /* mvff with cache */
+  {"mvffl", arena_wrap, dj_lookup,  mps_class_mvff}, /* mvff with lookups */
+  {"rgn",   arena_wrap, dj_region,  mps_class_rgn},  /* region per iteration */
   {"an",    wrap,       dj_malloc,  dummy_class},
 };
 
@@ -250,7 +378,7 @@ int main(int argc, char *argv[])
 
   seed = rnd_seed();
 
-  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:c:r:d:m:a:x:zS:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:c:r:d:m:a:x:zS:f",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -315,6 +443,9 @@ int main(int argc, char *argv[])
     case 'S':
       spare = strtod(optarg, NULL);
       break;
+    case 'f':
+      fragmentation = TRUE;
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -354,7 +485,9 @@ int main(int argc, char *argv[])
               "  -z, --arena-unzoned\n"
               "    Disabled zoned allocation in the arena\n"
               "  -S f, --spare\n"
-              "    Maximum spare committed fraction (default %f)\n",
+              "    Maximum spare committed fraction (default %f)\n"
+              "  -f, --fragmentation\n"
+              "    Report the pool's peak total size and mean free fraction\n",
               pact,
               rinter,
               rmax,
@@ -364,6 +497,11 @@ int main(int argc, char *argv[])
               "  mvt   pool class MVT\n"
               "  mvff  pool class MVFF (buffer interface)\n"
               "  mvffa pool class MVFF (alloc interface)\n"
+              "  mvfft pool class MVFF with TLSF (buffer interface)\n"
+              "  mvffta pool class MVFF with TLSF (alloc interface)\n"
+              "  mvffc pool class MVFF with magazine cache (alloc interface)\n"
+              "  mvffl pool class MVFF with address lookups (buffer interface)\n"
+              "  rgn   pool class RGN, reset after each iteration\n"
               "  an    malloc\n");
       return EXIT_FAILURE;
     }
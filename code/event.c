@@ -68,7 +68,11 @@ failWrite:
 }
 
 
-/* EventFlush -- flush event buffer (perhaps to the event stream) */
+/* EventFlush -- flush event buffer (perhaps to the event stream)
+ *
+ * Called from EVENT_BEGIN with the event lock held.  See
+ * <code/event.h#.lock>.
+ */
 
 void EventFlush(EventKind kind)
 {
@@ -89,13 +93,27 @@ void EventFlush(EventKind kind)
 }
 
 
-/* EventSync -- synchronize the event stream with the buffers */
+/* EventSync -- synchronize the event stream with the buffers
+ *
+ * .sync.lock: EventSync is called by mps_telemetry_flush without the
+ * arena lock, and by EventFlush with some arena's lock, so it claims
+ * the event lock to serialize writes to the telemetry stream.  See
+ * job003387.  An arena lock is not enough, because each arena has
+ * its own lock and all arenas share the event buffers, so the event
+ * lock is also held while each event is written to its buffer (see
+ * <code/event.h#.lock>).  This can't be the global recursive lock, because
+ * GlobalsClaimAll claims that before the arena locks, so claiming it
+ * here under an arena lock would invert the lock order.  Nothing
+ * claims another lock while holding the event lock.
+ */
 
 void EventSync(void)
 {
   EventKind kind;
   Bool wrote = FALSE;
 
+  LockClaimGlobalEvent();
+
   for (kind = 0; kind < EventKindLIMIT; ++kind) {
 
     /* Is event logging enabled for this kind of event, or are or are we just
@@ -117,6 +135,7 @@ void EventSync(void)
           res = (Res)mps_io_create(&eventIO);
           if(res != ResOK) {
             /* TODO: Consider taking some other action if open fails. */
+            LockReleaseGlobalEvent();
             return;
           }
           eventIOInited = TRUE;
@@ -142,6 +161,8 @@ void EventSync(void)
     (void)eventClockSync();
     (void)mps_io_flush(eventIO);
   }
+
+  LockReleaseGlobalEvent();
 }
 
 
@@ -48,7 +48,14 @@ extern char *EventLast[EventKindLIMIT];
 extern Word EventKindControl;
 
 
-/* EVENT_BEGIN -- flush buffer if necessary and write event header */
+/* EVENT_BEGIN -- flush buffer if necessary and write event header
+ *
+ * .lock: The event buffers are shared by all arenas, and threads
+ * holding different arena locks (or none, in mps_telemetry_label and
+ * mps_telemetry_flush) may emit events at the same time, so the event
+ * lock is held from EVENT_BEGIN to EVENT_END.  See
+ * <code/event.c#.sync.lock>.
+ */
 
 #define EVENT_BEGIN(name, structSize)                           \
   BEGIN                                                         \
@@ -56,6 +63,7 @@ extern Word EventKindControl;
     EventKind _kind = Event##name##Kind;                        \
     size_t _size = size_tAlignUp(structSize, EVENT_ALIGN);      \
     AVER(Event##name##Used);                                    \
+    LockClaimGlobalEvent();                                     \
     if (_size > (size_t)(EventLast[Event##name##Kind]           \
                          - EventBuffer[Event##name##Kind]))     \
       EventFlush(Event##name##Kind);                            \
@@ -68,6 +76,7 @@ extern Word EventKindControl;
 
 #define EVENT_END                   \
     EventLast[_kind] -= _size;      \
+    LockReleaseGlobalEvent();       \
   END
 
 
@@ -107,6 +116,7 @@ extern Word EventKindControl;
 #define EVENT12 EVENT_RECORD12
 #define EVENT13 EVENT_RECORD13
 #define EVENT14 EVENT_RECORD14
+#define EVENT15 EVENT_RECORD15
 
 #else /* !EVENT */
 
@@ -125,6 +135,7 @@ extern Word EventKindControl;
 #define EVENT12 EVENT_IGNORE12
 #define EVENT13 EVENT_IGNORE13
 #define EVENT14 EVENT_IGNORE14
+#define EVENT15 EVENT_IGNORE15
 
 #endif /* !EVENT */
 
@@ -145,6 +156,7 @@ extern Word EventKindControl;
 #define EVENT_CRITICAL12 EVENT12
 #define EVENT_CRITICAL13 EVENT13
 #define EVENT_CRITICAL14 EVENT14
+#define EVENT_CRITICAL15 EVENT15
 
 #else /* !EVENT_ALL */
 
@@ -163,12 +175,13 @@ extern Word EventKindControl;
 #define EVENT_CRITICAL12 EVENT_IGNORE12
 #define EVENT_CRITICAL13 EVENT_IGNORE13
 #define EVENT_CRITICAL14 EVENT_IGNORE14
+#define EVENT_CRITICAL15 EVENT_IGNORE15
 
 #endif /* !EVENT_ALL */
 
 
 /* The following lines were generated with
-   python -c 'for i in range(15): print("#define EVENT_RECORD{i}(name{args}) EVENT_BEGIN(name, sizeof(Event##name##Struct)) {assign} EVENT_END\n#define EVENT_IGNORE{i}(name{args}) BEGIN {unused} END".format(i=i, args="".join(map(", p{}".format, range(i))), assign=" ".join(map("_event->f{0} = (p{0});".format, range(i))), unused=" ".join(map("UNUSED(p{});".format, range(i)))))'
+   python -c 'for i in range(16): print("#define EVENT_RECORD{i}(name{args}) EVENT_BEGIN(name, sizeof(Event##name##Struct)) {assign} EVENT_END\n#define EVENT_IGNORE{i}(name{args}) BEGIN {unused} END".format(i=i, args="".join(map(", p{}".format, range(i))), assign=" ".join(map("_event->f{0} = (p{0});".format, range(i))), unused=" ".join(map("UNUSED(p{});".format, range(i)))))'
  */
 #define EVENT_RECORD0(name) EVENT_BEGIN(name, sizeof(Event##name##Struct))  EVENT_END
 #define EVENT_IGNORE0(name) BEGIN  END
@@ -200,6 +213,8 @@ extern Word EventKindControl;
 #define EVENT_IGNORE13(name, p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12) BEGIN UNUSED(p0); UNUSED(p1); UNUSED(p2); UNUSED(p3); UNUSED(p4); UNUSED(p5); UNUSED(p6); UNUSED(p7); UNUSED(p8); UNUSED(p9); UNUSED(p10); UNUSED(p11); UNUSED(p12); END
 #define EVENT_RECORD14(name, p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13) EVENT_BEGIN(name, sizeof(Event##name##Struct)) _event->f0 = (p0); _event->f1 = (p1); _event->f2 = (p2); _event->f3 = (p3); _event->f4 = (p4); _event->f5 = (p5); _event->f6 = (p6); _event->f7 = (p7); _event->f8 = (p8); _event->f9 = (p9); _event->f10 = (p10); _event->f11 = (p11); _event->f12 = (p12); _event->f13 = (p13); EVENT_END
 #define EVENT_IGNORE14(name, p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13) BEGIN UNUSED(p0); UNUSED(p1); UNUSED(p2); UNUSED(p3); UNUSED(p4); UNUSED(p5); UNUSED(p6); UNUSED(p7); UNUSED(p8); UNUSED(p9); UNUSED(p10); UNUSED(p11); UNUSED(p12); UNUSED(p13); END
+#define EVENT_RECORD15(name, p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14) EVENT_BEGIN(name, sizeof(Event##name##Struct)) _event->f0 = (p0); _event->f1 = (p1); _event->f2 = (p2); _event->f3 = (p3); _event->f4 = (p4); _event->f5 = (p5); _event->f6 = (p6); _event->f7 = (p7); _event->f8 = (p8); _event->f9 = (p9); _event->f10 = (p10); _event->f11 = (p11); _event->f12 = (p12); _event->f13 = (p13); _event->f14 = (p14); EVENT_END
+#define EVENT_IGNORE15(name, p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14) BEGIN UNUSED(p0); UNUSED(p1); UNUSED(p2); UNUSED(p3); UNUSED(p4); UNUSED(p5); UNUSED(p6); UNUSED(p7); UNUSED(p8); UNUSED(p9); UNUSED(p10); UNUSED(p11); UNUSED(p12); UNUSED(p13); UNUSED(p14); END
 
 #endif /* event_h */
 
@@ -31,12 +31,17 @@
  * If the environment variable does not exist, the default filename of
  * "mpsio.log" is used.
  *
+ * If the MPS was compiled with CONFIG_IO_RING, the telemetry file is
+ * a memory-mapped ring file (see <code/mpsioix.c>).  Use the -r
+ * option to read it; this may be done while the program is running.
+ *
  * $Id$
  */
 
 #include "config.h"
 #include "eventdef.h"
 #include "eventcom.h"
+#include "mpsio.h" /* for mps_io_ring_s */
 #include "testlib.h" /* for ulongest_t and associated print formats */
 
 #include <stddef.h> /* for size_t */
@@ -51,6 +56,7 @@
 
 static EventClock eventTime; /* current event time */
 static const char *prog; /* program name */
+static Bool ring = FALSE; /* is the input a ring file? */
 
 /* Errors and Warnings */
 
@@ -97,7 +103,7 @@ static void everror(const char *format, ...)
 
 static void usage(void)
 {
-  (void)fprintf(stderr, "Usage: %s [-f logfile] [-h]\n"
+  (void)fprintf(stderr, "Usage: %s [-f logfile] [-r] [-h]\n"
                 "See \"Telemetry\" in the reference manual for instructions.\n",
                 prog);
 }
@@ -134,6 +140,9 @@ static char *parseArgs(int argc, char *argv[])
         else
           name = argv[i];
         break;
+      case 'r': /* ring file */
+        ring = TRUE;
+        break;
       case '?': case 'h': /* help */
         usage();
         exit(EXIT_SUCCESS);
@@ -297,6 +306,76 @@ static void readLog(FILE *stream)
 }
 
 
+/* readRingHeader -- read and check the header of a ring file */
+
+static void readRingHeader(mps_io_ring_s *header, FILE *stream)
+{
+  if (fseek(stream, 0L, SEEK_SET) != 0
+      || fread(header, sizeof *header, 1, stream) != 1)
+    everror("Unable to read ring file header");
+  if (memcmp(header->magic, MPS_IO_RING_MAGIC, sizeof header->magic) != 0)
+    everror("Not a telemetry ring file");
+  if (header->version != MPS_IO_RING_VERSION)
+    everror("Ring file version %lu does not match %lu",
+            (unsigned long)header->version,
+            (unsigned long)MPS_IO_RING_VERSION);
+}
+
+
+/* readRing -- copy the records in a ring file to a temporary stream
+ *
+ * The header is read again after the data, and records older than the
+ * second tail are skipped, because the MPS may have overwritten them
+ * while we were reading.  See <code/mpsioix.c#overwrite>.
+ */
+
+static FILE *readRing(FILE *input)
+{
+  mps_io_ring_s before, after;
+  mps_word_t pos, head;
+  char *data;
+  FILE *output;
+
+  readRingHeader(&before, input);
+  data = malloc((size_t)before.size);
+  if (data == NULL)
+    everror("Unable to allocate %lu bytes for ring data",
+            (unsigned long)before.size);
+  if (fread(data, (size_t)before.size, 1, input) != 1)
+    everror("Unable to read ring file data");
+  readRingHeader(&after, input);
+  if (after.size != before.size)
+    everror("Ring file changed size");
+
+  output = tmpfile();
+  if (output == NULL)
+    everror("Unable to create temporary file");
+
+  pos = after.tail > before.tail ? after.tail : before.tail;
+  head = before.head;
+  while (pos < head) {
+    mps_word_t offset = pos % before.size;
+    mps_word_t length;
+    memcpy(&length, data + offset, sizeof length);
+    if (length == 0) { /* padding to the end of the data area */
+      pos += before.size - offset;
+    } else {
+      if (length > before.size - offset - sizeof length)
+        everror("Corrupt record in ring file");
+      if (fwrite(data + offset + sizeof length, (size_t)length, 1,
+                 output) != 1)
+        everror("I/O error writing temporary file");
+      pos += (sizeof length + length + sizeof length - 1)
+        & ~(mps_word_t)(sizeof length - 1);
+    }
+  }
+
+  free(data);
+  rewind(output);
+  return output;
+}
+
+
 /* CHECKCONV -- check t2 can be cast to t1 without loss */
 
 #define CHECKCONV(t1, t2) \
@@ -330,6 +409,9 @@ int main(int argc, char *argv[])
       everror("unable to open \"%s\"\n", filename);
   }
 
+  if (ring)
+    input = readRing(input);
+
   readLog(input);
 
   return EXIT_SUCCESS;
@@ -36,8 +36,8 @@
  */
 
 #define EVENT_VERSION_MAJOR  ((unsigned)2)
-#define EVENT_VERSION_MEDIAN ((unsigned)0)
-#define EVENT_VERSION_MINOR  ((unsigned)0)
+#define EVENT_VERSION_MEDIAN ((unsigned)1)
+#define EVENT_VERSION_MINOR  ((unsigned)2)
 
 
 /* EVENT_LIST -- list of event types and general properties
@@ -61,7 +61,7 @@
  */
 
 #define EventNameMAX ((size_t)19)
-#define EventCodeMAX ((EventCode)0x005c)
+#define EventCodeMAX ((EventCode)0x005e)
 
 #define EVENT_LIST(EVENT, X) \
   /*       0123456789012345678 <- don't exceed without changing EventNameMAX */ \
@@ -156,7 +156,9 @@
   EVENT(X, VMFinish           , 0x0059,  TRUE, Arena) \
   EVENT(X, VMInit             , 0x005a,  TRUE, Arena) \
   EVENT(X, VMMap              , 0x005b,  TRUE, Seg) \
-  EVENT(X, VMUnmap            , 0x005c,  TRUE, Seg)
+  EVENT(X, VMUnmap            , 0x005c,  TRUE, Seg) \
+  EVENT(X, TraceZoneFilter    , 0x005d,  TRUE, Trace) \
+  EVENT(X, BufferSample       , 0x005e,  TRUE, Object)
 
 
 /* Remember to update EventNameMAX and EventCodeMAX above!
@@ -637,7 +639,8 @@
   PARAM(X, 10, W, singleCopiedSize, "bytes copied by scanning single references") \
   PARAM(X, 11, W, readBarrierHitCount, "read barrier faults") \
   PARAM(X, 12, W, greySegMax, "maximum number of grey segments") \
-  PARAM(X, 13, W, pointlessScanCount, "pointless segment scans")
+  PARAM(X, 13, W, pointlessScanCount, "pointless segment scans") \
+  PARAM(X, 14, W, rootSkippedSize, "root bytes skipped as unchanged")
 
 #define EVENT_VMArenaExtendDone_PARAMS(PARAM, X) \
   PARAM(X,  0, W, chunkSize, "request succeeded for chunkSize bytes") \
@@ -675,6 +678,20 @@
   PARAM(X,  1, A, base, "base of unmapped addresses") \
   PARAM(X,  2, A, limit, "limit of unmapped addresses")
 
+#define EVENT_TraceZoneFilter_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace, "the trace") \
+  PARAM(X,  1, P, arena, "trace's arena") \
+  PARAM(X,  2, W, white, "zones condemned by the trace") \
+  PARAM(X,  3, W, fixRefCount, "references which pass zone check") \
+  PARAM(X,  4, W, whiteSegRefCount, "references which refer to white segments") \
+  PARAM(X,  5, W, freeZones, "zones with no memory allocated") \
+  PARAM(X,  6, W, genSkipCount, "segments not scanned due to generation summaries")
+
+#define EVENT_BufferSample_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, buffer, "the buffer") \
+  PARAM(X,  1, A, p, "sampled object") \
+  PARAM(X,  2, W, size, "size of sampled object")
+
 #endif /* eventdef_h */
 
 
@@ -0,0 +1,571 @@
+/* eventtrace.c: event text log to Chrome trace-event format.
+ *
+ * $Id$
+ *
+ * Copyright (c) 2012-2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is a command-line tool that converts events from a text-format
+ * MPS telemetry file (as output by the eventcnv program, q.v.) into
+ * the JSON trace-event format understood by Chrome's about:tracing
+ * viewer and by the Perfetto UI <https://ui.perfetto.dev/>, so that
+ * the timeline of collections, pauses and heap growth can be
+ * inspected visually.
+ *
+ * The conversion is as follows:
+ *
+ * .trace: Each trace is an asynchronous span from TraceCreate to
+ * TraceDestroy, with nested spans for its condemn phase (TraceCreate
+ * to TraceStart), its scan phase (TraceFlipEnd to TraceReclaim) and
+ * its reclaim phase (TraceReclaim to TraceDestroy).
+ *
+ * .pause: Polls that did some work (ArenaPollBegin to ArenaPollEnd),
+ * barrier hits (ArenaAccessBegin to ArenaAccessEnd) and flips
+ * (TraceFlipBegin to TraceFlipEnd) are slices on the "mutator" track,
+ * since these are the times when the client program is paused.
+ *
+ * .scan: Segment and root scans are nested slices.  The telemetry
+ * stream records only the start of each scan (SegScan and RootScan),
+ * so a scan is taken to end at the start of the next scan, or at the
+ * next pause or trace event, whichever is sooner.  This makes the
+ * slices nest properly within the pauses, at the cost of
+ * over-estimating the duration of the last scan in each pause.
+ *
+ * .counter: The total size of memory allocated by the arena
+ * (ArenaAlloc less ArenaFree) and mapped by the virtual memory
+ * interface (VMMap less VMUnmap) are counter tracks.
+ *
+ * .thread: The telemetry stream does not record which thread emitted
+ * an event, so the tracks are logical rather than per-thread.
+ *
+ * .clock: Event timestamps are in units of the event clock, which may
+ * be a processor cycle counter.  The tool makes two passes over the
+ * log: the first finds the first and last EventClockSync events,
+ * which relate the event clock to mps_clock(), and the EventInit
+ * event, which gives mps_clocks_per_sec(); the second pass uses these
+ * to convert timestamps to microseconds.  If the log is read from
+ * standard input, it is copied to a temporary file during the first
+ * pass.
+ *
+ * The input should be sorted by timestamp, as for eventtxt:
+ *
+ *     mpseventcnv | sort | mpseventtrace > mpsio.json
+ *
+ * Options:
+ *
+ * -l <logfile>: Import events from the named logfile.  Defaults to
+ * stdin.
+ *
+ * $Id$
+ */
+
+#include "check.h"
+#include "config.h"
+#include "eventcom.h"
+#include "eventdef.h"
+#include "mps.h"
+#include "testlib.h" /* for ulongest_t and associated print formats */
+
+#include <stdio.h>
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS */
+
+static const char *prog; /* program name */
+static const char *logFileName = NULL;
+
+/* everror -- error signalling */
+
+ATTRIBUTE_FORMAT((printf, 1, 2))
+static void everror(const char *format, ...)
+{
+  va_list args;
+
+  (void)fflush(stdout); /* sync */
+  (void)fprintf(stderr, "%s: ", prog);
+  va_start(args, format);
+  (void)vfprintf(stderr, format, args);
+  (void)fprintf(stderr, "\n");
+  va_end(args);
+  exit(EXIT_FAILURE);
+}
+
+static void usage(void)
+{
+  (void)fprintf(stderr, "Usage: %s [-l <logfile>]\n", prog);
+}
+
+static void usageError(void)
+{
+  usage();
+  everror("Bad usage");
+}
+
+/* parseArgs -- parse command line arguments */
+
+static void parseArgs(int argc, char *argv[])
+{
+  int i = 1;
+
+  if (argc >= 1)
+    prog = argv[0];
+  else
+    prog = "unknown";
+
+  while (i < argc) { /* consider argument i */
+    if (argv[i][0] == '-') { /* it's an option argument */
+      switch (argv[i][1]) {
+      case 'l': /* log file name */
+        ++ i;
+        if (i == argc)
+          usageError();
+        else
+          logFileName = argv[i];
+        break;
+      case '?': case 'h': /* help */
+        usage();
+        exit(EXIT_SUCCESS);
+      default:
+        usageError();
+      }
+    } /* if option */
+    ++ i;
+  }
+}
+
+
+/* Reading clocks, hex numbers, doubles, and quoted-and-escaped
+ * strings.  Only the syntax of doubles and strings is checked: their
+ * values are not needed. */
+
+static EventClock parseClock(char **pInOut)
+{
+  EventClock val;
+  int i, l;
+  unsigned long low, high;
+  char *p = *pInOut;
+
+  i = sscanf(p, "%08lX%08lX%n", &high, &low, &l);
+  if (i != 2)
+    everror("Couldn't read a clock from '%s'", p);
+  EVENT_CLOCK_MAKE(val, low, high);
+
+  *pInOut = p + l;
+  return val;
+}
+
+static ulongest_t parseHex(char **pInOut)
+{
+  ulongest_t val;
+  int i, l;
+  char *p = *pInOut;
+
+  i = sscanf(p, "%" SCNXLONGEST "%n", &val, &l);
+  if (i != 1)
+    everror("Couldn't read a hex number from '%s'", p);
+  *pInOut = p + l;
+  return val;
+}
+
+static void skipDouble(char **pInOut)
+{
+  double val;
+  int i, l;
+  char *p = *pInOut;
+
+  i = sscanf(p, "%lg%n", &val, &l);
+  if (i != 1)
+    everror("Couldn't read a float from '%s'", p);
+  *pInOut = p + l;
+}
+
+static void skipString(char **pInOut)
+{
+  char *p = *pInOut;
+  while(*p == ' ')
+    ++p;
+
+  if (*p != '"')
+    everror("String has no opening quotation mark: '%s'", p);
+  ++p;
+
+  while(1) {
+    if (*p == '\\') { /* escaped character */
+      ++p;
+      if (*p == '\0')
+        everror("Closing NUL byte escaped by backslash.");
+      ++p;
+    } else if (*p == '"') { /* end of string */
+      ++p;
+      *pInOut = p;
+      return;
+    } else if (*p == '\0')
+      everror("Unexpected closing NUL byte.");
+    else
+      ++p;
+  }
+}
+
+
+/* parameter processing.  Integer parameters of the events of
+ * interest are stored in the val array, indexed by their position
+ * in the event; other parameters are skipped. */
+
+#define MAX_PARAMS 16
+
+#define processParamA(index) val[index] = parseHex(&p);
+#define processParamP(index) val[index] = parseHex(&p);
+#define processParamW(index) val[index] = parseHex(&p);
+#define processParamU(index) val[index] = parseHex(&p);
+#define processParamB(index) val[index] = parseHex(&p);
+#define processParamD(index) skipDouble(&p);
+#define processParamS(index) skipString(&p);
+
+#define EVENT_PROCESS_PARAM(X, index, sort, ident, doc) \
+  processParam##sort(index);
+
+#define EVENT_PROCESS(X, name, code, used, kind)        \
+  case code:                                            \
+    EVENT_##name##_PARAMS(EVENT_PROCESS_PARAM, X)       \
+    break;
+
+
+/* Clock calibration, see .clock. */
+
+static Bool syncFound = FALSE;    /* seen any EventClockSync? */
+static EventClock syncFirst;      /* event clock of first sync */
+static EventClock syncLast;       /* event clock of last sync */
+static ulongest_t syncFirstClock; /* mps_clock() at first sync */
+static ulongest_t syncLastClock;  /* mps_clock() at last sync */
+static ulongest_t clocksPerSec = 0; /* mps_clocks_per_sec() */
+static Bool baseFound = FALSE;    /* seen any event? */
+static EventClock clockBase;      /* event clock of first event */
+static EventClock clockLast;      /* event clock of last event */
+static double ticksPerMicrosecond = 1.0;
+
+static void calibrate(void)
+{
+  double ticks, seconds;
+
+  if (clocksPerSec == 0) {
+    (void)fprintf(stderr, "%s: no EventInit event: "
+                  "timestamps will be in event clock units\n", prog);
+    return;
+  }
+  if (!syncFound || syncLastClock <= syncFirstClock
+      || syncLast <= syncFirst)
+  {
+    /* Assume the event clock is mps_clock(). */
+    ticksPerMicrosecond = (double)clocksPerSec / 1e6;
+    return;
+  }
+  ticks = (double)(syncLast - syncFirst);
+  seconds = (double)(syncLastClock - syncFirstClock) / (double)clocksPerSec;
+  ticksPerMicrosecond = ticks / (seconds * 1e6);
+}
+
+static double timestamp(EventClock clock)
+{
+  if (clock < clockBase)
+    return 0.0;
+  return (double)(clock - clockBase) / ticksPerMicrosecond;
+}
+
+
+/* output code */
+
+static Bool firstRecord = TRUE;
+
+/* printRecord -- start a JSON trace event record
+ *
+ * The caller must print the remainder of the record, if any, and the
+ * closing brace.
+ */
+
+static void printRecord(const char *phase, const char *category,
+                        const char *name, EventClock clock)
+{
+  printf("%s\n{\"ph\":\"%s\",\"cat\":\"%s\",\"name\":\"%s\","
+         "\"pid\":1,\"ts\":%.3f",
+         firstRecord ? "" : ",", phase, category, name, timestamp(clock));
+  firstRecord = FALSE;
+}
+
+/* Thread ids for the logical tracks, see .thread. */
+
+#define TRACK_MUTATOR 1
+#define TRACK_COLLECTOR 2
+
+static void printTrackName(int tid, const char *name)
+{
+  printf("%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,"
+         "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+         firstRecord ? "" : ",", tid, name);
+  firstRecord = FALSE;
+}
+
+/* printSlice -- a complete slice on the mutator track */
+
+static void printSlice(const char *category, const char *name,
+                       EventClock begin, EventClock end)
+{
+  printRecord("X", category, name, begin);
+  printf(",\"tid\":%d,\"dur\":%.3f}", TRACK_MUTATOR,
+         timestamp(end) - timestamp(begin));
+}
+
+/* printTracePhase -- begin or end an asynchronous trace span */
+
+static void printTracePhase(const char *phase, const char *name,
+                            EventClock clock, ulongest_t trace)
+{
+  printRecord(phase, "trace", name, clock);
+  printf(",\"tid\":%d,\"id\":\"0x%" PRIXLONGEST "\"}",
+         TRACK_COLLECTOR, trace);
+}
+
+static void printCounter(const char *name, EventClock clock,
+                         ulongest_t value)
+{
+  printRecord("C", "arena", name, clock);
+  printf(",\"args\":{\"bytes\":%" PRIuLONGEST "}}", value);
+}
+
+
+/* Pending slices.  A slice is pending between its begin and end
+ * events.  At most one scan is pending at a time, see .scan. */
+
+typedef struct PendingStruct {
+  Bool pending;                 /* slice begun but not ended? */
+  EventClock begin;             /* clock at start of slice */
+} PendingStruct;
+
+static PendingStruct pollSlice, accessSlice, flipSlice, scanSlice;
+static const char *scanName;   /* "SegScan" or "RootScan" */
+static ulongest_t allocated = 0; /* bytes allocated by arenas */
+static ulongest_t mapped = 0;    /* bytes mapped by VMs */
+
+/* scanEnd -- end the pending scan, if any */
+
+static void scanEnd(EventClock clock)
+{
+  if (scanSlice.pending) {
+    printSlice("scan", scanName, scanSlice.begin, clock);
+    scanSlice.pending = FALSE;
+  }
+}
+
+static void scanBegin(EventClock clock, const char *name)
+{
+  scanEnd(clock);
+  scanSlice.pending = TRUE;
+  scanSlice.begin = clock;
+  scanName = name;
+}
+
+static void sliceBegin(PendingStruct *slice, EventClock clock)
+{
+  scanEnd(clock);
+  slice->pending = TRUE;
+  slice->begin = clock;
+}
+
+static void sliceEnd(PendingStruct *slice, const char *name,
+                     EventClock clock, Bool print)
+{
+  scanEnd(clock);
+  if (slice->pending && print)
+    printSlice("pause", name, slice->begin, clock);
+  slice->pending = FALSE;
+}
+
+
+/* processEvent -- convert one event to trace-event records */
+
+static void processEvent(EventClock clock, int code, ulongest_t *val)
+{
+  switch (code) {
+  case EventArenaPollBeginCode:
+    sliceBegin(&pollSlice, clock);
+    break;
+  case EventArenaPollEndCode:   /* val[1] is workWasDone */
+    sliceEnd(&pollSlice, "ArenaPoll", clock, val[1] != 0);
+    break;
+  case EventArenaAccessBeginCode:
+    sliceBegin(&accessSlice, clock);
+    break;
+  case EventArenaAccessEndCode:
+    sliceEnd(&accessSlice, "ArenaAccess", clock, TRUE);
+    break;
+  case EventTraceFlipBeginCode: /* val[0] is trace */
+    sliceBegin(&flipSlice, clock);
+    break;
+  case EventTraceFlipEndCode:   /* val[0] is trace */
+    sliceEnd(&flipSlice, "TraceFlip", clock, TRUE);
+    printTracePhase("b", "scan", clock, val[0]);
+    break;
+  case EventSegScanCode:
+    scanBegin(clock, "SegScan");
+    break;
+  case EventRootScanCode:
+    scanBegin(clock, "RootScan");
+    break;
+  case EventTraceCreateCode:    /* val[0] is trace */
+    scanEnd(clock);
+    printTracePhase("b", "Trace", clock, val[0]);
+    printTracePhase("b", "condemn", clock, val[0]);
+    break;
+  case EventTraceStartCode:     /* val[1] is trace */
+    scanEnd(clock);
+    printTracePhase("e", "condemn", clock, val[1]);
+    break;
+  case EventTraceReclaimCode:   /* val[0] is trace */
+    scanEnd(clock);
+    printTracePhase("e", "scan", clock, val[0]);
+    printTracePhase("b", "reclaim", clock, val[0]);
+    break;
+  case EventTraceDestroyCode:   /* val[1] is trace */
+    scanEnd(clock);
+    printTracePhase("e", "reclaim", clock, val[1]);
+    printTracePhase("e", "Trace", clock, val[1]);
+    break;
+  case EventArenaAllocCode:     /* val[3] is size */
+    allocated += val[3];
+    printCounter("allocated", clock, allocated);
+    break;
+  case EventArenaFreeCode:      /* val[2] is size */
+    allocated -= val[2];
+    printCounter("allocated", clock, allocated);
+    break;
+  case EventVMMapCode:          /* val[1] is base, val[2] is limit */
+    mapped += val[2] - val[1];
+    printCounter("mapped", clock, mapped);
+    break;
+  case EventVMUnmapCode:        /* val[1] is base, val[2] is limit */
+    mapped -= val[2] - val[1];
+    printCounter("mapped", clock, mapped);
+    break;
+  default:
+    break;
+  }
+}
+
+
+/* readLog -- read and parse log.
+ *
+ * On the first pass, find the calibration events (see .clock) and
+ * copy the log to copy, if not NULL.  On the second pass, convert the
+ * events.
+ */
+
+#define MAX_LOG_LINE_LENGTH 1024
+
+static void readLog(FILE *input, Bool convert, FILE *copy)
+{
+  while (TRUE) { /* loop for each event */
+    char line[MAX_LOG_LINE_LENGTH];
+    char *p;
+    EventClock clock;
+    int code;
+    ulongest_t val[MAX_PARAMS] = {0}; /* not all events have all params */
+
+    p = fgets(line, MAX_LOG_LINE_LENGTH, input);
+    if (!p) {
+      if (feof(input))
+        break;
+      else
+        everror("Couldn't read line from input.");
+    }
+    if (copy != NULL && fputs(line, copy) == EOF)
+      everror("Couldn't copy line to temporary file.");
+
+    clock = parseClock(&p);
+    code = (int)parseHex(&p);
+    if (code < 0 || code > EventCodeMAX)
+      continue;
+
+    switch(code) {
+      EVENT_LIST(EVENT_PROCESS, X);
+    default:
+      break;
+    }
+
+    if (!convert) {
+      if (!baseFound || clock < clockBase)
+        clockBase = clock;
+      if (!baseFound || clock > clockLast)
+        clockLast = clock;
+      baseFound = TRUE;
+      if (code == EventEventInitCode) {
+        clocksPerSec = val[6];  /* clocksPerSec */
+      } else if (code == EventEventClockSyncCode) {
+        if (!syncFound) {
+          syncFirst = clock;
+          syncFirstClock = val[0]; /* clock */
+          syncFound = TRUE;
+        }
+        syncLast = clock;
+        syncLastClock = val[0]; /* clock */
+      }
+    } else {
+      processEvent(clock, code, val);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *input;
+
+  parseArgs(argc, argv);
+  if (!logFileName) {
+    /* Standard input can't be rewound, so copy it, see .clock. */
+    input = tmpfile();
+    if (input == NULL)
+      everror("unable to create temporary file");
+    readLog(stdin, FALSE, input);
+  } else {
+    input = fopen(logFileName, "r");
+    if (input == NULL)
+      everror("unable to open %s", logFileName);
+    readLog(input, FALSE, NULL);
+  }
+  rewind(input);
+  calibrate();
+
+  printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  printTrackName(TRACK_MUTATOR, "mutator");
+  printTrackName(TRACK_COLLECTOR, "collector");
+  readLog(input, TRUE, NULL);
+  scanEnd(clockLast);
+  printf("\n]}\n");
+
+  (void)fclose(input);
+  return 0;
+}
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2012-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
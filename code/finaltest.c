@@ -141,6 +141,27 @@ static void register_indirect_tree(mps_word_t tree, mps_arena_t arena)
 
 static void *root[rootCOUNT];
 
+
+/* Count notifications of finalization messages. Notifications are
+ * coalesced, so there may be fewer than messages, but there must be
+ * at least one if there were any messages. They are delivered after
+ * the arena lock is released, so the notifier can call the MPS. */
+
+static size_t final_notified = 0;
+
+static void final_notify(mps_arena_t arena, mps_message_type_t type,
+                         void *p)
+{
+  mps_message_type_t queued;
+  Insist(p == &final_notified);
+  if (type == mps_message_type_finalization()) {
+    Insist(mps_message_queue_type(&queued, arena));
+    ++ final_notified;
+  }
+}
+
+#define drainCOUNT 64
+
 static void test_trees(int mode, const char *name, mps_arena_t arena,
                        mps_pool_t pool, mps_ap_t ap,
                        mps_word_t (*make)(mps_word_t, mps_ap_t),
@@ -153,6 +174,7 @@ static void test_trees(int mode, const char *name, mps_arena_t arena,
   PoolClass klass = ClassOfPoly(Pool, pool);
 
   object_count = 0;
+  final_notified = 0;
 
   printf("---- Mode %s, pool class %s, %s trees ----\n",
          mode == ModePARK ? "PARK" : "POLL",
@@ -199,13 +221,21 @@ static void test_trees(int mode, const char *name, mps_arena_t arena,
       Insist(free_size <= total_size);
       Insist(free_size + live_size <= total_size);
     }
+    for (;;) {
+      mps_addr_t refs[drainCOUNT];
+      size_t n = mps_message_finalization_drain(refs, drainCOUNT, arena);
+      Insist(n <= drainCOUNT);
+      for (i = 0; i < n; ++i)
+        Insist(refs[i] != NULL);
+      final_this_time += n;
+      if (n < drainCOUNT)
+        break;
+    }
     while (mps_message_queue_type(&type, arena)) {
       mps_message_t message;
       cdie(mps_message_get(&message, arena, type), "message_get");
       if (type == mps_message_type_finalization()) {
-        mps_addr_t objaddr;
-        mps_message_finalization_ref(&objaddr, arena, message);
-        ++ final_this_time;
+        error("Finalization message left after drain.");
       } else if (type == mps_message_type_gc()) {
         ++ collections;
       } else {
@@ -226,6 +256,11 @@ static void test_trees(int mode, const char *name, mps_arena_t arena,
           mode == ModePOLL ? "POLL" : "PARK");
   }
 
+  if (finals > 0 ? final_notified == 0 || final_notified > finals
+                 : final_notified != 0)
+    error("Notified %lu times of finalization messages but got %lu.",
+          (unsigned long)final_notified, (unsigned long)finals);
+
   if (collections > collectionCOUNT)
     error("Expected no more than %lu collections but got %lu.",
           (unsigned long)collectionCOUNT, (unsigned long)collections);
@@ -300,6 +335,7 @@ int main(int argc, char *argv[])
         "arena_create\n");
   } MPS_ARGS_END(args);
   mps_message_type_enable(arena, mps_message_type_finalization());
+  mps_message_notify_set(arena, final_notify, &final_notified);
   die(mps_thread_reg(&thread, arena), "thread_reg\n");
   for (i = 0; i < gens; ++i) {
     params[i].mps_capacity = 1;
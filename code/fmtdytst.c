@@ -148,6 +148,31 @@ mps_res_t make_dylan_vector(mps_word_t *v, mps_ap_t ap, size_t slots)
   return MPS_RES_OK;
 }
 
+/* dylan_alloc -- allocate an object on an allocation point
+ *
+ * Reserves, initializes (see dylan_init) and commits an object of
+ * size bytes, retrying until the commit succeeds.
+ */
+
+mps_res_t dylan_alloc(mps_addr_t *pReturn, mps_ap_t ap, size_t size,
+                      mps_addr_t *refs, size_t nr_refs)
+{
+  mps_res_t res;
+  mps_addr_t addr;
+
+  do {
+    MPS_RESERVE_BLOCK(res, addr, ap, size);
+    if (res != MPS_RES_OK)
+      return res;
+    res = dylan_init(addr, size, refs, nr_refs);
+    if (res != MPS_RES_OK)
+      return res;
+  } while (!mps_commit(ap, addr, size));
+
+  *pReturn = addr;
+  return MPS_RES_OK;
+}
+
 
 void dylan_write(mps_addr_t addr, mps_addr_t *refs, size_t nr_refs)
 {
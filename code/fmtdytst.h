@@ -22,6 +22,8 @@ extern int dylan_wrapper_check(mps_word_t *w);
 extern mps_res_t dylan_make_wrappers(void);
 
 extern mps_res_t make_dylan_vector(mps_word_t *v, mps_ap_t ap, size_t slots);
+extern mps_res_t dylan_alloc(mps_addr_t *pReturn, mps_ap_t ap, size_t size,
+                             mps_addr_t *refs, size_t nr_refs);
 
 #define DYLAN_VECTOR_SLOT(o,n) (((mps_word_t *) (o))[(n)+2])
 
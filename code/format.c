@@ -33,6 +33,7 @@ Bool FormatCheck(Format format)
   CHECKL(FUNCHECK(format->isMoved));
   CHECKL(FUNCHECK(format->pad));
   CHECKL(FUNCHECK(format->klass));
+  CHECKL(format->census == NULL || FUNCHECK(format->census));
 
   return TRUE;
 }
@@ -95,6 +96,7 @@ ARG_DEFINE_KEY(FMT_ISFWD, Fun);
 ARG_DEFINE_KEY(FMT_PAD, Fun);
 ARG_DEFINE_KEY(FMT_HEADER_SIZE, Size);
 ARG_DEFINE_KEY(FMT_CLASS, Fun);
+ARG_DEFINE_KEY(FMT_CENSUS, Fun);
 
 Res FormatCreate(Format *formatReturn, Arena arena, ArgList args)
 {
@@ -110,6 +112,7 @@ Res FormatCreate(Format *formatReturn, Arena arena, ArgList args)
   mps_fmt_isfwd_t fmtIsfwd = FMT_ISFWD_DEFAULT;
   mps_fmt_pad_t fmtPad = FMT_PAD_DEFAULT;
   mps_fmt_class_t fmtClass = FMT_CLASS_DEFAULT;
+  mps_fmt_census_t fmtCensus = FMT_CENSUS_DEFAULT;
 
   AVER(formatReturn != NULL);
   AVERT(Arena, arena);
@@ -131,6 +134,8 @@ Res FormatCreate(Format *formatReturn, Arena arena, ArgList args)
     fmtPad = arg.val.fmt_pad;
   if (ArgPick(&arg, args, MPS_KEY_FMT_CLASS))
     fmtClass = arg.val.fmt_class;
+  if (ArgPick(&arg, args, MPS_KEY_FMT_CENSUS))
+    fmtCensus = arg.val.fmt_census;
 
   res = ControlAlloc(&p, arena, sizeof(FormatStruct));
   if(res != ResOK)
@@ -148,6 +153,7 @@ Res FormatCreate(Format *formatReturn, Arena arena, ArgList args)
   format->isMoved = fmtIsfwd;
   format->pad = fmtPad;
   format->klass = fmtClass;
+  format->census = fmtCensus;
 
   format->sig = FormatSig;
   format->serial = arena->formatSerial;
@@ -0,0 +1,251 @@
+/* freezetest.c: FROZEN POOL TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Makes objects in a pool and freezes it with
+ * mps_pool_freeze, so that the objects are not collected even though
+ * they are not reachable from any root. Then allocates in a second
+ * pool, whose objects refer to the frozen objects, while that pool is
+ * collected. Checks that the frozen objects are intact, that the
+ * frozen pool doesn't change size, and that its objects can still be
+ * walked. Finally thaws the pool, and checks that the objects are
+ * then collected. See <design/seg#.frozen>.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpscams.h"
+#include "mpsclo.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define frozenCOUNT       1000
+#define rootsCOUNT        1000
+#define objectsCOUNT      100000
+#define checkFREQ         10000
+#define avLEN             3
+#define genCOUNT          2
+
+/* objNULL needs to be odd so that it's ignored in roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 150, 0.85 }, { 170, 0.45 } };
+
+static mps_addr_t frozenObjs[frozenCOUNT]; /* not a root */
+static mps_addr_t roots[rootsCOUNT];
+
+
+/* make_frozen -- make objects in a pool and freeze it
+ *
+ * Each object refers only to objects made before it (or to none, if
+ * the pool is not scanned), so that the frozen objects refer only to
+ * each other. They are not reachable from any root, so the arena is
+ * parked until they are frozen.
+ */
+
+static void make_frozen(mps_arena_t arena, mps_pool_t pool,
+                        mps_bool_t scanned)
+{
+  mps_ap_t ap;
+  size_t i;
+
+  mps_arena_park(arena);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create frozen");
+  for (i = 0; i < frozenCOUNT; ++i) {
+    size_t size = (rnd() % (avLEN * 8) + 2) * sizeof(mps_word_t);
+    die(dylan_alloc(&frozenObjs[i], ap, size, frozenObjs, scanned ? i : 0),
+        "dylan_alloc frozen");
+  }
+  /* Memory attached to an allocation point is not frozen. */
+  mps_ap_destroy(ap);
+  die(mps_pool_freeze(pool), "mps_pool_freeze");
+  mps_arena_release(arena);
+}
+
+
+/* check_frozen -- check the frozen objects */
+
+static void check_frozen(mps_arena_t arena)
+{
+  size_t i;
+  for (i = 0; i < frozenCOUNT; ++i)
+    cdie(dylan_check(frozenObjs[i])
+         && mps_arena_has_addr(arena, frozenObjs[i]),
+         "frozen objects check");
+}
+
+
+/* area_count -- area scanning function for mps_pool_walk
+ *
+ * Counts the objects in the area, not including padding.
+ */
+
+static mps_res_t area_count(mps_ss_t ss, void *base, void *limit,
+                            void *closure)
+{
+  size_t *count = closure;
+  mps_res_t res;
+  while (base < limit) {
+    mps_addr_t prev = base;
+    if (!dylan_ispad(base))
+      ++ *count;
+    res = dylan_scan1(ss, &base);
+    if (res != MPS_RES_OK)
+      return res;
+    Insist(prev < base);
+  }
+  Insist(base == limit);
+  return MPS_RES_OK;
+}
+
+
+/* allocated -- memory allocated to objects in a pool */
+
+static size_t allocated(mps_pool_t pool)
+{
+  return mps_pool_total_size(pool) - mps_pool_free_size(pool);
+}
+
+
+static void test(mps_arena_t arena, mps_pool_class_t pool_class,
+                 mps_bool_t scanned)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t frozenPool, pool;
+  mps_root_t root;
+  mps_ap_t ap;
+  size_t i, frozenSize, count;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&frozenPool, arena, pool_class, args),
+        "pool_create frozen");
+  } MPS_ARGS_END(args);
+  make_frozen(arena, frozenPool, scanned);
+  frozenSize = allocated(frozenPool);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  for (i = 0; i < rootsCOUNT; ++i)
+    roots[i] = objNULL;
+  die(mps_root_create_table_masked(&root, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, roots, rootsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table");
+
+  /* The new objects refer to each other, and to the frozen objects,
+     which must not move. */
+  for (i = 0; i < objectsCOUNT; ++i) {
+    size_t length = rnd() % (avLEN * 2);
+    size_t r = (size_t)rnd() % rootsCOUNT;
+    if (roots[r] != objNULL)
+      cdie(dylan_check(roots[r]), "root check");
+    if (r % 2 == 0)
+      die(dylan_alloc(&roots[r], ap, (length + 2) * sizeof(mps_word_t),
+                      roots, rootsCOUNT),
+          "dylan_alloc");
+    else
+      die(dylan_alloc(&roots[r], ap, (length + 2) * sizeof(mps_word_t),
+                      frozenObjs, frozenCOUNT),
+          "dylan_alloc");
+    if (i % checkFREQ == 0) {
+      check_frozen(arena);
+      Insist(allocated(frozenPool) == frozenSize);
+    }
+  }
+
+  mps_arena_park(arena);
+  printf("%lu collections\n", (unsigned long)mps_collections(arena));
+  check_frozen(arena);
+  Insist(allocated(frozenPool) == frozenSize);
+  count = 0;
+  die(mps_pool_walk(frozenPool, area_count, &count), "mps_pool_walk");
+  Insist(count == frozenCOUNT);
+
+  /* Once thawed, the frozen objects are unreachable and so die. */
+  mps_root_destroy(root);
+  mps_pool_thaw(frozenPool);
+  die(mps_arena_collect(arena), "collect");
+  printf("frozen pool allocated %lu bytes, then %lu after thawing\n",
+         (unsigned long)frozenSize, (unsigned long)allocated(frozenPool));
+  Insist(allocated(frozenPool) < frozenSize);
+
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_pool_destroy(frozenPool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+      "arena_create");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  test(arena, mps_class_amc(), TRUE);
+  test(arena, mps_class_amcz(), FALSE);
+  test(arena, mps_class_ams(), TRUE);
+  test(arena, mps_class_lo(), FALSE);
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -40,6 +40,7 @@ static mps_chain_t chain;
 /* objNULL needs to be odd so that it's ignored in exactRoots. */
 #define objNULL           ((obj_t)MPS_WORD_CONST(0xDECEA5ED))
 #define genLIMIT  100
+#define descentCOUNT      65536   /* random descents of tree per pass */
 
 static rnd_state_t seed = 0;      /* random number seed */
 static unsigned nthreads = 1;     /* threads */
@@ -57,6 +58,8 @@ static unsigned pinleaf = FALSE;  /* are leaf objects pinned at start */
 static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static double pause_time = ARENA_DEFAULT_PAUSE_TIME; /* maximum pause time */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
+static mps_bool_t depth_first = FALSE; /* AMC copies depth-first */
+static double dense = 0.0;        /* AMC dense survival fraction */
 
 typedef struct gcthread_s *gcthread_t;
 
@@ -181,6 +184,50 @@ static void *gc_tree(gcthread_t thread)
   return NULL;
 }
 
+/* descend_tree - follow random paths from the root of a tree to its
+ * leaves, returning the number of nodes visited. */
+static size_t descend_tree(obj_t tree, unsigned d)
+{
+  size_t i, count = 0;
+  for (i = 0; i < descentCOUNT; ++i) {
+    obj_t node = tree;
+    unsigned k;
+    for (k = 0; k < d && node != objNULL; ++k) {
+      node = aref(node, rnd() % width);
+      ++count;
+    }
+  }
+  return count;
+}
+
+/* gc_walk -- measure mutator locality after collection
+ *
+ * Makes a tree, collects the world so that the tree is copied, and
+ * then times random descents of the copy. The time depends on how
+ * close together the collector placed parents and children.
+ */
+static void *gc_walk(gcthread_t thread)
+{
+  unsigned i, j;
+  mps_ap_t ap = thread->ap;
+  obj_t leaf = pinleaf ? mktree(ap, 1, objNULL) : objNULL;
+  clock_t walk_time = 0;
+  size_t count = 0;
+  for (i = 0; i < niter; ++i) {
+    obj_t tree = mktree(ap, depth, leaf);
+    clock_t begin;
+    mps_arena_collect(arena);
+    mps_arena_release(arena);
+    begin = clock();
+    for (j = 0 ; j < npass; ++j)
+      count += descend_tree(tree, depth);
+    walk_time += clock() - begin;
+  }
+  printf("walk: %g (%lu nodes)\n", (double)walk_time / CLOCKS_PER_SEC,
+         (unsigned long)count);
+  return NULL;
+}
+
 /* start -- start routine for each thread */
 static void *start(void *p)
 {
@@ -258,6 +305,10 @@ static void arena_setup(gcthread_fn_t fn,
     RESMUST(mps_chain_create(&chain, arena, ngen, gen));
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    if (pool_class == mps_class_amc()) {
+      MPS_ARGS_ADD(args, MPS_KEY_AMC_DEPTH_FIRST, depth_first);
+      MPS_ARGS_ADD(args, MPS_KEY_AMC_DENSE, dense);
+    }
     if (ngen > 0)
       MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
     RESMUST(mps_pool_create_k(&pool, arena, pool_class, args));
@@ -291,6 +342,8 @@ static struct option longopts[] = {
   {"arena-unzoned",    no_argument,       NULL, 'z'},
   {"pause-time",       required_argument, NULL, 'P'},
   {"spare",            required_argument, NULL, 'S'},
+  {"depth-first",      no_argument,       NULL, 'D'},
+  {"dense",            required_argument, NULL, 'E'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -303,6 +356,7 @@ static struct {
   {"amc", gc_tree, mps_class_amc},
   {"ams", gc_tree, mps_class_ams},
   {"awl", gc_tree, mps_class_awl},
+  {"amcwalk", gc_walk, mps_class_amc},
 };
 
 
@@ -316,7 +370,7 @@ int main(int argc, char *argv[])
 
   seed = rnd_seed();
 
-  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:S:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:S:DE:",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -413,6 +467,12 @@ int main(int argc, char *argv[])
     case 'S':
       spare = strtod(optarg, NULL);
       break;
+    case 'D':
+      depth_first = TRUE;
+      break;
+    case 'E':
+      dense = strtod(optarg, NULL);
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -462,10 +522,15 @@ int main(int argc, char *argv[])
               "    Maximum pause time in seconds (default %f)\n"
               "  -S f, --spare\n"
               "    Maximum spare committed fraction (default %f)\n"
+              "  -D, --depth-first\n"
+              "    AMC copies objects depth-first\n"
+              "  -E f, --dense=f\n"
+              "    AMC keeps segments this fraction live (default off)\n"
               "Tests:\n"
-              "  amc   pool class AMC\n"
-              "  ams   pool class AMS\n"
-              "  awl   pool class AWL\n",
+              "  amc      pool class AMC\n"
+              "  ams      pool class AMS\n"
+              "  awl      pool class AWL\n"
+              "  amcwalk  descend tree after AMC collection\n",
               pause_time,
               spare);
       return EXIT_FAILURE;
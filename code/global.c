@@ -61,6 +61,7 @@ void GlobalsClaimAll(void)
   LockClaimGlobalRecursive();
   arenaClaimRingLock();
   GlobalsArenaMap(ArenaEnter);
+  LockClaimGlobalEvent(); /* claimed last: <code/event.c#.sync.lock> */
 }
 
 /* GlobalsReleaseAll -- release all MPS locks. GlobalsClaimAll must
@@ -68,6 +69,7 @@ void GlobalsClaimAll(void)
 
 void GlobalsReleaseAll(void)
 {
+  LockReleaseGlobalEvent();
   GlobalsArenaMap(ArenaLeave);
   arenaReleaseRingLock();
   LockReleaseGlobalRecursive();
@@ -79,6 +81,10 @@ static void arenaReinitLock(Arena arena)
 {
   AVERT(Arena, arena);
   ShieldLeave(arena);
+  /* Threads that were looking up addresses in the parent don't exist
+     in the child. <code/arena.c#.lookup> */
+  arena->lookupReaders = 0;
+  arena->lookupExcluded = 0;
   LockInit(ArenaGlobals(arena)->lock);
 }
 
@@ -192,6 +198,9 @@ Bool GlobalsCheck(Globals arenaGlobals)
   CHECKD_NOSIG(Ring, &arena->messageRing);
   if (arena->enabledMessageTypes != NULL)
     CHECKD_NOSIG(BT, arena->enabledMessageTypes);
+  if (arena->messageNotify != NULL)
+    CHECKL(FUNCHECK(arena->messageNotify));
+  CHECKL(arena->messageNotifyPending >> MessageTypeLIMIT == 0);
   CHECKL(BoolCheck(arena->isFinalPool));
   if (arena->isFinalPool) {
     CHECKD(Pool, arena->finalPool);
@@ -207,6 +216,7 @@ Bool GlobalsCheck(Globals arenaGlobals)
   CHECKL(TraceSetCheck(arena->busyTraces));
   CHECKL(TraceSetCheck(arena->flippedTraces));
   CHECKL(TraceSetSuper(arena->busyTraces, arena->flippedTraces));
+  CHECKL(arena->rb_s._arena == arena);
 
   TRACE_SET_ITER(ti, trace, TraceSetUNIV, arena)
     /* <design/arena#.trace> */
@@ -319,13 +329,29 @@ Res GlobalsInit(Globals arenaGlobals)
   RingInit(&arena->messageRing);
   arena->enabledMessageTypes = NULL;
   arena->droppedMessages = 0;
+  arena->messageNotify = NULL;
+  arena->messageNotifyClosure = NULL;
+  arena->messageNotifyPending = 0;
   arena->isFinalPool = FALSE;
   arena->finalPool = NULL;
   arena->busyTraces = TraceSetEMPTY;    /* <code/trace.c> */
   arena->flippedTraces = TraceSetEMPTY; /* <code/trace.c> */
+  arena->rb_s._arena = arena;
+  arena->rb_s._zs = 0;
+  arena->rb_s._w = ZoneSetEMPTY;
+  arena->rb_s._epoch = 0;
   arena->tracedWork = 0.0;
   arena->tracedTime = 0.0;
   arena->lastWorldCollect = ClockNow();
+  HistogramInit(&arena->pollHistogram);
+  HistogramInit(&arena->flipHistogram);
+  HistogramInit(&arena->reclaimHistogram);
+  HistogramInit(&arena->suspendHistogram);
+  arena->accessCount = 0;
+  arena->fillCount = 0;
+  arena->fixRefCount = 0;
+  arena->whiteSegRefCount = 0;
+  arena->genSkipCount = 0;
   ShieldInit(ArenaShield(arena));
 
   for (ti = 0; ti < TraceLIMIT; ++ti) {
@@ -592,12 +618,30 @@ void ArenaEnterRecursive(Arena arena)
   ArenaEnterLock(arena, TRUE);
 }
 
-/* ArenaLeave -- leave the state where you can look at MPM data structures */
+/* ArenaLeave -- leave the state where you can look at MPM data structures
+ *
+ * .leave.notify: Message notifications are delivered after the lock
+ * is released, so that the client's notifier runs with the mutator
+ * running. See <code/message.c#.notify>. ArenaAccess doesn't deliver
+ * them, because it runs in a fault handler that may have interrupted
+ * the client while it held its own locks; they are delivered by the
+ * next call to ArenaLeave.
+ */
 
 void ArenaLeave(Arena arena)
 {
+  Word pending;
+  mps_message_notify_t notify;
+  void *closure;
+
   AVERT(Arena, arena);
+  pending = arena->messageNotifyPending;
+  notify = arena->messageNotify;
+  closure = arena->messageNotifyClosure;
+  arena->messageNotifyPending = 0;
   ArenaLeaveLock(arena, FALSE);
+  if (pending != 0)
+    MessageNotifyDeliver((mps_arena_t)arena, pending, notify, closure);
 }
 
 void ArenaLeaveLock(Arena arena, Bool recursive)
@@ -654,6 +698,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
 
     ArenaEnter(arena);     /* <design/arena#.lock.arena> */
     EVENT3(ArenaAccessBegin, arena, addr, mode);
+    ++arena->accessCount;
 
     /* @@@@ The code below assumes that Roots and Segs are disjoint. */
     /* It will fall over (in TraceSegAccess probably) if there is a */
@@ -675,15 +720,15 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
            or a fault in a nested exception handler: nothing to do now. */
       }
       EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
+      ArenaLeaveLock(arena, FALSE); /* .leave.notify */
       return TRUE;
     } else if (RootOfAddr(&root, arena, addr)) {
       arenaReleaseRingLock();
       mode &= RootPM(root);
       if (mode != AccessSetEMPTY)
-        RootAccess(root, mode);
+        RootAccess(root, addr, mode);
       EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
+      ArenaLeaveLock(arena, FALSE); /* .leave.notify */
       return TRUE;
     } else {
       /* No segment or root was found at the address: this must mean
@@ -691,7 +736,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
        * via a signal or exception handler) caused the segment or root
        * to go away. So there's nothing to do now. */
       EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
+      ArenaLeaveLock(arena, FALSE); /* .leave.notify */
     }
   }
 
@@ -751,7 +796,9 @@ void (ArenaPoll)(Globals globals)
 
   /* Don't count time spent checking for work, if there was no work to do. */
   if (workWasDone) {
-    ArenaAccumulateTime(arena, start, ClockNow());
+    Clock end = ClockNow();
+    ArenaAccumulateTime(arena, start, end);
+    HistogramAdd(&arena->pollHistogram, end - start);
   }
 
   EVENT2(ArenaPollEnd, arena, BOOLOF(workWasDone));
@@ -811,8 +858,12 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
     now = ClockNow();
   } while (now < intervalEnd);
 
+  /* Use the rest of the idle time to map memory ahead of allocation. */
+  ArenaPrecommit(arena);
+
   if (workWasDone) {
     ArenaAccumulateTime(arena, start, now);
+    HistogramAdd(&arena->pollHistogram, now - start);
   }
 
   return workWasDone;
@@ -910,8 +961,15 @@ Ref ArenaPeekSeg(Arena arena, Seg seg, Ref *p)
      would be wrong to even ask what rank to scan it at, since there might
      not be any traces running. */
   if (TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY) {
-    rank = TraceRankForAccess(arena, seg);
-    TraceScanSingleRef(arena->flippedTraces, rank, arena, seg, p);
+    ShieldExpose(arena, seg);
+    ref = *p;
+    ShieldCover(arena, seg);
+    /* .read.tagging: As SegSingleAccess, assume that an unaligned
+       word is not a reference. */
+    if (WordIsAligned((Word)ref, sizeof(Word))) {
+      rank = TraceRankForAccess(arena, seg);
+      TraceScanSingleRef(arena->flippedTraces, rank, arena, seg, p);
+    }
   }
 
   /* We don't need to update the Seg Summary as in PoolSingleAccess
@@ -3,7 +3,7 @@
  * $Id$
  * Copyright (c) 2001-2020 Ravenbrook Limited.  See end of file for license.
  *
- * Test all three Land implementations against duplicate operations on
+ * Test all four Land implementations against duplicate operations on
  * a bit-table.
  *
  * Test the "steal" operations on a CBS.
@@ -18,6 +18,7 @@
 #include "mpstd.h"
 #include "poolmfs.h"
 #include "testlib.h"
+#include "tlsf.h"
 
 #include <stdio.h> /* printf */
 
@@ -31,6 +32,7 @@ SRCID(landtest, "$Id$");
 #define nCBSOperations ((Size)125000)
 #define nFLOperations ((Size)12500)
 #define nFOOperations ((Size)12500)
+#define nTLSFOperations ((Size)125000)
 
 static Count NAllocateTried, NAllocateSucceeded, NDeallocateTried,
   NDeallocateSucceeded;
@@ -43,12 +45,14 @@ typedef struct TestStateStruct {
   Addr block;
   Size size;
   Land land;
+  Bool ordered; /* does land iterate and find in address order? */
 } TestStateStruct, *TestState;
 
 typedef struct CheckTestClosureStruct {
   TestState state;
   Addr limit;
   Addr oldLimit;
+  Size freeSize;
 } CheckTestClosureStruct, *CheckTestClosure;
 
 
@@ -99,11 +103,66 @@ static Bool checkVisitor(Land land, Range range, void *closure)
   return TRUE;
 }
 
+/* checkUnorderedVisitor -- check a range from a land that does not
+ * iterate in address order
+ *
+ * Each range must be free and maximal. The visitor adds up the number
+ * of grains visited, for comparison with the number of free grains.
+ */
+
+static Bool checkUnorderedVisitor(Land land, Range range, void *closure)
+{
+  CheckTestClosure cl = closure;
+  TestState state;
+  Index ib, il;
+
+  testlib_unused(land);
+  Insist(cl != NULL);
+  state = cl->state;
+
+  ib = indexOfAddr(state, RangeBase(range));
+  il = indexOfAddr(state, RangeLimit(range));
+  Insist(ib < il);
+  Insist(il <= state->size);
+  Insist(BTIsResRange(state->allocTable, ib, il));
+  Insist(ib == 0 || BTGet(state->allocTable, ib - 1));
+  Insist(il == state->size || BTGet(state->allocTable, il));
+
+  cl->freeSize += RangeSize(range);
+
+  return TRUE;
+}
+
+static void checkUnordered(TestState state)
+{
+  CheckTestClosureStruct closure;
+  Bool b;
+  Index i;
+  Count free = 0;
+
+  closure.state = state;
+  closure.freeSize = 0;
+
+  b = LandIterate(state->land, checkUnorderedVisitor, &closure);
+  Insist(b);
+
+  for (i = 0; i < state->size; ++i)
+    if (!BTGet(state->allocTable, i))
+      ++ free;
+  Insist(closure.freeSize == free * state->align);
+  Insist(LandSize(state->land) == free * state->align);
+}
+
 static void check(TestState state)
 {
   CheckTestClosureStruct closure;
   Bool b;
 
+  if (!state->ordered) {
+    checkUnordered(state);
+    return;
+  }
+
   closure.state = state;
   closure.limit = addrOfIndex(state, state->size);
   closure.oldLimit = state->block;
@@ -279,6 +338,11 @@ static void deallocate(TestState state, Addr base, Addr limit)
 
   NDeallocateTried++;
 
+  /* A land that doesn't keep its ranges in address order need not
+   * detect the insertion of a range that overlaps a free range. */
+  if (!state->ordered && !isAllocated)
+    return;
+
   if (isAllocated) {
     /* Find the free blocks adjacent to the allocated block */
     if (ib > 0 && !BTGet(state->allocTable, ib - 1)) {
@@ -377,7 +441,41 @@ static void find(TestState state, Size size, Bool high, FindDelete findDelete)
 
   Insist(found == expected);
 
-  if (found) {
+  if (found && !state->ordered) {
+    /* Any free block of the right size will do: check that the range
+     * found is free, and that it lies at the right end of the
+     * maximal free range containing it. */
+    Index ib, il, ob, ol;
+    ib = indexOfAddr(state, RangeBase(&foundRange));
+    il = indexOfAddr(state, RangeLimit(&foundRange));
+    Insist(BTIsResRange(state->allocTable, ib, il));
+    ob = lastEdge(state->allocTable, state->size, ib);
+    ol = nextEdge(state->allocTable, state->size, il - 1);
+    switch (findDelete) {
+    case FindDeleteNONE:
+    case FindDeleteENTIRE:
+      Insist(ib == ob);
+      Insist(il == ol);
+      Insist(il - ib >= size);
+      break;
+    case FindDeleteLOW:
+      Insist(ib == ob);
+      Insist(il - ib == size);
+      break;
+    case FindDeleteHIGH:
+      Insist(il == ol);
+      Insist(il - ib == size);
+      break;
+    default:
+      cdie(0, "invalid findDelete");
+      break;
+    }
+    if (findDelete != FindDeleteNONE) {
+      Insist(RangeBase(&oldRange) == addrOfIndex(state, ob));
+      Insist(RangeLimit(&oldRange) == addrOfIndex(state, ol));
+      BTSetRange(state->allocTable, ib, il);
+    }
+  } else if (found) {
     Insist(expectedBase == indexOfAddr(state, RangeBase(&foundRange)));
     Insist(expectedLimit == indexOfAddr(state, RangeLimit(&foundRange)));
 
@@ -449,13 +547,16 @@ static void test_land(void)
   CBSStruct cbsStruct;
   FreelistStruct flStruct;
   FailoverStruct foStruct;
+  TLSFStruct tlsfStruct;
   Land cbs = CBSLand(&cbsStruct);
   Land fl = FreelistLand(&flStruct);
   Land fo = FailoverLand(&foStruct);
+  Land tlsf = TLSFLand(&tlsfStruct);
   Pool mfs = MFSPool(&blockPool);
   size_t i;
 
   state.size = ArraySize;
+  state.ordered = TRUE;
   state.align = (1 << rnd() % 4) * MPS_PF_ALIGN;
 
   NAllocateTried = NAllocateSucceeded = NDeallocateTried =
@@ -538,6 +639,16 @@ static void test_land(void)
       PoolFinish(mfs);
   }
 
+  /* 4. Test TLSF */
+
+  die((mps_res_t)LandInit(tlsf, CLASS(TLSF), arena, state.align,
+                          NULL, mps_args_none),
+      "failed to initialise TLSF");
+  state.land = tlsf;
+  state.ordered = FALSE;
+  test(&state, nTLSFOperations, 3);
+  LandFinish(tlsf);
+
   ControlFree(arena, p, (state.size + 1) * state.align);
   mps_arena_destroy(arena);
 
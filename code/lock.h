@@ -133,6 +133,27 @@ extern void LockClaimGlobal(void);
 extern void LockReleaseGlobal(void);
 
 
+/*  LockClaimGlobalEvent
+ *
+ *  This is called to increase the number of claims on the recursive
+ *  event lock, which serializes writes to the event buffers and the
+ *  telemetry stream.  It may be claimed while holding any other MPS
+ *  lock, so no other lock may be claimed while holding it.  See
+ *  <code/event.c#.sync.lock>.
+ */
+
+extern void LockClaimGlobalEvent(void);
+
+
+/*  LockReleaseGlobalEvent
+ *
+ *  This is called to reduce the number of claims on the event lock.
+ *  It must not be called without possession of the lock.
+ */
+
+extern void LockReleaseGlobalEvent(void);
+
+
 /* LockSetup -- one-time lock initialization */
 
 extern void LockSetup(void);
@@ -102,16 +102,25 @@ static LockStruct globalRecursiveLockStruct = {
   0
 };
 
+static LockStruct globalEventLockStruct = {
+  LockSig,
+  0
+};
+
 static Lock globalLock = &globalLockStruct;
 
 static Lock globalRecLock = &globalRecursiveLockStruct;
 
+static Lock globalEventLock = &globalEventLockStruct;
+
 void LockInitGlobal(void)
 {
   globalLock->claims = 0;
   LockInit(globalLock);
   globalRecLock->claims = 0;
   LockInit(globalRecLock);
+  globalEventLock->claims = 0;
+  LockInit(globalEventLock);
 }
 
 void (LockClaimGlobalRecursive)(void)
@@ -134,6 +143,16 @@ void (LockReleaseGlobal)(void)
   LockRelease(globalLock);
 }
 
+void (LockClaimGlobalEvent)(void)
+{
+  LockClaimRecursive(globalEventLock);
+}
+
+void (LockReleaseGlobalEvent)(void)
+{
+  LockReleaseRecursive(globalEventLock);
+}
+
 void LockSetup(void)
 {
   /* Nothing to do as ANSI platform does not have fork(). */
@@ -201,19 +201,22 @@ Bool (LockIsHeld)(Lock lock)
 
 /* Global locks
  *
- * .global: The two "global" locks are statically allocated normal locks.
+ * .global: The three "global" locks are statically allocated normal locks.
  */
 
 static LockStruct globalLockStruct;
 static LockStruct globalRecLockStruct;
+static LockStruct globalEventLockStruct;
 static Lock globalLock = &globalLockStruct;
 static Lock globalRecLock = &globalRecLockStruct;
+static Lock globalEventLock = &globalEventLockStruct;
 static pthread_once_t isGlobalLockInit = PTHREAD_ONCE_INIT;
 
 void LockInitGlobal(void)
 {
   LockInit(globalLock);
   LockInit(globalRecLock);
+  LockInit(globalEventLock);
 }
 
 
@@ -259,6 +262,27 @@ void (LockReleaseGlobal)(void)
 }
 
 
+/* LockClaimGlobalEvent -- claim the event lock */
+
+void (LockClaimGlobalEvent)(void)
+{
+  int res;
+
+  /* Ensure the global lock has been initialized */
+  res = pthread_once(&isGlobalLockInit, LockInitGlobal);
+  AVER(res == 0);
+  LockClaimRecursive(globalEventLock);
+}
+
+
+/* LockReleaseGlobalEvent -- release the event lock */
+
+void (LockReleaseGlobalEvent)(void)
+{
+  LockReleaseRecursive(globalEventLock);
+}
+
+
 /* LockSetup -- one-time lock initialization */
 
 void LockSetup(void)
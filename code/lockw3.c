@@ -123,8 +123,10 @@ Bool (LockIsHeld)(Lock lock)
 
 static LockStruct globalLockStruct;
 static LockStruct globalRecLockStruct;
+static LockStruct globalEventLockStruct;
 static Lock globalLock = &globalLockStruct;
 static Lock globalRecLock = &globalRecLockStruct;
+static Lock globalEventLock = &globalEventLockStruct;
 static Bool globalLockInit = FALSE; /* TRUE iff initialized */
 
 void LockInitGlobal(void)
@@ -133,6 +135,8 @@ void LockInitGlobal(void)
   LockInit(globalLock);
   globalRecLock->claims = 0;
   LockInit(globalRecLock);
+  globalEventLock->claims = 0;
+  LockInit(globalEventLock);
   globalLockInit = TRUE;
 }
 
@@ -190,6 +194,19 @@ void (LockReleaseGlobal)(void)
   LockRelease(globalLock);
 }
 
+void (LockClaimGlobalEvent)(void)
+{
+  lockEnsureGlobalLock();
+  AVER(globalLockInit);
+  LockClaimRecursive(globalEventLock);
+}
+
+void (LockReleaseGlobalEvent)(void)
+{
+  AVER(globalLockInit);
+  LockReleaseRecursive(globalEventLock);
+}
+
 void LockSetup(void)
 {
   /* Nothing to do as MPS does not support fork() on Windows. */
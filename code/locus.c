@@ -71,6 +71,11 @@ void LocusPrefExpress(LocusPref pref, LocusPrefKind kind, void *p)
     pref->zones = *(ZoneSet *)p;
     break;
 
+  case LocusPrefNODE:
+    AVER(p != NULL);
+    pref->node = *(Index *)p;
+    break;
+
   default:
     /* Unknown kinds are ignored for binary compatibility. */
     break;
@@ -135,6 +140,7 @@ static Bool GenParamCheck(GenParamStruct *params)
 static void GenDescInit(Arena arena, GenDesc gen, GenParamStruct *params)
 {
   TraceId ti;
+  Index i;
 
   AVER(arena != NULL); /* might not be initialized yet. */
   AVER(gen != NULL);
@@ -143,6 +149,8 @@ static void GenDescInit(Arena arena, GenDesc gen, GenParamStruct *params)
   gen->serial = arena->genSerial;
   ++ arena->genSerial;
   gen->zones = ZoneSetEMPTY;
+  for (i = 0; i < MPS_WORD_WIDTH; ++i)
+    gen->zoneSize[i] = 0;
   gen->capacity = params->capacity * 1024;
   gen->mortality = params->mortality;
   RingInit(&gen->locusRing);
@@ -593,11 +601,12 @@ static void PoolGenAccountForAlloc(PoolGen pgen, Size size)
 /* PoolGenAlloc -- allocate a segment in a pool generation
  *
  * Allocate a segment belong to klass (which must be GCSegClass or a
- * subclass), attach it to the generation, and update the accounting.
+ * subclass), preferably on memory node node (or anywhere, if
+ * NodeNONE), attach it to the generation, and update the accounting.
  */
 
 Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
-                 ArgList args)
+                 Index node, ArgList args)
 {
   LocusPrefStruct pref;
   Res res;
@@ -621,14 +630,17 @@ Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
   pref.high = FALSE;
   pref.zones = zones;
   pref.avoid = ZoneSetBlacklist(arena);
+  pref.node = node;
   res = SegAlloc(&seg, klass, &pref, size, pgen->pool, args);
   if (res != ResOK)
     return res;
 
   RingAppend(&gen->segRing, &SegGCSeg(seg)->genRing);
+  SegGCSeg(seg)->gen = gen;
 
   moreZones = ZoneSetUnion(zones, ZoneSetOfSeg(arena, seg));
   gen->zones = moreZones;
+  ZoneSizeAdd(gen->zoneSize, arena, SegBase(seg), SegLimit(seg));
 
   if (!ZoneSetSuper(zones, moreZones)) {
     /* Tracking the whole zoneset for each generation gives more
@@ -816,6 +828,9 @@ void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
                  Size newSize, Bool deferred)
 {
   Size size;
+  GenDesc gen;
+  Arena arena;
+  ZoneSet emptied;
 
   AVERT(PoolGen, pgen);
   AVERT(Seg, seg);
@@ -826,11 +841,85 @@ void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
   PoolGenAccountForFree(pgen, size, oldSize, newSize, deferred);
 
   RingRemove(&SegGCSeg(seg)->genRing);
+  SegGCSeg(seg)->gen = NULL;
+
+  /* A zone in which the generation no longer has any segments is
+   * dropped from its zone set, so that it can be recycled. See
+   * <code/policy.c#zone.recycle>. */
+  gen = pgen->gen;
+  arena = PoolArena(pgen->pool);
+  emptied = ZoneSizeSub(gen->zoneSize, arena, SegBase(seg), SegLimit(seg));
+  if (ZoneSetInter(gen->zones, emptied) != ZoneSetEMPTY) {
+    gen->zones = ZoneSetDiff(gen->zones, emptied);
+    EVENT3(GenZoneSet, arena, gen, gen->zones);
+  }
 
   SegFree(seg);
 }
 
 
+/* PoolGenPromote -- move a segment to another generation in place
+ *
+ * Move a segment, which must be entirely accounted as old (as it is
+ * once it has been condemned), from pool generation pgen to pool
+ * generation to, without copying its contents. The deferred flag is
+ * as for PoolGenAccountForEmpty.
+ */
+
+void PoolGenPromote(PoolGen pgen, PoolGen to, Seg seg, Bool deferred)
+{
+  Size size;
+  GenDesc gen;
+  Arena arena;
+  ZoneSet emptied, zones, moreZones;
+
+  AVERT(PoolGen, pgen);
+  AVERT(PoolGen, to);
+  AVER(to != pgen);
+  AVER(to->pool == pgen->pool);
+  AVERT(Seg, seg);
+  AVER(SegGCSeg(seg)->gen == pgen->gen);
+  AVERT(Bool, deferred);
+
+  size = SegSize(seg);
+  if (deferred) {
+    AVER(pgen->oldDeferredSize >= size);
+    pgen->oldDeferredSize -= size;
+    to->oldDeferredSize += size;
+  } else {
+    AVER(pgen->oldSize >= size);
+    pgen->oldSize -= size;
+    to->oldSize += size;
+  }
+  AVER(pgen->totalSize >= size);
+  pgen->totalSize -= size;
+  AVER(pgen->segs > 0);
+  -- pgen->segs;
+  to->totalSize += size;
+  ++ to->segs;
+
+  /* Move the segment's zones, as PoolGenFree and PoolGenAlloc do. */
+  arena = PoolArena(pgen->pool);
+  gen = pgen->gen;
+  emptied = ZoneSizeSub(gen->zoneSize, arena, SegBase(seg), SegLimit(seg));
+  if (ZoneSetInter(gen->zones, emptied) != ZoneSetEMPTY) {
+    gen->zones = ZoneSetDiff(gen->zones, emptied);
+    EVENT3(GenZoneSet, arena, gen, gen->zones);
+  }
+  gen = to->gen;
+  zones = gen->zones;
+  moreZones = ZoneSetUnion(zones, ZoneSetOfSeg(arena, seg));
+  gen->zones = moreZones;
+  ZoneSizeAdd(gen->zoneSize, arena, SegBase(seg), SegLimit(seg));
+  if (!ZoneSetSuper(zones, moreZones))
+    EVENT3(GenZoneSet, arena, gen, moreZones);
+
+  RingRemove(&SegGCSeg(seg)->genRing);
+  RingAppend(&gen->segRing, &SegGCSeg(seg)->genRing);
+  SegGCSeg(seg)->gen = gen;
+}
+
+
 /* PoolGenDescribe -- describe a PoolGen */
 
 Res PoolGenDescribe(PoolGen pgen, mps_lib_FILE *stream, Count depth)
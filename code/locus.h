@@ -44,6 +44,7 @@ typedef struct GenDescStruct {
   Sig sig;              /* <design/sig> */
   Serial serial;        /* serial number within arena */
   ZoneSet zones;        /* zoneset for this generation */
+  Size zoneSize[MPS_WORD_WIDTH]; /* size of segments in each zone */
   Size capacity;        /* capacity in bytes */
   double mortality;     /* moving average mortality */
   RingStruct locusRing; /* Ring of all PoolGen's in this GenDesc (locus) */
@@ -113,9 +114,10 @@ extern Bool PoolGenCheck(PoolGen pgen);
 extern Res PoolGenInit(PoolGen pgen, GenDesc gen, Pool pool);
 extern void PoolGenFinish(PoolGen pgen);
 extern Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass,
-                        Size size, ArgList args);
+                        Size size, Index node, ArgList args);
 extern void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
                         Size newSize, Bool deferred);
+extern void PoolGenPromote(PoolGen pgen, PoolGen to, Seg seg, Bool deferred);
 extern void PoolGenAccountForFill(PoolGen pgen, Size size);
 extern void PoolGenAccountForEmpty(PoolGen pgen, Size used, Size unused, Bool deferred);
 extern void PoolGenAccountForAge(PoolGen pgen, Size wasBuffered, Size wasNew, Bool deferred);
@@ -0,0 +1,527 @@
+/* mag.c: MAGAZINE CACHE IMPLEMENTATION
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: A magazine cache sits in front of a manual pool and
+ * serves mps_alloc and mps_free for small blocks without entering
+ * the arena, so that small-object allocation from several threads
+ * does not serialize on the arena lock.  A pool gets one if it is
+ * created with MPS_KEY_POOL_CACHE.
+ *
+ * .source: Jeff Bonwick, Jonathan Adams; "Magazines and Vmem:
+ * Extending the Slab Allocator to Many CPUs and Arbitrary
+ * Resources"; USENIX 2001.
+ *
+ * .class: Blocks are cached in MAG_CLASSES size classes.  Class k
+ * holds blocks whose size, rounded up to the pool alignment, is k+1
+ * alignment units.  The pool rounds sizes up to its alignment itself,
+ * so a block from a class will do for any request in that class.
+ * (MFS only has one size, so only ever uses one class.)
+ *
+ * .magazine: A magazine is a stack of up to MAG_ROUNDS blocks of one
+ * class.  Empty magazines belong to no class.
+ *
+ * .stripe: The MPS has no thread-local storage, so instead of a set
+ * of magazines per thread there are MAG_STRIPES stripes, and a
+ * thread uses the stripe selected by a hash of its stack address.
+ * Threads' stacks are disjoint, so a thread usually gets the same
+ * stripe each time and different threads usually get different
+ * stripes; when two threads do share a stripe they just contend for
+ * its lock.  Each stripe has a loaded and a previous magazine per
+ * class, so that a thread alternating between allocating and freeing
+ * at a magazine boundary does not keep going to the depot.
+ *
+ * .depot: When both of a stripe's magazines for a class are empty
+ * (on alloc) or full (on free), the stripe exchanges a magazine with
+ * the depot, which keeps a list of full magazines per class and a
+ * list of empty magazines, under its own lock.
+ *
+ * .miss: If the depot can't help, MagCacheAlloc or MagCacheFree
+ * returns FALSE and the caller uses the pool directly, in the arena.
+ * MagCacheFree notes that an empty magazine was wanted, and
+ * MagCacheFill (called by mps_free in the arena) allocates some from
+ * the control pool, up to MAG_LIMIT.  Allocation never fills
+ * magazines from the pool: the cache only holds blocks that the
+ * client has freed.
+ *
+ * .lock.order: A stripe lock may be held while claiming the depot
+ * lock.  Neither is held while entering the arena, but both may be
+ * claimed in the arena (by MagCacheFill and MagCacheDestroy), so
+ * there is no cycle.
+ *
+ * .flush: If the pool can't allocate a block because it has run out
+ * of memory, mps_alloc calls MagCacheFlush to give all the cached
+ * blocks back to the pool, and tries again.  Otherwise blocks of one
+ * size class could be stranded in the cache while allocations of
+ * other sizes fail.
+ *
+ * .check: The fast path doesn't reach the pool's alloc and free
+ * methods, so it makes the checks on the size and address that they
+ * would make without entering the arena.  MFS insists on the unit
+ * size it was created with, so the cache remembers it.
+ *
+ * .accounting: Blocks in the cache count as allocated by the pool,
+ * so they are not included in mps_pool_free_size.
+ */
+
+#include "mag.h"
+#include "mpm.h"
+#include "poolmfs.h"
+
+SRCID(mag, "$Id$");
+
+
+#define MagCacheSig ((Sig)0x519A6CAC) /* SIGnature MAGazine CAChe */
+
+typedef struct MagStruct *Mag;
+
+typedef struct MagStruct {
+  Mag next;                     /* next magazine in depot list */
+  Count rounds;                 /* number of blocks in magazine */
+  Addr round[MAG_ROUNDS];       /* the blocks */
+} MagStruct;
+
+typedef struct MagStripeStruct *MagStripe;
+
+typedef struct MagStripeStruct {
+  Lock lock;                    /* protects the magazines */
+  Mag loaded[MAG_CLASSES];      /* magazine in use, or NULL */
+  Mag previous[MAG_CLASSES];    /* the other magazine, or NULL */
+} MagStripeStruct;
+
+typedef struct MagCacheStruct {
+  Sig sig;                      /* <design/sig> */
+  Pool pool;                    /* pool being cached */
+  Shift shift;                  /* log2 of class width */
+  Size limit;                   /* sizes up to this are cached */
+  Size unitSize;                /* only size pool accepts, or 0; .check */
+  Count mags;                   /* magazines allocated, see .miss */
+  Lock depotLock;               /* protects the depot */
+  Bool wanted;                  /* an empty magazine was wanted */
+  Mag empty;                    /* list of empty magazines */
+  Mag full[MAG_CLASSES];        /* lists of full magazines */
+  MagStripeStruct stripe[MAG_STRIPES];
+} MagCacheStruct;
+
+
+/* MagCacheCheck -- check a magazine cache
+ *
+ * The magazines can't be checked without claiming their locks.
+ */
+
+Bool MagCacheCheck(MagCache cache)
+{
+  CHECKS(MagCache, cache);
+  CHECKU(Pool, cache->pool);
+  CHECKL(ShiftCheck(cache->shift));
+  CHECKL(cache->limit == (Size)MAG_CLASSES << cache->shift);
+  CHECKL(cache->mags <= MAG_LIMIT);
+  CHECKL(LockCheck(cache->depotLock));
+  return TRUE;
+}
+
+
+/* magStripe -- select the stripe for the current thread
+ *
+ * See .stripe.  The address of the parameter is on the stack of the
+ * calling thread.  A multiplicative hash spreads stacks that are
+ * placed at regular intervals.
+ */
+
+static MagStripe magStripe(MagCache cache)
+{
+  Word w = (Word)&cache >> MAG_STRIPE_SHIFT;
+  w *= (Word)0x9E3779B9;
+  return &cache->stripe[(w >> (MPS_WORD_WIDTH - 8)) % MAG_STRIPES];
+}
+
+
+/* MagCacheAlloc -- try to allocate a block from the cache
+ *
+ * Returns TRUE and the block if the cache has one, otherwise FALSE.
+ */
+
+Bool MagCacheAlloc(Addr *pReturn, MagCache cache, Size size)
+{
+  MagStripe stripe;
+  Index k;
+  Mag mag, prev;
+  Bool found = FALSE;
+
+  AVER_CRITICAL(pReturn != NULL);
+  AVERT_CRITICAL(MagCache, cache);
+
+  /* This also rejects size 0. */
+  if (size - 1 >= cache->limit)
+    return FALSE;
+  AVER(cache->unitSize == 0 || size == cache->unitSize); /* .check */
+  k = (size - 1) >> cache->shift;
+
+  stripe = magStripe(cache);
+  LockClaim(stripe->lock);
+  mag = stripe->loaded[k];
+  if (mag == NULL || mag->rounds == 0) {
+    prev = stripe->previous[k];
+    if (prev != NULL && prev->rounds > 0) {
+      stripe->previous[k] = mag;
+      stripe->loaded[k] = prev;
+      mag = prev;
+    } else {
+      /* Trade the empty magazine for a full one.  See .depot. */
+      LockClaim(cache->depotLock);
+      if (cache->full[k] != NULL) {
+        Mag full = cache->full[k];
+        cache->full[k] = full->next;
+        if (mag != NULL) {
+          mag->next = cache->empty;
+          cache->empty = mag;
+        }
+        stripe->loaded[k] = full;
+        mag = full;
+      }
+      LockRelease(cache->depotLock);
+    }
+  }
+  if (mag != NULL && mag->rounds > 0) {
+    --mag->rounds;
+    *pReturn = mag->round[mag->rounds];
+    found = TRUE;
+  }
+  LockRelease(stripe->lock);
+  return found;
+}
+
+
+/* MagCacheFree -- try to put a freed block in the cache
+ *
+ * Returns TRUE if the cache took the block, otherwise FALSE, in
+ * which case the caller must free it to the pool and then call
+ * MagCacheFill.  See .miss.
+ */
+
+Bool MagCacheFree(MagCache cache, Addr old, Size size)
+{
+  MagStripe stripe;
+  Index k;
+  Mag mag, prev;
+  Bool taken = FALSE;
+
+  AVERT_CRITICAL(MagCache, cache);
+  AVER_CRITICAL(old != (Addr)0);
+
+  if (size - 1 >= cache->limit)
+    return FALSE;
+  /* .check */
+  AVER(cache->unitSize == 0 || size == cache->unitSize);
+  AVER(AddrIsAligned(old, PoolAlignment(cache->pool)));
+  k = (size - 1) >> cache->shift;
+
+  stripe = magStripe(cache);
+  LockClaim(stripe->lock);
+  mag = stripe->loaded[k];
+  if (mag == NULL || mag->rounds == MAG_ROUNDS) {
+    prev = stripe->previous[k];
+    if (prev != NULL && prev->rounds < MAG_ROUNDS) {
+      stripe->previous[k] = mag;
+      stripe->loaded[k] = prev;
+      mag = prev;
+    } else {
+      /* Load an empty magazine, moving the previous magazine (which
+         is full) to the depot.  See .depot. */
+      LockClaim(cache->depotLock);
+      if (cache->empty != NULL) {
+        Mag empty = cache->empty;
+        cache->empty = empty->next;
+        if (prev != NULL) {
+          prev->next = cache->full[k];
+          cache->full[k] = prev;
+        }
+        stripe->previous[k] = mag;
+        stripe->loaded[k] = empty;
+        mag = empty;
+      } else {
+        cache->wanted = TRUE;
+      }
+      LockRelease(cache->depotLock);
+    }
+  }
+  if (mag != NULL && mag->rounds < MAG_ROUNDS) {
+    mag->round[mag->rounds] = old;
+    ++mag->rounds;
+    taken = TRUE;
+  }
+  LockRelease(stripe->lock);
+  return taken;
+}
+
+
+/* MagCacheFill -- supply the depot with empty magazines if wanted
+ *
+ * Must be called in the arena.  See .miss.
+ */
+
+void MagCacheFill(MagCache cache)
+{
+  Arena arena;
+  Bool wanted;
+  Index i;
+
+  AVERT(MagCache, cache);
+
+  LockClaim(cache->depotLock);
+  wanted = cache->wanted;
+  cache->wanted = FALSE;
+  LockRelease(cache->depotLock);
+  if (!wanted)
+    return;
+
+  arena = PoolArena(cache->pool);
+  for (i = 0; i < MAG_STRIPES && cache->mags < MAG_LIMIT; ++i) {
+    Mag mag;
+    void *p;
+    Res res = ControlAlloc(&p, arena, sizeof(MagStruct));
+    if (res != ResOK)
+      break;
+    mag = p;
+    mag->rounds = 0;
+    ++cache->mags;
+    LockClaim(cache->depotLock);
+    mag->next = cache->empty;
+    cache->empty = mag;
+    LockRelease(cache->depotLock);
+  }
+}
+
+
+/* magFlush -- free the blocks in a magazine, if any, to the pool
+ *
+ * Returns the number of blocks freed.
+ */
+
+static Count magFlush(MagCache cache, Mag mag, Index k)
+{
+  Size size;
+  Count freed;
+
+  if (mag == NULL)
+    return 0;
+  if (cache->unitSize != 0)
+    size = cache->unitSize;
+  else
+    size = (Size)(k + 1) << cache->shift;
+  freed = mag->rounds;
+  while (mag->rounds > 0) {
+    --mag->rounds;
+    PoolFree(cache->pool, mag->round[mag->rounds], size);
+  }
+  return freed;
+}
+
+
+/* MagCacheFlush -- free all the cached blocks to the pool
+ *
+ * Must be called in the arena.  Returns TRUE if any blocks were
+ * freed.  See .flush.
+ */
+
+Bool MagCacheFlush(MagCache cache)
+{
+  Count freed = 0;
+  Index i, k;
+
+  AVERT(MagCache, cache);
+
+  for (i = 0; i < MAG_STRIPES; ++i) {
+    MagStripe stripe = &cache->stripe[i];
+    LockClaim(stripe->lock);
+    for (k = 0; k < MAG_CLASSES; ++k) {
+      freed += magFlush(cache, stripe->loaded[k], k);
+      freed += magFlush(cache, stripe->previous[k], k);
+    }
+    LockRelease(stripe->lock);
+  }
+
+  LockClaim(cache->depotLock);
+  for (k = 0; k < MAG_CLASSES; ++k) {
+    while (cache->full[k] != NULL) {
+      Mag mag = cache->full[k];
+      cache->full[k] = mag->next;
+      freed += magFlush(cache, mag, k);
+      mag->next = cache->empty;
+      cache->empty = mag;
+    }
+  }
+  LockRelease(cache->depotLock);
+
+  return freed > 0;
+}
+
+
+/* MagCacheCreate -- create a magazine cache for a pool */
+
+Res MagCacheCreate(MagCache *cacheReturn, Pool pool)
+{
+  Arena arena;
+  MagCache cache;
+  void *p;
+  Res res;
+  Index i, k;
+
+  AVER(cacheReturn != NULL);
+  AVERT(Pool, pool);
+  arena = PoolArena(pool);
+
+  /* The cache only holds blocks that were freed, and only gives them
+     back through mps_alloc, so a pool without mps_alloc can't use it.
+     A debugging pool checks the size and fenceposts of each block
+     when it is freed, which the cache would defeat. */
+  if (ClassOfPoly(Pool, pool)->alloc == PoolNoAlloc
+      || Method(Pool, pool, debugMixin)(pool) != NULL)
+    return ResPARAM;
+
+  res = ControlAlloc(&p, arena, sizeof(MagCacheStruct));
+  if (res != ResOK)
+    goto failCache;
+  cache = p;
+
+  res = ControlAlloc(&p, arena, LockSize());
+  if (res != ResOK)
+    goto failDepotLock;
+  cache->depotLock = p;
+  LockInit(cache->depotLock);
+
+  for (i = 0; i < MAG_STRIPES; ++i) {
+    MagStripe stripe = &cache->stripe[i];
+    res = ControlAlloc(&p, arena, LockSize());
+    if (res != ResOK)
+      goto failStripeLock;
+    stripe->lock = p;
+    LockInit(stripe->lock);
+    for (k = 0; k < MAG_CLASSES; ++k) {
+      stripe->loaded[k] = NULL;
+      stripe->previous[k] = NULL;
+    }
+  }
+
+  cache->pool = pool;
+  cache->shift = SizeLog2(PoolAlignment(pool));
+  cache->limit = (Size)MAG_CLASSES << cache->shift;
+  cache->unitSize = 0;
+  if (IsA(MFSPool, pool))
+    cache->unitSize = MustBeA(MFSPool, pool)->unroundedUnitSize;
+  cache->mags = 0;
+  cache->wanted = FALSE;
+  cache->empty = NULL;
+  for (k = 0; k < MAG_CLASSES; ++k)
+    cache->full[k] = NULL;
+
+  cache->sig = MagCacheSig;
+  AVERT(MagCache, cache);
+  *cacheReturn = cache;
+  return ResOK;
+
+failStripeLock:
+  while (i > 0) {
+    --i;
+    LockFinish(cache->stripe[i].lock);
+    ControlFree(arena, cache->stripe[i].lock, LockSize());
+  }
+  LockFinish(cache->depotLock);
+  ControlFree(arena, cache->depotLock, LockSize());
+failDepotLock:
+  ControlFree(arena, cache, sizeof(MagCacheStruct));
+failCache:
+  return res;
+}
+
+
+/* magDestroy -- free a magazine, if any
+ *
+ * The blocks in the magazine are not freed: the pool is being
+ * destroyed, so its memory is going anyway.
+ */
+
+static void magDestroy(MagCache cache, Mag mag)
+{
+  if (mag != NULL) {
+    AVER(cache->mags > 0);
+    --cache->mags;
+    ControlFree(PoolArena(cache->pool), mag, sizeof(MagStruct));
+  }
+}
+
+
+/* MagCacheDestroy -- destroy the magazine cache of a pool
+ *
+ * Must be called in the arena, when no other thread is using the
+ * pool.
+ */
+
+void MagCacheDestroy(MagCache cache)
+{
+  Arena arena;
+  Index i, k;
+  Mag mag;
+
+  AVERT(MagCache, cache);
+  arena = PoolArena(cache->pool);
+
+  for (i = 0; i < MAG_STRIPES; ++i) {
+    MagStripe stripe = &cache->stripe[i];
+    for (k = 0; k < MAG_CLASSES; ++k) {
+      magDestroy(cache, stripe->loaded[k]);
+      magDestroy(cache, stripe->previous[k]);
+    }
+    LockFinish(stripe->lock);
+    ControlFree(arena, stripe->lock, LockSize());
+  }
+  for (k = 0; k < MAG_CLASSES; ++k) {
+    while (cache->full[k] != NULL) {
+      mag = cache->full[k];
+      cache->full[k] = mag->next;
+      magDestroy(cache, mag);
+    }
+  }
+  while (cache->empty != NULL) {
+    mag = cache->empty;
+    cache->empty = mag->next;
+    magDestroy(cache, mag);
+  }
+  AVER(cache->mags == 0);
+
+  LockFinish(cache->depotLock);
+  ControlFree(arena, cache->depotLock, LockSize());
+  cache->sig = SigInvalid;
+  ControlFree(arena, cache, sizeof(MagCacheStruct));
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -138,6 +138,12 @@ void MessagePost(Arena arena, Message message)
       message->postedClock = ClockNow();
     }
     RingAppend(&arena->messageRing, &message->queueRing);
+    /* .notify: Tell the client, if it asked to be told.  This may be
+     * during a scan with the mutator suspended, so the notification
+     * is deferred until the arena lock is released.  See
+     * MessageNotifyDeliver. */
+    if (arena->messageNotify != NULL)
+      arena->messageNotifyPending |= (Word)1 << MessageGetType(message);
   } else {
     /* discard message immediately if client hasn't enabled that type */
     MessageDiscard(arena, message);
@@ -279,6 +285,42 @@ void MessageDiscard(Arena arena, Message message)
 }
 
 
+/* Set (or clear, if notify is NULL) the function that is called each
+ * time a message of an enabled type is posted.  See .notify. */
+void MessageNotifySet(Arena arena, mps_message_notify_t notify,
+                      void *closure)
+{
+  AVERT(Arena, arena);
+  AVER(notify == NULL || FUNCHECK(notify));
+
+  arena->messageNotify = notify;
+  arena->messageNotifyClosure = closure;
+  if (notify == NULL)
+    arena->messageNotifyPending = 0;
+}
+
+
+/* MessageNotifyDeliver -- call the notifier for deferred notifications
+ *
+ * Called by ArenaLeave after releasing the arena lock, with the types
+ * that were pending, and the notifier and closure, read while the
+ * lock was held.  See .notify.  The mutator is running, so the
+ * notifier may block or call the MPS.
+ */
+
+void MessageNotifyDeliver(mps_arena_t arena, Word pending,
+                          mps_message_notify_t notify, void *closure)
+{
+  MessageType type;
+
+  AVER(FUNCHECK(notify));
+
+  for (type = 0; type < MessageTypeLIMIT; ++type)
+    if (pending & ((Word)1 << type))
+      (*notify)(arena, (mps_message_type_t)type, closure);
+}
+
+
 /* Message Methods, Generic
  *
  * (Some of these dispatch on message->klass).
@@ -336,6 +378,44 @@ void MessageFinalizationRef(Ref *refReturn, Arena arena,
   (*message->klass->finalizationRef)(refReturn, arena, message);
 }
 
+/* MessageFinalizationDrain -- get and discard finalization messages
+ *
+ * Removes up to count finalization messages from the queue, stores
+ * their finalization references in successive elements of refs, and
+ * discards the messages.  Returns the number of references stored.
+ * This is equivalent to a loop over MessageGet, MessageFinalizationRef
+ * and MessageDiscard, but makes a single pass over the queue.
+ *
+ * .drain.poke: The references are stored with ArenaPoke, for the
+ * same reason as in mps_message_finalization_ref: the client may
+ * pass an array in memory managed by the MPS.
+ */
+
+Count MessageFinalizationDrain(Ref *refs, Count count, Arena arena)
+{
+  Ring node, next;
+  Count i = 0;
+
+  AVER(refs != NULL);
+  AVERT(Arena, arena);
+
+  RING_FOR(node, &arena->messageRing, next) {
+    Message message;
+    Ref ref;
+    if (i >= count)
+      break;
+    message = RING_ELT(Message, queueRing, node);
+    if (MessageGetType(message) == MessageTypeFINALIZATION) {
+      RingRemove(&message->queueRing);
+      MessageFinalizationRef(&ref, arena, message);
+      ArenaPoke(arena, &refs[i], ref); /* .drain.poke */
+      MessageDelete(message);
+      ++i;
+    }
+  }
+  return i;
+}
+
 Size MessageGCLiveSize(Message message)
 {
   AVERT(Message, message);
@@ -360,6 +440,18 @@ Size MessageGCNotCondemnedSize(Message message)
   return (*message->klass->gcNotCondemnedSize)(message);
 }
 
+void MessageGCCensus(Count *countReturn, Size *sizeReturn,
+                     Message message, Index type)
+{
+  AVER(countReturn != NULL);
+  AVER(sizeReturn != NULL);
+  AVERT(Message, message);
+  AVER(MessageGetType(message) == MessageTypeGC);
+  AVER(type < CensusTYPES);
+
+  (*message->klass->gcCensus)(countReturn, sizeReturn, message, type);
+}
+
 const char *MessageGCStartWhy(Message message)
 {
   AVERT(Message, message);
@@ -414,6 +506,17 @@ Size MessageNoGCNotCondemnedSize(Message message)
   return (Size)0;
 }
 
+void MessageNoGCCensus(Count *countReturn, Size *sizeReturn,
+                       Message message, Index type)
+{
+  AVER(countReturn != NULL);
+  AVER(sizeReturn != NULL);
+  AVERT(Message, message);
+  UNUSED(type);
+
+  NOTREACHED;
+}
+
 const char *MessageNoGCStartWhy(Message message)
 {
   AVERT(Message, message);
@@ -36,6 +36,7 @@ static MessageClassStruct DFMessageClassStruct = {
   MessageNoGCLiveSize,         /* GCLiveSize */
   MessageNoGCCondemnedSize,    /* GCCondemnedSize */
   MessageNoGCNotCondemnedSize, /* GCNotCondemnedSize */
+  MessageNoGCCensus,           /* GCCensus */
   MessageNoGCStartWhy,         /* GCStartWhy */
   MessageClassSig              /* <design/message#.class.sig.double> */
 };
@@ -52,6 +53,7 @@ static MessageClassStruct DGCMessageClassStruct = {
   MessageNoGCLiveSize,         /* GCLiveSize */
   MessageNoGCCondemnedSize,    /* GCCondemnedSize */
   MessageNoGCNotCondemnedSize, /* GCNoteCondemnedSize */
+  MessageNoGCCensus,           /* GCCensus */
   MessageNoGCStartWhy,         /* GCStartWhy */
   MessageClassSig              /* <design/message#.class.sig.double> */
 };
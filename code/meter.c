@@ -96,6 +96,76 @@ void MeterEmit(Meter meter)
 }
 
 
+/* HistogramInit -- initialize a histogram */
+
+void HistogramInit(Histogram histogram)
+{
+  Index i;
+
+  AVER(histogram != NULL);
+
+  histogram->count = 0;
+  histogram->total = 0;
+  histogram->max = 0;
+  for (i = 0; i < HistogramBUCKETS; ++i)
+    histogram->bucket[i] = 0;
+}
+
+
+/* HistogramBucketIndex -- index of bucket counting an interval
+ *
+ * Intervals less than HistogramSUB have a bucket each.  Otherwise, the
+ * interval has the form 1ssxxx... in binary, where there are
+ * HistogramSUBSHIFT bits ss that select the sub-bucket within the
+ * power of two.
+ */
+
+Index HistogramBucketIndex(Clock interval)
+{
+  Shift shift;
+  Index index;
+
+  if (interval < HistogramSUB)
+    return (Index)interval;
+  shift = SizeFloorLog2((Size)interval);
+  index = (shift - HistogramSUBSHIFT + 1) * HistogramSUB
+    + ((interval >> (shift - HistogramSUBSHIFT)) & (HistogramSUB - 1));
+  if (index >= HistogramBUCKETS)
+    index = HistogramBUCKETS - 1;
+  return index;
+}
+
+
+/* HistogramBucketBase -- smallest interval counted by a bucket */
+
+Clock HistogramBucketBase(Index index)
+{
+  Shift shift;
+
+  AVER(index < HistogramBUCKETS);
+
+  if (index < HistogramSUB)
+    return (Clock)index;
+  shift = (Shift)(index / HistogramSUB) + HistogramSUBSHIFT - 1;
+  return ((Clock)1 << shift)
+    + ((Clock)(index % HistogramSUB) << (shift - HistogramSUBSHIFT));
+}
+
+
+/* HistogramAdd -- count an interval in a histogram */
+
+void HistogramAdd(Histogram histogram, Clock interval)
+{
+  AVER(histogram != NULL);
+
+  ++histogram->count;
+  histogram->total += interval;
+  if (interval > histogram->max)
+    histogram->max = interval;
+  ++histogram->bucket[HistogramBucketIndex(interval)];
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
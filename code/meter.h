@@ -57,6 +57,35 @@ extern void MeterEmit(Meter meter);
 #define METER_EMIT(meter) STATISTIC(MeterEmit(meter))
 
 
+/* Histogram -- log-linear histogram of clock intervals
+ *
+ * Unlike meters, histograms are always on, in all varieties, so that
+ * they can be read by the client program through mps_arena_stats.
+ * Bucket i counts intervals whose length (in clocks) is at least
+ * HistogramBucketBase(i) and less than HistogramBucketBase(i + 1).
+ * Each power of two is split into HistogramSUB equal sub-buckets,
+ * giving a relative error of at most 1/HistogramSUB.  Intervals too
+ * long for the last bucket are counted in it.
+ */
+
+#define HistogramSUBSHIFT 2
+#define HistogramSUB ((Count)1 << HistogramSUBSHIFT)
+
+typedef struct HistogramStruct *Histogram;
+
+typedef struct HistogramStruct {
+  Count count;                       /* number of intervals */
+  Clock total;                       /* sum of intervals */
+  Clock max;                         /* longest interval */
+  Count bucket[HistogramBUCKETS];    /* see above */
+} HistogramStruct;
+
+extern void HistogramInit(Histogram histogram);
+extern void HistogramAdd(Histogram histogram, Clock interval);
+extern Index HistogramBucketIndex(Clock interval);
+extern Clock HistogramBucketBase(Index index);
+
+
 #endif /* meter_h */
 
 
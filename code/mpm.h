@@ -234,6 +234,8 @@ extern void (PoolFree)(Pool pool, Addr old, Size size);
 extern PoolGen PoolSegPoolGen(Pool pool, Seg seg);
 extern Res PoolTraceBegin(Pool pool, Trace trace);
 extern void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p);
+extern Res PoolFreeze(Pool pool);
+extern void PoolThaw(Pool pool);
 extern Size PoolTotalSize(Pool pool);
 extern Size PoolFreeSize(Pool pool);
 
@@ -306,6 +308,11 @@ extern Bool MessageQueueType(MessageType *typeReturn, Arena arena);
 extern Bool MessageGet(Message *messageReturn, Arena arena,
                        MessageType type);
 extern void MessageDiscard(Arena arena, Message message);
+extern void MessageNotifyDeliver(mps_arena_t arena, Word pending,
+                                 mps_message_notify_t notify,
+                                 void *closure);
+extern void MessageNotifySet(Arena arena, mps_message_notify_t notify,
+                             void *closure);
 /* -- Message Methods, Generic */
 extern MessageType MessageGetType(Message message);
 extern MessageClass MessageGetClass(Message message);
@@ -313,9 +320,13 @@ extern Clock MessageGetClock(Message message);
 /* -- Message Method Dispatchers, Type-specific */
 extern void MessageFinalizationRef(Ref *refReturn,
                                    Arena arena, Message message);
+extern Count MessageFinalizationDrain(Ref *refs, Count count,
+                                      Arena arena);
 extern Size MessageGCLiveSize(Message message);
 extern Size MessageGCCondemnedSize(Message message);
 extern Size MessageGCNotCondemnedSize(Message message);
+extern void MessageGCCensus(Count *countReturn, Size *sizeReturn,
+                            Message message, Index type);
 extern const char *MessageGCStartWhy(Message message);
 /* -- Message Method Stubs, Type-specific */
 extern void MessageNoFinalizationRef(Ref *refReturn,
@@ -323,6 +334,8 @@ extern void MessageNoFinalizationRef(Ref *refReturn,
 extern Size MessageNoGCLiveSize(Message message);
 extern Size MessageNoGCCondemnedSize(Message message);
 extern Size MessageNoGCNotCondemnedSize(Message message);
+extern void MessageNoGCCensus(Count *countReturn, Size *sizeReturn,
+                              Message message, Index type);
 extern const char *MessageNoGCStartWhy(Message message);
 
 
@@ -399,6 +412,8 @@ extern const char *TraceStartWhyToString(TraceStartWhy why);
 extern void TracePostStartMessage(Trace trace);
 extern Bool TraceMessageCheck(TraceMessage message);  /* trace end */
 extern void TracePostMessage(Trace trace);  /* trace end */
+extern void TraceCensus(TraceSet ts, Arena arena, Format format,
+                        Addr obj, Size size);
 extern Bool TraceIdMessagesCheck(Arena arena, TraceId ti);
 extern Res TraceIdMessagesCreate(Arena arena, TraceId ti);
 extern void TraceIdMessagesDestroy(Arena arena, TraceId ti);
@@ -536,6 +551,13 @@ extern Res ArenaStartCollect(Globals globals, TraceStartWhy why);
 extern Res ArenaCollect(Globals globals, TraceStartWhy why);
 extern Bool ArenaBusy(Arena arena);
 extern Bool ArenaHasAddr(Arena arena, Addr addr);
+extern void ArenaLookupExclude(Arena arena);
+extern void ArenaLookupAllow(Arena arena);
+extern Bool ArenaLookupPool(Pool *poolReturn, Arena arena, Addr addr);
+extern Res ArenaBind(Arena arena, Addr base, Addr limit, Index node);
+extern Index ArenaCurrentNode(Arena arena);
+extern void ArenaPrecommit(Arena arena);
+extern Bool ArenaZeroed(Arena arena, Addr base, Addr limit);
 extern void ArenaChunkInsert(Arena arena, Chunk chunk);
 extern void ArenaChunkRemoved(Arena arena, Chunk chunk);
 extern void ArenaAccumulateTime(Arena arena, Clock start, Clock now);
@@ -588,6 +610,8 @@ extern Size ArenaCommitLimit(Arena arena);
 extern Res ArenaSetCommitLimit(Arena arena, Size limit);
 extern double ArenaPauseTime(Arena arena);
 extern void ArenaSetPauseTime(Arena arena, double pauseTime);
+extern void ArenaSetAllocSample(Arena arena, Size interval,
+                                mps_alloc_sample_t fun, void *closure);
 extern Size ArenaNoPurgeSpare(Arena arena, Size size);
 extern Res ArenaNoGrow(Arena arena, LocusPref pref, Size size);
 
@@ -659,6 +683,8 @@ extern Res SegWholeAccess(Seg seg, Arena arena, Addr addr,
 extern Res SegSingleAccess(Seg seg, Arena arena, Addr addr,
                            AccessSet mode, MutatorContext context);
 extern Res SegWhiten(Seg seg, Trace trace);
+extern Res SegFreeze(Seg seg);
+extern void SegThaw(Seg seg);
 extern void SegGreyen(Seg seg, Trace trace);
 extern void SegBlacken(Seg seg, TraceSet traceSet);
 extern Res SegScan(Bool *totalReturn, Seg seg, ScanState ss);
@@ -670,6 +696,8 @@ extern void SegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
 extern Res SegAbsDescribe(Inst seg, mps_lib_FILE *stream, Count depth);
 extern Res SegDescribe(Seg seg, mps_lib_FILE *stream, Count depth);
 extern void SegSetSummary(Seg seg, RefSet summary);
+extern void SegSetGenSummary(Seg seg, ZoneSet white, GenSet genSummary);
+extern Bool SegGenSummaryExcludes(Seg seg, ZoneSet white, GenSet gens);
 extern Bool SegHasBuffer(Seg seg);
 extern Bool SegBuffer(Buffer *bufferReturn, Seg seg);
 extern void SegSetBuffer(Seg seg, Buffer buffer);
@@ -703,6 +731,7 @@ extern Addr (SegLimit)(Seg seg);
 #define SegGrey(seg)            RVALUE((TraceSet)(seg)->grey)
 #define SegWhite(seg)           RVALUE((TraceSet)(seg)->white)
 #define SegNailed(seg)          RVALUE((TraceSet)(seg)->nailed)
+#define SegFrozen(seg)          RVALUE((Bool)(seg)->frozen)
 #define SegPoolRing(seg)        (&(seg)->poolRing)
 #define SegOfPoolRing(node)     RING_ELT(Seg, poolRing, (node))
 #define SegOfGreyRing(node)     (&(RING_ELT(GCSeg, greyRing, (node)) \
@@ -714,6 +743,7 @@ extern Addr (SegLimit)(Seg seg);
 #define SegSetSM(seg, mode)     ((void)((seg)->sm = BS_BITFIELD(Access, (mode))))
 #define SegSetDepth(seg, d)     ((void)((seg)->depth = BITFIELD(unsigned, (d), ShieldDepthWIDTH)))
 #define SegSetNailed(seg, ts)   ((void)((seg)->nailed = BS_BITFIELD(Trace, (ts))))
+#define SegSetZeroed(seg, b)    ((void)((seg)->zeroed = BOOLOF(b)))
 
 
 /* Buffer Interface -- see <code/buffer.c> */
@@ -756,6 +786,7 @@ extern void BufferAttach(Buffer buffer,
                          Addr base, Addr limit, Addr init, Size size);
 extern void BufferDetach(Buffer buffer, Pool pool);
 extern void BufferFlip(Buffer buffer);
+extern void BufferSampleReset(Buffer buffer);
 
 extern mps_ap_t (BufferAP)(Buffer buffer);
 #define BufferAP(buffer)        (&(buffer)->ap_s)
@@ -764,6 +795,7 @@ extern Buffer BufferOfAP(mps_ap_t ap);
 
 #define BufferArena(buffer) ((buffer)->arena)
 #define BufferPool(buffer)  ((buffer)->pool)
+#define BufferNode(buffer)  ((buffer)->node)
 
 extern Seg BufferSeg(Buffer buffer);
 
@@ -856,6 +888,16 @@ extern Bool RankSetCheck(RankSet rankSet);
 #define ZoneSetIsMember(zs, z) BS_IS_MEMBER(zs, z)
 
 
+/* Generation sets -- see <code/trace.c#gen.summary> */
+
+#define GenSetEMPTY            BS_EMPTY(GenSet)
+#define GenSetUNIV             BS_UNIV(GenSet)
+#define GenSetUnion(gs1, gs2)  BS_UNION(gs1, gs2)
+#define GenSetInter(gs1, gs2)  BS_INTER(gs1, gs2)
+#define GenSetAdd(gs, gen) \
+  BS_ADD(GenSet, gs, (gen)->serial % MPS_WORD_WIDTH)
+
+
 extern ZoneSet ZoneSetOfRange(Arena arena, Addr base, Addr limit);
 extern ZoneSet ZoneSetOfSeg(Arena arena, Seg seg);
 typedef Bool (*RangeInZoneSet)(Addr *baseReturn, Addr *limitReturn,
@@ -868,6 +910,10 @@ extern Bool RangeInZoneSetLast(Addr *baseReturn, Addr *limitReturn,
                                Addr base, Addr limit,
                                Arena arena, ZoneSet zoneSet, Size size);
 extern ZoneSet ZoneSetBlacklist(Arena arena);
+extern void ZoneSizeAdd(Size zoneSize[MPS_WORD_WIDTH], Arena arena,
+                        Addr base, Addr limit);
+extern ZoneSet ZoneSizeSub(Size zoneSize[MPS_WORD_WIDTH], Arena arena,
+                           Addr base, Addr limit);
 
 
 /* Shield Interface -- see <code/shield.c> */
@@ -963,7 +1009,8 @@ extern void RootGrey(Root root, Trace trace);
 extern Res RootScan(ScanState ss, Root root);
 extern Arena RootArena(Root root);
 extern Bool RootOfAddr(Root *root, Arena arena, Addr addr);
-extern void RootAccess(Root root, AccessSet mode);
+extern void RootAccess(Root root, Addr addr, AccessSet mode);
+extern void RootSetWatermark(Root root, void *watermark);
 typedef Res (*RootIterateFn)(Root root, void *p);
 extern Res RootsIterate(Globals arena, RootIterateFn f, void *p);
 
@@ -13,6 +13,7 @@
 #include "mpslib.h"
 #include "mpslib.h"
 #include "testlib.h"
+#include "testthr.h"
 
 #include <stdio.h> /* printf */
 
@@ -23,13 +24,22 @@
 #define testLOOPS 10
 
 
-/* check_allocated_size -- check the allocated size of the pool */
+/* check_allocated_size -- check the allocated size of the pool
+ *
+ * Blocks held in a pool's magazine cache count as allocated by the
+ * pool, so when the pool is cached only a bound can be checked.
+ */
+
+static mps_bool_t cached = FALSE;
 
 static void check_allocated_size(mps_pool_t pool, size_t allocated)
 {
   size_t total_size = mps_pool_total_size(pool);
   size_t free_size = mps_pool_free_size(pool);
-  Insist(total_size - free_size == allocated);
+  if (cached)
+    Insist(total_size - free_size >= allocated);
+  else
+    Insist(total_size - free_size == allocated);
 }
 
 
@@ -147,6 +157,151 @@ static mps_pool_debug_option_s fenceOptions = {
   /* .free_size = */        0
 };
 
+/* cache_thread -- allocate and free small blocks in a cached pool
+ *
+ * Several of these run at once on the same pool, so that the stripes
+ * and the depot of the magazine cache are shared.  Each thread fills
+ * the blocks it holds with its own mark, and checks the mark before
+ * freeing them, so a block handed out twice is detected.  testlib's
+ * rnd is not thread-safe, so each thread has its own generator.
+ */
+
+#define cacheTHREADS 4
+#define cacheBLOCKS 100
+#define cacheLOOPS 500
+
+typedef struct cache_thread_s {
+  mps_pool_t pool;
+  mps_align_t align;
+  unsigned long seed;
+} cache_thread_s;
+
+static void *cache_thread(void *arg)
+{
+  cache_thread_s *ct = arg;
+  mps_word_t *ps[cacheBLOCKS];
+  size_t ss[cacheBLOCKS];
+  mps_word_t mark = (mps_word_t)ct;
+  unsigned long r = ct->seed;
+  size_t i, j, k;
+
+  for (i = 0; i < cacheBLOCKS; ++i)
+    ps[i] = NULL;
+  for (k = 0; k < cacheLOOPS; ++k) {
+    for (i = 0; i < cacheBLOCKS; ++i) {
+      mps_addr_t obj;
+      r = (r * 1103515245ul + 12345ul) & 0x7FFFFFFFul;
+      if (ps[i] != NULL) {
+        if ((r & 0x10000) == 0)
+          continue;
+        for (j = 0; j < ss[i] / sizeof(mps_word_t); ++j)
+          Insist(ps[i][j] == mark);
+        mps_free(ct->pool, ps[i], ss[i]);
+      }
+      /* Sizes up to 20 alignment units, so that some miss the cache. */
+      ss[i] = ((r >> 17) % 20 + 1) * ct->align;
+      die(mps_alloc(&obj, ct->pool, ss[i]), "mps_alloc");
+      ps[i] = obj;
+      for (j = 0; j < ss[i] / sizeof(mps_word_t); ++j)
+        ps[i][j] = mark;
+    }
+  }
+  for (i = 0; i < cacheBLOCKS; ++i)
+    mps_free(ct->pool, ps[i], ss[i]);
+  return NULL;
+}
+
+static void cache_threads(mps_arena_t arena)
+{
+  mps_pool_t pool;
+  testthr_t kids[cacheTHREADS];
+  cache_thread_s cts[cacheTHREADS];
+  size_t i;
+
+  printf("Pool class MVFF cached, %d threads\n", cacheTHREADS);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_CACHE, TRUE);
+    die(mps_pool_create_k(&pool, arena, mps_class_mvff(), args),
+        "mps_pool_create_k");
+  } MPS_ARGS_END(args);
+
+  for (i = 0; i < cacheTHREADS; ++i) {
+    cts[i].pool = pool;
+    cts[i].align = MPS_PF_ALIGN;
+    cts[i].seed = rnd();
+    testthr_create(&kids[i], cache_thread, &cts[i]);
+  }
+  for (i = 0; i < cacheTHREADS; ++i)
+    testthr_join(&kids[i], NULL);
+
+  mps_pool_destroy(pool);
+}
+
+
+/* cache_flush -- check that cached blocks are used when memory runs out
+ *
+ * Fill the arena up to a commit limit with blocks of the smallest
+ * size and free them, so that the cache holds as many of them as it
+ * can.  Then allocate blocks of twice the size until that fails: by
+ * then, mps_alloc must have flushed the cache back to the pool.  The
+ * blocks are kept on lists threaded through their first words.
+ */
+
+static void cache_flush(mps_arena_t arena)
+{
+  mps_pool_t pool;
+  size_t size0 = sizeof(void *), size1 = 2 * sizeof(void *);
+  size_t commit_limit, n1 = 0;
+  void **list = NULL, **next;
+  mps_addr_t obj;
+  size_t i;
+
+  printf("Pool class MVFF cached, commit limit\n");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, size0);
+    MPS_ARGS_ADD(args, MPS_KEY_SPARE, 0.0);
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_CACHE, TRUE);
+    die(mps_pool_create_k(&pool, arena, mps_class_mvff(), args),
+        "mps_pool_create_k");
+  } MPS_ARGS_END(args);
+
+  /* Before the limit is set, so that the cache can get magazines. */
+  for (i = 0; i < 10000; ++i) {
+    die(mps_alloc(&obj, pool, size0), "mps_alloc");
+    *(void **)obj = list;
+    list = obj;
+  }
+  for (; list != NULL; list = next) {
+    next = *list;
+    mps_free(pool, list, size0);
+  }
+
+  commit_limit = mps_arena_commit_limit(arena);
+  die(mps_arena_commit_limit_set(arena, mps_arena_committed(arena)
+                                 + ((size_t)1 << 20)),
+      "mps_arena_commit_limit_set");
+
+  while (mps_alloc(&obj, pool, size0) == MPS_RES_OK) {
+    *(void **)obj = list;
+    list = obj;
+  }
+  for (; list != NULL; list = next) {
+    next = *list;
+    mps_free(pool, list, size0);
+  }
+  Insist(mps_pool_total_size(pool) > mps_pool_free_size(pool));
+
+  while (mps_alloc(&obj, pool, size1) == MPS_RES_OK)
+    ++n1;
+  Insist(mps_pool_total_size(pool) - mps_pool_free_size(pool)
+         == n1 * size1);
+
+  mps_pool_destroy(pool);
+  die(mps_arena_commit_limit_set(arena, commit_limit),
+      "mps_arena_commit_limit_set");
+}
+
+
 /* testInArena -- test all the pool classes in the given arena */
 
 static void testInArena(mps_arena_class_t arena_class, size_t arena_grain_size,
@@ -168,6 +323,15 @@ static void testInArena(mps_arena_class_t arena_class, size_t arena_grain_size,
                mps_class_mvff(), args), "stress MVFF");
   } MPS_ARGS_END(args);
 
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_TLSF, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_SPARE, rnd_double());
+    die(stress(arena, NULL, randomSizeAligned, align, "MVFF TLSF",
+               mps_class_mvff(), args), "stress MVFF TLSF");
+  } MPS_ARGS_END(args);
+
   MPS_ARGS_BEGIN(args) {
     mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
@@ -188,6 +352,36 @@ static void testInArena(mps_arena_class_t arena_class, size_t arena_grain_size,
                mps_class_mfs(), args), "stress MFS");
   } MPS_ARGS_END(args);
 
+  cached = TRUE;
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_CACHE, TRUE);
+    die(stress(arena, NULL, randomSizeAligned, align, "MVFF cached",
+               mps_class_mvff(), args), "stress MVFF cached");
+  } MPS_ARGS_END(args);
+
+  MPS_ARGS_BEGIN(args) {
+    fixedSizeSize = 1 + rnd() % 64;
+    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, fixedSizeSize);
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_CACHE, TRUE);
+    die(stress(arena, NULL, fixedSize, MPS_PF_ALIGN, "MFS cached",
+               mps_class_mfs(), args), "stress MFS cached");
+  } MPS_ARGS_END(args);
+
+  cache_threads(arena);
+  cache_flush(arena);
+
+  /* A debugging pool can't have a cache. */
+  MPS_ARGS_BEGIN(args) {
+    mps_pool_t pool;
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_DEBUG_OPTIONS, options);
+    MPS_ARGS_ADD(args, MPS_KEY_POOL_CACHE, TRUE);
+    Insist(mps_pool_create_k(&pool, arena, mps_class_mvff_debug(), args)
+           == MPS_RES_PARAM);
+  } MPS_ARGS_END(args);
+  cached = FALSE;
+
   /* Manual allocation should not cause any garbage collections. */
   Insist(mps_collections(arena) == 0);
   mps_arena_destroy(arena);
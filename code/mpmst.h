@@ -96,6 +96,7 @@ typedef struct mps_pool_s {     /* generic structure */
   Align alignment;              /* alignment for grains */
   Shift alignShift;             /* log2(alignment) */
   Format format;                /* format or NULL */
+  MagCache cache;               /* magazine cache or NULL, <code/mag.c> */
 } PoolStruct;
 
 
@@ -150,6 +151,7 @@ typedef struct MessageClassStruct {
   MessageGCLiveSizeMethod gcLiveSize;
   MessageGCCondemnedSizeMethod gcCondemnedSize;
   MessageGCNotCondemnedSizeMethod gcNotCondemnedSize;
+  MessageGCCensusMethod gcCensus;
 
   /* methods specific to MessageTypeGCSTART */
   MessageGCStartWhyMethod gcStartWhy;
@@ -208,6 +210,7 @@ typedef struct SegClassStruct {
   SegFixMethod fixEmergency;    /* as fix, no failure allowed */
   SegReclaimMethod reclaim;     /* reclaim dead objects after tracing */
   SegWalkMethod walk;           /* walk over a segment */
+  SegFreezeMethod freeze;       /* account objects before freezing */
   Sig sig;                      /* .class.end-sig */
 } SegClassStruct;
 
@@ -227,6 +230,8 @@ typedef struct SegStruct {      /* segment structure */
   Addr limit;                   /* limit of segment */
   unsigned depth : ShieldDepthWIDTH; /* see <design/shield#.def.depth> */
   BOOLFIELD(queued);            /* in shield queue? */
+  BOOLFIELD(zeroed);            /* known to be zero? <code/buffer.c#zeroed> */
+  BOOLFIELD(frozen);            /* permanently black? <design/seg#.frozen> */
   AccessSet pm : AccessLIMIT;   /* protection mode, <code/shield.c> */
   AccessSet sm : AccessLIMIT;   /* shield mode, <code/shield.c> */
   TraceSet grey : TraceLIMIT;   /* traces for which seg is grey */
@@ -250,6 +255,9 @@ typedef struct GCSegStruct {    /* GC segment structure */
   RefSet summary;               /* summary of references out of seg */
   Buffer buffer;                /* non-NULL if seg is buffered */
   RingStruct genRing;           /* link in list of segs in gen */
+  GenDesc gen;                  /* generation of seg, or NULL */
+  GenSet genSummary;            /* generations referred to by seg */
+  ZoneSet genWhite;             /* white set for which genSummary holds */
   Sig sig;                      /* <design/sig> */
 } GCSegStruct;
 
@@ -268,6 +276,7 @@ typedef struct LocusPrefStruct { /* locus placement preferences */
   Bool high;                    /* high or low */
   ZoneSet zones;                /* preferred zones */
   ZoneSet avoid;                /* zones to avoid */
+  Index node;                   /* preferred memory node, or NodeNONE */
 } LocusPrefStruct;
 
 
@@ -325,6 +334,11 @@ typedef struct BufferStruct {
   Addr poolLimit;               /* the pool's idea of the limit */
   Align alignment;              /* allocation alignment */
   unsigned rampCount;           /* see <code/buffer.c#ramp.hack> */
+  Index node;                   /* preferred memory node, <code/buffer.c#numa> */
+  Bool zeroed;                  /* reserves zeros? <code/buffer.c#zeroed> */
+  Addr sampleBase;              /* sampling countdown starts here ... */
+  Size sampleRemaining;         /* ... and ends here, <code/buffer.c#sample> */
+  Bool sampled;                 /* last fill took a sample? */
 } BufferStruct;
 
 
@@ -365,6 +379,7 @@ typedef struct mps_fmt_s {
   mps_fmt_isfwd_t isMoved;
   mps_fmt_pad_t pad;
   mps_fmt_class_t klass;        /* pointer indicating class */
+  mps_fmt_census_t census;      /* census type of object, or NULL */
   Size headerSize;              /* size of header */
 } FormatStruct;
 
@@ -411,15 +426,17 @@ typedef struct ScanStateStruct {
   Rank rank;                    /* reference rank of scanning */
   Bool wasMarked;               /* <design/fix#.protocol.was-ready> */
   RefSet fixedSummary;          /* accumulated summary of fixed references */
-  STATISTIC_DECL(Count fixRefCount) /* refs which pass zone check */
+  GenSet genSummary;            /* generations referred to by fixed refs */
+  Count fixRefCount;            /* refs which pass zone check */
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segs */
-  STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
+  Count whiteSegRefCount;       /* refs which refer to white segs */
   STATISTIC_DECL(Count nailCount) /* segments nailed by ambig refs */
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objs */
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
   STATISTIC_DECL(Size copiedSize) /* bytes copied */
   Size scannedSize;             /* bytes scanned */
+  STATISTIC_DECL(Size skippedSize) /* root bytes not scanned */
 } ScanStateStruct;
 
 
@@ -434,6 +451,7 @@ typedef struct TraceStruct {
   TraceStartWhy why;            /* why the trace began */
   ZoneSet white;                /* zones in the white set */
   ZoneSet mayMove;              /* zones containing possibly moving objs */
+  GenSet whiteGens;             /* generations in the white set */
   TraceState state;             /* current state of trace */
   Rank band;                    /* current band */
   Bool firstStretch;            /* in first stretch of band (see accessor) */
@@ -450,19 +468,21 @@ typedef struct TraceStruct {
   STATISTIC_DECL(Count rootScanCount) /* number of roots scanned */
   Count rootScanSize;           /* total size of scanned roots */
   STATISTIC_DECL(Size rootCopiedSize) /* bytes copied by scanning roots */
+  STATISTIC_DECL(Size rootSkippedSize) /* root bytes skipped as unchanged */
   STATISTIC_DECL(Count segScanCount) /* number of segments scanned */
   Count segScanSize;            /* total size of scanned segments */
   STATISTIC_DECL(Size segCopiedSize) /* bytes copied by scanning segments */
   STATISTIC_DECL(Count singleScanCount) /* number of single refs scanned */
   STATISTIC_DECL(Count singleScanSize) /* total size of single refs scanned */
   STATISTIC_DECL(Size singleCopiedSize) /* bytes copied by scanning single refs */
-  STATISTIC_DECL(Count fixRefCount) /* refs which pass zone check */
+  Count fixRefCount;            /* refs which pass zone check */
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segments */
-  STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
+  Count whiteSegRefCount;       /* refs which refer to white segs */
   STATISTIC_DECL(Count nailCount) /* segments nailed by ambiguous refs */
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objects */
   STATISTIC_DECL(Count readBarrierHitCount) /* read barrier faults */
   STATISTIC_DECL(Count pointlessScanCount) /* pointless segment scans */
+  Count genSkipCount;           /* segs not greyed due to genSummary */
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
   Size forwardedSize;           /* bytes preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
@@ -492,6 +512,10 @@ typedef struct mps_arena_class_s {
   ArenaCompactMethod compact;
   ArenaPagesMarkAllocatedMethod pagesMarkAllocated;
   ArenaChunkPageMappedMethod chunkPageMapped;
+  ArenaBindMethod bind;
+  ArenaCurrentNodeMethod currentNode;
+  ArenaPrecommitMethod precommit;
+  ArenaZeroedMethod zeroed;
   Sig sig;
 } ArenaClassStruct;
 
@@ -647,6 +671,36 @@ typedef struct FreelistStruct {
 } FreelistStruct;
 
 
+/* TLSFStruct -- two-level segregated fit
+ *
+ * TLSF is a subclass of Land that maintains a collection of disjoint
+ * ranges in segregated free lists indexed by size class, with
+ * address-hashed tables of block boundaries for coalescing.
+ *
+ * See <code/tlsf.c>.
+ */
+
+#define TLSFSig ((Sig)0x5197157F) /* SIGnature TLSF */
+
+typedef struct TLSFBlockStruct *TLSFBlock;
+
+typedef struct TLSFStruct {
+  LandStruct landStruct;        /* superclass fields come first */
+  Pool blockPool;               /* pool that manages block descriptors */
+  Shift alignShift;             /* log2 of land alignment */
+  Word flBitmap;                /* first-level classes that are non-empty */
+  Word slBitmap[TLSF_FL_COUNT]; /* second-level classes that are non-empty */
+  TLSFBlock *freeLists;         /* list of blocks in each size class */
+  TLSFBlock *baseTable;         /* blocks hashed by base address */
+  TLSFBlock *limitTable;        /* blocks hashed by limit address */
+  Count buckets;                /* number of buckets in each table */
+  TLSFBlock hint;               /* block last found, or NULL */
+  Count blocks;                 /* number of blocks */
+  Size size;                    /* total size of ranges in TLSF */
+  Sig sig;                      /* .class.end-sig */
+} TLSFStruct;
+
+
 /* SortStruct -- extra memory required by sorting
  *
  * See QuickSort in mpm.c.  This exists so that the caller can make
@@ -680,6 +734,7 @@ typedef struct ShieldStruct {
   Count depth;       /* sum of depths of all segs */
   Count unsynced;    /* number of unsynced segments */
   Count holds;       /* number of holds */
+  Clock suspendTime; /* when mutator was suspended, if suspended */
   SortStruct sortStruct; /* workspace for queue sort */
 } ShieldStruct;
 
@@ -719,10 +774,15 @@ typedef struct MVFFStruct {     /* MVFF pool outer structure */
   double spare;                 /* spare space fraction, see MVFFReduce */
   MFSStruct cbsBlockPoolStruct; /* stores blocks for CBSs */
   CBSStruct totalCBSStruct;     /* all memory allocated from the arena */
-  CBSStruct freeCBSStruct;      /* free memory (primary) */
+  union {                       /* free memory (primary) */
+    LandStruct landStruct;      /* ... superclass fields of either */
+    CBSStruct cbsStruct;        /* ... unless MPS_KEY_MVFF_TLSF */
+    TLSFStruct tlsfStruct;      /* ... if MPS_KEY_MVFF_TLSF */
+  } freePrimaryStruct;
   FreelistStruct flStruct;      /* free memory (secondary, for emergencies) */
   FailoverStruct foStruct;      /* free memory (fail-over mechanism) */
   Bool firstFit;                /* as opposed to last fit */
+  Bool tlsf;                    /* free primary is TLSF, not CBS */
   Bool slotHigh;                /* prefers high part of large block */
   Sig sig;                      /* <design/sig> */
 } MVFFStruct;
@@ -752,6 +812,16 @@ typedef struct mps_arena_s {
   double spare;                 /* maximum spareCommitted/committed */
   double pauseTime;             /* maximum pause time, in seconds */
 
+  Size sampleInterval;          /* mean bytes between samples, or 0 */
+  mps_alloc_sample_t sampleFun; /* client sample function, or NULL */
+  void *sampleClosure;          /* closure argument for sampleFun */
+
+  Size precommit;               /* maximum headroom, see ArenaPrecommit */
+  double precommitRate;         /* smoothed allocation rate, bytes/sec */
+  double precommitFilled;       /* bytes filled at last sample */
+  Clock precommitClock;         /* time of last sample */
+  ZoneSet precommitZones;       /* zones allocated in since last sample */
+
   Shift zoneShift;              /* see also <code/ref.c> */
   Size grainSize;               /* <design/arena#.grain> */
 
@@ -762,11 +832,14 @@ typedef struct mps_arena_s {
   RingStruct chunkRing;         /* all the chunks, in a ring for iteration */
   Tree chunkTree;               /* all the chunks, in a tree for fast lookup */
   Serial chunkSerial;           /* next chunk number */
+  Count lookupReaders;          /* lock-free lookups in progress */
+  Count lookupExcluded;         /* depth of exclusion of lock-free lookups */
 
   Bool hasFreeLand;              /* Is freeLand available? */
   MFSStruct freeCBSBlockPoolStruct;
   CBSStruct freeLandStruct;
-  ZoneSet freeZones;            /* zones not yet allocated */
+  ZoneSet freeZones;            /* zones with no memory allocated */
+  Size zoneSize[MPS_WORD_WIDTH]; /* memory allocated in each zone */
   Bool zoned;                   /* use zoned allocation? */
 
   /* locus fields <code/locus.c> */
@@ -781,6 +854,9 @@ typedef struct mps_arena_s {
   RingStruct messageRing;       /* ring of pending messages */
   BT enabledMessageTypes;       /* map of which types are enabled */
   Count droppedMessages;        /* <design/message-gc#.lifecycle> */
+  mps_message_notify_t messageNotify; /* client notifier, or NULL */
+  void *messageNotifyClosure;   /* closure argument for messageNotify */
+  Word messageNotifyPending;    /* types posted but not yet notified */
 
   /* finalization fields <design/finalize>, <code/poolmrg.c> */
   Bool isFinalPool;             /* indicator for finalPool */
@@ -796,6 +872,10 @@ typedef struct mps_arena_s {
   /* trace fields <code/trace.c> */
   TraceSet busyTraces;          /* set of running traces */
   TraceSet flippedTraces;       /* set of running and flipped traces */
+  /* .rb: The software read barrier is exported to the client
+     program by mps_arena_rb. See <code/mps.h#rb> and
+     <design/poolawl#.soft>. */
+  mps_rb_s rb_s;                /* software read barrier */
   TraceStruct trace[TraceLIMIT]; /* trace structures.  See
                                    <design/trace#.instance.limit> */
 
@@ -808,6 +888,17 @@ typedef struct mps_arena_s {
   double tracedTime;
   Clock lastWorldCollect;
 
+  /* statistics fields, see mps_arena_stats <code/mpsi.c> */
+  HistogramStruct pollHistogram;    /* ArenaPoll/ArenaStep increments */
+  HistogramStruct flipHistogram;    /* traceFlip */
+  HistogramStruct reclaimHistogram; /* traceReclaim */
+  HistogramStruct suspendHistogram; /* time mutator threads suspended */
+  Count accessCount;                /* barrier hits in ArenaAccess */
+  Count fillCount;                  /* buffer refills in BufferFill */
+  Count fixRefCount;                /* refs which passed zone check */
+  Count whiteSegRefCount;           /* refs which hit white segments */
+  Count genSkipCount;               /* segs not greyed due to genSummary */
+
   RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
   RingStruct chainRing;         /* ring of chains */
 
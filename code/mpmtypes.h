@@ -53,6 +53,7 @@ typedef mps_key_t Key;
 
 typedef Word RefSet;                    /* <design/collection#.refsets> */
 typedef Word ZoneSet;                   /* <design/collection#.refsets> */
+typedef Word GenSet;                    /* <code/trace.c#gen.summary> */
 typedef unsigned Rank;                  /* <design/type#.rank> */
 typedef unsigned RankSet;               /* <design/type#.rankset> */
 typedef unsigned RootMode;              /* <design/type#.rootmode> */
@@ -108,6 +109,7 @@ typedef unsigned FindDelete;            /* <design/land> */
 typedef struct ShieldStruct *Shield; /* <design/shield> */
 typedef struct HistoryStruct *History;  /* <design/arena#.ld> */
 typedef struct PoolGenStruct *PoolGen;  /* <design/strategy> */
+typedef struct MagCacheStruct *MagCache; /* <code/mag.c> */
 
 
 /* Arena*Method -- see <code/mpmst.h#ArenaClassStruct> */
@@ -127,6 +129,11 @@ typedef Res (*ArenaPagesMarkAllocatedMethod)(Arena arena, Chunk chunk,
                                              Index baseIndex, Count pages,
                                              Pool pool);
 typedef Bool (*ArenaChunkPageMappedMethod)(Chunk chunk, Index index);
+typedef Res (*ArenaBindMethod)(Arena arena, Addr base, Addr limit,
+                               Index node);
+typedef Index (*ArenaCurrentNodeMethod)(Arena arena);
+typedef Size (*ArenaPrecommitMethod)(Arena arena, Addr base, Addr limit);
+typedef Bool (*ArenaZeroedMethod)(Arena arena, Addr base, Addr limit);
 
 
 /* These are not generally exposed and public, but are part of a commercial
@@ -181,6 +188,7 @@ typedef Res (*SegFixMethod)(Seg seg, ScanState ss, Ref *refIO);
 typedef void (*SegReclaimMethod)(Seg seg, Trace trace);
 typedef void (*SegWalkMethod)(Seg seg, Format format, FormattedObjectsVisitor f,
                               void *v, size_t s);
+typedef Res (*SegFreezeMethod)(Seg seg);
 
 
 /* Buffer*Method -- see <design/buffer> */
@@ -237,6 +245,8 @@ typedef void (*MessageFinalizationRefMethod)
 typedef Size (*MessageGCLiveSizeMethod)(Message message);
 typedef Size (*MessageGCCondemnedSizeMethod)(Message message);
 typedef Size (*MessageGCNotCondemnedSizeMethod)(Message message);
+typedef void (*MessageGCCensusMethod)(Count *countReturn, Size *sizeReturn,
+                                      Message message, Index type);
 typedef const char * (*MessageGCStartWhyMethod)(Message message);
 
 /* Message Types -- <design/message> and elsewhere */
@@ -289,9 +299,13 @@ enum {
   LocusPrefHIGH = 1,
   LocusPrefLOW,
   LocusPrefZONESET,
+  LocusPrefNODE,
   LocusPrefLIMIT
 };
 
+/* Memory nodes.  <code/buffer.c#numa> */
+#define NodeNONE        ((Index)-1)     /* no preferred node */
+
 
 /* Buffer modes */
 #define BufferModeATTACHED      ((BufferMode)(1<<0))
@@ -56,6 +56,7 @@
 #include "ld.c"
 #include "event.c"
 #include "sac.c"
+#include "mag.c"
 #include "message.c"
 #include "poolmrg.c"
 #include "poolmfs.c"
@@ -78,6 +79,7 @@
 #include "nailboard.c"
 #include "land.c"
 #include "failover.c"
+#include "tlsf.c"
 #include "vm.c"
 #include "policy.c"
 
@@ -88,6 +90,7 @@
 #include "poolawl.c"
 #include "poollo.c"
 #include "poolsnc.c"
+#include "poolrgn.c"
 #include "poolmv2.c"
 #include "poolmvff.c"
 
@@ -95,8 +98,12 @@
 
 #if defined(PLINTH)     /* see CONFIG_PLINTH_NONE in config.h  */
 #include "mpsliban.c"
+#if defined(IO_RING)    /* see CONFIG_IO_RING in config.h */
+#include "mpsioix.c"
+#else
 #include "mpsioan.c"
 #endif
+#endif
 
 /* Generic ("ANSI") platform */
 
@@ -57,6 +57,7 @@ typedef struct mps_thr_s    *mps_thr_t;    /* thread registration */
 typedef struct mps_ap_s     *mps_ap_t;     /* allocation point */
 typedef struct mps_ld_s     *mps_ld_t;     /* location dependency */
 typedef struct mps_ss_s     *mps_ss_t;     /* scan state */
+typedef struct mps_rb_s     *mps_rb_t;     /* software read barrier */
 typedef struct mps_message_s
   *mps_message_t;                          /* message */
 typedef struct mps_alloc_pattern_s
@@ -119,6 +120,7 @@ typedef void (*mps_fmt_fwd_t)(mps_addr_t, mps_addr_t);
 typedef mps_addr_t (*mps_fmt_isfwd_t)(mps_addr_t);
 typedef void (*mps_fmt_pad_t)(mps_addr_t, size_t);
 typedef mps_addr_t (*mps_fmt_class_t)(mps_addr_t);
+typedef size_t (*mps_fmt_census_t)(mps_addr_t);
 
 
 /* Keyword argument lists */
@@ -154,6 +156,7 @@ typedef struct mps_arg_s {
     mps_fmt_isfwd_t fmt_isfwd;
     mps_fmt_pad_t fmt_pad;
     mps_fmt_class_t fmt_class;
+    mps_fmt_census_t fmt_census;
     mps_pool_t pool;
   } val;
 } mps_arg_s;
@@ -192,6 +195,9 @@ extern const struct mps_key_s _mps_key_SPARE_COMMIT_LIMIT;
 extern const struct mps_key_s _mps_key_PAUSE_TIME;
 #define MPS_KEY_PAUSE_TIME      (&_mps_key_PAUSE_TIME)
 #define MPS_KEY_PAUSE_TIME_FIELD d
+extern const struct mps_key_s _mps_key_ARENA_PRECOMMIT;
+#define MPS_KEY_ARENA_PRECOMMIT (&_mps_key_ARENA_PRECOMMIT)
+#define MPS_KEY_ARENA_PRECOMMIT_FIELD size
 
 extern const struct mps_key_s _mps_key_EXTEND_BY;
 #define MPS_KEY_EXTEND_BY       (&_mps_key_EXTEND_BY)
@@ -217,6 +223,18 @@ extern const struct mps_key_s _mps_key_SPARE;
 extern const struct mps_key_s _mps_key_INTERIOR;
 #define MPS_KEY_INTERIOR        (&_mps_key_INTERIOR)
 #define MPS_KEY_INTERIOR_FIELD  b
+extern const struct mps_key_s _mps_key_AP_NUMA;
+#define MPS_KEY_AP_NUMA         (&_mps_key_AP_NUMA)
+#define MPS_KEY_AP_NUMA_FIELD   b
+extern const struct mps_key_s _mps_key_AP_ZEROED;
+#define MPS_KEY_AP_ZEROED       (&_mps_key_AP_ZEROED)
+#define MPS_KEY_AP_ZEROED_FIELD b
+extern const struct mps_key_s _mps_key_POOL_CACHE;
+#define MPS_KEY_POOL_CACHE      (&_mps_key_POOL_CACHE)
+#define MPS_KEY_POOL_CACHE_FIELD b
+extern const struct mps_key_s _mps_key_SAC_LOOKUP_LIMIT;
+#define MPS_KEY_SAC_LOOKUP_LIMIT (&_mps_key_SAC_LOOKUP_LIMIT)
+#define MPS_KEY_SAC_LOOKUP_LIMIT_FIELD size
 
 extern const struct mps_key_s _mps_key_VMW3_TOP_DOWN;
 #define MPS_KEY_VMW3_TOP_DOWN   (&_mps_key_VMW3_TOP_DOWN)
@@ -246,6 +264,9 @@ extern const struct mps_key_s _mps_key_FMT_PAD;
 extern const struct mps_key_s _mps_key_FMT_CLASS;
 #define MPS_KEY_FMT_CLASS   (&_mps_key_FMT_CLASS)
 #define MPS_KEY_FMT_CLASS_FIELD fmt_class
+extern const struct mps_key_s _mps_key_FMT_CENSUS;
+#define MPS_KEY_FMT_CENSUS   (&_mps_key_FMT_CENSUS)
+#define MPS_KEY_FMT_CENSUS_FIELD fmt_census
 
 /* Maximum length of a keyword argument list. */
 #define MPS_ARGS_MAX          32
@@ -297,6 +318,10 @@ enum {
 #define mps_message_type_gc() _mps_MESSAGE_TYPE_GC
 #define mps_message_type_gc_start() _mps_MESSAGE_TYPE_GC_START
 
+/* Message notification function, see mps_message_notify_set. */
+typedef void (*mps_message_notify_t)(mps_arena_t, mps_message_type_t,
+                                     void *);
+
 
 /* Reference Ranks
  *
@@ -312,7 +337,7 @@ extern mps_rank_t mps_rank_weak(void);
 
 #define MPS_RM_CONST      (((mps_rm_t)1<<0))
 #define MPS_RM_PROT       (((mps_rm_t)1<<1))
-#define MPS_RM_PROT_INNER (((mps_rm_t)1<<1))
+#define MPS_RM_PROT_INNER (((mps_rm_t)1<<2))
 
 
 /* Allocation Point */
@@ -338,9 +363,15 @@ typedef struct _mps_sac_freelist_block_s {
   mps_addr_t _blocks;
 } _mps_sac_freelist_block_s;
 
+/* _freelists is variable length and must be last, so the fields for
+   the lookup table precede it. */
+
 typedef struct _mps_sac_s {
   size_t _middle;
   mps_bool_t _trapped;
+  size_t _lookup_limit;         /* sizes up to this use _lookup */
+  unsigned _lookup_shift;       /* log2 of the pool alignment */
+  unsigned char *_lookup;       /* (size-1) >> _lookup_shift -> index */
   _mps_sac_freelist_block_s _freelists[2 * MPS_SAC_CLASS_LIMIT];
 } _mps_sac_s;
 
@@ -370,6 +401,15 @@ typedef struct mps_ss_s {
 } mps_ss_s;
 
 
+/* Software Read Barrier */
+/* .rb: See also <code/mpmst.h#rb>. */
+
+typedef struct mps_rb_s {
+  mps_arena_t _arena;
+  mps_word_t _zs, _w, _epoch;
+} mps_rb_s;
+
+
 /* Format Variants */
 
 typedef struct mps_fmt_A_s {
@@ -460,6 +500,38 @@ extern size_t mps_arena_spare_commit_limit(mps_arena_t);
 extern double mps_arena_pause_time(mps_arena_t);
 extern void mps_arena_pause_time_set(mps_arena_t, double);
 
+/* Allocation sampling function, see mps_arena_alloc_sample_set. */
+typedef void (*mps_alloc_sample_t)(mps_ap_t, mps_addr_t, size_t, void *);
+extern void mps_arena_alloc_sample_set(mps_arena_t, size_t,
+                                       mps_alloc_sample_t, void *);
+
+/* .histogram.buckets: Must match HistogramBUCKETS in <code/config.h>. */
+#define MPS_HISTOGRAM_BUCKETS 128
+
+typedef struct mps_histogram_s {
+  size_t count;                        /* number of intervals */
+  mps_clock_t total;                   /* sum of intervals */
+  mps_clock_t max;                     /* longest interval */
+  size_t bucket[MPS_HISTOGRAM_BUCKETS]; /* counts by interval length */
+} mps_histogram_s;
+
+typedef struct mps_arena_stats_s {
+  size_t size;                  /* size of this structure */
+  mps_histogram_s increment;    /* incremental collection work */
+  mps_histogram_s flip;         /* flips */
+  mps_histogram_s reclaim;      /* reclaims */
+  mps_histogram_s suspend;      /* mutator thread suspensions */
+  size_t access;                /* barrier hits */
+  size_t fill;                  /* allocation point refills */
+  size_t fix;                   /* references passing the zone check */
+  size_t fix_white;             /* references to condemned segments */
+  mps_word_t zones_free;        /* zones with no memory allocated */
+  size_t gen_skip;              /* segments skipped by generation */
+} mps_arena_stats_s;
+
+extern void mps_arena_stats(mps_arena_stats_s *, mps_arena_t);
+extern mps_clock_t mps_histogram_bucket_base(size_t);
+
 extern mps_bool_t mps_arena_busy(mps_arena_t);
 extern mps_bool_t mps_arena_has_addr(mps_arena_t, mps_addr_t);
 extern mps_bool_t mps_addr_pool(mps_pool_t *, mps_arena_t, mps_addr_t);
@@ -499,6 +571,8 @@ extern void mps_pool_destroy(mps_pool_t);
 extern size_t mps_pool_total_size(mps_pool_t);
 extern size_t mps_pool_free_size(mps_pool_t);
 extern mps_res_t mps_pool_walk(mps_pool_t, mps_area_scan_t, void *);
+extern mps_res_t mps_pool_freeze(mps_pool_t);
+extern void mps_pool_thaw(mps_pool_t);
 
 
 /* Chains */
@@ -548,6 +622,8 @@ extern mps_res_t mps_ap_alloc_pattern_reset(mps_ap_t);
 
 extern mps_res_t mps_sac_create(mps_sac_t *, mps_pool_t, size_t,
                                 mps_sac_classes_s *);
+extern mps_res_t mps_sac_create_k(mps_sac_t *, mps_pool_t, size_t,
+                                  mps_sac_classes_s *, mps_arg_s []);
 extern void mps_sac_destroy(mps_sac_t);
 extern mps_res_t mps_sac_alloc(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
 extern void mps_sac_free(mps_sac_t, mps_addr_t, size_t);
@@ -557,20 +633,35 @@ extern void mps_sac_flush(mps_sac_t);
 extern mps_res_t mps_sac_fill(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
 extern void mps_sac_empty(mps_sac_t, mps_addr_t, size_t);
 
+/* _MPS_SAC_FIND -- find the free list for size
+ *
+ * Sizes up to _lookup_limit are looked up in a table built by
+ * mps_sac_create_k; larger sizes, and all sizes if there is no table
+ * (_lookup_limit is zero), walk the free lists out from the middle.
+ * Keep in sync with <code/sac.c#find>.
+ */
+
+#define _MPS_SAC_FIND(i_o, sac, s) \
+  MPS_BEGIN \
+    if ((s) - 1 < (sac)->_lookup_limit) { \
+      (i_o) = (sac)->_lookup[((s) - 1) >> (sac)->_lookup_shift]; \
+    } else if ((s) > (sac)->_middle) { \
+      (i_o) = 0; \
+      while ((s) > (sac)->_freelists[i_o]._size) \
+        (i_o) += 2; \
+    } else { \
+      (i_o) = 1; \
+      while ((s) <= (sac)->_freelists[i_o]._size) \
+        (i_o) += 2; \
+    } \
+  MPS_END
+
 #define MPS_SAC_ALLOC_FAST(res_o, p_o, sac, size, unused) \
   MPS_BEGIN \
     size_t _mps_i, _mps_s; \
     \
     _mps_s = (size); \
-    if (_mps_s > (sac)->_middle) { \
-      _mps_i = 0; \
-      while (_mps_s > (sac)->_freelists[_mps_i]._size) \
-        _mps_i += 2; \
-    } else { \
-      _mps_i = 1; \
-      while (_mps_s <= (sac)->_freelists[_mps_i]._size) \
-        _mps_i += 2; \
-    } \
+    _MPS_SAC_FIND(_mps_i, sac, _mps_s); \
     if ((sac)->_freelists[_mps_i]._count != 0) { \
       (p_o) = (sac)->_freelists[_mps_i]._blocks; \
       (sac)->_freelists[_mps_i]._blocks = *(mps_addr_t *)(p_o); \
@@ -585,15 +676,7 @@ extern void mps_sac_empty(mps_sac_t, mps_addr_t, size_t);
     size_t _mps_i, _mps_s; \
     \
     _mps_s = (size); \
-    if (_mps_s > (sac)->_middle) { \
-      _mps_i = 0; \
-      while (_mps_s > (sac)->_freelists[_mps_i]._size) \
-        _mps_i += 2; \
-    } else { \
-      _mps_i = 1; \
-      while (_mps_s <= (sac)->_freelists[_mps_i]._size) \
-        _mps_i += 2; \
-    } \
+    _MPS_SAC_FIND(_mps_i, sac, _mps_s); \
     if ((sac)->_freelists[_mps_i]._count \
         < (sac)->_freelists[_mps_i]._count_max) { \
        *(mps_addr_t *)(p) = (sac)->_freelists[_mps_i]._blocks; \
@@ -683,6 +766,7 @@ extern mps_res_t mps_root_create_thread_tagged(mps_root_t *, mps_arena_t,
                                                mps_area_scan_t,
                                                mps_word_t, mps_word_t,
                                                void *);
+extern void mps_root_thread_watermark_set(mps_root_t, void *);
 extern void mps_root_destroy(mps_root_t);
 
 extern mps_res_t mps_stack_scan_ambig(mps_ss_t, mps_thr_t,
@@ -715,6 +799,8 @@ extern mps_bool_t mps_message_queue_type(mps_message_type_t *, mps_arena_t);
 extern mps_bool_t mps_message_get(mps_message_t *,
                                   mps_arena_t, mps_message_type_t);
 extern void mps_message_discard(mps_arena_t, mps_message_t);
+extern void mps_message_notify_set(mps_arena_t, mps_message_notify_t,
+                                   void *);
 
 /* Message Methods */
 
@@ -725,6 +811,8 @@ extern mps_clock_t mps_message_clock(mps_arena_t, mps_message_t);
 /* -- mps_message_type_finalization */
 extern void mps_message_finalization_ref(mps_addr_t *,
                                          mps_arena_t, mps_message_t);
+extern size_t mps_message_finalization_drain(mps_addr_t *, size_t,
+                                             mps_arena_t);
 
 /* -- mps_message_type_gc */
 extern size_t mps_message_gc_live_size(mps_arena_t, mps_message_t);
@@ -732,6 +820,12 @@ extern size_t mps_message_gc_condemned_size(mps_arena_t, mps_message_t);
 extern size_t mps_message_gc_not_condemned_size(mps_arena_t,
                                                 mps_message_t);
 
+/* .census.types: Must match CensusTYPES in <code/config.h>. */
+#define MPS_CENSUS_TYPES 64
+
+extern void mps_message_gc_census(size_t *, size_t *, mps_arena_t,
+                                  mps_message_t, size_t);
+
 /* -- mps_message_type_gc_start */
 extern const char *mps_message_gc_start_why(mps_arena_t, mps_message_t);
 
@@ -833,6 +927,41 @@ extern mps_res_t _mps_fix2(mps_ss_t, mps_addr_t *);
   MPS_END
 
 
+/* Software Read Barrier */
+
+extern mps_rb_t mps_arena_rb(mps_arena_t);
+extern mps_addr_t mps_weak_ref_get(mps_rb_t, mps_addr_t *);
+
+/* .rb.order: The epoch and white set must be read before the slot,
+ * and the epoch again after it, even on processors that reorder
+ * loads, so the loads before the last are acquire loads. The MPS
+ * stores the white set with a release store. With MSVC, volatile
+ * loads are acquire loads on x86 and x64 (/volatile:ms). See
+ * <design/poolawl#.soft.order>. */
+
+#if defined(__ATOMIC_ACQUIRE) /* GCC 4.7 or later, or Clang */
+#define _MPS_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#else
+#define _MPS_LOAD_ACQUIRE(p) (*(p))
+#endif
+
+#define MPS_WEAK_REF_GET(ref_o, rb, slot) \
+  MPS_BEGIN \
+    mps_rb_t _mps_rb = (rb); \
+    mps_word_t _mps_epoch = \
+      _MPS_LOAD_ACQUIRE((volatile mps_word_t *)&_mps_rb->_epoch); \
+    mps_word_t _mps_w = \
+      _MPS_LOAD_ACQUIRE((volatile mps_word_t *)&_mps_rb->_w); \
+    mps_addr_t _mps_ref = \
+      _MPS_LOAD_ACQUIRE((mps_addr_t volatile *)(void *)(slot)); \
+    if ((_mps_w >> ((mps_word_t)_mps_ref >> _mps_rb->_zs \
+                    & (sizeof(mps_word_t) * CHAR_BIT - 1)) & 1) != 0 \
+        || *(volatile mps_word_t *)&_mps_rb->_epoch != _mps_epoch) \
+      _mps_ref = mps_weak_ref_get(_mps_rb, (slot)); \
+    *(ref_o) = _mps_ref; \
+  MPS_END
+
+
 #endif /* mps_h */
 
 
@@ -9,6 +9,13 @@
 
 #include "mps.h"
 
+extern const struct mps_key_s _mps_key_AMC_DEPTH_FIRST;
+#define MPS_KEY_AMC_DEPTH_FIRST (&_mps_key_AMC_DEPTH_FIRST)
+#define MPS_KEY_AMC_DEPTH_FIRST_FIELD b
+extern const struct mps_key_s _mps_key_AMC_DENSE;
+#define MPS_KEY_AMC_DENSE (&_mps_key_AMC_DENSE)
+#define MPS_KEY_AMC_DENSE_FIELD d
+
 extern mps_pool_class_t mps_class_amc(void);
 extern mps_pool_class_t mps_class_amcz(void);
 
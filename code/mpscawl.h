@@ -12,6 +12,9 @@
 extern const struct mps_key_s _mps_key_AWL_FIND_DEPENDENT;
 #define MPS_KEY_AWL_FIND_DEPENDENT (&_mps_key_AWL_FIND_DEPENDENT)
 #define MPS_KEY_AWL_FIND_DEPENDENT_FIELD addr_method
+extern const struct mps_key_s _mps_key_AWL_SOFTWARE_BARRIER;
+#define MPS_KEY_AWL_SOFTWARE_BARRIER (&_mps_key_AWL_SOFTWARE_BARRIER)
+#define MPS_KEY_AWL_SOFTWARE_BARRIER_FIELD b
 
 extern mps_pool_class_t mps_class_awl(void);
 
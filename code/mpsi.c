@@ -46,6 +46,7 @@
 
 #include "mpm.h"
 #include "mps.h"
+#include "mag.h"
 #include "sac.h"
 
 #include <stdarg.h>
@@ -101,6 +102,11 @@ static Bool mpsi_check(void)
   /* out to external. */
   CHECKL(COMPATTYPE(mps_clock_t, Clock));
 
+  /* Histograms are copied out bucket by bucket, but the external */
+  /* and internal number of buckets had better match. */
+  /* See <code/mps.h#histogram.buckets>. */
+  CHECKL(HistogramBUCKETS == MPS_HISTOGRAM_BUCKETS);
+
   return TRUE;
 }
 
@@ -164,6 +170,59 @@ size_t mps_arena_committed(mps_arena_t arena)
   return (size_t)size;
 }
 
+/* mps_arena_stats -- copy the arena's pause statistics
+ *
+ * The client sets stats->size to the size of its structure, so that
+ * fields can be added to the end of mps_arena_stats_s without
+ * breaking binary compatibility.  The statistics are read under the
+ * arena lock, but the arena is not parked.
+ */
+
+static void histogramCopy(mps_histogram_s *to, Histogram from)
+{
+  Index i;
+
+  to->count = from->count;
+  to->total = from->total;
+  to->max = from->max;
+  for (i = 0; i < HistogramBUCKETS; ++i)
+    to->bucket[i] = from->bucket[i];
+}
+
+void mps_arena_stats(mps_arena_stats_s *stats, mps_arena_t arena)
+{
+  mps_arena_stats_s copy;
+  size_t size;
+
+  AVER(stats != NULL);
+  size = stats->size;
+  AVER(size >= sizeof stats->size);
+
+  ArenaEnter(arena);
+  histogramCopy(&copy.increment, &arena->pollHistogram);
+  histogramCopy(&copy.flip, &arena->flipHistogram);
+  histogramCopy(&copy.reclaim, &arena->reclaimHistogram);
+  histogramCopy(&copy.suspend, &arena->suspendHistogram);
+  copy.access = arena->accessCount;
+  copy.fill = arena->fillCount;
+  copy.fix = arena->fixRefCount;
+  copy.fix_white = arena->whiteSegRefCount;
+  copy.zones_free = arena->freeZones;
+  copy.gen_skip = arena->genSkipCount;
+  ArenaLeave(arena);
+
+  if (size > sizeof copy)
+    size = sizeof copy;
+  copy.size = size;
+  (void)mps_lib_memcpy(stats, &copy, size);
+}
+
+mps_clock_t mps_histogram_bucket_base(size_t index)
+{
+  AVER(index < HistogramBUCKETS);
+  return HistogramBucketBase(index);
+}
+
 size_t mps_arena_spare_committed(mps_arena_t arena)
 {
   Size size;
@@ -257,6 +316,15 @@ void mps_arena_pause_time_set(mps_arena_t arena, double pause_time)
 }
 
 
+void mps_arena_alloc_sample_set(mps_arena_t arena, size_t interval,
+                                mps_alloc_sample_t fun, void *closure)
+{
+  ArenaEnter(arena);
+  ArenaSetAllocSample(arena, (Size)interval, fun, closure);
+  ArenaLeave(arena);
+}
+
+
 void mps_arena_clamp(mps_arena_t arena)
 {
   ArenaEnter(arena);
@@ -401,11 +469,25 @@ mps_bool_t mps_arena_busy(mps_arena_t arena)
 }
 
 
-/* mps_arena_has_addr -- is this address managed by this arena? */
+/* mps_arena_has_addr -- is this address managed by this arena?
+ *
+ * .addr.lockfree: This and mps_addr_pool are called by clients on hot
+ * paths in many threads, so they first try to look up the address
+ * without claiming the arena lock, and only claim it if the chunk
+ * tree or page tables are being changed, or the mutator is suspended.
+ * See <code/arena.c#.lookup>.
+ * The result is consistent with the state of the arena at some moment
+ * during the call, but not necessarily with allocation or freeing in
+ * other threads that overlaps the call.
+ */
 
 mps_bool_t mps_arena_has_addr(mps_arena_t arena, mps_addr_t p)
 {
     Bool b;
+    Pool pool;
+
+    if (ArenaLookupPool(&pool, arena, (Addr)p))
+      return pool != NULL;
 
     /* One of the few functions that can be called
        during the call to an MPS function.  IE this function
@@ -421,6 +503,7 @@ mps_bool_t mps_arena_has_addr(mps_arena_t arena, mps_addr_t p)
 /* mps_addr_pool -- return the pool containing the given address
  *
  * Wrapper for PoolOfAddr.  Note: may return an MPS-internal pool.
+ * See .addr.lockfree.
  */
 
 mps_bool_t mps_addr_pool(mps_pool_t *mps_pool_o,
@@ -434,6 +517,13 @@ mps_bool_t mps_addr_pool(mps_pool_t *mps_pool_o,
     /* mps_arena -- will be checked by ArenaEnterRecursive */
     /* p -- cannot be checked */
 
+    if (ArenaLookupPool(&pool, arena, (Addr)p)) {
+      if (pool == NULL)
+        return FALSE;
+      *mps_pool_o = (mps_pool_t)pool;
+      return TRUE;
+    }
+
     /* One of the few functions that can be called
        during the call to an MPS function.  IE this function
        can be called when walking the heap. */
@@ -765,6 +855,37 @@ size_t mps_pool_free_size(mps_pool_t pool)
   return (size_t)size;
 }
 
+mps_res_t mps_pool_freeze(mps_pool_t pool)
+{
+  Arena arena;
+  Res res;
+
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  res = PoolFreeze(pool);
+
+  ArenaLeave(arena);
+
+  return (mps_res_t)res;
+}
+
+void mps_pool_thaw(mps_pool_t pool)
+{
+  Arena arena;
+
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  PoolThaw(pool);
+
+  ArenaLeave(arena);
+}
+
 
 mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
 {
@@ -775,6 +896,12 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* See <code/mag.c#purpose>. */
+  if (pool->cache != NULL && MagCacheAlloc(&p, pool->cache, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
   STACK_CONTEXT_BEGIN(arena) {
 
@@ -787,6 +914,9 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
     /* <design/pool#.method.alloc.size.align>. */
 
     res = PoolAlloc(&p, pool, size);
+    if (ResIsAllocFailure(res) && pool->cache != NULL
+        && MagCacheFlush(pool->cache)) /* <code/mag.c#flush> */
+      res = PoolAlloc(&p, pool, size);
 
   } STACK_CONTEXT_END(arena);
   ArenaLeave(arena);
@@ -805,6 +935,10 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* See <code/mag.c#purpose>. */
+  if (pool->cache != NULL && MagCacheFree(pool->cache, (Addr)p, size))
+    return;
+
   ArenaEnter(arena);
 
   AVERT_CRITICAL(Pool, pool);
@@ -813,6 +947,8 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   /* <design/pool#.method.free.size.align>. */
 
   PoolFree(pool, (Addr)p, size);
+  if (pool->cache != NULL)
+    MagCacheFill(pool->cache); /* <code/mag.c#miss> */
   ArenaLeave(arena);
 }
 
@@ -1054,6 +1190,8 @@ mps_res_t mps_ap_fill(mps_addr_t *p_o, mps_ap_t mps_ap, size_t size)
   Arena arena;
   Addr p;
   Res res;
+  mps_alloc_sample_t sampleFun;
+  void *sampleClosure;
 
   AVER(mps_ap != NULL);
   AVER(TESTT(Buffer, buf));
@@ -1072,10 +1210,23 @@ mps_res_t mps_ap_fill(mps_addr_t *p_o, mps_ap_t mps_ap, size_t size)
     res = BufferFill(&p, buf, size);
 
   } STACK_CONTEXT_END(arena);
+
+  /* .fill.sample: If the fill took a sample, the client's sample
+     function is called after leaving the arena, so that it may use
+     the MPS (but not this allocation point). */
+  sampleFun = NULL;
+  sampleClosure = NULL;
+  if (res == ResOK && buf->sampled) {
+    buf->sampled = FALSE;
+    sampleFun = arena->sampleFun;
+    sampleClosure = arena->sampleClosure;
+  }
   ArenaLeave(arena);
 
   if (res != ResOK)
     return (mps_res_t)res;
+  if (sampleFun != NULL)
+    (*sampleFun)(mps_ap, (mps_addr_t)p, size, sampleClosure);
   *p_o = (mps_addr_t)p;
   return MPS_RES_OK;
 }
@@ -1115,6 +1266,17 @@ mps_bool_t mps_ap_trip(mps_ap_t mps_ap, mps_addr_t p, size_t size)
 
 mps_res_t mps_sac_create(mps_sac_t *mps_sac_o, mps_pool_t pool,
                          size_t classes_count, mps_sac_classes_s *classes)
+{
+  return mps_sac_create_k(mps_sac_o, pool, classes_count, classes,
+                          mps_args_none);
+}
+
+
+/* mps_sac_create_k -- create an SAC object with keyword arguments */
+
+mps_res_t mps_sac_create_k(mps_sac_t *mps_sac_o, mps_pool_t pool,
+                           size_t classes_count, mps_sac_classes_s *classes,
+                           mps_arg_s args[])
 {
   Arena arena;
   SAC sac;
@@ -1126,7 +1288,8 @@ mps_res_t mps_sac_create(mps_sac_t *mps_sac_o, mps_pool_t pool,
 
   ArenaEnter(arena);
 
-  res = SACCreate(&sac, pool, (Count)classes_count, classes);
+  AVERT(ArgList, args);
+  res = SACCreate(&sac, pool, (Count)classes_count, classes, args);
 
   ArenaLeave(arena);
 
@@ -1562,6 +1725,23 @@ mps_res_t mps_stack_scan_ambig(mps_ss_t mps_ss,
 }
 
 
+/* mps_root_thread_watermark_set -- publish a thread's stack watermark */
+
+void mps_root_thread_watermark_set(mps_root_t mps_root, void *watermark)
+{
+  Root root = (Root)mps_root;
+  Arena arena;
+
+  arena = RootArena(root);
+
+  ArenaEnter(arena);
+
+  RootSetWatermark(root, watermark);
+
+  ArenaLeave(arena);
+}
+
+
 void mps_root_destroy(mps_root_t mps_root)
 {
   Root root = (Root)mps_root;
@@ -1669,6 +1849,37 @@ mps_word_t mps_collections(mps_arena_t arena)
 }
 
 
+/* mps_arena_rb -- return the software read barrier of an arena */
+
+mps_rb_t mps_arena_rb(mps_arena_t arena)
+{
+  return &arena->rb_s; /* thread safe: the address doesn't change */
+}
+
+
+/* mps_weak_ref_get -- read a reference through the software barrier
+ *
+ * This is the slow path of MPS_WEAK_REF_GET. See
+ * <design/poolawl#.soft>.
+ */
+
+mps_addr_t mps_weak_ref_get(mps_rb_t rb, mps_addr_t *slot)
+{
+  Arena arena;
+  Ref ref;
+
+  AVER(rb != NULL);
+  arena = rb->_arena;
+  ArenaEnter(arena);
+
+  AVER(slot != NULL);
+  ref = ArenaPeek(arena, (Ref *)slot);
+
+  ArenaLeave(arena);
+  return (mps_addr_t)ref;
+}
+
+
 /* mps_finalize -- register for finalization */
 
 mps_res_t mps_finalize(mps_arena_t arena, mps_addr_t *refref)
@@ -1788,6 +1999,16 @@ void mps_message_discard(mps_arena_t arena,
   ArenaLeave(arena);
 }
 
+void mps_message_notify_set(mps_arena_t arena,
+                            mps_message_notify_t notify, void *p)
+{
+  ArenaEnter(arena);
+
+  MessageNotifySet(arena, notify, p);
+
+  ArenaLeave(arena);
+}
+
 
 /* Message Methods */
 
@@ -1841,6 +2062,22 @@ void mps_message_finalization_ref(mps_addr_t *mps_addr_return,
   ArenaLeave(arena);
 }
 
+size_t mps_message_finalization_drain(mps_addr_t *refs_o, size_t count,
+                                      mps_arena_t arena)
+{
+  Count n;
+
+  AVER(refs_o != NULL);
+
+  ArenaEnter(arena);
+
+  AVERT(Arena, arena);
+  n = MessageFinalizationDrain((Ref *)refs_o, count, arena);
+
+  ArenaLeave(arena);
+  return (size_t)n;
+}
+
 /* -- mps_message_type_gc */
 
 size_t mps_message_gc_live_size(mps_arena_t arena,
@@ -1885,6 +2122,27 @@ size_t mps_message_gc_not_condemned_size(mps_arena_t arena,
   return (size_t)size;
 }
 
+void mps_message_gc_census(size_t *count_o, size_t *size_o,
+                           mps_arena_t arena, mps_message_t message,
+                           size_t type)
+{
+  Count count;
+  Size size;
+
+  ArenaEnter(arena);
+
+  AVER(count_o != NULL);
+  AVER(size_o != NULL);
+  AVERT(Arena, arena);
+  AVER(type < CensusTYPES);
+  MessageGCCensus(&count, &size, message, (Index)type);
+
+  ArenaLeave(arena);
+
+  *count_o = (size_t)count;
+  *size_o = (size_t)size;
+}
+
 /* -- mps_message_type_gc_start */
 
 const char *mps_message_gc_start_why(mps_arena_t arena,
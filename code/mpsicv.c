@@ -23,6 +23,11 @@
 #define ambigRootsCOUNT  49
 #define OBJECTS          100000
 #define patternFREQ      100
+#define watermarkDEPTH   100
+#define watermarkREFS    8
+#define watermarkOBJECTS 20000
+#define promoteOBJECTS   4096
+#define promotePINS      16
 
 /* objNULL needs to be odd so that it's ignored in exactRoots. */
 #define objNULL         ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
@@ -286,6 +291,163 @@ static mps_res_t root_single(mps_ss_t ss, void *p, size_t s)
 }
 
 
+/* watermark_promote, watermark_collect, watermark_level -- test
+ * stack watermarks
+ *
+ * watermark_level recurses to build a deep stack whose frames hold
+ * the only (ambiguous) references to some objects. These are taken
+ * from exactRoots after watermark_promote has promoted them out of the
+ * nursery, so that collections of the nursery may skip the cold stack
+ * (unless stale words in it still refer to the nursery). At the
+ * bottom, the stack colder than the deepest frame's references is
+ * published as unchanged while enough objects are allocated to provoke
+ * collections. The objects must survive intact.
+ */
+
+static void watermark_promote(mps_arena_t arena)
+{
+  size_t i;
+
+  for (i = 0; i < exactRootsCOUNT; ++i)
+    exactRoots[i] = make();
+  die(mps_arena_collect(arena), "collect");
+  mps_arena_release(arena);
+}
+
+static void watermark_collect(mps_arena_t arena, mps_root_t root,
+                              void *watermark)
+{
+  mps_word_t collections = mps_collections(arena);
+  size_t i;
+
+  mps_root_thread_watermark_set(root, watermark);
+  for (i = 0; i < watermarkOBJECTS; ++i)
+    (void)make();
+  die(mps_arena_collect(arena), "collect");
+  mps_arena_release(arena);
+  for (i = 0; i < watermarkOBJECTS; ++i)
+    (void)make();
+  mps_root_thread_watermark_set(root, NULL);
+  cdie(mps_collections(arena) > collections, "watermark collections");
+}
+
+static size_t watermark_level(mps_arena_t arena, mps_root_t root,
+                              size_t depth)
+{
+  mps_addr_t objs[watermarkREFS];
+  size_t i, checked;
+
+  for (i = 0; i < watermarkREFS; ++i)
+    objs[i] = exactRoots[(depth * watermarkREFS + i) % exactRootsCOUNT];
+  if (depth == 0) {
+    for (i = 0; i < exactRootsCOUNT; ++i)
+      exactRoots[i] = objNULL;
+    watermark_collect(arena, root, &objs[0]);
+    checked = 0;
+  } else {
+    checked = watermark_level(arena, root, depth - 1);
+  }
+  for (i = 0; i < watermarkREFS; ++i) {
+    cdie(dylan_check(objs[i]), "watermark check");
+    ++checked;
+  }
+  return checked;
+}
+
+
+/* watermark_promote_test -- test a segment pinned by the cold stack
+ *
+ * Objects are copied into an old generation whose low mortality makes
+ * its segments dense (see <code/poolamc.c#.dense>), and then the cold
+ * stack holds the only references to some objects in the first
+ * segment. The next collection pins the segment there and promotes it
+ * to the oldest generation, leaving the old generation empty, and the
+ * one after condemns only the oldest generation. The cold stack must
+ * not be skipped then, so the objects must survive.
+ */
+
+static mps_addr_t promoteRoots[promoteOBJECTS];
+
+#define promoteGENS 3
+static mps_gen_param_s promoteChain[promoteGENS] = {
+  { 1024, 0.5 }, { 1024, 0.0 }, { 1024, 0.0 } };
+
+static void watermark_promote_pin(mps_arena_t arena, mps_root_t root,
+                                  mps_pool_t pool)
+{
+  mps_addr_t pins[promotePINS];
+  size_t i, j;
+
+  for (i = 0; i < promotePINS; ++i)
+    pins[i] = promoteRoots[i];
+  for (i = 0; i < promoteOBJECTS; ++i)
+    promoteRoots[i] = objNULL;
+  mps_root_thread_watermark_set(root, &pins[0]);
+  for (j = 0; j < 2; ++j) {
+    die(mps_arena_collect(arena), "collect");
+    for (i = 0; i < promotePINS; ++i) {
+      mps_pool_t p;
+      cdie(mps_addr_pool(&p, arena, pins[i]) && p == pool,
+           "watermark promote pool");
+      cdie(dylan_check(pins[i]), "watermark promote check");
+    }
+  }
+  mps_root_thread_watermark_set(root, NULL);
+}
+
+static void watermark_promote_test(void *marker)
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+  mps_root_t root, tableRoot;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_ap_t promoteAp;
+  size_t i;
+
+  die(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none),
+      "arena_create");
+  mps_arena_park(arena);
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+  die(mps_root_create_thread(&root, arena, thread, marker),
+      "root_create_thread");
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, promoteGENS, promoteChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&promoteAp, pool, mps_args_none), "ap_create");
+  die(mps_root_create_table(&tableRoot, arena, mps_rank_exact(),
+                            (mps_rm_t)0, promoteRoots, promoteOBJECTS),
+      "root_create_table");
+
+  for (i = 0; i < promoteOBJECTS; ++i) {
+    mps_word_t v;
+    die(make_dylan_vector(&v, promoteAp, 4), "make_dylan_vector");
+    promoteRoots[i] = (mps_addr_t)v;
+  }
+  /* Copy the objects into the old generation. */
+  die(mps_arena_collect(arena), "collect");
+
+  watermark_promote_pin(arena, root, pool);
+
+  mps_arena_park(arena);
+  mps_root_destroy(tableRoot);
+  mps_ap_destroy(promoteAp);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_root_destroy(root);
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+}
+
+
 /* arena_commit_test
  *
  * intended to test:
@@ -350,7 +512,7 @@ static void arena_commit_test(mps_arena_t arena)
 }
 
 
-static void test(mps_arena_t arena)
+static void test(mps_arena_t arena, mps_root_t reg_root)
 {
   mps_fmt_t format;
   mps_chain_t chain;
@@ -527,6 +689,10 @@ static void test(mps_arena_t arena)
     }
   }
 
+  watermark_promote(arena);
+  cdie(watermark_level(arena, reg_root, watermarkDEPTH)
+       == (watermarkDEPTH + 1) * watermarkREFS, "watermark_level");
+
   arena_commit_test(arena);
   alignmentTest(arena);
 
@@ -593,7 +759,8 @@ int main(int argc, char *argv[])
     break;
   }
 
-  test(arena);
+  test(arena, reg_root);
+  watermark_promote_test(marker);
   switch (rnd() % 2) {
   default:
   case 0:
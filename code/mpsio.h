@@ -22,6 +22,24 @@ extern mps_res_t mps_io_write(mps_io_t, void *, size_t);
 extern mps_res_t mps_io_flush(mps_io_t);
 
 
+/* Telemetry ring file
+ *
+ * Layout of the header of the memory-mapped ring file written by the
+ * POSIX ring I/O implementation.  See <code/mpsioix.c#layout>.
+ */
+
+#define MPS_IO_RING_MAGIC "MPSRING"     /* including the terminating NUL */
+#define MPS_IO_RING_VERSION 1
+
+typedef struct mps_io_ring_s {
+  char magic[8];                        /* MPS_IO_RING_MAGIC */
+  mps_word_t version;                   /* MPS_IO_RING_VERSION */
+  mps_word_t size;                      /* size of data area in bytes */
+  volatile mps_word_t head;             /* stream offset of next record */
+  volatile mps_word_t tail;             /* stream offset of oldest record */
+} mps_io_ring_s;
+
+
 #endif /* mpsio_h */
 
 
@@ -0,0 +1,246 @@
+/* mpsioix.c: RAVENBROOK MEMORY POOL SYSTEM I/O IMPLEMENTATION (POSIX RING)
+ *
+ * $Id$
+ * Copyright (c) 2001-2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .readership: For MPS client application developers and MPS developers.
+ * .sources: <design/io>
+ *
+ * .purpose: This is an implementation of the I/O interface (mpsio.h)
+ * that writes the telemetry stream into a fixed-size memory-mapped
+ * ring file rather than appending it to a file with the C library.
+ * Writing an event buffer is then a memcpy into shared memory, with
+ * no system calls, so telemetry can be left switched on in
+ * production.  An external tool can read the file while the program
+ * is running (see mpseventcnv -r).
+ *
+ * .use: mps.c includes this file instead of mpsioan.c when compiled
+ * with CONFIG_IO_RING.  See <code/config.h#io.ring>.
+ *
+ * .layout: The file starts with an mps_io_ring_s header (see
+ * mpsio.h) followed by ring->size bytes of data.  The ring->head and
+ * ring->tail fields are byte offsets into the stream of everything
+ * ever written, so that the offset into the data area is the stream
+ * offset modulo ring->size.  Each call to mps_io_write appends one
+ * record: a word giving the length of the payload, followed by the
+ * payload padded to a word boundary.  Records never wrap around the
+ * end of the data area; if a record doesn't fit in the space at the
+ * end, that space is filled by a padding record of length zero.
+ *
+ * .overwrite: When there is no room for a new record, the oldest
+ * records are discarded by advancing ring->tail past them before
+ * their space is overwritten.  ring->head is advanced only after the
+ * new record has been written.  So a reader that copies out the
+ * records between tail and head, and then reads tail again, knows
+ * that any record older than the new tail may have been overwritten
+ * while it was copying, and must be discarded.
+ *
+ * .overwrite.order: The reader may be running on another processor,
+ * so the stores must become visible in this order too: each new
+ * value of ring->tail before the data that overwrites the discarded
+ * records (ATOMIC_FENCE_RELEASE), and each record before the new
+ * value of ring->head (ATOMIC_STORE_RELEASE).  The reader reads the
+ * header, the data, and the header again with separate reads from
+ * the file, so its loads are not reordered across them.  The magic
+ * number is stored last when the ring is created, so that a reader
+ * that finds it also finds a consistent header.
+ *
+ * .env: The file name is taken from the environment variable
+ * MPS_TELEMETRY_FILENAME (default "mpsio.log"), as in mpsioan.c.  The
+ * size of the file in bytes is taken from MPS_TELEMETRY_RING_SIZE
+ * (default IO_RING_SIZE_DEFAULT).
+ */
+
+#include "mpsio.h"
+#include "mpstd.h"
+
+/* See <code/mpsioan.c> for why we use AVER rather than assert. */
+#include "check.h"
+#include "config.h"  /* to get platform configurations */
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "mpsioix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#if !defined(ATOMIC_STORE_RELEASE) || !defined(ATOMIC_FENCE_RELEASE)
+#error "mpsioix.c needs ATOMIC_STORE_RELEASE and ATOMIC_FENCE_RELEASE"
+#endif
+
+#include <fcntl.h> /* open, O_CREAT, O_RDWR, O_TRUNC */
+#include <stdlib.h> /* getenv, strtoul */
+#include <string.h> /* memcpy */
+#include <sys/mman.h> /* mmap, munmap */
+#include <unistd.h> /* close, ftruncate */
+
+
+#define IO_RING_SIZE_DEFAULT ((size_t)16 << 20)
+#define IO_RING_SIZE_MIN     ((size_t)64 << 10)
+
+#define ringALIGN           sizeof(mps_word_t)
+#define ringAlignUp(n)      (((n) + ringALIGN - 1) & ~(mps_word_t)(ringALIGN - 1))
+#define ringData(ring)      ((char *)(ring) + sizeof(mps_io_ring_s))
+#define ringRecord(ring, p) ((mps_word_t *)(ringData(ring) + (p) % (ring)->size))
+
+static mps_io_ring_s *ioRing = NULL;
+static size_t ioRingMapSize;
+
+
+mps_res_t mps_io_create(mps_io_t *mps_io_r)
+{
+  const char *filename, *sizeString;
+  size_t size = IO_RING_SIZE_DEFAULT;
+  mps_io_ring_s *ring;
+  void *p;
+  int fd;
+
+  if (ioRing != NULL) /* See <code/event.c#trans.log> */
+    return MPS_RES_LIMIT; /* Cannot currently open more than one log */
+
+  filename = getenv("MPS_TELEMETRY_FILENAME");
+  if (filename == NULL)
+    filename = "mpsio.log";
+
+  sizeString = getenv("MPS_TELEMETRY_RING_SIZE");
+  if (sizeString != NULL)
+    size = (size_t)strtoul(sizeString, NULL, 0);
+  if (size < IO_RING_SIZE_MIN)
+    size = IO_RING_SIZE_MIN;
+
+  fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+    return MPS_RES_IO;
+  if (ftruncate(fd, (off_t)size) == -1) {
+    (void)close(fd);
+    return MPS_RES_IO;
+  }
+  p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  (void)close(fd);
+  if (p == MAP_FAILED)
+    return MPS_RES_IO;
+
+  ring = p;
+  ring->version = MPS_IO_RING_VERSION;
+  ring->size = (size - sizeof(mps_io_ring_s)) & ~(mps_word_t)(ringALIGN - 1);
+  ring->head = 0;
+  ring->tail = 0;
+  ATOMIC_FENCE_RELEASE(); /* .overwrite.order */
+  memcpy(ring->magic, MPS_IO_RING_MAGIC, sizeof ring->magic);
+
+  ioRing = ring;
+  ioRingMapSize = size;
+  *mps_io_r = (mps_io_t)ring;
+  return MPS_RES_OK;
+}
+
+
+void mps_io_destroy(mps_io_t mps_io)
+{
+  mps_io_ring_s *ring = (mps_io_ring_s *)mps_io;
+  AVER(ring == ioRing);
+  AVER(ring != NULL);
+
+  ioRing = NULL;
+  (void)munmap((void *)ring, ioRingMapSize);
+}
+
+
+/* ringDiscard -- discard old records until there's room for size bytes
+ *
+ * See .overwrite.
+ */
+
+static void ringDiscard(mps_io_ring_s *ring, mps_word_t size)
+{
+  mps_word_t tail = ring->tail;
+  AVER(size <= ring->size);
+  if (ring->head + size - tail <= ring->size)
+    return;
+  do {
+    mps_word_t length = *ringRecord(ring, tail);
+    if (length == 0) /* padding to the end of the data area */
+      tail += ring->size - tail % ring->size;
+    else
+      tail += ringAlignUp(sizeof(mps_word_t) + length);
+  } while (ring->head + size - tail > ring->size);
+  ring->tail = tail;
+  ATOMIC_FENCE_RELEASE(); /* .overwrite.order */
+}
+
+
+mps_res_t mps_io_write(mps_io_t mps_io, void *buf, size_t size)
+{
+  mps_io_ring_s *ring = (mps_io_ring_s *)mps_io;
+  mps_word_t recordSize, space;
+  mps_word_t *record;
+  AVER(ring == ioRing);
+  AVER(ring != NULL);
+
+  if (size == 0)
+    return MPS_RES_OK;
+  recordSize = ringAlignUp(sizeof(mps_word_t) + size);
+  if (recordSize > ring->size)
+    return MPS_RES_LIMIT;
+
+  /* Pad out the end of the data area if the record won't fit there. */
+  space = ring->size - ring->head % ring->size;
+  if (space < recordSize) {
+    ringDiscard(ring, space);
+    *ringRecord(ring, ring->head) = 0;
+    ATOMIC_STORE_RELEASE(&ring->head, ring->head + space);
+  }
+
+  ringDiscard(ring, recordSize);
+  record = ringRecord(ring, ring->head);
+  record[0] = (mps_word_t)size;
+  memcpy(&record[1], buf, size);
+  ATOMIC_STORE_RELEASE(&ring->head, ring->head + recordSize);
+
+  return MPS_RES_OK;
+}
+
+
+/* mps_io_flush -- flush the ring
+ *
+ * The file is mapped shared, so records are visible to readers as
+ * soon as they are written, and the kernel writes the pages back in
+ * its own time.  There is nothing to do here.
+ */
+
+mps_res_t mps_io_flush(mps_io_t mps_io)
+{
+  mps_io_ring_s *ring = (mps_io_ring_s *)mps_io;
+  AVER(ring == ioRing);
+  AVER(ring != NULL);
+
+  return MPS_RES_OK;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
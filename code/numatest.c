@@ -0,0 +1,217 @@
+/* numatest.c: NUMA-PREFERRING ALLOCATION POINT TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Allocates objects on allocation points created with
+ * MPS_KEY_AP_NUMA in automatically managed pools, while the pools are
+ * collected, and checks that most of the objects are on the node of
+ * the thread that created the allocation point.
+ *
+ * .platform: Only Linux will tell us the node of the calling thread
+ * and of a page. Elsewhere the test just checks that the allocation
+ * points work.
+ */
+
+#include "mpm.h" /* first, for syscall; see .feature.li in config.h */
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpscams.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+#if defined(MPS_OS_LI)
+#include <linux/mempolicy.h> /* MPOL_F_NODE, MPOL_F_ADDR */
+#include <sys/syscall.h> /* SYS_get_mempolicy, SYS_getcpu */
+#include <unistd.h> /* syscall */
+#endif
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define rootsCOUNT        1000
+#define objectsCOUNT      100000
+#define sampleFREQ        16
+#define avLEN             3
+#define genCOUNT          2
+
+/* objNULL needs to be odd so that it's ignored in roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 100, 0.85 }, { 170, 0.45 } };
+
+static mps_addr_t roots[rootsCOUNT];
+static unsigned long numaSampled, numaLocal;
+
+
+/* numa_node -- node of the calling thread, or -1 if unknown */
+
+static int numa_node(void)
+{
+#if defined(MPS_OS_LI)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    return (int)node;
+#endif
+  return -1;
+}
+
+
+/* check_numa -- sample an object allocated by a MPS_KEY_AP_NUMA ap
+ *
+ * The object should usually be on the node where the ap was created,
+ * but binding is only a preference, and pages that were resident
+ * before their segment was allocated aren't moved, so this only
+ * counts the objects that are.
+ */
+
+static void check_numa(mps_addr_t obj, int node)
+{
+#if defined(MPS_OS_LI)
+  int objNode;
+  if (node >= 0
+      && syscall(SYS_get_mempolicy, &objNode, NULL, 0ul, obj,
+                 (unsigned long)(MPOL_F_NODE | MPOL_F_ADDR)) == 0) {
+    ++ numaSampled;
+    if (objNode == node)
+      ++ numaLocal;
+  }
+#else
+  testlib_unused(obj);
+  testlib_unused(node);
+#endif
+}
+
+
+/* make -- create one new object */
+
+static mps_addr_t make(mps_ap_t ap, size_t refsCount)
+{
+  size_t length = rnd() % (avLEN * 2);
+  mps_addr_t p;
+  die(dylan_alloc(&p, ap, (length + 2) * sizeof(mps_word_t),
+                  roots, refsCount),
+      "dylan_alloc");
+  return p;
+}
+
+
+/* test -- allocate on a NUMA ap, replacing random roots */
+
+static void test(mps_arena_t arena, mps_pool_class_t pool_class,
+                 size_t refsCount)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  mps_ap_t ap;
+  size_t i;
+  int node;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
+  } MPS_ARGS_END(args);
+
+  for (i = 0; i < rootsCOUNT; ++i)
+    roots[i] = objNULL;
+  die(mps_root_create_table_masked(&root, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, roots, rootsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table");
+
+  node = numa_node();
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_RANK, mps_rank_exact());
+    MPS_ARGS_ADD(args, MPS_KEY_AP_NUMA, TRUE);
+    die(mps_ap_create_k(&ap, pool, args), "ap_create");
+  } MPS_ARGS_END(args);
+
+  for (i = 0; i < objectsCOUNT; ++i) {
+    size_t r = (size_t)rnd() % rootsCOUNT;
+    if (roots[r] != objNULL)
+      cdie(dylan_check(roots[r]), "root check");
+    roots[r] = make(ap, refsCount);
+    if (i % sampleFREQ == 0)
+      check_numa(roots[r], node);
+  }
+
+  mps_arena_park(arena);
+  for (i = 0; i < rootsCOUNT; ++i)
+    cdie(roots[i] == objNULL || dylan_check(roots[i]), "final check");
+  mps_ap_destroy(ap);
+  mps_root_destroy(root);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+      "arena_create");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  numaSampled = numaLocal = 0;
+  test(arena, mps_class_amc(), rootsCOUNT);
+  test(arena, mps_class_amcz(), 0);
+  test(arena, mps_class_ams(), rootsCOUNT);
+
+  /* Most objects should be local, but allow for the thread moving
+     between nodes and for memory already resident. */
+  printf("%lu of %lu NUMA objects on the allocating node\n",
+         numaLocal, numaSampled);
+  Insist(numaLocal * 4 >= numaSampled);
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -64,9 +64,11 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
 
   /* Plan B: add free zones that aren't blacklisted */
   /* TODO: Pools without ambiguous roots might not care about the blacklist. */
-  /* TODO: zones are precious and (currently) never deallocated, so we
-   * should consider extending the arena first if address space is plentiful.
-   * See also job003384. */
+  /* .zone.recycle: Zones are precious, but they are not lost forever:
+   * the arena counts the memory allocated in each zone, and a zone
+   * returns to arena->freeZones when the last of its memory is freed
+   * (see ArenaFree). Likewise a generation forgets a zone when the last
+   * of its segments in that zone is freed (see PoolGenFree). */
   moreZones = ZoneSetUnion(pref->zones, ZoneSetDiff(arena->freeZones, pref->avoid));
   if (moreZones != zones) {
     res = ArenaFreeLandAlloc(&tract, arena, moreZones, pref->high, size, pool);
@@ -29,6 +29,7 @@
  */
 
 #include "mpm.h"
+#include "mag.h"
 
 SRCID(pool, "$Id$");
 
@@ -95,6 +96,8 @@ Bool PoolCheck(Pool pool)
   CHECKL(pool->alignment == PoolGrainsSize(pool, (Align)1));
   if (pool->format != NULL)
     CHECKD(Format, pool->format);
+  if (pool->cache != NULL)
+    CHECKL(MagCacheCheck(pool->cache));
   return TRUE;
 }
 
@@ -113,6 +116,7 @@ ARG_DEFINE_KEY(MAX_SIZE, Size);
 ARG_DEFINE_KEY(ALIGN, Align);
 ARG_DEFINE_KEY(SPARE, double);
 ARG_DEFINE_KEY(INTERIOR, Bool);
+ARG_DEFINE_KEY(POOL_CACHE, Bool);
 
 
 /* PoolInit -- initialize a pool
@@ -124,6 +128,7 @@ ARG_DEFINE_KEY(INTERIOR, Bool);
 Res PoolInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 {
   Res res;
+  ArgStruct arg;
 
   AVERT(PoolClass, klass);
 
@@ -131,6 +136,14 @@ Res PoolInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   if (res != ResOK)
     return res;
 
+  if (ArgPick(&arg, args, MPS_KEY_POOL_CACHE) && arg.val.b) {
+    res = MagCacheCreate(&pool->cache, pool);
+    if (res != ResOK) {
+      Method(Inst, pool, finish)(MustBeA(Inst, pool));
+      return res;
+    }
+  }
+
   EVENT4(PoolInit, pool, PoolArena(pool), ClassOfPoly(Pool, pool),
          pool->serial);
 
@@ -178,6 +191,10 @@ failControlAlloc:
 void PoolFinish(Pool pool)
 {
   AVERT(Pool, pool);
+  if (pool->cache != NULL) {
+    MagCacheDestroy(pool->cache);
+    pool->cache = NULL;
+  }
   Method(Inst, pool, finish)(MustBeA(Inst, pool));
 }
 
@@ -283,6 +300,57 @@ void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p)
 }
 
 
+/* PoolFreeze -- freeze the segments of a pool
+ *
+ * Segments with buffers are left alone, because objects may still be
+ * allocated in them. The arena must be parked, so that no segment is
+ * white or grey. See <design/seg#.frozen>.
+ */
+
+Res PoolFreeze(Pool pool)
+{
+  Arena arena;
+  Ring node, nextNode;
+  Res res;
+
+  AVERT(Pool, pool);
+  arena = PoolArena(pool);
+  AVER(ArenaGlobals(arena)->clamped);
+  AVER(arena->busyTraces == TraceSetEMPTY);
+
+  RING_FOR(node, &pool->segRing, nextNode) {
+    Seg seg = SegOfPoolRing(node);
+    if (!SegHasBuffer(seg)) {
+      res = SegFreeze(seg);
+      if (res != ResOK)
+        return res;
+    }
+  }
+  return ResOK;
+}
+
+
+/* PoolThaw -- thaw the frozen segments of a pool
+ *
+ * The arena must be parked, because a thawed segment has no write
+ * barrier until it is next scanned.
+ */
+
+void PoolThaw(Pool pool)
+{
+  Arena arena;
+  Ring node, nextNode;
+
+  AVERT(Pool, pool);
+  arena = PoolArena(pool);
+  AVER(ArenaGlobals(arena)->clamped);
+  AVER(arena->busyTraces == TraceSetEMPTY);
+
+  RING_FOR(node, &pool->segRing, nextNode)
+    SegThaw(SegOfPoolRing(node));
+}
+
+
 /* PoolTotalSize -- return total memory allocated from arena */
 
 Size PoolTotalSize(Pool pool)
@@ -89,6 +89,7 @@ Res PoolAbsInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignment = MPS_PF_ALIGN;
   pool->alignShift = SizeLog2(pool->alignment);
   pool->format = NULL;
+  pool->cache = NULL;
 
   if (ArgPick(&arg, args, MPS_KEY_FORMAT)) {
     Format format = arg.val.format;
@@ -25,6 +25,7 @@ typedef Bool (*amcPinnedFunction)(AMC amc, Nailboard board, Addr base, Addr limi
 
 static void amcSegBufferEmpty(Seg seg, Buffer buffer);
 static Res amcSegWhiten(Seg seg, Trace trace);
+static Res amcSegFreeze(Seg seg);
 static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static void amcSegReclaim(Seg seg, Trace trace);
 static Bool amcSegHasNailboard(Seg seg);
@@ -32,6 +33,7 @@ static Nailboard amcSegNailboard(Seg seg);
 static Bool AMCCheck(AMC amc);
 static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO);
 static Res amcSegFixEmergency(Seg seg, ScanState ss, Ref *refIO);
+static Res amcScanStackDrain(ScanState ss, AMC amc, Format format);
 static void amcSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                        void *p, size_t s);
 
@@ -99,6 +101,27 @@ enum {
  * collection via TracePoll), and by hash array allocations (where we
  * don't want the allocation to provoke a collection that makes the
  * location dependency stale immediately).
+ *
+ * .seg.promote: The "promote" field is the generation that the segment
+ * will be moved to when it is reclaimed, or NULL. It is set when the
+ * segment is preserved in place instead of having its contents
+ * copied; see .promote.
+ *
+ * .seg.live: The "live" field estimates the size of the live objects
+ * in the segment. It is the size of the objects copied into the
+ * segment, or the size of the objects preserved in place the last
+ * time the segment was reclaimed. It is zero for segments allocated
+ * by the mutator, whose liveness is unknown.
+ *
+ * .seg.dense: The "dense" flag is TRUE if the segment was estimated
+ * to be dense when it was condemned, and so its objects are being
+ * preserved in place rather than copied; see .dense.
+ *
+ * .seg.large: The "large" flag is TRUE if the segment was allocated
+ * for a single large object, which is at its base; see
+ * AMCBufferFill.  The segment's size doesn't tell us this, because a
+ * segment for small objects may be as big as largeSize if extendBy
+ * is.
  */
 
 typedef struct amcSegStruct *amcSeg;
@@ -110,9 +133,13 @@ typedef struct amcSegStruct {
   amcGen gen;               /* generation this segment belongs to */
   Nailboard board;          /* nailboard for this segment or NULL if none */
   Size forwarded[TraceLIMIT]; /* size of objects forwarded for each trace */
+  amcGen promote;           /* .seg.promote */
+  Size live;                /* .seg.live */
   BOOLFIELD(accountedAsBuffered); /* .seg.accounted-as-buffered */
   BOOLFIELD(old);           /* .seg.old */
   BOOLFIELD(deferred);      /* .seg.deferred */
+  BOOLFIELD(dense);         /* .seg.dense */
+  BOOLFIELD(large);         /* .seg.large */
   Sig sig;                  /* <code/misc.h#sig> */
 } amcSegStruct;
 
@@ -127,9 +154,16 @@ static Bool amcSegCheck(amcSeg amcseg)
     CHECKD(Nailboard, amcseg->board);
     CHECKL(SegNailed(MustBeA(Seg, amcseg)) != TraceSetEMPTY);
   }
+  if (amcseg->promote != NULL) {
+    CHECKU(amcGen, amcseg->promote);
+    CHECKL(SegNailed(MustBeA(Seg, amcseg)) != TraceSetEMPTY);
+  }
+  CHECKL(amcseg->live <= SegSize(MustBeA(Seg, amcseg)));
+  CHECKL(!amcseg->dense || amcseg->board != NULL);
   /* CHECKL(BoolCheck(amcseg->accountedAsBuffered)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->old)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->deferred)); <design/type#.bool.bitfield.check> */
+  /* CHECKL(BoolCheck(amcseg->dense)); <design/type#.bool.bitfield.check> */
   return TRUE;
 }
 
@@ -157,9 +191,13 @@ static Res AMCSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
 
   amcseg->gen = amcgen;
   amcseg->board = NULL;
+  amcseg->promote = NULL;
+  amcseg->live = 0;
   amcseg->accountedAsBuffered = FALSE;
   amcseg->old = FALSE;
   amcseg->deferred = FALSE;
+  amcseg->dense = FALSE;
+  amcseg->large = FALSE;
 
   SetClassOfPoly(seg, CLASS(amcSeg));
   amcseg->sig = amcSegSig;
@@ -365,6 +403,7 @@ DEFINE_CLASS(Seg, amcSeg, klass)
   klass->fixEmergency = amcSegFixEmergency;
   klass->reclaim = amcSegReclaim;
   klass->walk = amcSegWalk;
+  klass->freeze = amcSegFreeze;
   AVERT(SegClass, klass);
 }
 
@@ -407,6 +446,16 @@ static amcGen amcSegGen(Seg seg)
 
 #define AMCSig          ((Sig)0x519A3C99) /* SIGnature AMC */
 
+/* amcScanEntryStruct -- object copied during depth-first scanning
+ *
+ * See .depth-first.
+ */
+
+typedef struct amcScanEntryStruct {
+  Addr ref;                /* client pointer to the new copy */
+  Seg seg;                 /* segment containing the new copy */
+} amcScanEntryStruct;
+
 typedef struct AMCStruct { /* <design/poolamc#.struct> */
   PoolStruct poolStruct;   /* generic pool structure */
   RankSet rankSet;         /* rankSet for entire pool */
@@ -422,6 +471,11 @@ typedef struct AMCStruct { /* <design/poolamc#.struct> */
   amcPinnedFunction pinned; /* function determining if block is pinned */
   Size extendBy;           /* segment size to extend pool by */
   Size largeSize;          /* min size of "large" segments */
+  Bool depthFirst;         /* scan copied objects first? .depth-first */
+  double dense;            /* survival fraction for .dense, or 0 */
+  Seg scanSeg;             /* segment being scanned, or NULL */
+  Count scanStackCount;    /* number of entries in scanStack */
+  amcScanEntryStruct scanStack[AMC_SCAN_STACK_DEPTH];
   Sig sig;                 /* <design/pool#.outer-structure.sig> */
 } AMCStruct;
 
@@ -707,6 +761,9 @@ static void AMCVarargs(ArgStruct args[MPS_ARGS_MAX], va_list varargs)
 }
 
 
+ARG_DEFINE_KEY(AMC_DEPTH_FIRST, Bool);
+ARG_DEFINE_KEY(AMC_DENSE, double);
+
 /* amcInitComm -- initialize AMC/Z pool
  *
  * <design/poolamc#.init>.
@@ -724,6 +781,8 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
   Chain chain;
   Size extendBy = AMC_EXTEND_BY_DEFAULT;
   Size largeSize = AMC_LARGE_SIZE_DEFAULT;
+  Bool depthFirst = AMC_DEPTH_FIRST_DEFAULT;
+  double dense = AMC_DENSE_DEFAULT;
   ArgStruct arg;
 
   AVER(pool != NULL);
@@ -742,11 +801,17 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
     extendBy = arg.val.size;
   if (ArgPick(&arg, args, MPS_KEY_LARGE_SIZE))
     largeSize = arg.val.size;
+  if (ArgPick(&arg, args, MPS_KEY_AMC_DEPTH_FIRST))
+    depthFirst = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_AMC_DENSE))
+    dense = arg.val.d;
 
   AVERT(Chain, chain);
   AVER(chain->arena == arena);
   AVER(extendBy > 0);
   AVER(largeSize > 0);
+  AVER(0.0 <= dense);
+  AVER(dense <= 1.0);
   /* TODO: it would be nice to be able to manage large objects that
    * are smaller than the extendBy, but currently this results in
    * unacceptable fragmentation due to the padding objects. This
@@ -785,6 +850,10 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
   /* .extend-by.aligned: extendBy is aligned to the arena alignment. */
   amc->extendBy = SizeArenaGrains(extendBy, arena);
   amc->largeSize = largeSize;
+  amc->depthFirst = depthFirst;
+  amc->dense = dense;
+  amc->scanSeg = NULL;
+  amc->scanStackCount = 0;
 
   SetClassOfPoly(pool, klass);
   amc->sig = AMCSig;
@@ -946,7 +1015,8 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   }
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD_FIELD(args, amcKeySegGen, p, gen);
-    res = PoolGenAlloc(&seg, pgen, CLASS(amcSeg), grainsSize, args);
+    res = PoolGenAlloc(&seg, pgen, CLASS(amcSeg), grainsSize,
+                       BufferNode(buffer), args);
   } MPS_ARGS_END(args);
   if(res != ResOK)
     return res;
@@ -989,6 +1059,7 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
       (*pool->format->pad)(limit, padSize);
       ShieldCover(arena, seg);
     }
+    MustBeA(amcSeg, seg)->large = TRUE;
   }
 
   PoolGenAccountForFill(pgen, SegSize(seg));
@@ -1009,7 +1080,6 @@ static void amcSegBufferEmpty(Seg seg, Buffer buffer)
   amcSeg amcseg = MustBeA(amcSeg, seg);
   Pool pool = SegPool(seg);
   Arena arena = PoolArena(pool);
-  AMC amc = MustBeA(AMCZPool, pool);
   Addr base, init, limit;
   TraceId ti;
   Trace trace;
@@ -1022,7 +1092,7 @@ static void amcSegBufferEmpty(Seg seg, Buffer buffer)
   AVER(SegBase(seg) <= base);
   AVER(base <= init);
   AVER(init <= limit);
-  if(SegSize(seg) < amc->largeSize) {
+  if (!amcseg->large) {
     /* Small or Medium segment: buffer had the entire seg. */
     AVER(limit == SegLimit(seg));
   } else {
@@ -1251,6 +1321,62 @@ static Res amcSegWhiten(Seg seg, Trace trace)
     amc->rampMode = RampCOLLECTING;
   }
 
+  /* .dense: If the pool was created with MPS_KEY_AMC_DENSE, and the
+   * segment is estimated to be at least that fraction live, preserve
+   * its objects in place instead of copying them, and move it to the
+   * generation they would have been copied to when it is reclaimed.
+   * The estimate is the size of the objects that were live when the
+   * segment was filled or last reclaimed (see .seg.live), less the
+   * generation's predicted mortality.  This is off by default,
+   * because in gcbench no segment is dense at 0.9, and at lower
+   * thresholds, which do preserve segments, collections are no
+   * faster.
+   *
+   * The segment's nailboard records which objects are live, and only
+   * those are scanned, so that the segment's liveness can be measured
+   * when it is reclaimed. See <design/poolamc#.dense>. */
+  if (amc->dense > 0.0
+      && !SegHasBuffer(seg)
+      && SegNailed(seg) == TraceSetEMPTY
+      && !amcseg->deferred
+      && (double)amcseg->live * (1.0 - gen->pgen.gen->mortality)
+         >= amc->dense * (double)SegSize(seg))
+  {
+    res = amcSegCreateNailboard(seg);
+    if (res == ResOK) {
+      amcGen promote = amcBufGen(gen->forward);
+      SegSetNailed(seg, TraceSetSingle(trace));
+      amcseg->dense = TRUE;
+      if (promote != gen)
+        amcseg->promote = promote;
+    }
+    /* Otherwise, the objects are copied as usual. */
+  }
+
+  return ResOK;
+}
+
+
+/* amcSegFreeze -- account for the objects in a segment as old
+ *
+ * See <design/seg#.frozen>.
+ */
+
+static Res amcSegFreeze(Seg seg)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  amcGen gen = amcSegGen(seg);
+
+  AVERT(amcGen, gen);
+  if (!amcseg->old) {
+    amcseg->old = TRUE;
+    if (amcseg->accountedAsBuffered) {
+      amcseg->accountedAsBuffered = FALSE;
+      PoolGenAccountForAge(&gen->pgen, SegSize(seg), 0, amcseg->deferred);
+    } else
+      PoolGenAccountForAge(&gen->pgen, 0, SegSize(seg), amcseg->deferred);
+  }
+
   return ResOK;
 }
 
@@ -1358,12 +1484,24 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
       return res;
     }
     loops += 1;
+    /* Scan the objects marked in dense segments during the pass. If
+       that marks objects in this segment, go round again. See
+       .dense.fix. */
+    res = amcScanStackDrain(ss, amc, pool->format);
+    if(res != ResOK) {
+      *totalReturn = FALSE;
+      return res;
+    }
+    moreScanning = NailboardNewNails(amcSegNailboard(seg));
   } while(moreScanning);
 
   if(loops > 1) {
     RefSet refset;
 
-    AVER(ArenaEmergency(PoolArena(pool)));
+    /* New marks are made in a segment being scanned only when fixing
+       in an emergency, or when the scan stack overflows while fixing
+       references to a dense segment. */
+    AVER(ArenaEmergency(PoolArena(pool)) || MustBeA(amcSeg, seg)->dense);
 
     /* Looped: fixed refs (from 1st pass) were seen by MPS_FIX1
      * (in later passes), so the "ss.unfixedSummary" is _not_
@@ -1388,29 +1526,184 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
 }
 
 
-/* amcSegScan -- scan a single seg, turning it black
+/* amcScanStackReverse -- reverse the entries pushed since index i
  *
- * <design/poolamc#.seg-scan>.
+ * A scan pushes the objects it copies in the order of the
+ * references, so reversing them means that the first is scanned
+ * first, and the children of the first reference are copied first.
  */
-static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
+static void amcScanStackReverse(AMC amc, Index i)
+{
+  Index j = amc->scanStackCount;
+  AVER(i <= j);
+  while (j - i > 1) {
+    amcScanEntryStruct entry = amc->scanStack[i];
+    --j;
+    amc->scanStack[i] = amc->scanStack[j];
+    amc->scanStack[j] = entry;
+    ++i;
+  }
+}
+
+
+/* amcScanStackPush -- push an object that needs scanning
+ *
+ * Returns FALSE if the pool isn't scanning a segment, or the stack is
+ * full.
+ */
+static Bool amcScanStackPush(AMC amc, Addr ref, Seg seg)
+{
+  if (amc->scanSeg == NULL
+      || amc->scanStackCount >= NELEMS(amc->scanStack))
+    return FALSE;
+  amc->scanStack[amc->scanStackCount].ref = ref;
+  amc->scanStack[amc->scanStackCount].seg = seg;
+  ++amc->scanStackCount;
+  return TRUE;
+}
+
+
+/* amcScanStackDrain -- scan the objects on the scan stack
+ *
+ * The stack holds objects that amcSegFix copied while scanning in
+ * depth-first order (see .depth-first), and objects that it marked
+ * in dense segments (see .dense.fix).
+ *
+ * .depth-first: When the pool was created with
+ * MPS_KEY_AMC_DEPTH_FIRST, amcSegFix pushes each object it copies
+ * onto a small stack, and amcSegScanDepthFirst scans them as soon as
+ * the object that referred to them has been scanned. Their children
+ * are therefore copied next to them, rather than being left for the
+ * breadth-first segment scan. When the stack is full, copied objects
+ * are left to the segment scan. The copies are still grey, so they
+ * are scanned again with their segment: this is extra work, and the
+ * option is off by default. See <design/poolamc#.depth-first>.
+ *
+ * Objects on the stack that are not in the segment being scanned
+ * contribute nothing to the summary of that segment: the references
+ * their scan finds are added to the summary of the segment
+ * containing the object instead, as they may now refer to zones that
+ * the segment's summary does not include.
+ */
+static Res amcScanStackDrain(ScanState ss, AMC amc, Format format)
+{
+  Arena arena = PoolArena(MustBeA(AbstractPool, amc));
+  Res res = ResOK;
+
+  while (res == ResOK && amc->scanStackCount > 0) {
+    amcScanEntryStruct entry;
+    RefSet unfixedSummary, fixedSummary;
+    Index mark;
+
+    --amc->scanStackCount;
+    entry = amc->scanStack[amc->scanStackCount];
+    mark = amc->scanStackCount;
+    unfixedSummary = ScanStateUnfixedSummary(ss);
+    fixedSummary = ss->fixedSummary;
+    ScanStateSetUnfixedSummary(ss, RefSetEMPTY);
+    ss->fixedSummary = RefSetEMPTY;
+
+    ShieldExpose(arena, entry.seg);
+    res = TraceScanFormat(ss, entry.ref, (*format->skip)(entry.ref));
+    ShieldCover(arena, entry.seg);
+    amcScanStackReverse(amc, mark);
+    if (entry.seg == amc->scanSeg) {
+      /* The summary of the segment being scanned will be set from the
+         scan state, so add the references to that instead. */
+      fixedSummary = RefSetUnion(fixedSummary, ScanStateSummary(ss));
+    } else {
+      SegSetSummary(entry.seg, RefSetUnion(SegSummary(entry.seg),
+                                           ScanStateSummary(ss)));
+      if (res != ResOK)
+        /* Scan the object again when its segment is scanned. */
+        SegSetGrey(entry.seg, TraceSetUnion(SegGrey(entry.seg),
+                                            ss->traces));
+    }
+
+    ScanStateSetUnfixedSummary(ss, unfixedSummary);
+    ss->fixedSummary = fixedSummary;
+  }
+  return res;
+}
+
+
+/* amcScanStackFlush -- abandon the objects on the scan stack
+ *
+ * Greys the segments containing them, so that they will be scanned
+ * later.
+ */
+static void amcScanStackFlush(ScanState ss, AMC amc)
+{
+  while (amc->scanStackCount > 0) {
+    Seg seg;
+    --amc->scanStackCount;
+    seg = amc->scanStack[amc->scanStackCount].seg;
+    SegSetGrey(seg, TraceSetUnion(SegGrey(seg), ss->traces));
+  }
+}
+
+
+/* amcSegScanDepthFirst -- scan a range of objects depth-first
+ *
+ * Scans the objects in [base, limit) one at a time, following each
+ * with the objects it caused to be copied. See .depth-first.
+ */
+static Res amcSegScanDepthFirst(ScanState ss, AMC amc, Format format,
+                                Addr base, Addr limit)
+{
+  Addr p = base;
+  Res res = ResOK;
+
+  AVER(amc->scanSeg != NULL);
+  while (p < limit) {
+    Addr q = (*format->skip)(p);
+    res = TraceScanFormat(ss, p, q);
+    if (res == ResOK) {
+      amcScanStackReverse(amc, 0);
+      res = amcScanStackDrain(ss, amc, format);
+    }
+    if (res != ResOK)
+      break;
+    p = q;
+  }
+  AVER(res != ResOK || p == limit);
+  return res;
+}
+
+
+/* amcSegScanRange -- scan a range of objects in a segment
+ *
+ * The objects on the scan stack are scanned before returning, so
+ * that if scanning them copies objects into the segment's buffer,
+ * the caller finds them when it looks at the buffer's scan limit
+ * again. See <design/poolamc#.depth-first.self>.
+ */
+static Res amcSegScanRange(ScanState ss, AMC amc, Format format,
+                           Addr base, Addr limit)
 {
-  Addr base, limit;
-  Format format;
-  Pool pool;
-  AMC amc;
   Res res;
-  Buffer buffer;
 
-  AVER(totalReturn != NULL);
-  AVERT(Seg, seg);
-  AVERT(ScanState, ss);
+  if (amc->depthFirst)
+    return amcSegScanDepthFirst(ss, amc, format, base, limit);
+  res = TraceScanFormat(ss, base, limit);
+  if (res != ResOK)
+    return res;
+  return amcScanStackDrain(ss, amc, format);
+}
 
-  pool = SegPool(seg);
-  amc = MustBeA(AMCZPool, pool);
-  format = pool->format;
+
+/* amcSegScanObjects -- scan the objects in a segment */
+
+static Res amcSegScanObjects(Bool *totalReturn, Seg seg, ScanState ss,
+                             AMC amc, Format format)
+{
+  Addr base, limit;
+  Res res;
+  Buffer buffer;
 
   if(amcSegHasNailboard(seg)) {
-    return amcSegScanNailed(totalReturn, ss, pool, seg, amc);
+    return amcSegScanNailed(totalReturn, ss, MustBeA(AbstractPool, amc),
+                            seg, amc);
   }
 
   base = AddrAdd(SegBase(seg), format->headerSize);
@@ -1425,7 +1718,7 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
       *totalReturn = TRUE;
       return ResOK;
     }
-    res = TraceScanFormat(ss, base, limit);
+    res = amcSegScanRange(ss, amc, format, base, limit);
     if(res != ResOK) {
       *totalReturn = FALSE;
       return res;
@@ -1438,7 +1731,7 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
   AVER(SegBase(seg) <= base);
   AVER(base <= AddrAdd(SegLimit(seg), format->headerSize));
   if(base < limit) {
-    res = TraceScanFormat(ss, base, limit);
+    res = amcSegScanRange(ss, amc, format, base, limit);
     if(res != ResOK) {
       *totalReturn = FALSE;
       return res;
@@ -1450,6 +1743,51 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
+/* amcSegScan -- scan a single seg, turning it black
+ *
+ * <design/poolamc#.seg-scan>.
+ *
+ * If the pool was created with MPS_KEY_AMC_DEPTH_FIRST or
+ * MPS_KEY_AMC_DENSE, then while the segment is being scanned,
+ * objects that need scanning are pushed onto the pool's scan stack,
+ * and are scanned after the range of objects that caused them to be
+ * pushed. If the scan fails, their segments are greyed instead.
+ * Otherwise the pool's scanSeg is left NULL, so amcScanStackPush
+ * refuses every object and the stack is never used.
+ *
+ * The stack belongs to the pool, but it is only non-empty during a
+ * single call to this function, so the objects on it were all pushed
+ * by one scan state, and are greyed for that scan state's traces if
+ * they are abandoned.
+ */
+static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
+{
+  Format format;
+  AMC amc;
+  Res res;
+
+  AVER(totalReturn != NULL);
+  AVERT(Seg, seg);
+  AVERT(ScanState, ss);
+
+  amc = MustBeA(AMCZPool, SegPool(seg));
+  format = SegPool(seg)->format;
+
+  AVER(amc->scanSeg == NULL);
+  AVER(amc->scanStackCount == 0);
+  if (amc->depthFirst || amc->dense > 0.0)
+    amc->scanSeg = seg;
+  res = amcSegScanObjects(totalReturn, seg, ss, amc, format);
+  if (res != ResOK) {
+    *totalReturn = FALSE;
+    amcScanStackFlush(ss, amc);
+  }
+  AVER(amc->scanStackCount == 0);
+  amc->scanSeg = NULL;
+  return res;
+}
+
+
 /* amcSegFixInPlace -- fix a reference without moving the object
  *
  * Usually this function is used for ambiguous references, but during
@@ -1461,6 +1799,7 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 static void amcSegFixInPlace(Seg seg, ScanState ss, Ref *refIO)
 {
   Addr ref;
+  amcGen promote;
 
   ref = (Addr)*refIO;
   /* An ambiguous reference can point before the header. */
@@ -1470,6 +1809,13 @@ static void amcSegFixInPlace(Seg seg, ScanState ss, Ref *refIO)
   /* segment. */
   AVER(ref < SegLimit(seg));
 
+  /* A segment preserved in place is promoted when it is reclaimed,
+   * however it was preserved (see .dense), so the reference will
+   * refer to its new generation. See .promote.gen. */
+  promote = MustBeA(amcSeg, seg)->promote;
+  if (promote != NULL)
+    ss->genSummary = GenSetAdd(ss->genSummary, promote->pgen.gen);
+
   if(amcSegHasNailboard(seg)) {
     Bool wasMarked = NailboardSet(amcSegNailboard(seg), ref);
     /* If there are no new marks (i.e., no new traces for which we */
@@ -1547,6 +1893,7 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
   amcGen gen;          /* generation of old copy of object */
   TraceSet grey;       /* greyness of object being relocated */
   Seg toSeg;           /* segment to which object is being relocated */
+  amcGen promote;      /* generation to promote segment to, see .promote */
   TraceId ti;
   Trace trace;
 
@@ -1611,6 +1958,11 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
           SegSetGrey(seg, TraceSetUnion(SegGrey(seg), ss->traces));
         SegSetNailed(seg, TraceSetUnion(SegNailed(seg), ss->traces));
       }
+      /* .promote.gen: The reference will refer to the segment's new
+       * generation.  See <code/trace.c#gen.summary>. */
+      promote = MustBeA_CRITICAL(amcSeg, seg)->promote;
+      if (promote != NULL)
+        ss->genSummary = GenSetAdd(ss->genSummary, promote->pgen.gen);
       res = ResOK;
       goto returnRes;
     } else if(ss->rank == RankWEAK) {
@@ -1623,11 +1975,65 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
 
     ss->wasMarked = FALSE; /* <design/fix#.was-marked.not> */
 
+    /* .dense.fix: The segment is dense, so preserve the object in
+     * place instead, by marking it. If the pool is scanning, push the
+     * object so that it is scanned straight after the objects being
+     * scanned, and so doesn't count as a new nail. Otherwise, grey the
+     * segment, so that all the marked objects in it are scanned again.
+     * See .dense and .promote.gen. */
+    if (MustBeA_CRITICAL(amcSeg, seg)->dense) {
+      Nailboard board = amcSegNailboard(seg);
+      Bool newNails = NailboardNewNails(board);
+      if (!NailboardSet(board, ref)
+          && SegRankSet(seg) != RankSetEMPTY) /* not for AMCZ */
+      {
+        if (amcScanStackPush(amc, ref, seg)) {
+          if (!newNails)
+            NailboardClearNewNails(board);
+        } else {
+          SegSetGrey(seg, TraceSetUnion(SegGrey(seg), ss->traces));
+        }
+      }
+      promote = MustBeA_CRITICAL(amcSeg, seg)->promote;
+      if (promote != NULL)
+        ss->genSummary = GenSetAdd(ss->genSummary, promote->pgen.gen);
+      res = ResOK;
+      goto returnRes;
+    }
+
     /* Get the forwarding buffer from the object's generation. */
     gen = amcSegGen(seg);
     buffer = gen->forward;
     AVER_CRITICAL(buffer != NULL);
 
+    /* .promote: A large segment holds just the object at its base
+     * (see .seg.large), so instead of copying the object, preserve
+     * the whole segment in place, as if it were nailed, and move it
+     * to the generation the object would have been copied to when it
+     * is reclaimed (see amcSegReclaimNailed).  This costs nothing
+     * per byte of the object.  Segments whose accounting is deferred
+     * are left alone, to keep ramp accounting simple.  See
+     * <design/poolamc#.promote>. */
+    if (base == SegBase(seg)
+        && MustBeA_CRITICAL(amcSeg, seg)->large
+        && SegNailed(seg) == TraceSetEMPTY
+        && !SegHasBuffer(seg)
+        && !MustBeA_CRITICAL(amcSeg, seg)->deferred)
+    {
+      promote = amcBufGen(buffer);
+      AVERT_CRITICAL(amcGen, promote);
+      if (SegRankSet(seg) != RankSetEMPTY) /* not for AMCZ */
+        SegSetGrey(seg, TraceSetUnion(SegGrey(seg), ss->traces));
+      SegSetNailed(seg, ss->traces);
+      if (promote != gen) {
+        MustBeA_CRITICAL(amcSeg, seg)->promote = promote;
+        /* See .promote.gen. */
+        ss->genSummary = GenSetAdd(ss->genSummary, promote->pgen.gen);
+      }
+      res = ResOK;
+      goto returnRes;
+    }
+
     length = AddrOffset(ref, clientQ);  /* .exposed.seg */
     STATISTIC(++ss->forwardedCount);
     do {
@@ -1657,11 +2063,20 @@ static Res amcSegFix(Seg seg, ScanState ss, Ref *refIO)
     } while (!BUFFER_COMMIT(buffer, newBase, length));
 
     STATISTIC(ss->copiedSize += length);
+    MustBeA_CRITICAL(amcSeg, toSeg)->live += length; /* .seg.live */
     TRACE_SET_ITER(ti, trace, ss->traces, ss->arena)
       MustBeA(amcSeg, seg)->forwarded[ti] += length;
     TRACE_SET_ITER_END(ti, trace, ss->traces, ss->arena);
 
+    /* Count the object before it is overwritten. <code/traceanc.c#census> */
+    if (format->census != NULL)
+      TraceCensus(ss->traces, arena, format, ref, length);
+
     (*format->move)(ref, newRef);  /* .exposed.seg */
+
+    /* See .depth-first. */
+    if (amc->depthFirst)
+      (void)amcScanStackPush(amc, newRef, toSeg);
   } else {
     /* reference to broken heart (which should be snapped out -- */
     /* consider adding to (non-existent) snap-out cache here) */
@@ -1684,6 +2099,7 @@ returnRes:
 
 static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
 {
+  amcSeg amcseg = MustBeA(amcSeg, seg);
   Addr p, limit;
   Arena arena;
   Format format;
@@ -1730,6 +2146,11 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     if(preserve) {
       ++preservedInPlaceCount;
       preservedInPlaceSize += length;
+      /* A pinned object might have been forwarded before it was
+         nailed, in which case it was counted when it was copied.
+         <code/traceanc.c#census> */
+      if (format->census != NULL && (*format->isMoved)(clientP) == NULL)
+        TraceCensus(TraceSetSingle(trace), arena, format, clientP, length);
       if (padLength > 0) {
         /* Replace run of forwarding pointers and unreachable objects
          * with a padding object. */
@@ -1759,8 +2180,10 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
   if(SegNailed(seg) == TraceSetEMPTY && amcSegHasNailboard(seg)) {
     NailboardDestroy(amcSegNailboard(seg), arena);
-    MustBeA(amcSeg, seg)->board = NULL;
+    amcseg->board = NULL;
+    amcseg->dense = FALSE;
   }
+  amcseg->live = preservedInPlaceSize; /* .seg.live */
 
   STATISTIC(AVER(bytesReclaimed <= SegSize(seg)));
   STATISTIC(trace->reclaimSize += bytesReclaimed);
@@ -1772,7 +2195,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     GenDescCondemned(pgen->gen, trace,
                      AddrOffset(BufferBase(buffer), BufferLimit(buffer)));
   }
-  GenDescSurvived(pgen->gen, trace, MustBeA(amcSeg, seg)->forwarded[trace->ti],
+  GenDescSurvived(pgen->gen, trace, amcseg->forwarded[trace->ti],
                   preservedInPlaceSize);
 
   /* Free the seg if we can; fixes .nailboard.limitations.middle. */
@@ -1783,7 +2206,15 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     /* We may not free a buffered seg. */
     AVER(!SegHasBuffer(seg));
 
-    PoolGenFree(pgen, seg, 0, SegSize(seg), 0, MustBeA(amcSeg, seg)->deferred);
+    PoolGenFree(pgen, seg, 0, SegSize(seg), 0, amcseg->deferred);
+  } else if (amcseg->promote != NULL && SegNailed(seg) == TraceSetEMPTY) {
+    /* The segment was preserved in place instead of being copied, so
+     * move it to the generation it would have been copied to.  See
+     * .promote. */
+    AVER(!SegHasBuffer(seg));
+    PoolGenPromote(pgen, &amcseg->promote->pgen, seg, amcseg->deferred);
+    amcseg->gen = amcseg->promote;
+    amcseg->promote = NULL;
   }
 }
 
@@ -2118,6 +2549,12 @@ static Bool AMCCheck(AMC amc)
   CHECKL((amc->rampCount != 0) || ((amc->rampMode != RampBEGIN) &&
                                    (amc->rampMode != RampRAMPING)));
 
+  CHECKL(BoolCheck(amc->depthFirst));
+  CHECKL(0.0 <= amc->dense);
+  CHECKL(amc->dense <= 1.0);
+  CHECKL(amc->scanStackCount <= NELEMS(amc->scanStack));
+  CHECKL(amc->scanSeg != NULL || amc->scanStackCount == 0);
+
   return TRUE;
 }
 
@@ -31,6 +31,7 @@ static Bool amsSegBufferFill(Addr *baseReturn, Addr *limitReturn,
 static void amsSegBufferEmpty(Seg seg, Buffer buffer);
 static void amsSegBlacken(Seg seg, TraceSet traceSet);
 static Res amsSegWhiten(Seg seg, Trace trace);
+static Res amsSegFreeze(Seg seg);
 static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO);
 static void amsSegReclaim(Seg seg, Trace trace);
@@ -634,6 +635,7 @@ DEFINE_CLASS(Seg, AMSSeg, klass)
   klass->fixEmergency = amsSegFix;
   klass->reclaim = amsSegReclaim;
   klass->walk = amsSegWalk;
+  klass->freeze = amsSegFreeze;
   AVERT(SegClass, klass);
 }
 
@@ -668,7 +670,7 @@ static Res AMSSegSizePolicy(Size *sizeReturn,
 /* AMSSegCreate -- create a single AMSSeg */
 
 static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
-                        RankSet rankSet)
+                        RankSet rankSet, Index node)
 {
   Seg seg;
   AMS ams;
@@ -690,13 +692,13 @@ static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
     goto failSize;
 
   res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), prefSize,
-                     argsNone);
+                     node, argsNone);
   if (res != ResOK) { /* try to allocate one that's just large enough */
     Size minSize = SizeArenaGrains(size, arena);
     if (minSize == prefSize)
       goto failSeg;
     res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), prefSize,
-                       argsNone);
+                       node, argsNone);
     if (res != ResOK)
       goto failSeg;
   }
@@ -707,7 +709,12 @@ static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
   } else {
     SegSetRankAndSummary(seg, rankSet, RefSetEMPTY);
   }
-  DebugPoolFreeSplat(pool, SegBase(seg), SegLimit(seg));
+  if (Method(Pool, pool, debugMixin)(pool) != NULL) {
+    DebugPoolFreeSplat(pool, SegBase(seg), SegLimit(seg));
+    /* The splat may have overwritten the zeros that a zeroed buffer
+       relies on.  See <code/buffer.c#zeroed>. */
+    SegSetZeroed(seg, FALSE);
+  }
 
   AVERT(AMSSeg, Seg2AMSSeg(seg));
 
@@ -981,7 +988,8 @@ static Res AMSBufferFill(Addr *baseReturn, Addr *limitReturn,
   }
 
   /* No segment had enough space, so make a new one. */
-  res = AMSSegCreate(&seg, pool, size, BufferRankSet(buffer));
+  res = AMSSegCreate(&seg, pool, size, BufferRankSet(buffer),
+                     BufferNode(buffer));
   if (res != ResOK)
     return res;
   b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
@@ -1174,6 +1182,29 @@ static Res amsSegWhiten(Seg seg, Trace trace)
 }
 
 
+/* amsSegFreeze -- account for the objects in a segment as old
+ *
+ * See <design/seg#.frozen>.
+ */
+
+static Res amsSegFreeze(Seg seg)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+  PoolGen pgen = PoolSegPoolGen(pool, seg);
+
+  /* All parameters checked by generic SegFreeze. */
+
+  PoolGenAccountForAge(pgen, PoolGrainsSize(pool, amsseg->bufferedGrains),
+                       PoolGrainsSize(pool, amsseg->newGrains), FALSE);
+  amsseg->oldGrains += amsseg->bufferedGrains + amsseg->newGrains;
+  amsseg->bufferedGrains = 0;
+  amsseg->newGrains = 0;
+
+  return ResOK;
+}
+
+
 /* AMSObjectFunction is the type of the method that an */
 /* amsIterate applies to each object in a segment. */
 typedef Res (*AMSObjectFunction)(
@@ -1316,6 +1347,9 @@ static Res amsScanObject(Seg seg, Index i, Addr p, Addr next, void *clos)
       AMS_GREY_BLACKEN(seg, i);
       if (i+1 < j)
         AMS_RANGE_WHITE_BLACKEN(seg, i+1, j);
+      if (format->census != NULL) /* <code/traceanc.c#census> */
+        TraceCensus(closure->ss->traces, PoolArena(SegPool(seg)), format,
+                    AddrAdd(p, format->headerSize), AddrOffset(p, next));
     }
   }
 
@@ -1405,6 +1439,9 @@ static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss)
           AMS_GREY_BLACKEN(seg, i);
           if (i+1 < j)
             AMS_RANGE_WHITE_BLACKEN(seg, i+1, j);
+          if (format->census != NULL) /* <code/traceanc.c#census> */
+            TraceCensus(ss->traces, arena, format, clientP,
+                        AddrOffset(p, next));
         }
       }
     } while(amsseg->marksChanged);
@@ -1493,8 +1530,11 @@ static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO)
 
           ShieldExpose(PoolArena(pool), seg);
           clientNext = (*pool->format->skip)(clientRef);
-          ShieldCover(PoolArena(pool), seg);
           next = AddrSub(clientNext, format->headerSize);
+          if (format->census != NULL) /* <code/traceanc.c#census> */
+            TraceCensus(ss->traces, PoolArena(pool), format, clientRef,
+                        AddrOffset(base, next));
+          ShieldCover(PoolArena(pool), seg);
           /* Part of the object might be grey, because of ambiguous */
           /* fixes, but that's OK, because scan will ignore that. */
           AMS_RANGE_WHITE_BLACKEN(seg, i, PoolIndexOfAddr(SegBase(seg), pool, next));
@@ -1521,15 +1561,19 @@ static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO)
 
 static Res amsSegBlackenObject(Seg seg, Index i, Addr p, Addr next, void *clos)
 {
-  UNUSED(p);
-  AVER(clos == UNUSED_POINTER);
+  TraceSet *traceSet = clos;
+  AVER(traceSet != NULL);
   /* Do what amsScanObject does, minus the scanning. */
   if (AMS_IS_GREY(seg, i)) {
     Index j = PoolIndexOfAddr(SegBase(seg), SegPool(seg), next);
+    Format format = SegPool(seg)->format;
     AVER(!AMS_IS_INVALID_COLOUR(seg, i));
     AMS_GREY_BLACKEN(seg, i);
     if (i+1 < j)
       AMS_RANGE_BLACKEN(seg, i+1, j);
+    if (format->census != NULL) /* <code/traceanc.c#census> */
+      TraceCensus(*traceSet, PoolArena(SegPool(seg)), format,
+                  AddrAdd(p, format->headerSize), AddrOffset(p, next));
   }
   return ResOK;
 }
@@ -1547,7 +1591,7 @@ static void amsSegBlacken(Seg seg, TraceSet traceSet)
     AVERT(AMSSeg, amsseg);
     AVER(amsseg->marksChanged); /* there must be something grey */
     amsseg->marksChanged = FALSE;
-    res = semSegIterate(seg, amsSegBlackenObject, UNUSED_POINTER);
+    res = semSegIterate(seg, amsSegBlackenObject, &traceSet);
     AVER(res == ResOK);
   }
 }
@@ -54,8 +54,11 @@ static void awlSegBufferEmpty(Seg seg, Buffer buffer);
 static Res awlSegAccess(Seg seg, Arena arena, Addr addr,
                         AccessSet mode, MutatorContext context);
 static Res awlSegWhiten(Seg seg, Trace trace);
+static Res awlSegFreeze(Seg seg);
 static void awlSegGreyen(Seg seg, Trace trace);
 static void awlSegBlacken(Seg seg, TraceSet traceSet);
+static void awlSegSetGrey(Seg seg, TraceSet grey);
+static void awlSegFlip(Seg seg, Trace trace);
 static Res awlSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static Res awlSegFix(Seg seg, ScanState ss, Ref *refIO);
 static void awlSegReclaim(Seg seg, Trace trace);
@@ -100,6 +103,7 @@ typedef struct AWLPoolStruct {
   PoolGenStruct pgenStruct; /* generation representing the pool */
   PoolGen pgen;             /* NULL or pointer to pgenStruct */
   Count succAccesses;       /* number of successive single accesses */
+  Bool softBarrier;         /* client reads through MPS_WEAK_REF_GET */
   FindDependentFunction findDependent; /*  to find a dependent object */
   awlStatTotalStruct stats;
   Sig sig;                  /* <code/misc.h#sig> */
@@ -283,11 +287,14 @@ DEFINE_CLASS(Seg, AWLSeg, klass)
   klass->whiten = awlSegWhiten;
   klass->greyen = awlSegGreyen;
   klass->blacken = awlSegBlacken;
+  klass->setGrey = awlSegSetGrey;
+  klass->flip = awlSegFlip;
   klass->scan = awlSegScan;
   klass->fix = awlSegFix;
   klass->fixEmergency = awlSegFix;
   klass->reclaim = awlSegReclaim;
   klass->walk = awlSegWalk;
+  klass->freeze = awlSegFreeze;
   AVERT(SegClass, klass);
 }
 
@@ -340,6 +347,10 @@ static Bool awlSegCanTrySingleAccess(Arena arena, Seg seg, Addr addr)
     return FALSE;
   }
 
+  /* Likewise if the pool has a software read barrier. */
+  if (!(SegSM(seg) & AccessREAD))
+    return FALSE;
+
   /* The trace is already in the weak band, so we can scan the whole
      segment without retention anyway.  Go for it. */
   if (TraceRankForAccess(arena, seg) == RankWEAK)
@@ -533,6 +544,7 @@ static Addr awlNoDependent(Addr addr)
 /* AWLInit -- initialize an AWL pool */
 
 ARG_DEFINE_KEY(AWL_FIND_DEPENDENT, Fun);
+ARG_DEFINE_KEY(AWL_SOFTWARE_BARRIER, Bool);
 
 static Res AWLInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 {
@@ -542,6 +554,7 @@ static Res AWLInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   Res res;
   ArgStruct arg;
   unsigned gen = AWL_GEN_DEFAULT;
+  Bool softBarrier = FALSE;
 
   AVER(pool != NULL);
   AVERT(Arena, arena);
@@ -558,6 +571,8 @@ static Res AWLInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   }
   if (ArgPick(&arg, args, MPS_KEY_GEN))
     gen = arg.val.u;
+  if (ArgPick(&arg, args, MPS_KEY_AWL_SOFTWARE_BARRIER))
+    softBarrier = arg.val.b;
 
   res = NextMethod(Pool, AWLPool, init)(pool, arena, klass, args);
   if (res != ResOK)
@@ -571,6 +586,7 @@ static Res AWLInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 
   AVER(FUNCHECK(findDependent));
   awl->findDependent = findDependent;
+  AVERT(Bool, softBarrier);
 
   AVERT(Chain, chain);
   AVER(gen <= ChainGens(chain));
@@ -579,6 +595,7 @@ static Res AWLInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   awl->pgen = NULL;
 
   awl->succAccesses = 0;
+  awl->softBarrier = softBarrier;
   awlStatTotalInit(awl);
 
   SetClassOfPoly(pool, CLASS(AWLPool));
@@ -660,7 +677,8 @@ static Res awlBufferFill(Addr *baseReturn, Addr *limitReturn,
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD_FIELD(args, awlKeySegRankSet, u, BufferRankSet(buffer));
     res = PoolGenAlloc(&seg, awl->pgen, CLASS(AWLSeg),
-                       SizeArenaGrains(size, PoolArena(pool)), args);
+                       SizeArenaGrains(size, PoolArena(pool)),
+                       BufferNode(buffer), args);
   } MPS_ARGS_END(args);
   if (res != ResOK)
     return res;
@@ -790,6 +808,29 @@ static Res awlSegWhiten(Seg seg, Trace trace)
 }
 
 
+/* awlSegFreeze -- account for the objects in a segment as old
+ *
+ * See <design/seg#.frozen>.
+ */
+
+static Res awlSegFreeze(Seg seg)
+{
+  AWLSeg awlseg = MustBeA(AWLSeg, seg);
+  Pool pool = SegPool(seg);
+  PoolGen pgen = PoolSegPoolGen(pool, seg);
+
+  /* All parameters checked by generic SegFreeze. */
+
+  PoolGenAccountForAge(pgen, PoolGrainsSize(pool, awlseg->bufferedGrains),
+                       PoolGrainsSize(pool, awlseg->newGrains), FALSE);
+  awlseg->oldGrains += awlseg->bufferedGrains + awlseg->newGrains;
+  awlseg->bufferedGrains = 0;
+  awlseg->newGrains = 0;
+
+  return ResOK;
+}
+
+
 /* awlSegGreyen -- Greyen method for AWL segments */
 
 /* awlSegRangeGreyen -- subroutine for awlSegGreyen */
@@ -848,6 +889,35 @@ static void awlSegBlacken(Seg seg, TraceSet traceSet)
 }
 
 
+/* awlSegSetGrey, awlSegFlip -- change greyness and flip
+ *
+ * If the pool has a software read barrier then the segment is never
+ * read protected, so skip the MutatorSeg methods, which raise and
+ * lower the read barrier, and go straight to the GCSeg methods. See
+ * <design/poolawl#.soft>.
+ */
+
+static void awlSegSetGrey(Seg seg, TraceSet grey)
+{
+  AWL awl = MustBeA_CRITICAL(AWLPool, SegPool(seg));
+
+  if (awl->softBarrier)
+    NextMethod(Seg, MutatorSeg, setGrey)(seg, grey);
+  else
+    NextMethod(Seg, AWLSeg, setGrey)(seg, grey);
+}
+
+static void awlSegFlip(Seg seg, Trace trace)
+{
+  AWL awl = MustBeA(AWLPool, SegPool(seg));
+
+  if (awl->softBarrier)
+    NextMethod(Seg, MutatorSeg, flip)(seg, trace);
+  else
+    NextMethod(Seg, AWLSeg, flip)(seg, trace);
+}
+
+
 /* awlScanObject -- scan a single object */
 /* base and limit are both offset by the header size */
 
@@ -1272,6 +1342,7 @@ static Bool AWLCheck(AWL awl)
   if (awl->pgen != NULL)
     CHECKD(PoolGen, awl->pgen);
   /* Nothing to check about succAccesses. */
+  CHECKL(BoolCheck(awl->softBarrier));
   CHECKL(FUNCHECK(awl->findDependent));
   /* Don't bother to check stats. */
   return TRUE;
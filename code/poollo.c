@@ -71,6 +71,7 @@ static Bool loSegBufferFill(Addr *baseReturn, Addr *limitReturn,
                             Seg seg, Size size, RankSet rankSet);
 static void loSegBufferEmpty(Seg seg, Buffer buffer);
 static Res loSegWhiten(Seg seg, Trace trace);
+static Res loSegFreeze(Seg seg);
 static Res loSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static Res loSegFix(Seg seg, ScanState ss, Ref *refIO);
 static void loSegReclaim(Seg seg, Trace trace);
@@ -95,6 +96,7 @@ DEFINE_CLASS(Seg, LOSeg, klass)
   klass->fixEmergency = loSegFix;
   klass->reclaim = loSegReclaim;
   klass->walk = loSegWalk;
+  klass->freeze = loSegFreeze;
   AVERT(SegClass, klass);
 }
 
@@ -577,7 +579,7 @@ static Res LOBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* No segment had enough space, so make a new one. */
   res = PoolGenAlloc(&seg, lo->pgen, CLASS(LOSeg),
                      SizeArenaGrains(size, PoolArena(pool)),
-                     argsNone);
+                     BufferNode(buffer), argsNone);
   if (res != ResOK)
     return res;
   b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
@@ -648,6 +650,29 @@ static Res loSegWhiten(Seg seg, Trace trace)
 }
 
 
+/* loSegFreeze -- account for the objects in a segment as old
+ *
+ * See <design/seg#.frozen>.
+ */
+
+static Res loSegFreeze(Seg seg)
+{
+  LOSeg loseg = MustBeA(LOSeg, seg);
+  Pool pool = SegPool(seg);
+  PoolGen pgen = PoolSegPoolGen(pool, seg);
+
+  /* All parameters checked by generic SegFreeze. */
+
+  PoolGenAccountForAge(pgen, PoolGrainsSize(pool, loseg->bufferedGrains),
+                       PoolGrainsSize(pool, loseg->newGrains), FALSE);
+  loseg->oldGrains += loseg->bufferedGrains + loseg->newGrains;
+  loseg->bufferedGrains = 0;
+  loseg->newGrains = 0;
+
+  return ResOK;
+}
+
+
 static Res loSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 {
   LOSeg loseg = MustBeA(LOSeg, seg);
@@ -476,6 +476,7 @@ static MessageClassStruct MRGMessageClassStruct = {
   MessageNoGCLiveSize,         /* GCLiveSize */
   MessageNoGCCondemnedSize,    /* GCCondemnedSize */
   MessageNoGCNotCondemnedSize, /* GCNotCondemnedSize */
+  MessageNoGCCensus,           /* GCCensus */
   MessageNoGCStartWhy,         /* GCStartWhy */
   MessageClassSig              /* <design/message#.class.sig.double> */
 };
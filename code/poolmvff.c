@@ -11,6 +11,10 @@
  * variable size where address-ordered first (or last) fit is an
  * appropriate policy.
  *
+ * .tlsf: If MPS_KEY_MVFF_TLSF is true, the primary free land is a
+ * TLSF instead of a CBS, and allocation is good fit in constant time
+ * instead of address-ordered fit. See <code/tlsf.c>.
+ *
  * .design: <design/poolmvff>
  *
  * .critical: In manual-allocation-bound programs using MVFF, many of
@@ -27,6 +31,7 @@
 #include "poolmvff.h"
 #include "mpscmfs.h"
 #include "poolmfs.h"
+#include "tlsf.h"
 
 SRCID(poolmvff, "$Id$");
 
@@ -42,7 +47,7 @@ DECLARE_CLASS(Pool, MVFFDebugPool, MVFFPool);
 
 #define PoolMVFF(pool)     PARENT(MVFFStruct, poolStruct, pool)
 #define MVFFTotalLand(mvff)  (&(mvff)->totalCBSStruct.landStruct)
-#define MVFFFreePrimary(mvff)   (&(mvff)->freeCBSStruct.landStruct)
+#define MVFFFreePrimary(mvff)   (&(mvff)->freePrimaryStruct.landStruct)
 #define MVFFFreeSecondary(mvff)  FreelistLand(&(mvff)->flStruct)
 #define MVFFFreeLand(mvff)  FailoverLand(&(mvff)->foStruct)
 #define MVFFLocusPref(mvff) (&(mvff)->locusPrefStruct)
@@ -395,6 +400,7 @@ static void MVFFDebugVarargs(ArgStruct args[MPS_ARGS_MAX], va_list varargs)
 ARG_DEFINE_KEY(MVFF_SLOT_HIGH, Bool);
 ARG_DEFINE_KEY(MVFF_ARENA_HIGH, Bool);
 ARG_DEFINE_KEY(MVFF_FIRST_FIT, Bool);
+ARG_DEFINE_KEY(MVFF_TLSF, Bool);
 
 static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 {
@@ -404,6 +410,7 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   Bool slotHigh = MVFF_SLOT_HIGH_DEFAULT;
   Bool arenaHigh = MVFF_ARENA_HIGH_DEFAULT;
   Bool firstFit = MVFF_FIRST_FIT_DEFAULT;
+  Bool tlsf = MVFF_TLSF_DEFAULT;
   double spare = MVFF_SPARE_DEFAULT;
   MVFF mvff;
   Res res;
@@ -440,6 +447,9 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   if (ArgPick(&arg, args, MPS_KEY_MVFF_FIRST_FIT))
     firstFit = arg.val.b;
 
+  if (ArgPick(&arg, args, MPS_KEY_MVFF_TLSF))
+    tlsf = arg.val.b;
+
   AVER(extendBy > 0);           /* .arg.check */
   AVER(avgSize > 0);            /* .arg.check */
   AVER(avgSize <= extendBy);    /* .arg.check */
@@ -454,6 +464,7 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   AVERT(Bool, slotHigh);
   AVERT(Bool, arenaHigh);
   AVERT(Bool, firstFit);
+  AVERT(Bool, tlsf);
 
   res = NextMethod(Pool, MVFFPool, init)(pool, arena, klass, args);
   if (res != ResOK)
@@ -468,6 +479,7 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignShift = SizeLog2(pool->alignment);
   mvff->slotHigh = slotHigh;
   mvff->firstFit = firstFit;
+  mvff->tlsf = tlsf;
   mvff->spare = spare;
 
   LocusPrefInit(MVFFLocusPref(mvff));
@@ -493,11 +505,19 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   if (res != ResOK)
     goto failTotalLandInit;
 
-  MPS_ARGS_BEGIN(liArgs) {
-    MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
-    res = LandInit(MVFFFreePrimary(mvff), CLASS(CBSFast), arena, align,
-                   mvff, liArgs);
-  } MPS_ARGS_END(liArgs);
+  /* The TLSF allocates its free lists from the control pool, so it
+   * can't be used when MVFF is the control pool. */
+  if (tlsf) {
+    AVER(arena->poolReady);
+    res = LandInit(MVFFFreePrimary(mvff), CLASS(TLSF), arena, align,
+                   mvff, mps_args_none);
+  } else {
+    MPS_ARGS_BEGIN(liArgs) {
+      MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
+      res = LandInit(MVFFFreePrimary(mvff), CLASS(CBSFast), arena, align,
+                     mvff, liArgs);
+    } MPS_ARGS_END(liArgs);
+  }
   if (res != ResOK)
     goto failFreePrimaryInit;
 
@@ -650,6 +670,7 @@ static Res MVFFDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "extendBy  $W\n",  (WriteFW)mvff->extendBy,
                "avgSize   $W\n",  (WriteFW)mvff->avgSize,
                "firstFit  $U\n",  (WriteFU)mvff->firstFit,
+               "tlsf      $U\n",  (WriteFU)mvff->tlsf,
                "slotHigh  $U\n",  (WriteFU)mvff->slotHigh,
                "spare     $D\n",  (WriteFD)mvff->spare,
                NULL);
@@ -744,7 +765,11 @@ Bool MVFFCheck(MVFF mvff)
   CHECKL(mvff->spare <= 1.0);                   /* see .arg.check */
   CHECKD(MFS, &mvff->cbsBlockPoolStruct);
   CHECKD(CBS, &mvff->totalCBSStruct);
-  CHECKD(CBS, &mvff->freeCBSStruct);
+  CHECKL(BoolCheck(mvff->tlsf));
+  if (mvff->tlsf)
+    CHECKD(TLSF, &mvff->freePrimaryStruct.tlsfStruct);
+  else
+    CHECKD(CBS, &mvff->freePrimaryStruct.cbsStruct);
   CHECKD(Freelist, &mvff->flStruct);
   CHECKD(Failover, &mvff->foStruct);
   CHECKL((LandSize)(MVFFTotalLand(mvff)) >= (LandSize)(MVFFFreeLand(mvff)));
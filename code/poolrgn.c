@@ -0,0 +1,734 @@
+/* poolrgn.c: REGION POOL CLASS
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * DESIGN
+ *
+ * .purpose: A region is a sequence of objects that are allocated by
+ * bumping a pointer and then all freed at once, for example the
+ * scratch data for one request in a server. Each allocation point on
+ * an RGN pool is a region. mps_rgn_reset frees all the objects
+ * allocated on the allocation point.
+ *
+ * .chain: Each buffer has a chain of the segments that it has filled
+ * from, newest first, linked through the next field of the segment.
+ * This is like the segment chain of an SNC pool <code/poolsnc.c>,
+ * except that a region is never partly popped.
+ *
+ * .cache: Resetting a region puts all its segments on the pool's
+ * cache of free segments, from which buffers are filled in preference
+ * to allocating new segments. Segments are normally allocated at the
+ * pool's extendBy size, so the segment at the head of the cache
+ * almost always fits and the cache is not searched. Cached segments
+ * are returned to the arena when the pool is destroyed.
+ *
+ * .cache.unpadded: Unlike SNC, the pool doesn't pad a segment when it
+ * is freed, so that resetting a region doesn't touch the memory in
+ * it. Instead, the free flag of a cached segment tells the scan and
+ * walk methods to skip it.
+ *
+ * .reset.light: If the region has only the segment that its buffer is
+ * attached to, resetting it just moves the allocation point back to
+ * the base of the buffer, as mps_ap_frame_pop does for a pop within a
+ * buffer. BufferSetAllocAddr zeroes the freed memory if the buffer is
+ * zeroed, and lowers the base for allocation sampling. If the region
+ * is not scanned or zeroed, and sampling is off, there's nothing to
+ * do but move the allocation point, so mps_rgn_reset does that
+ * without entering the arena. This is safe because only the thread
+ * using the allocation point modifies its chain, the collector only
+ * flips buffers that have a rank, and turning sampling on resets the
+ * sampling base of each buffer (see BufferSampleReset). A scanned
+ * region is reset in place only while its buffer is not flipped,
+ * because the init pointer must not move below initAtFlip (see
+ * BufferCheck).
+ *
+ * .scan: If an allocation point is created with the MPS_KEY_RANK
+ * keyword argument, its segments have that rank, and so the objects
+ * in the region are scanned as roots by every collection until the
+ * region is reset. Otherwise the region's segments have no rank, and
+ * the pool doesn't need a format.
+ */
+
+#include "mpscrgn.h"
+#include "mpm.h"
+
+SRCID(poolrgn, "$Id$");
+
+
+/* RGNStruct -- structure for an RGN pool */
+
+#define RGNSig  ((Sig)0x519B6E99)       /* SIGnature RGN Pool */
+
+typedef struct RGNStruct {
+  PoolStruct poolStruct;
+  Size extendBy;                /* minimum segment size */
+  Seg freeSegs;                 /* cache of free segments, .cache */
+  Sig sig;                      /* <design/sig> */
+} RGNStruct, *RGN;
+
+#define PoolRGN(pool) PARENT(RGNStruct, poolStruct, (pool))
+#define RGNPool(rgn) (&(rgn)->poolStruct)
+
+
+/* Forward declarations */
+
+typedef RGN RGNPool;
+#define RGNPoolCheck RGNCheck
+DECLARE_CLASS(Pool, RGNPool, AbstractSegBufPool);
+
+DECLARE_CLASS(Seg, RGNSeg, MutatorSeg);
+DECLARE_CLASS(Buffer, RGNBuf, SegBuf);
+static Bool RGNCheck(RGN rgn);
+static void rgnFreeChain(RGN rgn, Buffer buffer);
+static void rgnSegBufferEmpty(Seg seg, Buffer buffer);
+static Res rgnSegScan(Bool *totalReturn, Seg seg, ScanState ss);
+static void rgnSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
+                       void *p, size_t s);
+
+
+/* RGNSegStruct -- RGN segment subclass
+ *
+ * This subclass of MutatorSeg links segments in chains.
+ */
+
+#define RGNSegSig ((Sig)0x519B6E59)    /* SIGnature RGN SeG */
+
+typedef struct RGNSegStruct *RGNSeg;
+
+typedef struct RGNSegStruct {
+  GCSegStruct gcSegStruct;  /* superclass fields must come first */
+  RGNSeg next;              /* next segment in chain or cache, or NULL */
+  Bool free;                /* in the pool's cache? .cache.unpadded */
+  Sig sig;                  /* <design/sig> */
+} RGNSegStruct;
+
+#define SegRGNSeg(seg)             ((RGNSeg)(seg))
+#define RGNSegSeg(rgnseg)          ((Seg)(rgnseg))
+
+#define rgnSegNext(seg) RVALUE(RGNSegSeg(SegRGNSeg(seg)->next))
+#define rgnSegSetNext(seg, nextseg) \
+  ((void)(SegRGNSeg(seg)->next = SegRGNSeg(nextseg)))
+
+ATTRIBUTE_UNUSED
+static Bool RGNSegCheck(RGNSeg rgnseg)
+{
+  CHECKS(RGNSeg, rgnseg);
+  CHECKD(GCSeg, &rgnseg->gcSegStruct);
+  if (NULL != rgnseg->next) {
+    CHECKS(RGNSeg, rgnseg->next);
+  }
+  CHECKL(BoolCheck(rgnseg->free));
+  /* A cached segment is not scanned. */
+  CHECKL(!rgnseg->free || SegRankSet(RGNSegSeg(rgnseg)) == RankSetEMPTY);
+  return TRUE;
+}
+
+
+/* rgnSegInit -- init method for RGN segments */
+
+static Res rgnSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
+{
+  RGNSeg rgnseg;
+  Res res;
+
+  /* Initialize the superclass fields first via next-method call */
+  res = NextMethod(Seg, RGNSeg, init)(seg, pool, base, size, args);
+  if (res != ResOK)
+    return res;
+  rgnseg = CouldBeA(RGNSeg, seg);
+
+  AVERT(Pool, pool);
+  /* no useful checks for base and size */
+
+  rgnseg->next = NULL;
+  rgnseg->free = FALSE;
+
+  SetClassOfPoly(seg, CLASS(RGNSeg));
+  rgnseg->sig = RGNSegSig;
+  AVERC(RGNSeg, rgnseg);
+
+  return ResOK;
+}
+
+
+/* rgnSegFinish -- finish an RGN segment */
+
+static void rgnSegFinish(Inst inst)
+{
+  Seg seg = MustBeA(Seg, inst);
+  RGNSeg rgnseg = MustBeA(RGNSeg, seg);
+
+  rgnseg->sig = SigInvalid;
+
+  /* finish the superclass fields last */
+  NextMethod(Inst, RGNSeg, finish)(inst);
+}
+
+
+/* RGNSegClass -- class definition for RGN segments */
+
+DEFINE_CLASS(Seg, RGNSeg, klass)
+{
+  INHERIT_CLASS(klass, RGNSeg, MutatorSeg);
+  SegClassMixInNoSplitMerge(klass);
+  klass->instClassStruct.finish = rgnSegFinish;
+  klass->size = sizeof(RGNSegStruct);
+  klass->init = rgnSegInit;
+  klass->bufferEmpty = rgnSegBufferEmpty;
+  klass->scan = rgnSegScan;
+  klass->walk = rgnSegWalk;
+  AVERT(SegClass, klass);
+}
+
+
+/* RGNBufStruct -- RGN buffer subclass
+ *
+ * This subclass of SegBuf holds the head of the region's segment
+ * chain. See .chain.
+ */
+
+#define RGNBufSig ((Sig)0x519B6EBF) /* SIGnature RGN BuFfer */
+
+typedef struct RGNBufStruct *RGNBuf;
+
+typedef struct RGNBufStruct {
+  SegBufStruct segBufStruct;      /* superclass fields must come first */
+  Seg segs;                       /* newest segment in region, or NULL */
+  Sig sig;                        /* <design/sig> */
+} RGNBufStruct;
+
+
+/* RGNBufCheck -- check consistency of an RGNBuf */
+
+ATTRIBUTE_UNUSED
+static Bool RGNBufCheck(RGNBuf rgnbuf)
+{
+  SegBuf segbuf = MustBeA(SegBuf, rgnbuf);
+  CHECKS(RGNBuf, rgnbuf);
+  CHECKD(SegBuf, segbuf);
+  if (rgnbuf->segs != NULL) {
+    CHECKD(Seg, rgnbuf->segs);
+  }
+  return TRUE;
+}
+
+
+/* rgnBufInit -- initialize an RGNBuf
+ *
+ * The region is scanned only if a rank is supplied. See .scan.
+ */
+
+static Res rgnBufInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
+{
+  RankSet rankSet = RankSetEMPTY;
+  RGNBuf rgnbuf;
+  ArgStruct arg;
+  Res res;
+
+  AVERT(ArgList, args);
+  if (ArgPick(&arg, args, MPS_KEY_RANK)) {
+    AVERT(Rank, arg.val.rank);
+    /* Weak references would need to be splatted, which RGN doesn't
+       support. */
+    AVER(arg.val.rank == RankAMBIG || arg.val.rank == RankEXACT);
+    AVER(pool->format != NULL);  /* can't scan without a format */
+    rankSet = RankSetSingle(arg.val.rank);
+  }
+
+  /* Initialize the superclass fields first via next-method call */
+  res = NextMethod(Buffer, RGNBuf, init)(buffer, pool, isMutator, args);
+  if (res != ResOK)
+    return res;
+  rgnbuf = CouldBeA(RGNBuf, buffer);
+
+  BufferSetRankSet(buffer, rankSet);
+  rgnbuf->segs = NULL;
+
+  SetClassOfPoly(buffer, CLASS(RGNBuf));
+  rgnbuf->sig = RGNBufSig;
+  AVERC(RGNBuf, rgnbuf);
+
+  return ResOK;
+}
+
+
+/* rgnBufFinish -- finish an RGNBuf
+ *
+ * Destroying an allocation point resets its region.
+ */
+
+static void rgnBufFinish(Inst inst)
+{
+  Buffer buffer = MustBeA(Buffer, inst);
+  RGNBuf rgnbuf = MustBeA(RGNBuf, buffer);
+  RGN rgn = MustBeA(RGNPool, BufferPool(buffer));
+
+  rgnFreeChain(rgn, buffer);
+
+  rgnbuf->sig = SigInvalid;
+
+  NextMethod(Inst, RGNBuf, finish)(inst);
+}
+
+
+/* RGNBufClass -- the class definition */
+
+DEFINE_CLASS(Buffer, RGNBuf, klass)
+{
+  INHERIT_CLASS(klass, RGNBuf, SegBuf);
+  klass->instClassStruct.finish = rgnBufFinish;
+  klass->size = sizeof(RGNBufStruct);
+  klass->init = rgnBufInit;
+  AVERT(BufferClass, klass);
+}
+
+
+/* rgnFreeChain -- put all the segments in a region in the cache
+ *
+ * The buffer must be detached. See .cache.unpadded.
+ */
+
+static void rgnFreeChain(RGN rgn, Buffer buffer)
+{
+  RGNBuf rgnbuf = MustBeA(RGNBuf, buffer);
+  Seg seg;
+
+  AVERT(RGN, rgn);
+  AVER(BufferIsReset(buffer));
+
+  seg = rgnbuf->segs;
+  while (seg != NULL) {
+    Seg next = rgnSegNext(seg);
+    AVERT(Seg, seg);
+    AVER(!SegRGNSeg(seg)->free);
+
+    /* Make sure it's not grey, and set to RankSetEMPTY, so that it
+       won't be scanned. */
+    SegSetGrey(seg, TraceSetEMPTY);
+    SegSetRankAndSummary(seg, RankSetEMPTY, RefSetEMPTY);
+    SegRGNSeg(seg)->free = TRUE;
+
+    rgnSegSetNext(seg, rgn->freeSegs);
+    rgn->freeSegs = seg;
+    seg = next;
+  }
+  rgnbuf->segs = NULL;
+}
+
+
+/* rgnFindFreeSeg -- detach a segment big enough for size from the cache
+ *
+ * Returns TRUE on success. See .cache.
+ */
+
+static Bool rgnFindFreeSeg(Seg *segReturn, RGN rgn, Size size)
+{
+  Seg free = rgn->freeSegs;
+  Seg last = NULL;
+
+  AVER(size > 0);
+
+  while (free != NULL) {
+    AVERT(Seg, free);
+    if (SegSize(free) >= size) {
+      if (last == NULL)
+        rgn->freeSegs = rgnSegNext(free);
+      else
+        rgnSegSetNext(last, rgnSegNext(free));
+      rgnSegSetNext(free, NULL);
+      SegRGNSeg(free)->free = FALSE;
+      *segReturn = free;
+      return TRUE;
+    }
+    last = free;
+    free = rgnSegNext(free);
+  }
+
+  return FALSE;
+}
+
+
+/* RGNInit -- initialize an RGN pool */
+
+static Res RGNInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
+{
+  RGN rgn;
+  Size extendBy = RGN_EXTEND_BY_DEFAULT;
+  Align align = RGN_ALIGN_DEFAULT;
+  ArgStruct arg;
+  Res res;
+
+  AVER(pool != NULL);
+  AVERT(Arena, arena);
+  AVERT(ArgList, args);
+  UNUSED(klass); /* used for debug pools only */
+
+  if (ArgPick(&arg, args, MPS_KEY_EXTEND_BY))
+    extendBy = arg.val.size;
+  if (ArgPick(&arg, args, MPS_KEY_ALIGN))
+    align = arg.val.align;
+  AVER(extendBy > 0);
+  AVERT(Align, align);
+
+  res = NextMethod(Pool, RGNPool, init)(pool, arena, klass, args);
+  if (res != ResOK)
+    goto failNextInit;
+  rgn = CouldBeA(RGNPool, pool);
+
+  /* The format, if any, determines the alignment. */
+  if (pool->format != NULL)
+    align = pool->format->alignment;
+  pool->alignment = align;
+  pool->alignShift = SizeLog2(pool->alignment);
+  rgn->extendBy = SizeArenaGrains(extendBy, arena);
+  rgn->freeSegs = NULL;
+
+  SetClassOfPoly(pool, CLASS(RGNPool));
+  rgn->sig = RGNSig;
+  AVERC(RGNPool, rgn);
+
+  return ResOK;
+
+failNextInit:
+  AVER(res != ResOK);
+  return res;
+}
+
+
+/* RGNFinish -- finish an RGN pool */
+
+static void RGNFinish(Inst inst)
+{
+  Pool pool = MustBeA(AbstractPool, inst);
+  RGN rgn = MustBeA(RGNPool, pool);
+  Ring ring, node, nextNode;
+
+  AVERT(RGN, rgn);
+
+  ring = &pool->segRing;
+  RING_FOR(node, ring, nextNode) {
+    Seg seg = SegOfPoolRing(node);
+    AVERT(Seg, seg);
+    SegFree(seg);
+  }
+
+  rgn->sig = SigInvalid;
+
+  NextMethod(Inst, RGNPool, finish)(inst);
+}
+
+
+/* RGNBufferFill -- refill a buffer from the cache or a new segment */
+
+static Res RGNBufferFill(Addr *baseReturn, Addr *limitReturn,
+                         Pool pool, Buffer buffer, Size size)
+{
+  RGN rgn = MustBeA(RGNPool, pool);
+  RGNBuf rgnbuf = MustBeA(RGNBuf, buffer);
+  RankSet rankSet;
+  Res res;
+  Seg seg;
+
+  AVER(baseReturn != NULL);
+  AVER(limitReturn != NULL);
+  AVER(size > 0);
+  AVER(BufferIsReset(buffer));
+
+  if (!rgnFindFreeSeg(&seg, rgn, size)) {
+    Size asize = SizeArenaGrains(size, PoolArena(pool));
+    LocusPrefStruct pref;
+    if (asize < rgn->extendBy)
+      asize = rgn->extendBy;
+    LocusPrefInit(&pref);
+    LocusPrefExpress(&pref, LocusPrefNODE, &BufferNode(buffer));
+    res = SegAlloc(&seg, CLASS(RGNSeg), &pref, asize, pool, argsNone);
+    if (res != ResOK)
+      return res;
+  }
+
+  /* <design/seg#.field.rankSet.start> */
+  rankSet = BufferRankSet(buffer);
+  if (rankSet == RankSetEMPTY)
+    SegSetRankAndSummary(seg, rankSet, RefSetEMPTY);
+  else
+    SegSetRankAndSummary(seg, rankSet, RefSetUNIV);
+
+  AVERT(Seg, seg);
+  /* put the segment on the buffer's chain */
+  AVER(rgnSegNext(seg) == NULL);
+  rgnSegSetNext(seg, rgnbuf->segs);
+  rgnbuf->segs = seg;
+
+  *baseReturn = SegBase(seg);
+  *limitReturn = SegLimit(seg);
+  return ResOK;
+}
+
+
+/* rgnSegBufferEmpty -- pad the unused part of a segment
+ *
+ * Padding makes the segment walkable. A pool without a format is
+ * never walked or scanned.
+ */
+
+static void rgnSegBufferEmpty(Seg seg, Buffer buffer)
+{
+  Pool pool;
+  Addr base, init, limit;
+
+  AVERT(Seg, seg);
+  AVERT(Buffer, buffer);
+  base = BufferBase(buffer);
+  init = BufferGetInit(buffer);
+  limit = BufferLimit(buffer);
+  AVER(SegBase(seg) <= base);
+  AVER(base <= init);
+  AVER(init <= limit);
+  AVER(limit <= SegLimit(seg));
+
+  pool = SegPool(seg);
+  if (init < limit && pool->format != NULL) {
+    Arena arena = PoolArena(pool);
+    ShieldExpose(arena, seg);
+    (*pool->format->pad)(init, AddrOffset(init, limit));
+    ShieldCover(arena, seg);
+  }
+}
+
+
+/* rgnSegScan -- scan the objects in a segment of a live region */
+
+static Res rgnSegScan(Bool *totalReturn, Seg seg, ScanState ss)
+{
+  Addr base, limit;
+  Res res;
+
+  AVER(totalReturn != NULL);
+  AVERT(ScanState, ss);
+  AVERT(Seg, seg);
+
+  base = SegBase(seg);
+  limit = SegBufferScanLimit(seg);
+
+  if (base < limit && !SegRGNSeg(seg)->free
+      && SegPool(seg)->format != NULL)
+  {
+    res = TraceScanFormat(ss, base, limit);
+    if (res != ResOK) {
+      *totalReturn = FALSE;
+      return res;
+    }
+  }
+
+  *totalReturn = TRUE;
+  return ResOK;
+}
+
+
+/* rgnSegWalk -- walk the objects in a segment of a live region */
+
+static void rgnSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
+                       void *p, size_t s)
+{
+  AVERT(Seg, seg);
+  AVERT(Format, format);
+  AVER(FUNCHECK(f));
+  /* p and s are arbitrary closures and can't be checked */
+
+  /* Avoid applying the function to grey objects, which may have
+     pointers to old-space, and to cached segments, which are not
+     padded (.cache.unpadded). */
+  if (SegGrey(seg) == TraceSetEMPTY && !SegRGNSeg(seg)->free) {
+    Addr object = SegBase(seg);
+    Addr nextObject;
+    Addr limit;
+    Pool pool = SegPool(seg);
+
+    limit = SegBufferScanLimit(seg);
+
+    while (object < limit) {
+      (*f)(object, format, pool, p, s);
+      nextObject = (*format->skip)(object);
+      AVER(nextObject > object);
+      object = nextObject;
+    }
+    AVER(object == limit);
+  }
+}
+
+
+/* rgnCanResetInPlace -- can a region be reset by moving its buffer? */
+
+static Bool rgnCanResetInPlace(Buffer buffer)
+{
+  RGNBuf rgnbuf = MustBeA_CRITICAL(RGNBuf, buffer);
+  return !BufferIsReset(buffer)
+    && rgnbuf->segs == BufferSeg(buffer)
+    && rgnSegNext(rgnbuf->segs) == NULL;
+}
+
+
+/* RGNReset -- free all the objects in a region */
+
+static void RGNReset(Pool pool, Buffer buffer)
+{
+  RGN rgn = MustBeA(RGNPool, pool);
+
+  AVERT(Buffer, buffer);
+  AVER(BufferPool(buffer) == pool);
+  AVER(BufferIsReady(buffer));
+
+  /* .reset.light */
+  if (rgnCanResetInPlace(buffer) && !BufferIsTrapped(buffer)) {
+    BufferSetAllocAddr(buffer, BufferBase(buffer));
+    return;
+  }
+
+  if (!BufferIsReset(buffer))
+    BufferDetach(buffer, pool);
+  rgnFreeChain(rgn, buffer);
+}
+
+
+/* RGNTotalSize -- total memory allocated from the arena */
+
+static Size RGNTotalSize(Pool pool)
+{
+  Ring ring, node, nextNode;
+  Size total = 0;
+
+  AVERT(Pool, pool);
+
+  ring = &pool->segRing;
+  RING_FOR(node, ring, nextNode) {
+    Seg seg = SegOfPoolRing(node);
+    AVERT(Seg, seg);
+    total += SegSize(seg);
+  }
+
+  return total;
+}
+
+
+/* RGNFreeSize -- free memory (unused by client program) */
+
+static Size RGNFreeSize(Pool pool)
+{
+  RGN rgn = MustBeA(RGNPool, pool);
+  Seg seg;
+  Size free = 0;
+
+  seg = rgn->freeSegs;
+  while (seg != NULL) {
+    AVERT(Seg, seg);
+    free += SegSize(seg);
+    seg = rgnSegNext(seg);
+  }
+
+  return free;
+}
+
+
+/* RGNPoolClass -- the class definition */
+
+DEFINE_CLASS(Pool, RGNPool, klass)
+{
+  INHERIT_CLASS(klass, RGNPool, AbstractSegBufPool);
+  klass->instClassStruct.finish = RGNFinish;
+  klass->size = sizeof(RGNStruct);
+  klass->init = RGNInit;
+  klass->bufferFill = RGNBufferFill;
+  klass->bufferClass = RGNBufClassGet;
+  klass->totalSize = RGNTotalSize;
+  klass->freeSize = RGNFreeSize;
+  AVERT(PoolClass, klass);
+}
+
+
+mps_pool_class_t mps_class_rgn(void)
+{
+  return (mps_pool_class_t)CLASS(RGNPool);
+}
+
+
+/* mps_rgn_reset -- free all the objects allocated on an allocation point */
+
+mps_res_t mps_rgn_reset(mps_ap_t mps_ap)
+{
+  Buffer buf;
+  Pool pool;
+  Arena arena;
+
+  AVER(mps_ap != NULL);
+
+  /* Fail if between reserve & commit */
+  if ((char *)mps_ap->alloc != (char *)mps_ap->init)
+    return MPS_RES_FAIL;
+
+  buf = BufferOfAP(mps_ap);
+  AVER(TESTT(Buffer, buf));
+  pool = buf->pool;
+  AVER(TESTT(Pool, pool));
+
+  /* .reset.light */
+  if (BufferRankSet(buf) == RankSetEMPTY && !buf->zeroed
+      && BufferArena(buf)->sampleInterval == 0
+      && rgnCanResetInPlace(buf)) {
+    mps_ap->init = mps_ap->alloc = (mps_addr_t)BufferBase(buf);
+    return MPS_RES_OK;
+  }
+
+  arena = BufferArena(buf);
+  ArenaEnter(arena);
+  RGNReset(pool, buf);
+  ArenaLeave(arena);
+
+  return MPS_RES_OK;
+}
+
+
+/* RGNCheck -- check an RGN pool */
+
+ATTRIBUTE_UNUSED
+static Bool RGNCheck(RGN rgn)
+{
+  CHECKS(RGN, rgn);
+  CHECKC(RGNPool, rgn);
+  CHECKD(Pool, RGNPool(rgn));
+  CHECKL(rgn->extendBy > 0);
+  if (rgn->freeSegs != NULL) {
+    CHECKD(Seg, rgn->freeSegs);
+  }
+  return TRUE;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
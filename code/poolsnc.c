@@ -437,6 +437,7 @@ static Res SNCBufferFill(Addr *baseReturn, Addr *limitReturn,
   Res res;
   Seg seg;
   Size asize;           /* aligned size */
+  LocusPrefStruct pref;
 
   AVER(baseReturn != NULL);
   AVER(limitReturn != NULL);
@@ -456,8 +457,9 @@ static Res SNCBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* No free seg, so create a new one */
   arena = PoolArena(pool);
   asize = SizeArenaGrains(size, arena);
-  res = SegAlloc(&seg, CLASS(SNCSeg), LocusPrefDefault(),
-                 asize, pool, argsNone);
+  LocusPrefInit(&pref);
+  LocusPrefExpress(&pref, LocusPrefNODE, &BufferNode(buffer));
+  res = SegAlloc(&seg, CLASS(SNCSeg), &pref, asize, pool, argsNone);
   if (res != ResOK)
     return res;
 
@@ -257,6 +257,77 @@ Bool RangeInZoneSetLast(Addr *baseReturn, Addr *limitReturn,
 }
 
 
+/* ZoneSizeAdd, ZoneSizeSub -- account for a range in each zone
+ *
+ * zoneSize is an array of MPS_WORD_WIDTH sizes, one for each zone.
+ * ZoneSizeAdd adds to each zone the size of the part of [base, limit)
+ * that lies in that zone.  ZoneSizeSub subtracts, and returns the set
+ * of zones whose size fell to zero, so that they can be recycled.
+ * See <code/policy.c#zone.recycle>.
+ */
+
+static ZoneSet zoneSizeUpdate(Size zoneSize[MPS_WORD_WIDTH], Arena arena,
+                              Addr base, Addr limit, Bool add)
+{
+  ZoneSet emptied = ZoneSetEMPTY;
+  Shift cycleShift;
+  Index zone;
+
+  AVERT(Arena, arena);
+  AVER(zoneSize != NULL);
+  AVER(base < limit);
+
+  /* Every whole cycle through the zones adds a stripe to each zone. */
+  cycleShift = ArenaZoneShift(arena) + MPS_WORD_SHIFT;
+  if (cycleShift < MPS_WORD_WIDTH) {
+    Size cycles = AddrOffset(base, limit) >> cycleShift;
+    if (cycles > 0) {
+      Size each = cycles << ArenaZoneShift(arena);
+      for (zone = 0; zone < MPS_WORD_WIDTH; ++zone) {
+        if (add) {
+          zoneSize[zone] += each;
+        } else {
+          AVER(zoneSize[zone] >= each);
+          zoneSize[zone] -= each;
+          if (zoneSize[zone] == 0)
+            emptied = BS_ADD(ZoneSet, emptied, zone);
+        }
+      }
+      base = AddrAdd(base, cycles << cycleShift);
+    }
+  }
+
+  while (base < limit) {
+    Addr next = nextStripe(base, limit, arena);
+    Size size = AddrOffset(base, next);
+    zone = AddrZone(arena, base);
+    if (add) {
+      zoneSize[zone] += size;
+    } else {
+      AVER(zoneSize[zone] >= size);
+      zoneSize[zone] -= size;
+      if (zoneSize[zone] == 0)
+        emptied = BS_ADD(ZoneSet, emptied, zone);
+    }
+    base = next;
+  }
+
+  return emptied;
+}
+
+void ZoneSizeAdd(Size zoneSize[MPS_WORD_WIDTH], Arena arena,
+                 Addr base, Addr limit)
+{
+  (void)zoneSizeUpdate(zoneSize, arena, base, limit, TRUE);
+}
+
+ZoneSet ZoneSizeSub(Size zoneSize[MPS_WORD_WIDTH], Arena arena,
+                    Addr base, Addr limit)
+{
+  return zoneSizeUpdate(zoneSize, arena, base, limit, FALSE);
+}
+
+
 /* ZoneSetBlacklist() -- calculate a zone set of likely false positives
  *
  * We blacklist the zones that could be referenced by values likely to be
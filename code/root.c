@@ -35,6 +35,10 @@ typedef struct RootStruct {
   Addr protBase;                /* base of protectable area */
   Addr protLimit;               /* limit of protectable area */
   AccessSet pm;                 /* Protection Mode */
+  Size chunkSize;               /* size of protectable chunks */
+  Count chunks;                 /* number of protectable chunks */
+  RefSet *chunkSummary;         /* summary of each chunk, <design/root#.chunk> */
+  Bool exposedEnds;             /* parts of root outside protectable area? */
   RootVar var;                  /* union discriminator */
   union RootUnion {
     struct {
@@ -53,6 +57,11 @@ typedef struct RootStruct {
       mps_area_scan_t scan_area;/* area scanner for stack and registers */
       AreaScanUnion the;
       void *stackCold;          /* cold end of stack */
+      void *watermark;          /* stack colder than this is unchanged */
+      void *cachedBase;         /* base of stack with cached summary */
+      RefSet cachedSummary;     /* summary of cachedBase to stackCold */
+      ZoneSet cachedWhite;      /* white set for which cachedGens holds */
+      GenSet cachedGens;        /* generations referred to from cache */
     } thread;
     struct {
       mps_fmt_scan_t scan;      /* format-like scanner */
@@ -135,6 +144,11 @@ Bool RootCheck(Root root)
     /* Can't check anything about closure as it could mean anything to
        scan_area. */
     /* Can't check anything about stackCold. */
+    CHECKL(root->the.thread.watermark == NULL
+           || root->the.thread.watermark < root->the.thread.stackCold);
+    CHECKL(root->the.thread.cachedBase == NULL
+           || (root->the.thread.watermark != NULL
+               && root->the.thread.watermark <= root->the.thread.cachedBase));
     break;
 
   case RootTHREAD_TAGGED:
@@ -143,6 +157,11 @@ Bool RootCheck(Root root)
     /* Can't check anything about tag as it could mean anything to
        scan_area. */
     /* Can't check anything about stackCold. */
+    CHECKL(root->the.thread.watermark == NULL
+           || root->the.thread.watermark < root->the.thread.stackCold);
+    CHECKL(root->the.thread.cachedBase == NULL
+           || (root->the.thread.watermark != NULL
+               && root->the.thread.watermark <= root->the.thread.cachedBase));
     break;
 
   case RootFMT:
@@ -161,11 +180,21 @@ Bool RootCheck(Root root)
     CHECKL(root->protLimit != (Addr)0);
     CHECKL(root->protBase < root->protLimit);
     CHECKL(AccessSetCheck(root->pm));
+    CHECKL(root->chunkSize > 0);
+    CHECKL(SizeIsArenaGrains(root->chunkSize, root->arena));
+    CHECKL(root->chunks > 0);
+    CHECKL(root->chunks
+           == SizeAlignUp(AddrOffset(root->protBase, root->protLimit),
+                          root->chunkSize) / root->chunkSize);
+    CHECKL(root->chunkSummary != NULL);
   } else {
     CHECKL(root->protBase == (Addr)0);
     CHECKL(root->protLimit == (Addr)0);
     CHECKL(root->pm == (AccessSet)0);
+    CHECKL(root->chunks == 0);
+    CHECKL(root->chunkSummary == NULL);
   }
+  CHECKL(BoolCheck(root->exposedEnds));
   return TRUE;
 }
 
@@ -209,6 +238,10 @@ static Res rootCreate(Root *rootReturn, Arena arena,
   root->protectable = FALSE;
   root->protBase = (Addr)0;
   root->protLimit = (Addr)0;
+  root->chunkSize = (Size)0;
+  root->chunks = 0;
+  root->chunkSummary = NULL;
+  root->exposedEnds = FALSE;
 
   /* <design/arena#.root-ring> */
   RingInit(&root->arenaRing);
@@ -233,6 +266,8 @@ static Res rootCreateProtectable(Root *rootReturn, Arena arena,
   Res res;
   Root root;
   Ring node, next;
+  void *p;
+  Index i;
 
   res = rootCreate(&root, arena, rank, mode, var, theUnion);
   if (res != ResOK)
@@ -269,6 +304,34 @@ static Res rootCreateProtectable(Root *rootReturn, Arena arena,
     }
   }
 
+  /* Divide the protectable area into chunks, each with its own
+     summary and barrier. A root of formatted objects can't be scanned
+     piecemeal, so it has only one chunk. See <design/root#.chunk>. */
+  if (root->protectable) {
+    Size size = AddrOffset(root->protBase, root->protLimit);
+    Size chunkSize;
+    Count chunks;
+    if (var == RootFMT)
+      chunkSize = size;
+    else
+      chunkSize = SizeArenaGrains(ROOT_CHUNK_SIZE, arena);
+    chunks = SizeAlignUp(size, chunkSize) / chunkSize;
+    res = ControlAlloc(&p, arena, chunks * sizeof(RefSet));
+    if (res != ResOK) {
+      root->protectable = FALSE;
+      root->protBase = (Addr)0;
+      root->protLimit = (Addr)0;
+      RootDestroy(root);
+      return res;
+    }
+    root->chunkSize = chunkSize;
+    root->chunks = chunks;
+    root->chunkSummary = p;
+    for (i = 0; i < root->chunks; ++i)
+      root->chunkSummary[i] = RefSetUNIV;
+    root->exposedEnds = base < root->protBase || root->protLimit < limit;
+  }
+
   AVERT(Root, root);
 
   *rootReturn = root;
@@ -350,6 +413,11 @@ Res RootCreateThread(Root *rootReturn, Arena arena,
   theUnion.thread.scan_area = scan_area;
   theUnion.thread.the.closure = closure;
   theUnion.thread.stackCold = stackCold;
+  theUnion.thread.watermark = NULL;
+  theUnion.thread.cachedBase = NULL;
+  theUnion.thread.cachedSummary = RefSetUNIV;
+  theUnion.thread.cachedWhite = ZoneSetEMPTY;
+  theUnion.thread.cachedGens = GenSetUNIV;
 
   return rootCreate(rootReturn, arena, rank, (RootMode)0, RootTHREAD,
                     &theUnion);
@@ -377,6 +445,11 @@ Res RootCreateThreadTagged(Root *rootReturn, Arena arena,
   theUnion.thread.the.tag.mask = mask;
   theUnion.thread.the.tag.pattern = pattern;
   theUnion.thread.stackCold = stackCold;
+  theUnion.thread.watermark = NULL;
+  theUnion.thread.cachedBase = NULL;
+  theUnion.thread.cachedSummary = RefSetUNIV;
+  theUnion.thread.cachedWhite = ZoneSetEMPTY;
+  theUnion.thread.cachedGens = GenSetUNIV;
 
   return rootCreate(rootReturn, arena, rank, (RootMode)0, RootTHREAD_TAGGED,
                     &theUnion);
@@ -444,6 +517,14 @@ void RootDestroy(Root root)
   RingRemove(&root->arenaRing);
   RingFinish(&root->arenaRing);
 
+  /* Remove any barrier, so that the client program can reuse the
+     memory. */
+  if (root->pm != AccessSetEMPTY)
+    ProtSet(root->protBase, root->protLimit, AccessSetEMPTY);
+
+  if (root->chunkSummary != NULL)
+    ControlFree(arena, root->chunkSummary, root->chunks * sizeof(RefSet));
+
   root->sig = SigInvalid;
 
   ControlFree(arena, root, sizeof(RootStruct));
@@ -499,23 +580,242 @@ void RootGrey(Root root, Trace trace)
 }
 
 
+/* rootChunkBase, rootChunkLimit -- bounds of a chunk of a protectable root */
+
+static Addr rootChunkBase(Root root, Index i)
+{
+  AVER(i < root->chunks);
+  return AddrAdd(root->protBase, i * root->chunkSize);
+}
+
+static Addr rootChunkLimit(Root root, Index i)
+{
+  AVER(i < root->chunks);
+  if (i + 1 == root->chunks)
+    return root->protLimit;
+  return AddrAdd(root->protBase, (i + 1) * root->chunkSize);
+}
+
+
+/* rootChunkMode -- protection mode of a chunk of a protectable root
+ *
+ * A chunk needs a write barrier unless its summary is universal.
+ */
+
+static AccessSet rootChunkMode(Root root, Index i)
+{
+  AVER(i < root->chunks);
+  if (root->chunkSummary[i] == RefSetUNIV)
+    return AccessSetEMPTY;
+  return AccessWRITE;
+}
+
+
+/* rootScansChunks -- is the root scanned a chunk at a time? */
+
+static Bool rootScansChunks(Root root)
+{
+  return root->protectable
+    && (root->var == RootAREA || root->var == RootAREA_TAGGED);
+}
+
+
+/* rootUpdateSummary -- recalculate root summary from chunk summaries
+ *
+ * The summary of a protectable root is the union of the summaries of
+ * its chunks, except that if parts of the root lie outside the
+ * protectable area then the mutator can write references there
+ * without hitting a barrier, so the summary is universal.
+ */
+
+static void rootUpdateSummary(Root root)
+{
+  RefSet summary = RefSetEMPTY;
+  AccessSet pm = AccessSetEMPTY;
+  Index i;
+
+  AVER(root->protectable);
+
+  for (i = 0; i < root->chunks; ++i) {
+    summary = RefSetUnion(summary, root->chunkSummary[i]);
+    pm |= rootChunkMode(root, i);
+  }
+  if (root->exposedEnds)
+    summary = RefSetUNIV;
+  root->summary = summary;
+  root->pm = pm;
+}
+
+
 static void rootSetSummary(Root root, RefSet summary)
 {
+  Index i;
+
   AVERT(Root, root);
   /* Can't check summary */
   if (root->protectable) {
-    if (summary == RefSetUNIV) {
-      root->summary = summary;
-      root->pm &= ~AccessWRITE;
-    } else {
-      root->pm |= AccessWRITE;
-      root->summary = summary;
-    }
+    for (i = 0; i < root->chunks; ++i)
+      root->chunkSummary[i] = summary;
+    rootUpdateSummary(root);
   } else
     AVER(root->summary == RefSetUNIV);
 }
 
 
+/* rootScanArea -- scan an area root
+ *
+ * A protectable area root is scanned a chunk at a time. A chunk whose
+ * summary doesn't intersect the white set contains no references
+ * that need fixing, so it is skipped. See <design/root#.chunk.scan>.
+ */
+
+static Res rootScanArea(ScanState ss, Root root, void *closure)
+{
+  Addr base = (Addr)root->the.area.base;
+  Addr limit = (Addr)root->the.area.limit;
+  mps_area_scan_t scan_area = root->the.area.scan_area;
+  RefSet summary;
+  Index i;
+  Res res;
+
+  if (!root->protectable)
+    return TraceScanArea(ss, (Word *)base, (Word *)limit,
+                         scan_area, closure);
+
+  /* Parts of the root outside the protectable area are always
+     scanned. See <design/root#.chunk.inner>. */
+  if (base < root->protBase) {
+    res = TraceScanArea(ss, (Word *)base, (Word *)root->protBase,
+                        scan_area, closure);
+    if (res != ResOK)
+      return res;
+  }
+  if (root->protLimit < limit) {
+    res = TraceScanArea(ss, (Word *)root->protLimit, (Word *)limit,
+                        scan_area, closure);
+    if (res != ResOK)
+      return res;
+  }
+  summary = ScanStateSummary(ss);
+
+  for (i = 0; i < root->chunks; ++i) {
+    Addr chunkBase = rootChunkBase(root, i);
+    Addr chunkLimit = rootChunkLimit(root, i);
+    AccessSet mode = rootChunkMode(root, i);
+    if (chunkBase < base)
+      chunkBase = base;
+    if (limit < chunkLimit)
+      chunkLimit = limit;
+    AVER(chunkBase < chunkLimit);
+
+    if (RefSetInter(root->chunkSummary[i], ScanStateWhite(ss))
+        == RefSetEMPTY) {
+      STATISTIC(ss->skippedSize += AddrOffset(chunkBase, chunkLimit));
+    } else {
+      if (mode != AccessSetEMPTY)
+        ProtSet(rootChunkBase(root, i), rootChunkLimit(root, i),
+                AccessSetEMPTY);
+      ScanStateSetSummary(ss, RefSetEMPTY);
+      res = TraceScanArea(ss, (Word *)chunkBase, (Word *)chunkLimit,
+                          scan_area, closure);
+      if (res == ResOK)
+        root->chunkSummary[i] = ScanStateSummary(ss);
+      if (mode != AccessSetEMPTY || rootChunkMode(root, i) != AccessSetEMPTY)
+        ProtSet(rootChunkBase(root, i), rootChunkLimit(root, i),
+                rootChunkMode(root, i));
+      if (res != ResOK) {
+        rootUpdateSummary(root);
+        return res;
+      }
+    }
+    summary = RefSetUnion(summary, root->chunkSummary[i]);
+  }
+
+  ScanStateSetSummary(ss, summary);
+  return ResOK;
+}
+
+
+/* rootScanThread -- scan a thread root
+ *
+ * If the client program has published a watermark, the part of the
+ * stack colder than the watermark is unchanged since the watermark was
+ * published, so the summaries of that part are cached, and it is only
+ * scanned if they show that it might refer to the white set. See
+ * <design/root#.watermark>.
+ */
+
+static Res rootScanThread(ScanState ss, Root root, void *closure)
+{
+  void *stackCold = root->the.thread.stackCold;
+  void *watermark = root->the.thread.watermark;
+  void *cachedBase = root->the.thread.cachedBase;
+  mps_area_scan_t scan_area = root->the.thread.scan_area;
+  ZoneSet white = ScanStateWhite(ss);
+  RefSet summary;
+  ZoneSet cachedWhite;
+  GenSet gens, whiteGens, oldGens;
+  TraceId ti;
+  Trace trace;
+  Res res;
+
+  if (watermark != NULL) {
+    AVER(ScanStateUnfixedSummary(ss) == RefSetEMPTY);
+    whiteGens = GenSetEMPTY;
+    TRACE_SET_ITER(ti, trace, ss->traces, ss->arena)
+      whiteGens = GenSetUnion(whiteGens, trace->whiteGens);
+    TRACE_SET_ITER_END(ti, trace, ss->traces, ss->arena);
+    oldGens = ss->genSummary;
+    ss->genSummary = GenSetEMPTY;
+    if (cachedBase != NULL
+        && (RefSetInter(root->the.thread.cachedSummary, white)
+            == RefSetEMPTY
+            || (ZoneSetSub(white, root->the.thread.cachedWhite)
+                && GenSetInter(root->the.thread.cachedGens, whiteGens)
+                   == GenSetEMPTY))) {
+      /* The cached part of the stack can't refer to the white set. */
+      STATISTIC(ss->skippedSize += AddrOffset(cachedBase, stackCold));
+      summary = root->the.thread.cachedSummary;
+      cachedWhite = ZoneSetInter(root->the.thread.cachedWhite, white);
+      gens = root->the.thread.cachedGens;
+      if (watermark < cachedBase) {
+        /* Stack between the watermark and the cached part became
+           unchanged since the last scan: scan it and add it to the
+           cache. */
+        res = TraceScanArea(ss, watermark, cachedBase, scan_area, closure);
+        if (res != ResOK)
+          goto failScan;
+        summary = RefSetUnion(summary, ScanStateUnfixedSummary(ss));
+        gens = GenSetUnion(gens, ss->genSummary);
+      }
+    } else {
+      res = TraceScanArea(ss, watermark, stackCold, scan_area, closure);
+      if (res != ResOK)
+        goto failScan;
+      summary = ScanStateUnfixedSummary(ss);
+      cachedWhite = white;
+      gens = ss->genSummary;
+    }
+    /* .watermark.unfixed: Cache the summary of all the words scanned,
+       not ScanStateSummary, because an ambiguous reference to a white
+       zone that didn't point to an object might point to one later. */
+    root->the.thread.cachedBase = watermark;
+    root->the.thread.cachedSummary = summary;
+    root->the.thread.cachedWhite = cachedWhite;
+    root->the.thread.cachedGens = gens;
+    ss->genSummary = GenSetUnion(oldGens, ss->genSummary);
+    stackCold = watermark;
+  }
+
+  return ThreadScan(ss, root->the.thread.thread, stackCold,
+                    scan_area, closure);
+
+failScan:
+  ss->genSummary = GenSetUnion(oldGens, ss->genSummary);
+  return res;
+}
+
+
 /* RootScan -- scan root */
 
 Res RootScan(ScanState ss, Root root)
@@ -531,27 +831,20 @@ Res RootScan(ScanState ss, Root root)
 
   AVER(ScanStateSummary(ss) == RefSetEMPTY);
 
-  if (root->pm != AccessSetEMPTY) {
+  /* Roots scanned a chunk at a time manage their own protection. */
+  if (root->pm != AccessSetEMPTY && !rootScansChunks(root)) {
     ProtSet(root->protBase, root->protLimit, AccessSetEMPTY);
   }
 
   switch(root->var) {
   case RootAREA:
-    res = TraceScanArea(ss,
-                        root->the.area.base,
-                        root->the.area.limit,
-                        root->the.area.scan_area,
-                        root->the.area.the.closure);
+    res = rootScanArea(ss, root, root->the.area.the.closure);
     if (res != ResOK)
       goto failScan;
     break;
 
   case RootAREA_TAGGED:
-    res = TraceScanArea(ss,
-                        root->the.area.base,
-                        root->the.area.limit,
-                        root->the.area.scan_area,
-                        &root->the.area.the.tag);
+    res = rootScanArea(ss, root, &root->the.area.the.tag);
     if (res != ResOK)
       goto failScan;
     break;
@@ -565,19 +858,13 @@ Res RootScan(ScanState ss, Root root)
     break;
 
   case RootTHREAD:
-    res = ThreadScan(ss, root->the.thread.thread,
-                     root->the.thread.stackCold,
-                     root->the.thread.scan_area,
-                     root->the.thread.the.closure);
+    res = rootScanThread(ss, root, root->the.thread.the.closure);
     if (res != ResOK)
       goto failScan;
     break;
 
   case RootTHREAD_TAGGED:
-    res = ThreadScan(ss, root->the.thread.thread,
-                     root->the.thread.stackCold,
-                     root->the.thread.scan_area,
-                     &root->the.thread.the.tag);
+    res = rootScanThread(ss, root, &root->the.thread.the.tag);
     if (res != ResOK)
       goto failScan;
     break;
@@ -597,11 +884,14 @@ Res RootScan(ScanState ss, Root root)
 
   AVER(res == ResOK);
   root->grey = TraceSetDiff(root->grey, ss->traces);
-  rootSetSummary(root, ScanStateSummary(ss));
+  if (rootScansChunks(root))
+    rootUpdateSummary(root);
+  else
+    rootSetSummary(root, ScanStateSummary(ss));
   EVENT3(RootScan, root, ss->traces, ScanStateSummary(ss));
 
 failScan:
-  if (root->pm != AccessSetEMPTY) {
+  if (root->pm != AccessSetEMPTY && !rootScansChunks(root)) {
     ProtSet(root->protBase, root->protLimit, root->pm);
   }
 
@@ -609,6 +899,37 @@ failScan:
 }
 
 
+/* RootSetWatermark -- publish the stack watermark of a thread root
+ *
+ * The client program guarantees that the part of the thread's stack
+ * between the watermark and the cold end does not change until the
+ * watermark is next set. See <design/root#.watermark>.
+ */
+
+void RootSetWatermark(Root root, void *watermark)
+{
+  AVERT(Root, root);
+  AVER(root->var == RootTHREAD || root->var == RootTHREAD_TAGGED);
+  AVER(watermark == NULL || watermark < root->the.thread.stackCold);
+  AVER(AddrIsAligned(watermark, sizeof(Word)));
+
+  if (watermark == NULL) {
+    /* No guarantee any more, so forget the cached summary. */
+    root->the.thread.cachedBase = NULL;
+    root->the.thread.cachedSummary = RefSetUNIV;
+    root->the.thread.cachedWhite = ZoneSetEMPTY;
+    root->the.thread.cachedGens = GenSetUNIV;
+  } else if (root->the.thread.cachedBase != NULL
+             && root->the.thread.cachedBase < watermark) {
+    /* Stack between the old and new watermarks may change from now
+       on, but it is covered by the cached summary of the colder part,
+       which is still valid. */
+    root->the.thread.cachedBase = watermark;
+  }
+  root->the.thread.watermark = watermark;
+}
+
+
 /* RootOfAddr -- return the root at addr
  *
  * Returns TRUE if the addr is in a root (and returns the root in
@@ -635,20 +956,34 @@ Bool RootOfAddr(Root *rootReturn, Arena arena, Addr addr)
 }
 
 
-/* RootAccess -- handle barrier hit on root */
+/* RootAccess -- handle barrier hit on root
+ *
+ * Only the chunk containing addr loses its summary and barrier. See
+ * <design/root#.chunk.access>.
+ */
 
-void RootAccess(Root root, AccessSet mode)
+void RootAccess(Root root, Addr addr, AccessSet mode)
 {
+  Index i;
+
   AVERT(Root, root);
   AVERT(AccessSet, mode);
   AVER((root->pm & mode) != AccessSetEMPTY);
   AVER(mode == AccessWRITE); /* only write protection supported */
+  AVER(root->protBase <= addr);
+  AVER(addr < root->protLimit);
+
+  i = AddrOffset(root->protBase, addr) / root->chunkSize;
+  if (rootChunkMode(root, i) == AccessSetEMPTY)
+    return; /* barrier already removed, for example by another thread */
 
-  rootSetSummary(root, RefSetUNIV);
+  root->chunkSummary[i] = RefSetUNIV;
+  rootUpdateSummary(root);
 
   /* Access must now be allowed. */
-  AVER((root->pm & mode) == AccessSetEMPTY);
-  ProtSet(root->protBase, root->protLimit, root->pm);
+  AVER((rootChunkMode(root, i) & mode) == AccessSetEMPTY);
+  ProtSet(rootChunkBase(root, i), rootChunkLimit(root, i),
+          rootChunkMode(root, i));
 }
 
 
@@ -697,6 +1032,8 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
                "  protectable $S", WriteFYesNo(root->protectable),
                "  protBase $A", (WriteFA)root->protBase,
                "  protLimit $A", (WriteFA)root->protLimit,
+               "  chunkSize $W", (WriteFW)root->chunkSize,
+               "  chunks $U", (WriteFU)root->chunks,
                "  pm",
                root->pm == AccessSetEMPTY ? " EMPTY" : "",
                root->pm & AccessREAD ? " READ" : "",
@@ -746,6 +1083,14 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
                  "closure $P\n",
                  (WriteFP)root->the.thread.the.closure,
                  "stackCold $P\n", (WriteFP)root->the.thread.stackCold,
+                 "watermark $P\n", (WriteFP)root->the.thread.watermark,
+                 "cachedBase $P\n", (WriteFP)root->the.thread.cachedBase,
+                 "cachedSummary $B\n",
+                 (WriteFB)root->the.thread.cachedSummary,
+                 "cachedWhite $B\n",
+                 (WriteFB)root->the.thread.cachedWhite,
+                 "cachedGens $B\n",
+                 (WriteFB)root->the.thread.cachedGens,
                  NULL);
     if (res != ResOK)
       return res;
@@ -757,6 +1102,14 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
                  "mask $B\n", (WriteFB)root->the.thread.the.tag.mask,
                  "pattern $B\n", (WriteFB)root->the.thread.the.tag.pattern,
                  "stackCold $P\n", (WriteFP)root->the.thread.stackCold,
+                 "watermark $P\n", (WriteFP)root->the.thread.watermark,
+                 "cachedBase $P\n", (WriteFP)root->the.thread.cachedBase,
+                 "cachedSummary $B\n",
+                 (WriteFB)root->the.thread.cachedSummary,
+                 "cachedWhite $B\n",
+                 (WriteFB)root->the.thread.cachedWhite,
+                 "cachedGens $B\n",
+                 (WriteFB)root->the.thread.cachedGens,
                  NULL);
     if (res != ResOK)
       return res;
@@ -0,0 +1,212 @@
+/* roottest.c: PROTECTABLE ROOT TEST
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: Registers large protectable roots, of which only the first
+ * quarter is written while objects are allocated in an AMC pool and
+ * collected, and checks that the roots are scanned correctly. See
+ * <design/root#.chunk>.
+ *
+ * .table: A table root, protected with MPS_RM_PROT_INNER, whose
+ * entries are checked after each collection.
+ *
+ * .area: An area root, whose scanning function counts the bytes it is
+ * asked to scan. The last three quarters are not written after they
+ * are filled, so their chunks should be skipped by collections that
+ * don't condemn the objects they refer to.
+ *
+ * .destroy: When the roots are destroyed, the client writes to them
+ * again. If their barriers were left in place, this would fault.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* free, malloc */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define rootsCOUNT        ((size_t)1 << 15)
+#define rootsSPREAD       1024
+#define objectsCOUNT      200000
+#define checkFREQ         1000
+#define avLEN             3
+#define genCOUNT          2
+
+/* objNULL needs to be odd so that it's ignored in the roots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 150, 0.85 }, { 170, 0.45 } };
+
+static mps_addr_t *tableRoots;  /* .table */
+static mps_addr_t *areaRoots;   /* .area */
+static size_t areaScanned;      /* bytes of areaRoots scanned */
+
+
+/* area_scan -- scan part of the area root, counting the bytes */
+
+static mps_res_t area_scan(mps_ss_t ss, void *base, void *limit,
+                           void *closure)
+{
+  Insist((mps_addr_t *)base >= areaRoots);
+  Insist((mps_addr_t *)limit <= areaRoots + rootsCOUNT);
+  areaScanned += (size_t)((char *)limit - (char *)base);
+  return mps_scan_area_tagged(ss, base, limit, closure);
+}
+
+
+/* make -- create one new object referring to the table root */
+
+static mps_addr_t make(mps_ap_t ap)
+{
+  size_t length = rnd() % (avLEN * 2);
+  mps_addr_t p;
+  die(dylan_alloc(&p, ap, (length + 2) * sizeof(mps_word_t),
+                  tableRoots, rootsCOUNT / 4),
+      "dylan_alloc");
+  return p;
+}
+
+
+/* check_roots -- check every object referred to by the roots */
+
+static void check_roots(mps_arena_t arena, mps_addr_t *roots)
+{
+  size_t i;
+  for (i = 0; i < rootsCOUNT; ++i)
+    cdie(roots[i] == objNULL
+         || (dylan_check(roots[i]) && mps_arena_has_addr(arena, roots[i])),
+         "roots check");
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_thr_t thread;
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t tableRoot, areaRoot;
+  mps_ap_t ap;
+  mps_scan_tag_s tag = {1, 0};
+  mps_word_t collections;
+  size_t i;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
+      "arena_create");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+
+  tableRoots = malloc(rootsCOUNT * sizeof tableRoots[0]);
+  areaRoots = malloc(rootsCOUNT * sizeof areaRoots[0]);
+  cdie(tableRoots != NULL && areaRoots != NULL, "malloc");
+  for (i = 0; i < rootsCOUNT; ++i)
+    tableRoots[i] = areaRoots[i] = objNULL;
+  die(mps_root_create_table_masked(&tableRoot, arena, mps_rank_exact(),
+                                   MPS_RM_PROT | MPS_RM_PROT_INNER,
+                                   tableRoots, rootsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table");
+  die(mps_root_create_area(&areaRoot, arena, mps_rank_exact(),
+                           MPS_RM_PROT, areaRoots, areaRoots + rootsCOUNT,
+                           area_scan, &tag),
+      "root_create_area");
+
+  /* Fill the roots sparsely, including the last entry, which may be
+     on a page that is only partly covered by the table. */
+  for (i = 0; i < rootsCOUNT; i += rootsSPREAD)
+    tableRoots[i] = areaRoots[i] = make(ap);
+  tableRoots[rootsCOUNT - 1] = make(ap);
+
+  /* Then only write the first quarter. */
+  collections = mps_collections(arena);
+  areaScanned = 0;
+  for (i = 0; i < objectsCOUNT; ++i) {
+    size_t r = (size_t)rnd() % (rootsCOUNT / 4);
+    mps_addr_t p = make(ap);
+    if (r % 2 == 0)
+      tableRoots[r] = p;
+    else
+      areaRoots[r] = p;
+    if (i % checkFREQ == 0) {
+      check_roots(arena, tableRoots);
+      check_roots(arena, areaRoots);
+    }
+  }
+
+  mps_arena_park(arena);
+  check_roots(arena, tableRoots);
+  check_roots(arena, areaRoots);
+  collections = mps_collections(arena) - collections;
+  printf("%lu collections scanned %lu bytes of a %lu byte area root\n",
+         (unsigned long)collections, (unsigned long)areaScanned,
+         (unsigned long)(rootsCOUNT * sizeof areaRoots[0]));
+  Insist(collections > 1);
+  Insist(areaScanned < collections * rootsCOUNT * sizeof areaRoots[0]);
+
+  mps_root_destroy(areaRoot);
+  mps_root_destroy(tableRoot);
+  for (i = 0; i < rootsCOUNT; ++i) /* .destroy */
+    tableRoots[i] = areaRoots[i] = objNULL;
+  free(areaRoots);
+  free(tableRoots);
+
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
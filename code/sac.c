@@ -7,9 +7,14 @@
 #include "mpm.h"
 #include "sac.h"
 
+#include <limits.h> /* for UCHAR_MAX */
+
 SRCID(sac, "$Id$");
 
 
+ARG_DEFINE_KEY(SAC_LOOKUP_LIMIT, Size);
+
+
 typedef _mps_sac_freelist_block_s *SACFreeListBlock;
 
 
@@ -67,6 +72,16 @@ static Bool SACCheck(SAC sac)
   CHECKL(sac->classesCount > sac->middleIndex);
   CHECKL(BoolCheck(esac->_trapped));
   CHECKL(esac->_middle > 0);
+  if (sac->lookupCount == 0) {
+    CHECKL(esac->_lookup_limit == 0);
+    CHECKL(esac->_lookup == NULL);
+  } else {
+    CHECKL(sac->lookupCount <= SAC_LOOKUP_MAX);
+    CHECKL(esac->_lookup != NULL);
+    CHECKL((Size)1 << esac->_lookup_shift == PoolAlignment(sac->pool));
+    CHECKL(esac->_lookup_limit
+           == (Size)sac->lookupCount << esac->_lookup_shift);
+  }
   /* check classes above middle */
   prevSize = esac->_middle;
   SAC_LARGE_ITER(sac->middleIndex, sac->classesCount, i, j) {
@@ -117,10 +132,55 @@ static Size sacSize(Index middleIndex, Count classesCount)
 }
 
 
+/* sacFind -- find the index corresponding to size
+ *
+ * .find: This function replicates the loop in _MPS_SAC_FIND, only with
+ * added checks.  It always walks the free lists, so that it can be used
+ * to build the lookup table, and checks that the table agrees.
+ */
+
+static void sacFind(Index *iReturn, Size *blockSizeReturn,
+                    SAC sac, Size size)
+{
+  Index i, j;
+  mps_sac_t esac;
+  _mps_sac_freelist_block_s *freelists;
+
+  esac = ExternalSACOfSAC(sac);
+  /* Index the free lists through a pointer: the array is declared
+     with fewer entries than a cache with many classes uses, so the
+     compiler may otherwise assume that i is small. */
+  freelists = esac->_freelists;
+  if (size > esac->_middle) {
+    i = 0; j = sac->middleIndex + 1;
+    AVER(j <= sac->classesCount);
+    while (size > freelists[i]._size) {
+      AVER(j < sac->classesCount);
+      i += 2; ++j;
+    }
+    *blockSizeReturn = freelists[i]._size;
+  } else {
+    Size prevSize = esac->_middle;
+
+    i = 1; j = sac->middleIndex;
+    while (size <= freelists[i]._size) {
+      AVER(j > 0);
+      prevSize = freelists[i]._size;
+      i += 2; --j;
+    }
+    *blockSizeReturn = prevSize;
+  }
+  AVER(size - 1 >= esac->_lookup_limit
+       || esac->_lookup[(size - 1) >> esac->_lookup_shift] == i);
+  *iReturn = i;
+}
+
+
+
 /* SACCreate -- create an SAC object */
 
 Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
-              SACClasses classes)
+              SACClasses classes, ArgList args)
 {
   void *p;
   SAC sac;
@@ -130,10 +190,18 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
   Size prevSize;
   unsigned totalFreq = 0;
   mps_sac_t esac;
+  Size lookupLimit = 0;
+  Count lookupCount;
+  Shift shift;
+  ArgStruct arg;
 
   AVER(sacReturn != NULL);
   AVERT(Pool, pool);
   AVER(classesCount > 0);
+  AVERT(ArgList, args);
+
+  if (ArgPick(&arg, args, MPS_KEY_SAC_LOOKUP_LIMIT))
+    lookupLimit = arg.val.size;
   /* In this cache type, there is no upper limit on classesCount. */
   prevSize = sizeof(Addr) - 1; /* must large enough for freelist link */
   /* @@@@ It would be better to dynamically adjust the smallest class */
@@ -204,11 +272,50 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
   sac->pool = pool;
   sac->classesCount = classesCount;
   sac->middleIndex = middleIndex;
+  sac->lookupCount = 0;
+  esac->_lookup_limit = 0;
+  esac->_lookup_shift = 0;
+  esac->_lookup = NULL;
   sac->sig = SACSig;
+
+  /* .lookup: Build the size-to-class table, which has one entry for
+     each pool alignment unit of size up to the limit.  All the sizes
+     that share an entry round up to the same class, because the class
+     sizes are aligned.  There's no point going past the largest class,
+     and the entries are bytes, so a cache with too many classes can't
+     have a table. */
+  shift = SizeLog2(PoolAlignment(pool));
+  if (lookupLimit > classes[classesCount - 1].mps_block_size)
+    lookupLimit = classes[classesCount - 1].mps_block_size;
+  lookupCount = (lookupLimit >> shift)
+                + ((lookupLimit & (PoolAlignment(pool) - 1)) != 0);
+  if (lookupCount > SAC_LOOKUP_MAX)
+    lookupCount = SAC_LOOKUP_MAX;
+  if (lookupCount > 0 && 2 * classesCount <= UCHAR_MAX) {
+    unsigned char *lookup;
+    Size blockSize;
+
+    res = ControlAlloc(&p, PoolArena(pool), lookupCount);
+    if (res != ResOK)
+      goto failLookupAlloc;
+    lookup = p;
+    for (i = 0; i < lookupCount; ++i) {
+      sacFind(&j, &blockSize, sac, (Size)(i + 1) << shift);
+      lookup[i] = (unsigned char)j;
+    }
+    sac->lookupCount = lookupCount;
+    esac->_lookup_shift = (unsigned)shift;
+    esac->_lookup = lookup;
+    esac->_lookup_limit = (Size)lookupCount << shift;
+  }
+
   AVERT(SAC, sac);
   *sacReturn = sac;
   return ResOK;
 
+failLookupAlloc:
+  sac->sig = SigInvalid;
+  ControlFree(PoolArena(pool), sac, sacSize(middleIndex, classesCount));
 failSACAlloc:
   return res;
 }
@@ -220,48 +327,15 @@ void SACDestroy(SAC sac)
 {
   AVERT(SAC, sac);
   SACFlush(sac);
+  if (sac->lookupCount > 0)
+    ControlFree(PoolArena(sac->pool), ExternalSACOfSAC(sac)->_lookup,
+                sac->lookupCount);
   sac->sig = SigInvalid;
   ControlFree(PoolArena(sac->pool), sac,
               sacSize(sac->middleIndex, sac->classesCount));
 }
 
 
-/* sacFind -- find the index corresponding to size
- *
- * This function replicates the loop in MPS_SAC_ALLOC_FAST, only with
- * added checks.
- */
-
-static void sacFind(Index *iReturn, Size *blockSizeReturn,
-                    SAC sac, Size size)
-{
-  Index i, j;
-  mps_sac_t esac;
-
-  esac = ExternalSACOfSAC(sac);
-  if (size > esac->_middle) {
-    i = 0; j = sac->middleIndex + 1;
-    AVER(j <= sac->classesCount);
-    while (size > esac->_freelists[i]._size) {
-      AVER(j < sac->classesCount);
-      i += 2; ++j;
-    }
-    *blockSizeReturn = esac->_freelists[i]._size;
-  } else {
-    Size prevSize = esac->_middle;
-
-    i = 1; j = sac->middleIndex;
-    while (size <= esac->_freelists[i]._size) {
-      AVER(j > 0);
-      prevSize = esac->_freelists[i]._size;
-      i += 2; --j;
-    }
-    *blockSizeReturn = prevSize;
-  }
-  *iReturn = i;
-}
-
-
 /* SACFill -- alloc an object, and perhaps fill the cache */
 
 Res SACFill(Addr *p_o, SAC sac, Size size)
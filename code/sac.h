@@ -25,6 +25,7 @@ typedef struct SACStruct {
   Pool pool;
   Count classesCount;  /* number of classes */
   Index middleIndex;   /* index of the middle */
+  Count lookupCount;   /* entries in esac_s._lookup, or zero */
   _mps_sac_s esac_s;   /* variable length, must be last */
 } SACStruct;
 
@@ -42,7 +43,7 @@ typedef struct mps_sac_classes_s *SACClasses;
 
 
 extern Res SACCreate(SAC *sac_o, Pool pool, Count classesCount,
-                     SACClasses classes);
+                     SACClasses classes, ArgList args);
 extern void SACDestroy(SAC sac);
 extern Res SACFill(Addr *p_o, SAC sac, Size size);
 extern void SACEmpty(SAC sac, Addr p, Size size);
@@ -0,0 +1,230 @@
+/* sacbench.c -- Benchmark for segregated allocation caches
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * This times the fast path of MPS_SAC_ALLOC and MPS_SAC_FREE, with
+ * and without a size-to-class lookup table (see
+ * MPS_KEY_SAC_LOOKUP_LIMIT). Each iteration allocates and then frees
+ * a fixed random sequence of sizes that all fit in the classes of the
+ * cache, which hold one alignment unit each. The cache is big enough
+ * to hold all the blocks, so once it is warm only the fast path is
+ * exercised. For example, to compare 8 and 32 classes:
+ *
+ *   make -f lii6gc.gmk VARIETY=hot sacbench
+ *   lii6gc/hot/sacbench -c 8 walk table
+ *   lii6gc/hot/sacbench -c 32 walk table
+ */
+
+#include "mps.c"
+
+#include "testlib.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, malloc, EXIT_SUCCESS, EXIT_FAILURE */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+#define classesMAX 32
+
+static rnd_state_t seed = 0;      /* random number seed */
+static unsigned niter = 1000;     /* iterations */
+static size_t nblocks = 1024;     /* blocks allocated per iteration */
+static size_t nclasses = 8;       /* classes in the cache */
+
+static mps_arena_t arena;
+static size_t *sizes;             /* size of each block */
+static mps_addr_t *blocks;        /* the blocks */
+
+
+/* bench -- allocate and free the blocks on a cache */
+
+static void bench(const char *name, size_t limit)
+{
+  mps_pool_t pool;
+  mps_sac_t sac;
+  mps_sac_class_s classes[classesMAX];
+  size_t align = sizeof(void *);
+  clock_t start, finish;
+  unsigned i;
+  size_t j;
+
+  for (j = 0; j < nclasses; ++j) {
+    classes[j].mps_block_size = (j + 1) * align;
+    classes[j].mps_cached_count = nblocks;
+    classes[j].mps_frequency = 1;
+  }
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    die(mps_pool_create_k(&pool, arena, mps_class_mvff(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_SAC_LOOKUP_LIMIT, limit);
+    die(mps_sac_create_k(&sac, pool, nclasses, classes, args),
+        "sac_create");
+  } MPS_ARGS_END(args);
+
+  start = clock();
+  for (i = 0; i < niter; ++i) {
+    for (j = 0; j < nblocks; ++j) {
+      mps_res_t res;
+      MPS_SAC_ALLOC_FAST(res, blocks[j], sac, sizes[j], FALSE);
+      if (res != MPS_RES_OK)
+        die(res, "MPS_SAC_ALLOC_FAST");
+    }
+    for (j = 0; j < nblocks; ++j)
+      MPS_SAC_FREE_FAST(sac, blocks[j], sizes[j]);
+  }
+  finish = clock();
+
+  printf("%s: %lu classes: %g\n", name, (unsigned long)nclasses,
+         (double)(finish - start) / CLOCKS_PER_SEC);
+
+  mps_sac_destroy(sac);
+  mps_pool_destroy(pool);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"niter",            required_argument, NULL, 'i'},
+  {"blocks",           required_argument, NULL, 'b'},
+  {"classes",          required_argument, NULL, 'c'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  size_t j;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hi:b:c:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'i':
+      niter = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'b':
+      nblocks = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      nclasses = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...] [test...]\n"
+              "Options:\n"
+              "  -i n, --niter=n\n"
+              "    Iterate each test n times (default %u)\n"
+              "  -b n, --blocks=n\n"
+              "    Number of blocks allocated per iteration (default %lu)\n"
+              "  -c n, --classes=n\n"
+              "    Number of classes in the cache, at most %d (default %lu)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              niter,
+              (unsigned long)nblocks,
+              classesMAX,
+              (unsigned long)nclasses);
+      fprintf(stderr,
+              "Tests:\n"
+              "  walk      find the size class by walking the freelists\n"
+              "  table     find the size class in a lookup table\n");
+      return EXIT_FAILURE;
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (nclasses == 0 || nclasses > classesMAX || nblocks == 0) {
+    fprintf(stderr, "Bad classes %lu or blocks %lu\n",
+            (unsigned long)nclasses, (unsigned long)nblocks);
+    return EXIT_FAILURE;
+  }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  rnd_state_set(seed);
+  sizes = malloc(nblocks * sizeof sizes[0]);
+  blocks = malloc(nblocks * sizeof blocks[0]);
+  if (sizes == NULL || blocks == NULL) {
+    fprintf(stderr, "Couldn't allocate %lu blocks\n",
+            (unsigned long)nblocks);
+    return EXIT_FAILURE;
+  }
+  for (j = 0; j < nblocks; ++j)
+    sizes[j] = rnd() % (nclasses * sizeof(void *)) + 1;
+
+  die(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none),
+      "arena_create");
+
+  while (argc > 0) {
+    if (strcmp(argv[0], "walk") == 0)
+      bench("walk", 0);
+    else if (strcmp(argv[0], "table") == 0)
+      bench("table", nclasses * sizeof(void *));
+    else {
+      fprintf(stderr, "unknown test \"%s\"\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+    --argc;
+    ++argv;
+  }
+
+  mps_arena_destroy(arena);
+  free(blocks);
+  free(sizes);
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
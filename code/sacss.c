@@ -68,8 +68,13 @@ static mps_res_t stress(mps_arena_t arena, mps_align_t align,
   if (res != MPS_RES_OK)
     return res;
 
-  die(mps_sac_create(&sac, pool, classes_count, classes),
-      "SACCreate");
+  MPS_ARGS_BEGIN(sac_args) {
+    /* Half the time, look small sizes up in a table. */
+    if (rnd() % 2)
+      MPS_ARGS_ADD(sac_args, MPS_KEY_SAC_LOOKUP_LIMIT, rnd() % 0x2000);
+    die(mps_sac_create_k(&sac, pool, classes_count, classes, sac_args),
+        "SACCreate");
+  } MPS_ARGS_END(sac_args);
 
   /* allocate a load of objects */
   for (i = 0; i < testSetSIZE; ++i) {
@@ -63,6 +63,7 @@ Res SegAlloc(Seg *segReturn, SegClass klass, LocusPref pref,
   res = SegInit(seg, klass, pool, base, size, args);
   if (res != ResOK)
     goto failInit;
+  seg->zeroed = ArenaZeroed(arena, base, AddrAdd(base, size));
 
   EVENT5(SegAlloc, arena, seg, SegBase(seg), size, pool);
   *segReturn = seg;
@@ -132,6 +133,8 @@ static Res segAbsInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   seg->defer = WB_DEFER_INIT;
   seg->depth = 0;
   seg->queued = FALSE;
+  seg->zeroed = FALSE;
+  seg->frozen = FALSE;
   seg->firstTract = NULL;
   RingInit(SegPoolRing(seg));
 
@@ -297,6 +300,20 @@ void SegSetRankSet(Seg seg, RankSet rankSet)
 }
 
 
+/* segForgetGenSummary -- discard the generation summary of a segment
+ *
+ * Any change to the summary means that references may have been
+ * written or updated, so the generation summary is no longer valid.
+ * This happens even if the summary itself doesn't change.
+ */
+
+static void segForgetGenSummary(Seg seg)
+{
+  if (IsA(GCSeg, seg))
+    SegGCSeg(seg)->genWhite = ZoneSetEMPTY;
+}
+
+
 /* SegSetSummary -- change the summary on a segment */
 
 void SegSetSummary(Seg seg, RefSet summary)
@@ -310,11 +327,48 @@ void SegSetSummary(Seg seg, RefSet summary)
   summary = RefSetUNIV;
 #endif
 
+  segForgetGenSummary(seg);
   if (summary != SegSummary(seg))
     Method(Seg, seg, setSummary)(seg, summary);
 }
 
 
+/* SegSetGenSummary -- record the generations a segment refers to
+ *
+ * Called after a total scan of the segment with white set white,
+ * during which the references that passed the zone check referred
+ * only to the generations in genSummary. See <code/trace.c#gen.summary>.
+ */
+
+void SegSetGenSummary(Seg seg, ZoneSet white, GenSet genSummary)
+{
+  GCSeg gcseg = SegGCSeg(seg);
+
+  /* Without the write barrier, the mutator could store references
+     that we would never see. */
+  if (SegSummary(seg) == RefSetUNIV)
+    return;
+
+  gcseg->genSummary = genSummary;
+  gcseg->genWhite = white;
+}
+
+
+/* SegGenSummaryExcludes -- segment has no references to generations?
+ *
+ * Returns TRUE if the generation summary of the segment proves that
+ * it has no references into the generations gens, given that the
+ * white set is white. See <code/trace.c#gen.summary>.
+ */
+
+Bool SegGenSummaryExcludes(Seg seg, ZoneSet white, GenSet gens)
+{
+  GCSeg gcseg = SegGCSeg(seg);
+  return ZoneSetSub(white, gcseg->genWhite)
+    && GenSetInter(gcseg->genSummary, gens) == GenSetEMPTY;
+}
+
+
 /* SegSetRankAndSummary -- set both the rank set and the summary */
 
 void SegSetRankAndSummary(Seg seg, RankSet rankSet, RefSet summary)
@@ -328,6 +382,7 @@ void SegSetRankAndSummary(Seg seg, RankSet rankSet, RefSet summary)
   }
 #endif
 
+  segForgetGenSummary(seg);
   Method(Seg, seg, setRankSummary)(seg, rankSet, summary);
 }
 
@@ -399,6 +454,9 @@ Bool SegBufferFill(Addr *baseReturn, Addr *limitReturn, Seg seg, Size size,
   AVERT(Seg, seg);
   AVER(size > 0);
   AVERT(RankSet, rankSet);
+  /* Frozen segments are not allocated in. See <design/seg#.frozen>. */
+  if (SegFrozen(seg))
+    return FALSE;
   return Method(Seg, seg, bufferFill)(baseReturn, limitReturn,
                                       seg, size, rankSet);
 }
@@ -448,6 +506,7 @@ static Res segAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                BS_IS_MEMBER(seg->rankSet, RankFINAL) ? " FINAL" : "",
                BS_IS_MEMBER(seg->rankSet, RankWEAK)  ? " WEAK"  : "",
                "\n",
+               seg->frozen ? "frozen\n" : "",
                NULL);
   if (res != ResOK)
     return res;
@@ -735,6 +794,60 @@ Res SegWhiten(Seg seg, Trace trace)
 }
 
 
+/* SegFreeze -- make a segment permanently black
+ *
+ * A frozen segment is never condemned, scanned, or protected by a
+ * write barrier, and is not allocated in, until it is thawed. Its
+ * summary is empty, recording the client program's promise that the
+ * segment has no references to objects that might be condemned. See
+ * <design/seg#.frozen>.
+ */
+
+Res SegFreeze(Seg seg)
+{
+  Res res;
+
+  AVERT(Seg, seg);
+  AVER(SegWhite(seg) == TraceSetEMPTY);
+  AVER(SegGrey(seg) == TraceSetEMPTY);
+  AVER(SegNailed(seg) == TraceSetEMPTY);
+  AVER(!SegHasBuffer(seg));
+
+  if (SegFrozen(seg))
+    return ResOK;
+
+  /* Give the pool the opportunity to account for the objects in the
+     segment as old, as it would when condemning it. */
+  res = Method(Seg, seg, freeze)(seg);
+  if (res != ResOK)
+    return res;
+
+  seg->frozen = TRUE;
+  if (SegRankSet(seg) != RankSetEMPTY)
+    SegSetSummary(seg, RefSetEMPTY); /* also lowers the write barrier */
+  return ResOK;
+}
+
+
+/* SegThaw -- make a frozen segment collectable again
+ *
+ * The client program may have written references to the segment while
+ * it was frozen, so its summary becomes universal, and it will be
+ * scanned by the next trace.
+ */
+
+void SegThaw(Seg seg)
+{
+  AVERT(Seg, seg);
+
+  if (!SegFrozen(seg))
+    return;
+  seg->frozen = FALSE;
+  if (SegRankSet(seg) != RankSetEMPTY)
+    SegSetSummary(seg, RefSetUNIV);
+}
+
+
 /* SegGreyen -- greyen non-white objects */
 
 void SegGreyen(Seg seg, Trace trace)
@@ -874,6 +987,13 @@ Bool SegCheck(Seg seg)
   CHECKL(AddrIsArenaGrain(seg->limit, arena));
   CHECKL(seg->limit > TractBase(seg->firstTract));
   /* CHECKL(BoolCheck(seq->queued)); <design/type#.bool.bitfield.check> */
+  /* CHECKL(BoolCheck(seq->zeroed)); <design/type#.bool.bitfield.check> */
+  /* CHECKL(BoolCheck(seg->frozen)); <design/type#.bool.bitfield.check> */
+  if (seg->frozen) {
+    /* <design/seg#.frozen>: A frozen segment is black for all traces. */
+    CHECKL(seg->white == TraceSetEMPTY);
+    CHECKL(seg->grey == TraceSetEMPTY);
+  }
 
   /* Each tract of the segment must agree about the segment and its
    * pool. Note that even if the CHECKs are compiled away there is
@@ -1114,6 +1234,9 @@ static Res segTrivMerge(Seg seg, Seg segHi,
   /* no need to update fields which match. See .similar */
 
   seg->limit = limit;
+  if (!segHi->zeroed)
+    seg->zeroed = FALSE;
+  AVER(seg->frozen == segHi->frozen);
   TRACT_FOR(tract, addr, arena, mid, limit) {
     AVERT(Tract, tract);
     AVER(segHi == TractSeg(tract));
@@ -1187,6 +1310,8 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   segHi->sm = seg->sm;
   segHi->depth = seg->depth;
   segHi->queued = seg->queued;
+  segHi->zeroed = seg->zeroed;
+  segHi->frozen = seg->frozen;
   segHi->firstTract = NULL;
   RingInit(SegPoolRing(segHi));
 
@@ -1347,6 +1472,15 @@ static Res segNoWhiten(Seg seg, Trace trace)
 }
 
 
+/* segNoFreeze -- freeze method for segs that can't be frozen */
+
+static Res segNoFreeze(Seg seg)
+{
+  AVERT(Seg, seg);
+  return ResUNIMPL;
+}
+
+
 /* segNoGreyen -- greyen method for non-GC segs */
 
 static void segNoGreyen(Seg seg, Trace trace)
@@ -1448,6 +1582,8 @@ Bool GCSegCheck(GCSeg gcseg)
   }
 
   CHECKD_NOSIG(Ring, &gcseg->genRing);
+  CHECKL((gcseg->gen == NULL) == RingIsSingle(&gcseg->genRing));
+  /* Nothing to check about genSummary or genWhite. */
 
   return TRUE;
 }
@@ -1470,6 +1606,9 @@ static Res gcSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   gcseg->buffer = NULL;
   RingInit(&gcseg->greyRing);
   RingInit(&gcseg->genRing);
+  gcseg->gen = NULL;
+  gcseg->genSummary = GenSetUNIV;
+  gcseg->genWhite = ZoneSetEMPTY;
 
   SetClassOfPoly(seg, CLASS(GCSeg));
   gcseg->sig = GCSegSig;
@@ -1719,14 +1858,15 @@ static void mutatorSegSetRankSet(Seg seg, RankSet rankSet)
  * references, and its summary is strictly smaller than the summary of
  * the unprotectable data (that is, the mutator). We don't maintain
  * such a summary, assuming that the mutator can access all
- * references, so its summary is RefSetUNIV.
+ * references, so its summary is RefSetUNIV. A frozen segment never
+ * has a write barrier: see <design/seg#.frozen>.
  */
 
 static void mutatorSegSyncWriteBarrier(Seg seg)
 {
   Arena arena = PoolArena(SegPool(seg));
   /* Can't check seg -- this function enforces invariants tested by SegCheck. */
-  if (SegSummary(seg) == RefSetUNIV)
+  if (SegSummary(seg) == RefSetUNIV || SegFrozen(seg))
     ShieldLower(arena, seg, AccessWRITE);
   else
     ShieldRaise(arena, seg, AccessWRITE);
@@ -1903,6 +2043,7 @@ static Res gcSegMerge(Seg seg, Seg segHi,
   RingFinish(&gcsegHi->greyRing);
   RingRemove(&gcsegHi->genRing);
   RingFinish(&gcsegHi->genRing);
+  gcsegHi->gen = NULL;
 
   /* Reassign any buffer that was connected to segHi  */
   if (NULL != buf) {
@@ -1964,6 +2105,9 @@ static Res gcSegSplit(Seg seg, Seg segHi,
   RingInit(&gcsegHi->greyRing);
   RingInit(&gcsegHi->genRing);
   RingInsert(&gcseg->genRing, &gcsegHi->genRing);
+  gcsegHi->gen = gcseg->gen;
+  gcsegHi->genSummary = gcseg->genSummary;
+  gcsegHi->genWhite = gcseg->genWhite;
   gcsegHi->sig = GCSegSig;
   gcSegSetGreyInternal(segHi, TraceSetEMPTY, grey);
 
@@ -2093,6 +2237,7 @@ Bool SegClassCheck(SegClass klass)
   CHECKL(FUNCHECK(klass->fixEmergency));
   CHECKL(FUNCHECK(klass->reclaim));
   CHECKL(FUNCHECK(klass->walk));
+  CHECKL(FUNCHECK(klass->freeze));
 
   /* Check that segment classes override sets of related methods. */
   CHECKL((klass->init == segAbsInit)
@@ -2145,6 +2290,7 @@ DEFINE_CLASS(Seg, Seg, klass)
   klass->fixEmergency = segNoFix;
   klass->reclaim = segNoReclaim;
   klass->walk = segTrivWalk;
+  klass->freeze = segNoFreeze;
   klass->sig = SegClassSig;
   AVERT(SegClass, klass);
 }
@@ -19,6 +19,7 @@ void ShieldInit(Shield shield)
 {
   shield->inside = FALSE;
   shield->suspended = FALSE;
+  shield->suspendTime = 0;
   shield->queuePending = FALSE;
   shield->queue = NULL;
   shield->length = 0;
@@ -242,6 +243,10 @@ static void shieldSuspend(Arena arena)
   AVER(shield->inside);
 
   if (!shield->suspended) {
+    shield->suspendTime = ClockNow();
+    /* .lookup: Lock-free lookups must not be suspended part way
+       through. See <code/arena.c#.lookup.suspend>. */
+    ArenaLookupExclude(arena);
     ThreadRingSuspend(ArenaThreadRing(arena), ArenaDeadRing(arena));
     shield->suspended = TRUE;
   }
@@ -699,7 +704,10 @@ void (ShieldLeave)(Arena arena)
      .inv.outside.running */
   if (shield->suspended) {
     ThreadRingResume(ArenaThreadRing(arena), ArenaDeadRing(arena));
+    ArenaLookupAllow(arena);
     shield->suspended = FALSE;
+    HistogramAdd(&arena->suspendHistogram,
+                 ClockNow() - shield->suspendTime);
   }
 
   shield->inside = FALSE;
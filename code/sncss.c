@@ -1,18 +1,23 @@
-/* sncss.c: SNC STRESS TEST
+/* sncss.c: SNC AND RGN STRESS TEST
  *
  * $Id$
  * Copyright (c) 2014-2020 Ravenbrook Limited.  See end of file for license.
  */
 
 #include "mpm.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpscamc.h"
 #include "mpscmvt.h"
 #include "mpscmvff.h"
 #include "mpscsnc.h"
+#include "mpscrgn.h"
 #include "mpsavm.h"
 #include "mps.h"
 #include "testlib.h"
 
 #include <stdio.h> /* printf */
+#include <string.h> /* memset */
 
 
 /* Simple format for the SNC pool. */
@@ -202,11 +207,333 @@ static void test(mps_pool_class_t pool_class)
   mps_arena_destroy(arena);
 }
 
+
+/* test_rgn -- allocate in regions and reset them
+ *
+ * Half the allocation points are scanned, to check that scanning a
+ * region doesn't disturb it. Resetting a region and allocating the
+ * same amount again must reuse the cached segments.
+ */
+
+#define RGN_LARGE_SIZE ((size_t)100000)
+
+static mps_res_t bare_alloc(mps_ap_t ap, size_t size)
+{
+  mps_addr_t p;
+  mps_res_t res;
+
+  do {
+    res = mps_reserve(&p, ap, size);
+    if (res != MPS_RES_OK)
+      return res;
+  } while (!mps_commit(ap, p, size));
+  return MPS_RES_OK;
+}
+
+static void test_rgn(void)
+{
+  size_t i, j;
+  mps_align_t align;
+  mps_arena_t arena;
+  mps_fmt_t fmt;
+  mps_pool_t pool, bare;
+  mps_ap_t aps[AP_MAX], ap;
+  size_t alloc[AP_MAX];
+  size_t total;
+  mps_addr_t p;
+
+  align = sizeof(obj_s) << (rnd() % 4);
+
+  die(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none),
+      "mps_arena_create");
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SCAN, fmtScan);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SKIP, fmtSkip);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_PAD, fmtPad);
+    die(mps_fmt_create_k(&fmt, arena, args), "fmt_create");
+  } MPS_ARGS_END(args);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    die(mps_pool_create_k(&pool, arena, mps_class_rgn(), args),
+        "pool_create(rgn)");
+  } MPS_ARGS_END(args);
+
+  for (i = 0; i < NELEMS(aps); ++i) {
+    MPS_ARGS_BEGIN(args) {
+      if (i % 2 == 0)
+        MPS_ARGS_ADD(args, MPS_KEY_RANK, mps_rank_exact());
+      die(mps_ap_create_k(&aps[i], pool, args), "ap_create");
+    } MPS_ARGS_END(args);
+    alloc[i] = 0;
+  }
+
+  for (i = 0; i < 1000000; ++i) {
+    size_t k = rnd() % NELEMS(aps);
+    if (rnd() % 1000 == 0) {
+      die(mps_rgn_reset(aps[k]), "mps_rgn_reset");
+      alloc[k] = 0;
+    } else {
+      size_t size = alignUp(1 + rnd() % 128, align);
+      if (rnd() % 10000 == 0)
+        size = alignUp(RGN_LARGE_SIZE, align);
+      make(&p, aps[k], size);
+      alloc[k] += size;
+    }
+    if (i % 100000 == 0)
+      mps_arena_collect(arena);
+  }
+
+  /* Can't reset between reserve and commit. */
+  die(mps_reserve(&p, aps[0], align), "mps_reserve");
+  cdie(mps_rgn_reset(aps[0]) == MPS_RES_FAIL, "reset during reserve");
+  ((obj_t)p)->size = align;
+  ((obj_t)p)->pad = 0;
+  cdie(mps_commit(aps[0], p, align), "mps_commit");
+  alloc[0] += align;
+
+  mps_arena_park(arena);
+  {
+    env_s env1 = {0, 0}, env2 = {0, 0};
+    size_t all = 0;
+
+    for (i = 0; i < NELEMS(aps); ++i)
+      all += alloc[i];
+
+    mps_arena_formatted_objects_walk(arena, fmtVisitor, &env1, 0);
+    Insist(all == env1.obj);
+
+    die(mps_pool_walk(pool, area_scan, &env2), "mps_pool_walk");
+    Insist(all == env2.obj);
+    Insist(env1.pad == env2.pad);
+    Insist(all + env1.pad + mps_pool_free_size(pool)
+           <= mps_pool_total_size(pool));
+  }
+  mps_arena_release(arena);
+
+  for (i = 0; i < NELEMS(aps); ++i)
+    mps_ap_destroy(aps[i]);
+  Insist(mps_pool_free_size(pool) == mps_pool_total_size(pool));
+  mps_pool_destroy(pool);
+
+  /* A pool without a format can't be scanned or walked, but a reset
+     region reuses its segments. */
+  die(mps_pool_create_k(&bare, arena, mps_class_rgn(), mps_args_none),
+      "pool_create(bare)");
+  die(mps_ap_create_k(&ap, bare, mps_args_none), "ap_create(bare)");
+  for (i = 0; i < 100000; ++i)
+    die(bare_alloc(ap, 64), "alloc(bare)");
+  total = mps_pool_total_size(bare);
+  for (j = 0; j < 10; ++j) {
+    die(mps_rgn_reset(ap), "mps_rgn_reset(bare)");
+    Insist(mps_pool_free_size(bare) == total);
+    for (i = 0; i < 100000; ++i)
+      die(bare_alloc(ap, 64), "alloc(bare)");
+    Insist(mps_pool_total_size(bare) == total);
+  }
+  mps_ap_destroy(ap);
+  mps_pool_destroy(bare);
+
+  mps_fmt_destroy(fmt);
+  mps_arena_destroy(arena);
+}
+
+
+/* test_rgn_reset -- check that resetting a region re-zeroes it
+ *
+ * Memory reserved on a zeroed allocation point must be zero even if
+ * it was used by the region before it was reset. The regions are
+ * sometimes small enough to be reset in place, and sometimes not. See
+ * <code/poolrgn.c#reset.light>. Resetting in place must also work
+ * when allocation sampling is on.
+ */
+
+#define RGN_RESET_ROUNDS 20
+#define RGN_RESET_BLOCKS 64
+
+static void test_rgn_reset(mps_bool_t sampling)
+{
+  mps_arena_t arena;
+  mps_pool_t pool;
+  mps_ap_t aps[2];
+  size_t i, j, k, blocks;
+
+  die(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none),
+      "mps_arena_create");
+  if (sampling)
+    mps_arena_alloc_sample_set(arena, 1024, NULL, NULL);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_EXTEND_BY, 4096);
+    die(mps_pool_create_k(&pool, arena, mps_class_rgn(), args),
+        "pool_create(rgn reset)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&aps[0], pool, mps_args_none), "ap_create(rgn)");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_AP_ZEROED, TRUE);
+    die(mps_ap_create_k(&aps[1], pool, args), "ap_create(rgn zeroed)");
+  } MPS_ARGS_END(args);
+
+  for (i = 0; i < RGN_RESET_ROUNDS; ++i) {
+    blocks = rnd() % RGN_RESET_BLOCKS + 1;
+    for (j = 0; j < NELEMS(aps); ++j) {
+      for (k = 0; k < blocks; ++k) {
+        size_t size = (rnd() % 24 + 1) * sizeof(mps_word_t);
+        mps_addr_t p;
+        do {
+          die(mps_reserve(&p, aps[j], size), "mps_reserve(rgn reset)");
+          if (j == 1)
+            check_zeroed(p, size);
+          memset(p, 0xA5, size);
+        } while (!mps_commit(aps[j], p, size));
+      }
+      die(mps_rgn_reset(aps[j]), "mps_rgn_reset");
+    }
+  }
+
+  mps_ap_destroy(aps[1]);
+  mps_ap_destroy(aps[0]);
+  mps_pool_destroy(pool);
+  mps_arena_destroy(arena);
+}
+
+
+/* test_rgn_scanned -- check that a scanned region keeps objects alive
+ *
+ * Each object in the region is the only reference to an object in an
+ * AMC pool, so that object survives only if the region is scanned.
+ * The region is reset when it is full.
+ */
+
+#define RGN_OBJS_MAX 100
+#define RGN_SCANNED_OBJS 100000
+
+/* objNULL needs to be odd so that it's ignored in roots. */
+#define objNULL ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_gen_param_s rgnChain[2] = {{150, 0.85}, {170, 0.45}};
+static mps_addr_t rgnTarget;              /* root for a new object */
+static mps_word_t *rgnObjs[RGN_OBJS_MAX]; /* objects in region */
+static size_t rgnObjsCount;
+
+static void check_rgn(mps_arena_t arena)
+{
+  size_t i;
+  for (i = 0; i < rgnObjsCount; ++i) {
+    mps_addr_t ref = (mps_addr_t)DYLAN_VECTOR_SLOT(rgnObjs[i], 0);
+    cdie(dylan_check(rgnObjs[i]) && dylan_check(ref)
+         && mps_arena_has_addr(arena, ref),
+         "region check");
+  }
+}
+
+static mps_res_t area_count(mps_ss_t ss, void *base, void *limit,
+                            void *closure)
+{
+  size_t *count = closure;
+  mps_res_t res;
+  while (base < limit) {
+    mps_addr_t prev = base;
+    if (!dylan_ispad(base))
+      ++ *count;
+    res = dylan_scan1(ss, &base);
+    if (res != MPS_RES_OK)
+      return res;
+    Insist(prev < base);
+  }
+  Insist(base == limit);
+  return MPS_RES_OK;
+}
+
+static void test_rgn_scanned(void)
+{
+  mps_arena_t arena;
+  mps_fmt_t fmt;
+  mps_chain_t chain;
+  mps_pool_t amc, rgn;
+  mps_ap_t amc_ap, rgn_ap;
+  mps_root_t root;
+  size_t i, count;
+
+  die(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none),
+      "mps_arena_create");
+  die(dylan_fmt(&fmt, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, NELEMS(rgnChain), rgnChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&amc, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    die(mps_pool_create_k(&rgn, arena, mps_class_rgn(), args),
+        "pool_create(rgn)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&amc_ap, amc, mps_rank_exact()), "ap_create(amc)");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_RANK, mps_rank_exact());
+    die(mps_ap_create_k(&rgn_ap, rgn, args), "ap_create(rgn)");
+  } MPS_ARGS_END(args);
+  rgnTarget = objNULL;
+  die(mps_root_create_table_masked(&root, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, &rgnTarget, 1,
+                                   (mps_word_t)1),
+      "root_create_table");
+
+  rgnObjsCount = 0;
+  for (i = 0; i < RGN_SCANNED_OBJS; ++i) {
+    mps_addr_t p;
+    die(dylan_alloc(&p, amc_ap, 4 * sizeof(mps_word_t), NULL, 0),
+        "dylan_alloc(garbage)");
+    if (i % 16 == 0) {
+      if (rgnObjsCount == RGN_OBJS_MAX) {
+        die(mps_rgn_reset(rgn_ap), "mps_rgn_reset");
+        rgnObjsCount = 0;
+      }
+      die(dylan_alloc(&rgnTarget, amc_ap, 4 * sizeof(mps_word_t), NULL, 0),
+          "dylan_alloc(target)");
+      die(dylan_alloc(&p, rgn_ap, 3 * sizeof(mps_word_t), NULL, 0),
+          "dylan_alloc(rgn)");
+      DYLAN_VECTOR_SLOT(p, 0) = (mps_word_t)rgnTarget;
+      rgnTarget = objNULL;
+      rgnObjs[rgnObjsCount++] = p;
+    }
+    if (i % 1000 == 0)
+      check_rgn(arena);
+  }
+
+  mps_arena_park(arena);
+  printf("%lu collections\n", (unsigned long)mps_collections(arena));
+  Insist(mps_collections(arena) > 0);
+  check_rgn(arena);
+  count = 0;
+  die(mps_pool_walk(rgn, area_count, &count), "mps_pool_walk");
+  Insist(count == rgnObjsCount);
+
+  mps_root_destroy(root);
+  mps_ap_destroy(rgn_ap);
+  mps_ap_destroy(amc_ap);
+  mps_pool_destroy(rgn);
+  mps_pool_destroy(amc);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(fmt);
+  mps_arena_destroy(arena);
+}
+
+
 int main(int argc, char *argv[])
 {
   testlib_init(argc, argv);
 
   test(mps_class_snc());
+  test_rgn();
+  test_rgn_reset(FALSE);
+  test_rgn_reset(TRUE);
+  test_rgn_scanned();
 
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
@@ -12,6 +12,7 @@
 #include "mpslib.h"
 #include "mpm.h"
 #include "mpscamc.h"
+#include "mpscmvff.h"
 #include "mpsavm.h"
 #include "mpstd.h"
 #include "mps.h"
@@ -27,6 +28,8 @@
 #define clockSetFREQ      10000
 #define multiStepFREQ     500000
 #define multiStepMULT     100
+#define precommitSIZE     ((size_t)4 << 20)
+#define precommitBLOCK    ((size_t)1024)
 
 #define genCOUNT          3
 #define gen1SIZE          750  /* kB */
@@ -278,6 +281,54 @@ static void test_step(mps_arena_t arena, double multiplier)
 
 /* test -- the body of the test */
 
+/* check_histogram -- check and print a histogram from mps_arena_stats */
+
+static void check_histogram(const char *name, mps_histogram_s *histogram)
+{
+  size_t i, sum = 0, p99 = 0;
+
+  for (i = 0; i < MPS_HISTOGRAM_BUCKETS; ++i) {
+    sum += histogram->bucket[i];
+    if (sum * 100 < histogram->count * 99)
+      p99 = i + 1;
+  }
+  Insist(sum == histogram->count);
+  Insist(histogram->total >= histogram->max);
+  printf("  %s: %"PRIuLONGEST" intervals, max %"PRIuLONGEST
+         ", 99%% below %"PRIuLONGEST" clocks.\n", name,
+         (ulongest_t)histogram->count, (ulongest_t)histogram->max,
+         (ulongest_t)(p99 + 1 < MPS_HISTOGRAM_BUCKETS
+                      ? mps_histogram_bucket_base(p99 + 1)
+                      : histogram->max));
+}
+
+
+/* check_stats -- check the arena's pause statistics */
+
+static void check_stats(mps_arena_t arena)
+{
+  mps_arena_stats_s stats;
+
+  stats.size = sizeof stats;
+  mps_arena_stats(&stats, arena);
+  Insist(stats.size == sizeof stats);
+  printf("Pause statistics:\n");
+  check_histogram("increment", &stats.increment);
+  check_histogram("flip", &stats.flip);
+  check_histogram("reclaim", &stats.reclaim);
+  check_histogram("suspend", &stats.suspend);
+  printf("  %"PRIuLONGEST" barrier hits, %"PRIuLONGEST" buffer fills.\n",
+         (ulongest_t)stats.access, (ulongest_t)stats.fill);
+  Insist(stats.increment.count > 0);
+  Insist(stats.flip.count > 0);
+  printf("  %"PRIuLONGEST" references passed the zone check, "
+         "%"PRIuLONGEST" were to condemned segments.\n",
+         (ulongest_t)stats.fix, (ulongest_t)stats.fix_white);
+  Insist(stats.fill > 0);
+  Insist(stats.fix_white <= stats.fix);
+}
+
+
 static void test(mps_arena_t arena, unsigned long step_period)
 {
     mps_fmt_t format;
@@ -415,6 +466,8 @@ static void test(mps_arena_t arena, unsigned long step_period)
     printf("  %"PRIuLONGEST" objects (%"PRIuLONGEST" bytes) allocated.\n",
            (ulongest_t)objs, (ulongest_t)alloc_bytes);
     printf("  Commit failed %ld times.\n", commit_failures);
+    printf("  %"PRIuLONGEST" bytes spare committed.\n",
+           (ulongest_t)mps_arena_spare_committed(arena));
 
     printf("Timings:\n");
     print_time("  Allocation took ", alloc_time, "");
@@ -455,6 +508,8 @@ static void test(mps_arena_t arena, unsigned long step_period)
     print_time("", total_clock_time / (double)clock_reads, " per read;");
     print_time(" recently measured as ", clock_time, ").\n");
 
+    check_stats(arena);
+
     mps_arena_park(arena);
     mps_ap_destroy(ap);
     mps_root_destroy(exactRoot);
@@ -464,17 +519,82 @@ static void test(mps_arena_t arena, unsigned long step_period)
     mps_fmt_destroy(format);
 }
 
+/* test_precommit -- check that an idle step maps memory ahead
+ *
+ * Allocates in a manually managed pool, so that there is nothing to
+ * collect, and then steps the arena. With MPS_KEY_ARENA_PRECOMMIT,
+ * the step should use its idle time to map memory for the allocation
+ * rate it has seen, so the committed and spare committed memory grow.
+ * Without it, the step has nothing to do.
+ */
+
+static void test_precommit(mps_bool_t precommit)
+{
+    mps_arena_t arena;
+    mps_pool_t mvff;
+    mps_ap_t mvff_ap;
+    size_t i, committed, spare;
+
+    MPS_ARGS_BEGIN(args) {
+        MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+        if (precommit)
+            MPS_ARGS_ADD(args, MPS_KEY_ARENA_PRECOMMIT, testArenaSIZE / 4);
+        die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+            "arena_create");
+    } MPS_ARGS_END(args);
+    mps_arena_clamp(arena);
+    die(mps_pool_create_k(&mvff, arena, mps_class_mvff(), mps_args_none),
+        "pool_create(mvff)");
+    die(mps_ap_create_k(&mvff_ap, mvff, mps_args_none), "ap_create(mvff)");
+
+    for (i = 0; i < precommitSIZE / precommitBLOCK; ++i) {
+        mps_addr_t p;
+        do {
+            die(mps_reserve(&p, mvff_ap, precommitBLOCK), "mps_reserve");
+        } while (!mps_commit(mvff_ap, p, precommitBLOCK));
+    }
+
+    committed = mps_arena_committed(arena);
+    spare = mps_arena_spare_committed(arena);
+    (void)mps_arena_step(arena, 0.001, 0.0);
+    printf("Precommit %d: committed %"PRIuLONGEST" -> %"PRIuLONGEST
+           ", spare %"PRIuLONGEST" -> %"PRIuLONGEST".\n", (int)precommit,
+           (ulongest_t)committed, (ulongest_t)mps_arena_committed(arena),
+           (ulongest_t)spare, (ulongest_t)mps_arena_spare_committed(arena));
+    if (precommit) {
+        Insist(mps_arena_committed(arena) > committed);
+        Insist(mps_arena_spare_committed(arena) > spare);
+    } else {
+        Insist(mps_arena_committed(arena) == committed);
+        Insist(mps_arena_spare_committed(arena) == spare);
+    }
+
+    mps_ap_destroy(mvff_ap);
+    mps_pool_destroy(mvff);
+    mps_arena_destroy(arena);
+}
+
 int main(int argc, char *argv[])
 {
     mps_arena_t arena;
     prepare_clock();
     testlib_init(argc, argv);
     set_clock_timing();
-    die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
-        "arena_create");
+    MPS_ARGS_BEGIN(args) {
+        MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+        /* Half the time, map memory ahead of allocation while stepping. */
+        if (rnd() % 2) {
+            printf("Precommitting.\n");
+            MPS_ARGS_ADD(args, MPS_KEY_ARENA_PRECOMMIT, testArenaSIZE / 4);
+        }
+        die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+            "arena_create");
+    } MPS_ARGS_END(args);
     mps_arena_clamp(arena);
     test(arena, (unsigned long)pow(10, rnd() % 10));
     mps_arena_destroy(arena);
+    test_precommit(FALSE);
+    test_precommit(TRUE);
     printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
     return 0;
 }
@@ -264,6 +264,16 @@ rnd_state_t rnd_seed(void)
 }
 
 
+/* check_zeroed -- check that a block is all zeros */
+
+void check_zeroed(void *p, size_t size)
+{
+  size_t i;
+  for (i = 0; i < size; ++i)
+    Insist(((unsigned char *)p)[i] == 0);
+}
+
+
 /* randomize -- randomize the generator, or initialize to replay
  *
  * There have been 3 versions of the rnd-states reported by this
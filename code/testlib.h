@@ -277,6 +277,15 @@ extern size_t rnd_align(size_t min, size_t max);
 extern double rnd_pause_time(void);
 
 
+/* check_zeroed -- check that a block is all zeros
+ *
+ * For blocks reserved on an allocation point created with
+ * MPS_KEY_AP_ZEROED.
+ */
+
+extern void check_zeroed(void *p, size_t size);
+
+
 /* randomize -- randomize the generator, or initialize to replay
  *
  * randomize(argc, argv) randomizes the rnd generator (using time(3))
@@ -57,6 +57,15 @@ extern void ThreadRingSuspend(Ring threadRing, Ring deadRing);
 extern void ThreadRingResume(Ring threadRing, Ring deadRing);
 
 
+/*  ThreadYield
+ *
+ *  Give up the processor to another thread, if there is one ready to
+ *  run. Used by the current thread while it waits for other threads.
+ */
+
+extern void ThreadYield(void);
+
+
 /*  ThreadRingThread
  *
  *  Return the thread from an element of the Arena's
@@ -97,6 +97,11 @@ void ThreadRingResume(Ring threadRing, Ring deadRing)
   AVERT(Ring, deadRing);
 }
 
+void ThreadYield(void)
+{
+  NOOP;
+}
+
 Thread ThreadRingThread(Ring threadRing)
 {
   Thread thread;
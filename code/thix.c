@@ -42,6 +42,7 @@
 #include "pthrdext.h"
 
 #include <pthread.h>
+#include <sched.h> /* sched_yield */
 
 SRCID(thix, "$Id$");
 
@@ -223,6 +224,12 @@ void ThreadRingResume(Ring threadRing, Ring deadRing)
 }
 
 
+void ThreadYield(void)
+{
+  (void)sched_yield();
+}
+
+
 /* ThreadRingThread -- return the thread at the given ring element */
 
 Thread ThreadRingThread(Ring threadRing)
@@ -222,6 +222,12 @@ void ThreadRingResume(Ring threadRing, Ring deadRing)
 }
 
 
+void ThreadYield(void)
+{
+  (void)SwitchToThread();
+}
+
+
 Thread ThreadRingThread(Ring threadRing)
 {
   Thread thread;
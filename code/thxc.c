@@ -32,6 +32,7 @@
 #include <mach/thread_act.h>
 #include <mach/thread_status.h>
 #include <pthread.h>
+#include <sched.h> /* sched_yield */
 
 
 SRCID(thxc, "$Id$");
@@ -204,6 +205,12 @@ void ThreadRingResume(Ring threadRing, Ring deadRing)
 }
 
 
+void ThreadYield(void)
+{
+  (void)sched_yield();
+}
+
+
 Thread ThreadRingThread(Ring threadRing)
 {
   Thread thread;
@@ -0,0 +1,936 @@
+/* tlsf.c: TWO-LEVEL SEGREGATED FIT LAND IMPLEMENTATION
+ *
+ * $Id$
+ * Copyright (c) 2020 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: TLSF is a Land that keeps its free ranges in segregated
+ * free lists, one per size class, so that finding a block of a given
+ * size and inserting a block (with coalescing) take constant time,
+ * independent of the number of blocks.  Deleting a range that doesn't
+ * share a boundary with its block is the exception: see .delete.  It
+ * is an alternative to the CBS for the free memory of MVFF, selected
+ * by MPS_KEY_MVFF_TLSF.
+ *
+ * .class: Size classes are in two levels.  The first level is the
+ * power of two of the size (in units of the land alignment); each
+ * first-level class is divided into TLSF_SL_COUNT linear second-level
+ * classes.  A bitmap of non-empty first-level classes and, for each
+ * of those, a bitmap of non-empty second-level classes, let us find
+ * the smallest non-empty class above a given size with a couple of
+ * bit scans.
+ *
+ * .fit: Find rounds the requested size up to the next class boundary,
+ * so that any block in the class found is big enough.  If there is no
+ * such class, it searches the list of the class containing the
+ * requested size, so that a block is found whenever there is one.
+ * The block found is not necessarily the lowest or highest in
+ * address, so LandFindFirst and LandFindLast are both "good fit"; the
+ * FindDelete argument decides which end of the block is used.
+ *
+ * .desc: Block descriptors are allocated out-of-band from an MFS pool
+ * (unlike the Freelist, which stores its blocks in the free memory),
+ * so that the free memory is never touched.
+ *
+ * .coalesce: Coalescing needs the block (if any) that ends where a
+ * range begins, and the block that begins where it ends.  These are
+ * found through two chained hash tables keyed by block base and block
+ * limit.  The tables double in size when the number of blocks exceeds
+ * the number of buckets; if the memory for a bigger table can't be
+ * allocated, the chains just get longer.
+ *
+ * .overlap: Insert detects a range that shares a base or limit with a
+ * block, and returns ResFAIL, but other overlaps are not detected:
+ * it is a precondition that the range is not already in the land.
+ *
+ * .delete: Delete finds the block containing the range through the
+ * hash tables when the range shares a base or limit with the block.
+ * Otherwise it tries the block most recently found by Find or
+ * FindLargest without deleting (MVFF's Reduce deletes part of such a
+ * block, see mvffReduce in <code/poolmvff.c>), and failing that it
+ * searches the size classes that could contain the range.  Only this
+ * last case takes time proportional to the number of blocks, and it
+ * only visits blocks at least as big as the range.
+ *
+ * .control: The free lists and hash tables are allocated from the
+ * arena control pool, so TLSF cannot be used to manage the control
+ * pool itself.
+ */
+
+#include "tlsf.h"
+#include "mpm.h"
+#include "poolmfs.h"
+#include "range.h"
+
+SRCID(tlsf, "$Id$");
+
+
+#define tlsfAlignment(tlsf) LandAlignment(TLSFLand(tlsf))
+#define tlsfCLASSES (TLSF_FL_COUNT << TLSF_SL_SHIFT)
+#define tlsfSL_MASK (TLSF_SL_COUNT - 1)
+
+typedef struct TLSFBlockStruct {
+  TLSFBlock next, prev;         /* neighbours in size class list */
+  TLSFBlock baseNext;           /* next in base hash chain */
+  TLSFBlock limitNext;          /* next in limit hash chain */
+  Addr base, limit;             /* the range */
+} TLSFBlockStruct;
+
+#define tlsfBlockSize(block) AddrOffset((block)->base, (block)->limit)
+
+
+/* tlsfLowBit, tlsfHighBit -- index of lowest and highest set bit
+ *
+ * These are the bit scans that make the class lookups constant time,
+ * so use the single-instruction builtins where there are any (see
+ * <code/config.h#WORD_CTZ>).
+ */
+
+#if defined(WORD_CTZ) && defined(WORD_CLZ)
+
+#define tlsfLowBit(word) WORD_CTZ(word)
+#define tlsfHighBit(word) (MPS_WORD_WIDTH - 1 - WORD_CLZ(word))
+
+#else /* WORD_CTZ and WORD_CLZ not defined */
+
+static Index tlsfLowBit(Word word)
+{
+  Index i = 0;
+  AVER(word != 0);
+#if MPS_WORD_WIDTH == 64
+  if ((word & (Word)0xFFFFFFFF) == 0) { word >>= 32; i += 32; }
+#endif
+  if ((word & (Word)0xFFFF) == 0) { word >>= 16; i += 16; }
+  if ((word & (Word)0xFF) == 0) { word >>= 8; i += 8; }
+  if ((word & (Word)0xF) == 0) { word >>= 4; i += 4; }
+  if ((word & (Word)0x3) == 0) { word >>= 2; i += 2; }
+  if ((word & (Word)0x1) == 0) i += 1;
+  return i;
+}
+
+static Index tlsfHighBit(Word word)
+{
+  Index i = 0;
+  AVER(word != 0);
+#if MPS_WORD_WIDTH == 64
+  if ((word >> 32) != 0) { word >>= 32; i += 32; }
+#endif
+  if ((word >> 16) != 0) { word >>= 16; i += 16; }
+  if ((word >> 8) != 0) { word >>= 8; i += 8; }
+  if ((word >> 4) != 0) { word >>= 4; i += 4; }
+  if ((word >> 2) != 0) { word >>= 2; i += 2; }
+  if ((word >> 1) != 0) i += 1;
+  return i;
+}
+
+#endif /* WORD_CTZ and WORD_CLZ */
+
+
+/* tlsfClass -- return the index of the size class containing size
+ *
+ * The first level is fl, the second level sl, and the index is fl *
+ * TLSF_SL_COUNT + sl.  Sizes (in alignment units) below
+ * TLSF_SL_COUNT all go in first-level class 0, one per second-level
+ * class.  See .class.
+ */
+
+static Index tlsfClass(TLSF tlsf, Size size)
+{
+  Word units = size >> tlsf->alignShift;
+  Index f;
+
+  if (units < TLSF_SL_COUNT)
+    return units;
+  f = tlsfHighBit(units);
+  return ((f - TLSF_SL_SHIFT + 1) << TLSF_SL_SHIFT)
+    + ((units >> (f - TLSF_SL_SHIFT)) & tlsfSL_MASK);
+}
+
+
+/* tlsfClassAbove -- return the index of the lowest size class all of
+ * whose blocks are at least size */
+
+static Index tlsfClassAbove(TLSF tlsf, Size size)
+{
+  Word units = size >> tlsf->alignShift;
+  Index f;
+
+  if (units < TLSF_SL_COUNT)
+    return units;
+  f = tlsfHighBit(units);
+  units += ((Word)1 << (f - TLSF_SL_SHIFT)) - 1;
+  return tlsfClass(tlsf, units << tlsf->alignShift);
+}
+
+
+/* tlsfNonEmptyClass -- find the lowest non-empty class at or above index */
+
+static Bool tlsfNonEmptyClass(Index *indexReturn, TLSF tlsf, Index index)
+{
+  Index fl = index >> TLSF_SL_SHIFT, sl = index & tlsfSL_MASK;
+  Word map;
+
+  AVER(index < tlsfCLASSES);
+
+  map = tlsf->slBitmap[fl] & ((Word)-1 << sl);
+  if (map == 0) {
+    if (fl + 1 >= TLSF_FL_COUNT)
+      return FALSE;
+    map = tlsf->flBitmap & ((Word)-1 << (fl + 1));
+    if (map == 0)
+      return FALSE;
+    fl = tlsfLowBit(map);
+    map = tlsf->slBitmap[fl];
+    AVER(map != 0);
+  }
+  *indexReturn = (fl << TLSF_SL_SHIFT) + tlsfLowBit(map);
+  return TRUE;
+}
+
+
+/* tlsfHash -- hash an address into the boundary tables */
+
+static Index tlsfHash(TLSF tlsf, Addr addr)
+{
+  Word h = ((Word)addr >> tlsf->alignShift) * (Word)2654435761UL;
+  h ^= h >> 15;
+  return (Index)(h & (tlsf->buckets - 1));
+}
+
+
+/* tlsfBlockWithBase, tlsfBlockWithLimit -- look up a block by boundary */
+
+static TLSFBlock tlsfBlockWithBase(TLSF tlsf, Addr base)
+{
+  TLSFBlock block = tlsf->baseTable[tlsfHash(tlsf, base)];
+  while (block != NULL && block->base != base)
+    block = block->baseNext;
+  return block;
+}
+
+static TLSFBlock tlsfBlockWithLimit(TLSF tlsf, Addr limit)
+{
+  TLSFBlock block = tlsf->limitTable[tlsfHash(tlsf, limit)];
+  while (block != NULL && block->limit != limit)
+    block = block->limitNext;
+  return block;
+}
+
+
+/* tlsfBlockLink -- add block to its size class and the hash tables */
+
+static void tlsfBlockLink(TLSF tlsf, TLSFBlock block)
+{
+  Index index, fl, h;
+  TLSFBlock *head;
+
+  AVER(block->base < block->limit);
+
+  index = tlsfClass(tlsf, tlsfBlockSize(block));
+  fl = index >> TLSF_SL_SHIFT;
+  head = &tlsf->freeLists[index];
+  block->prev = NULL;
+  block->next = *head;
+  if (*head != NULL)
+    (*head)->prev = block;
+  *head = block;
+  tlsf->slBitmap[fl] |= (Word)1 << (index & tlsfSL_MASK);
+  tlsf->flBitmap |= (Word)1 << fl;
+
+  h = tlsfHash(tlsf, block->base);
+  block->baseNext = tlsf->baseTable[h];
+  tlsf->baseTable[h] = block;
+  h = tlsfHash(tlsf, block->limit);
+  block->limitNext = tlsf->limitTable[h];
+  tlsf->limitTable[h] = block;
+}
+
+
+/* tlsfBlockUnlink -- remove block from its size class and the tables */
+
+static void tlsfBlockUnlink(TLSF tlsf, TLSFBlock block)
+{
+  Index index, fl;
+  TLSFBlock *p;
+
+  index = tlsfClass(tlsf, tlsfBlockSize(block));
+  fl = index >> TLSF_SL_SHIFT;
+  if (block->prev != NULL) {
+    block->prev->next = block->next;
+  } else {
+    AVER(tlsf->freeLists[index] == block);
+    tlsf->freeLists[index] = block->next;
+    if (block->next == NULL) {
+      tlsf->slBitmap[fl] &= ~((Word)1 << (index & tlsfSL_MASK));
+      if (tlsf->slBitmap[fl] == 0)
+        tlsf->flBitmap &= ~((Word)1 << fl);
+    }
+  }
+  if (block->next != NULL)
+    block->next->prev = block->prev;
+
+  p = &tlsf->baseTable[tlsfHash(tlsf, block->base)];
+  while (*p != block) {
+    AVER(*p != NULL);
+    p = &(*p)->baseNext;
+  }
+  *p = block->baseNext;
+  p = &tlsf->limitTable[tlsfHash(tlsf, block->limit)];
+  while (*p != block) {
+    AVER(*p != NULL);
+    p = &(*p)->limitNext;
+  }
+  *p = block->limitNext;
+}
+
+
+/* tlsfBlockSetRange -- change the range of a block in the land */
+
+static void tlsfBlockSetRange(TLSF tlsf, TLSFBlock block,
+                              Addr base, Addr limit)
+{
+  tlsfBlockUnlink(tlsf, block);
+  block->base = base;
+  block->limit = limit;
+  tlsfBlockLink(tlsf, block);
+}
+
+
+/* tlsfGrow -- double the size of the hash tables, if possible
+ *
+ * Failure to allocate is not an error: see .coalesce.
+ */
+
+static void tlsfGrow(TLSF tlsf)
+{
+  Arena arena = LandArena(TLSFLand(tlsf));
+  Count oldBuckets = tlsf->buckets, buckets = oldBuckets * 2;
+  TLSFBlock *oldBaseTable = tlsf->baseTable;
+  TLSFBlock *oldLimitTable = tlsf->limitTable;
+  void *p, *q;
+  Index i;
+
+  if (ControlAlloc(&p, arena, buckets * sizeof(TLSFBlock)) != ResOK)
+    return;
+  if (ControlAlloc(&q, arena, buckets * sizeof(TLSFBlock)) != ResOK) {
+    ControlFree(arena, p, buckets * sizeof(TLSFBlock));
+    return;
+  }
+  tlsf->baseTable = p;
+  tlsf->limitTable = q;
+  tlsf->buckets = buckets;
+  for (i = 0; i < buckets; ++i) {
+    tlsf->baseTable[i] = NULL;
+    tlsf->limitTable[i] = NULL;
+  }
+
+  for (i = 0; i < oldBuckets; ++i) {
+    TLSFBlock block, next;
+    for (block = oldBaseTable[i]; block != NULL; block = next) {
+      Index h = tlsfHash(tlsf, block->base);
+      next = block->baseNext;
+      block->baseNext = tlsf->baseTable[h];
+      tlsf->baseTable[h] = block;
+    }
+    for (block = oldLimitTable[i]; block != NULL; block = next) {
+      Index h = tlsfHash(tlsf, block->limit);
+      next = block->limitNext;
+      block->limitNext = tlsf->limitTable[h];
+      tlsf->limitTable[h] = block;
+    }
+  }
+
+  ControlFree(arena, oldBaseTable, oldBuckets * sizeof(TLSFBlock));
+  ControlFree(arena, oldLimitTable, oldBuckets * sizeof(TLSFBlock));
+}
+
+
+/* tlsfBlockNew -- allocate a new block descriptor and add it */
+
+static Res tlsfBlockNew(TLSF tlsf, Addr base, Addr limit)
+{
+  TLSFBlock block;
+  Addr p;
+  Res res;
+
+  res = PoolAlloc(&p, tlsf->blockPool, sizeof(TLSFBlockStruct));
+  if (res != ResOK)
+    return res;
+  block = (TLSFBlock)p;
+  block->base = base;
+  block->limit = limit;
+  tlsfBlockLink(tlsf, block);
+  ++ tlsf->blocks;
+  if (tlsf->blocks > tlsf->buckets)
+    tlsfGrow(tlsf);
+  return ResOK;
+}
+
+
+/* tlsfBlockDestroy -- remove a block and free its descriptor */
+
+static void tlsfBlockDestroy(TLSF tlsf, TLSFBlock block)
+{
+  tlsfBlockUnlink(tlsf, block);
+  if (tlsf->hint == block)
+    tlsf->hint = NULL;
+  AVER(tlsf->blocks > 0);
+  -- tlsf->blocks;
+  PoolFree(tlsf->blockPool, (Addr)block, sizeof(TLSFBlockStruct));
+}
+
+
+Bool TLSFCheck(TLSF tlsf)
+{
+  Land land;
+  CHECKS(TLSF, tlsf);
+  land = TLSFLand(tlsf);
+  CHECKD(Land, land);
+  CHECKD(Pool, tlsf->blockPool);
+  CHECKL(tlsf->alignShift == SizeLog2(tlsfAlignment(tlsf)));
+  CHECKL(tlsf->freeLists != NULL);
+  CHECKL(tlsf->baseTable != NULL);
+  CHECKL(tlsf->limitTable != NULL);
+  CHECKL(tlsf->buckets > 0);
+  CHECKL(WordIsP2(tlsf->buckets));
+  CHECKL((tlsf->flBitmap == 0) == (tlsf->blocks == 0));
+  CHECKL((tlsf->blocks == 0) == (tlsf->size == 0));
+  CHECKL(SizeIsAligned(tlsf->size, tlsfAlignment(tlsf)));
+  return TRUE;
+}
+
+
+static Res tlsfInit(Land land, Arena arena, Align alignment, ArgList args)
+{
+  TLSF tlsf;
+  Res res;
+  void *p;
+  Index i;
+
+  AVER(land != NULL);
+  res = NextMethod(Land, TLSF, init)(land, arena, alignment, args);
+  if (res != ResOK)
+    goto failNextInit;
+  tlsf = CouldBeA(TLSF, land);
+
+  MPS_ARGS_BEGIN(pcArgs) {
+    MPS_ARGS_ADD(pcArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(TLSFBlockStruct));
+    res = PoolCreate(&tlsf->blockPool, arena, PoolClassMFS(), pcArgs);
+  } MPS_ARGS_END(pcArgs);
+  if (res != ResOK)
+    goto failPoolCreate;
+
+  res = ControlAlloc(&p, arena, tlsfCLASSES * sizeof(TLSFBlock));
+  if (res != ResOK)
+    goto failFreeLists;
+  tlsf->freeLists = p;
+  for (i = 0; i < tlsfCLASSES; ++i)
+    tlsf->freeLists[i] = NULL;
+
+  tlsf->buckets = TLSF_BUCKETS_DEFAULT;
+  res = ControlAlloc(&p, arena, tlsf->buckets * sizeof(TLSFBlock));
+  if (res != ResOK)
+    goto failBaseTable;
+  tlsf->baseTable = p;
+  res = ControlAlloc(&p, arena, tlsf->buckets * sizeof(TLSFBlock));
+  if (res != ResOK)
+    goto failLimitTable;
+  tlsf->limitTable = p;
+  for (i = 0; i < tlsf->buckets; ++i) {
+    tlsf->baseTable[i] = NULL;
+    tlsf->limitTable[i] = NULL;
+  }
+
+  tlsf->alignShift = SizeLog2(alignment);
+  tlsf->flBitmap = 0;
+  for (i = 0; i < TLSF_FL_COUNT; ++i)
+    tlsf->slBitmap[i] = 0;
+  tlsf->blocks = 0;
+  tlsf->size = 0;
+  tlsf->hint = NULL;
+
+  SetClassOfPoly(land, CLASS(TLSF));
+  tlsf->sig = TLSFSig;
+  AVERC(TLSF, tlsf);
+
+  return ResOK;
+
+failLimitTable:
+  ControlFree(arena, tlsf->baseTable, tlsf->buckets * sizeof(TLSFBlock));
+failBaseTable:
+  ControlFree(arena, tlsf->freeLists, tlsfCLASSES * sizeof(TLSFBlock));
+failFreeLists:
+  PoolDestroy(tlsf->blockPool);
+failPoolCreate:
+  NextMethod(Inst, TLSF, finish)(MustBeA(Inst, land));
+failNextInit:
+  AVER(res != ResOK);
+  return res;
+}
+
+
+static void tlsfFinish(Inst inst)
+{
+  Land land = MustBeA(Land, inst);
+  TLSF tlsf = MustBeA(TLSF, land);
+  Arena arena = LandArena(land);
+
+  tlsf->sig = SigInvalid;
+  ControlFree(arena, tlsf->limitTable, tlsf->buckets * sizeof(TLSFBlock));
+  ControlFree(arena, tlsf->baseTable, tlsf->buckets * sizeof(TLSFBlock));
+  ControlFree(arena, tlsf->freeLists, tlsfCLASSES * sizeof(TLSFBlock));
+  /* Destroying the pool frees the descriptors of any remaining blocks. */
+  PoolDestroy(tlsf->blockPool);
+  NextMethod(Inst, TLSF, finish)(inst);
+}
+
+
+static Size tlsfSize(Land land)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  return tlsf->size;
+}
+
+
+static Res tlsfInsert(Range rangeReturn, Land land, Range range)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  TLSFBlock left, right;
+  Addr base, limit;
+  Res res;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+  AVER_CRITICAL(!RangeIsEmpty(range));
+  AVER_CRITICAL(RangeIsAligned(range, tlsfAlignment(tlsf)));
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+
+  /* See .overlap. */
+  if (tlsfBlockWithBase(tlsf, base) != NULL
+      || tlsfBlockWithLimit(tlsf, limit) != NULL)
+    return ResFAIL;
+
+  left = tlsfBlockWithLimit(tlsf, base);
+  right = tlsfBlockWithBase(tlsf, limit);
+
+  if (left != NULL && right != NULL) {
+    base = left->base;
+    limit = right->limit;
+    tlsfBlockDestroy(tlsf, right);
+    tlsfBlockSetRange(tlsf, left, base, limit);
+
+  } else if (left != NULL) {
+    base = left->base;
+    tlsfBlockSetRange(tlsf, left, base, limit);
+
+  } else if (right != NULL) {
+    limit = right->limit;
+    tlsfBlockSetRange(tlsf, right, base, limit);
+
+  } else {
+    res = tlsfBlockNew(tlsf, base, limit);
+    if (res != ResOK)
+      return res;
+  }
+
+  tlsf->size += RangeSize(range);
+  RangeInit(rangeReturn, base, limit);
+  return ResOK;
+}
+
+
+/* tlsfDeleteFromBlock -- delete range from block
+ *
+ * range must be a subset of block. Update rangeReturn to be the
+ * original range of block. If range is in the middle of block, a new
+ * descriptor is needed for the right-hand fragment, and if that can't
+ * be allocated, return the error without changing the land.
+ */
+
+static Res tlsfDeleteFromBlock(Range rangeReturn, TLSF tlsf,
+                               Range range, TLSFBlock block)
+{
+  Addr base, limit, blockBase, blockLimit;
+  Res res;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+  AVER_CRITICAL(block->base <= RangeBase(range));
+  AVER_CRITICAL(RangeLimit(range) <= block->limit);
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+  blockBase = block->base;
+  blockLimit = block->limit;
+  RangeInit(rangeReturn, blockBase, blockLimit);
+
+  if (base == blockBase && limit == blockLimit) {
+    /* No fragment at left; no fragment at right. */
+    tlsfBlockDestroy(tlsf, block);
+
+  } else if (base == blockBase) {
+    /* No fragment at left; block at right. */
+    tlsfBlockSetRange(tlsf, block, limit, blockLimit);
+
+  } else if (limit == blockLimit) {
+    /* Block at left; no fragment at right. */
+    tlsfBlockSetRange(tlsf, block, blockBase, base);
+
+  } else {
+    /* Block at left; block at right. */
+    tlsfBlockSetRange(tlsf, block, blockBase, base);
+    res = tlsfBlockNew(tlsf, limit, blockLimit);
+    if (res != ResOK) {
+      tlsfBlockSetRange(tlsf, block, blockBase, blockLimit);
+      return res;
+    }
+  }
+
+  AVER_CRITICAL(tlsf->size >= RangeSize(range));
+  tlsf->size -= RangeSize(range);
+  return ResOK;
+}
+
+
+/* tlsfBlockContaining -- find the block containing a range, if any
+ *
+ * See .delete.
+ */
+
+static TLSFBlock tlsfBlockContaining(TLSF tlsf, Addr base, Addr limit)
+{
+  TLSFBlock block;
+  Index index;
+
+  block = tlsfBlockWithBase(tlsf, base);
+  if (block != NULL)
+    return limit <= block->limit ? block : NULL;
+  block = tlsfBlockWithLimit(tlsf, limit);
+  if (block != NULL)
+    return block->base <= base ? block : NULL;
+  block = tlsf->hint;
+  if (block != NULL && block->base <= base && limit <= block->limit)
+    return block;
+
+  /* Only blocks at least as big as the range can contain it. */
+  index = tlsfClass(tlsf, AddrOffset(base, limit));
+  while (tlsfNonEmptyClass(&index, tlsf, index)) {
+    for (block = tlsf->freeLists[index]; block != NULL; block = block->next)
+      if (block->base <= base && limit <= block->limit)
+        return block;
+    ++ index;
+    if (index >= tlsfCLASSES)
+      break;
+  }
+  return NULL;
+}
+
+
+static Res tlsfDelete(Range rangeReturn, Land land, Range range)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  TLSFBlock block;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+  AVER_CRITICAL(!RangeIsEmpty(range));
+
+  block = tlsfBlockContaining(tlsf, RangeBase(range), RangeLimit(range));
+  if (block == NULL)
+    return ResFAIL;
+  return tlsfDeleteFromBlock(rangeReturn, tlsf, range, block);
+}
+
+
+static Bool tlsfIterate(Land land, LandVisitor visitor, void *closure)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  Index index;
+
+  AVER(FUNCHECK(visitor));
+  /* closure arbitrary */
+
+  for (index = 0; index < tlsfCLASSES; ++index) {
+    TLSFBlock block, next;
+    for (block = tlsf->freeLists[index]; block != NULL; block = next) {
+      RangeStruct range;
+      /* Take next before calling the visitor, in case the visitor
+       * touches the block. */
+      next = block->next;
+      RangeInit(&range, block->base, block->limit);
+      if (!(*visitor)(land, &range, closure))
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+static Bool tlsfIterateAndDelete(Land land, LandDeleteVisitor visitor,
+                                 void *closure)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  Index index;
+
+  AVER(FUNCHECK(visitor));
+  /* closure arbitrary */
+
+  for (index = 0; index < tlsfCLASSES; ++index) {
+    TLSFBlock block, next;
+    for (block = tlsf->freeLists[index]; block != NULL; block = next) {
+      Bool delete = FALSE;
+      RangeStruct range;
+      Bool cont;
+      next = block->next;
+      RangeInit(&range, block->base, block->limit);
+      cont = (*visitor)(&delete, land, &range, closure);
+      if (delete) {
+        AVER(tlsf->size >= RangeSize(&range));
+        tlsf->size -= RangeSize(&range);
+        tlsfBlockDestroy(tlsf, block);
+      }
+      if (!cont)
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+/* tlsfFindDeleteFromBlock -- delete size bytes from block
+ *
+ * As freelistFindDeleteFromBlock in <code/freelist.c>.
+ */
+
+static void tlsfFindDeleteFromBlock(Range rangeReturn, Range oldRangeReturn,
+                                    TLSF tlsf, Size size,
+                                    FindDelete findDelete, TLSFBlock block)
+{
+  Bool callDelete = TRUE;
+  Addr base, limit;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVERT_CRITICAL(FindDelete, findDelete);
+  AVER_CRITICAL(tlsfBlockSize(block) >= size);
+
+  base = block->base;
+  limit = block->limit;
+
+  switch (findDelete) {
+  case FindDeleteNONE:
+    callDelete = FALSE;
+    tlsf->hint = block; /* see .delete */
+    break;
+
+  case FindDeleteLOW:
+    limit = AddrAdd(base, size);
+    break;
+
+  case FindDeleteHIGH:
+    base = AddrSub(limit, size);
+    break;
+
+  case FindDeleteENTIRE:
+    /* do nothing */
+    break;
+
+  default:
+    NOTREACHED;
+    break;
+  }
+
+  RangeInit(rangeReturn, base, limit);
+  if (callDelete) {
+    Res res;
+    /* Deleting from one end of a block never needs a new descriptor. */
+    res = tlsfDeleteFromBlock(oldRangeReturn, tlsf, rangeReturn, block);
+    AVER_CRITICAL(res == ResOK);
+  } else {
+    RangeInit(oldRangeReturn, base, limit);
+  }
+}
+
+
+/* tlsfFind -- find a block of at least size bytes; see .fit */
+
+static Bool tlsfFind(Range rangeReturn, Range oldRangeReturn,
+                     Land land, Size size, FindDelete findDelete)
+{
+  TLSF tlsf = MustBeA_CRITICAL(TLSF, land);
+  TLSFBlock block;
+  Index index;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(SizeIsAligned(size, tlsfAlignment(tlsf)));
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (tlsfNonEmptyClass(&index, tlsf, tlsfClassAbove(tlsf, size))) {
+    block = tlsf->freeLists[index];
+  } else {
+    for (block = tlsf->freeLists[tlsfClass(tlsf, size)]; block != NULL;
+         block = block->next)
+      if (tlsfBlockSize(block) >= size)
+        break;
+    if (block == NULL)
+      return FALSE;
+  }
+
+  tlsfFindDeleteFromBlock(rangeReturn, oldRangeReturn, tlsf, size,
+                          findDelete, block);
+  return TRUE;
+}
+
+
+static Bool tlsfFindLargest(Range rangeReturn, Range oldRangeReturn,
+                            Land land, Size size, FindDelete findDelete)
+{
+  TLSF tlsf = MustBeA(TLSF, land);
+  TLSFBlock block, best;
+  Index fl, index;
+
+  AVER(rangeReturn != NULL);
+  AVER(oldRangeReturn != NULL);
+  AVERT(FindDelete, findDelete);
+
+  if (tlsf->flBitmap == 0)
+    return FALSE;
+
+  /* All blocks in the highest non-empty class are bigger than any
+   * block in a lower class. */
+  fl = tlsfHighBit(tlsf->flBitmap);
+  index = (fl << TLSF_SL_SHIFT) + tlsfHighBit(tlsf->slBitmap[fl]);
+  best = tlsf->freeLists[index];
+  AVER(best != NULL);
+  for (block = best->next; block != NULL; block = block->next)
+    if (tlsfBlockSize(block) > tlsfBlockSize(best))
+      best = block;
+
+  if (tlsfBlockSize(best) < size)
+    return FALSE;
+
+  tlsfFindDeleteFromBlock(rangeReturn, oldRangeReturn, tlsf,
+                          tlsfBlockSize(best), findDelete, best);
+  return TRUE;
+}
+
+
+/* tlsfDescribeVisitor -- visitor method for tlsfDescribe
+ *
+ * Writes a decription of the range into the stream pointed to by
+ * closure.
+ */
+
+typedef struct TLSFDescribeClosureStruct {
+  mps_lib_FILE *stream;
+  Count depth;
+} TLSFDescribeClosureStruct, *TLSFDescribeClosure;
+
+static Bool tlsfDescribeVisitor(Land land, Range range, void *closure)
+{
+  Res res;
+  TLSFDescribeClosure my = closure;
+
+  if (!TESTT(Land, land))
+    return FALSE;
+  if (!RangeCheck(range))
+    return FALSE;
+  if (my->stream == NULL)
+    return FALSE;
+
+  res = WriteF(my->stream, my->depth,
+               "[$P,", (WriteFP)RangeBase(range),
+               "$P)", (WriteFP)RangeLimit(range),
+               " {$U}\n", (WriteFU)RangeSize(range),
+               NULL);
+
+  return res == ResOK;
+}
+
+
+static Res tlsfDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  Land land = CouldBeA(Land, inst);
+  TLSF tlsf = CouldBeA(TLSF, land);
+  Res res;
+  Bool b;
+  TLSFDescribeClosureStruct closure;
+
+  if (!TESTC(TLSF, tlsf))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  res = NextMethod(Inst, TLSF, describe)(inst, stream, depth);
+  if (res != ResOK)
+    return res;
+
+  res = WriteF(stream, depth + 2,
+               "blockPool $P\n", (WriteFP)tlsf->blockPool,
+               "flBitmap  $B\n", (WriteFB)tlsf->flBitmap,
+               "buckets   $U\n", (WriteFU)tlsf->buckets,
+               "blocks    $U\n", (WriteFU)tlsf->blocks,
+               "size      $U\n", (WriteFU)tlsf->size,
+               NULL);
+  if (res != ResOK)
+    return res;
+
+  closure.stream = stream;
+  closure.depth = depth + 2;
+  b = LandIterate(land, tlsfDescribeVisitor, &closure);
+  if (!b)
+    return ResFAIL;
+
+  return ResOK;
+}
+
+
+DEFINE_CLASS(Land, TLSF, klass)
+{
+  INHERIT_CLASS(klass, TLSF, Land);
+  klass->instClassStruct.describe = tlsfDescribe;
+  klass->instClassStruct.finish = tlsfFinish;
+  klass->size = sizeof(TLSFStruct);
+  klass->init = tlsfInit;
+  klass->sizeMethod = tlsfSize;
+  klass->insert = tlsfInsert;
+  klass->delete = tlsfDelete;
+  klass->iterate = tlsfIterate;
+  klass->iterateAndDelete = tlsfIterateAndDelete;
+  klass->findFirst = tlsfFind;
+  klass->findLast = tlsfFind;
+  klass->findLargest = tlsfFindLargest;
+  AVERT(LandClass, klass);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
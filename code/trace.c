@@ -110,18 +110,20 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   ScanStateSetZoneShift(ss, arena->zoneShift);
   ScanStateSetUnfixedSummary(ss, RefSetEMPTY);
   ss->fixedSummary = RefSetEMPTY;
+  ss->genSummary = GenSetEMPTY;
   ss->arena = arena;
   ss->wasMarked = TRUE;
   ScanStateSetWhite(ss, white);
-  STATISTIC(ss->fixRefCount = (Count)0);
+  ss->fixRefCount = (Count)0;
   STATISTIC(ss->segRefCount = (Count)0);
-  STATISTIC(ss->whiteSegRefCount = (Count)0);
+  ss->whiteSegRefCount = (Count)0;
   STATISTIC(ss->nailCount = (Count)0);
   STATISTIC(ss->snapCount = (Count)0);
   STATISTIC(ss->forwardedCount = (Count)0);
   STATISTIC(ss->preservedInPlaceCount = (Count)0);
   STATISTIC(ss->copiedSize = (Size)0);
   ss->scannedSize = (Size)0; /* see .work */
+  STATISTIC(ss->skippedSize = (Size)0);
   ss->sig = ScanStateSig;
 
   AVERT(ScanState, ss);
@@ -298,6 +300,7 @@ static void traceUpdateCounts(Trace trace, ScanState ss,
     case traceAccountingPhaseRootScan: {
       trace->rootScanSize += ss->scannedSize;
       STATISTIC(trace->rootCopiedSize += ss->copiedSize);
+      STATISTIC(trace->rootSkippedSize += ss->skippedSize);
       STATISTIC(++trace->rootScanCount);
       break;
     }
@@ -315,9 +318,9 @@ static void traceUpdateCounts(Trace trace, ScanState ss,
     default:
       NOTREACHED;
   }
-  STATISTIC(trace->fixRefCount += ss->fixRefCount);
+  trace->fixRefCount += ss->fixRefCount;
   STATISTIC(trace->segRefCount += ss->segRefCount);
-  STATISTIC(trace->whiteSegRefCount += ss->whiteSegRefCount);
+  trace->whiteSegRefCount += ss->whiteSegRefCount;
   STATISTIC(trace->nailCount += ss->nailCount);
   STATISTIC(trace->snapCount += ss->snapCount);
   STATISTIC(trace->forwardedCount += ss->forwardedCount);
@@ -359,6 +362,31 @@ static ZoneSet traceSetWhiteUnion(TraceSet ts, Arena arena)
 }
 
 
+/* traceUpdateReadBarrier -- update the software read barrier
+ *
+ * Must be called whenever arena->flippedTraces changes. The epoch
+ * counts flips, so that a client reading through the barrier can tell
+ * if a flip happened while it was reading. See
+ * <design/poolawl#.soft.order>.
+ */
+
+static void traceUpdateReadBarrier(Arena arena, Bool flip)
+{
+  ZoneSet white = traceSetWhiteUnion(arena->flippedTraces, arena);
+  arena->rb_s._zs = arena->zoneShift;
+  /* The white set shrinks without a flip when a trace finishes, so
+     it must be stored after the references the trace splatted. See
+     <code/mps.h#.rb.order>. */
+#if defined(ATOMIC_STORE_RELEASE)
+  ATOMIC_STORE_RELEASE(&arena->rb_s._w, white);
+#else
+  arena->rb_s._w = white;
+#endif
+  if (flip)
+    ++arena->rb_s._epoch;
+}
+
+
 /* TraceIsEmpty -- return TRUE if trace has no condemned segments
  *
  * .empty.size: If the trace has a condemned size of zero, then it has
@@ -388,6 +416,10 @@ Res TraceAddWhite(Trace trace, Seg seg)
   pool = SegPool(seg);
   AVERT(Pool, pool);
 
+  /* Frozen segments are never condemned. See <design/seg#.frozen>. */
+  if (SegFrozen(seg))
+    return ResOK;
+
   condemnedBefore = trace->condemned;
 
   /* Give the pool the opportunity to turn the segment white. */
@@ -470,6 +502,8 @@ Res TraceCondemnEnd(double *mortalityReturn, Trace trace)
     }
     AVER(trace->condemned >= condemnedBefore);
     condemnedGen = trace->condemned - condemnedBefore;
+    if (condemnedGen > 0)
+      trace->whiteGens = GenSetAdd(trace->whiteGens, gen);
     casualtySize += (Size)((double)condemnedGen * gen->mortality);
   }
   ShieldRelease(trace->arena);
@@ -618,6 +652,7 @@ static Res traceFlip(Trace trace)
   Rank rank;
   struct rootFlipClosureStruct rfc;
   Res res;
+  Clock start = ClockNow();
 
   AVERT(Trace, trace);
   rfc.ts = TraceSetSingle(trace);
@@ -678,10 +713,12 @@ static Res traceFlip(Trace trace)
   /* Mark the trace as flipped. */
   trace->state = TraceFLIPPED;
   arena->flippedTraces = TraceSetAdd(arena->flippedTraces, trace);
+  traceUpdateReadBarrier(arena, TRUE);
 
   EVENT2(TraceFlipEnd, trace, arena);
 
   ShieldRelease(arena);
+  HistogramAdd(&arena->flipHistogram, ClockNow() - start);
   return ResOK;
 
 failRootFlip:
@@ -739,6 +776,7 @@ found:
   trace->why = why;
   trace->white = ZoneSetEMPTY;
   trace->mayMove = ZoneSetEMPTY;
+  trace->whiteGens = GenSetEMPTY;
   trace->ti = ti;
   trace->state = TraceINIT;
   trace->band = RankMIN;
@@ -755,19 +793,21 @@ found:
   STATISTIC(trace->rootScanCount = (Count)0);
   trace->rootScanSize = (Size)0;
   STATISTIC(trace->rootCopiedSize = (Size)0);
+  STATISTIC(trace->rootSkippedSize = (Size)0);
   STATISTIC(trace->segScanCount = (Count)0);
   trace->segScanSize = (Size)0; /* see .work */
   STATISTIC(trace->segCopiedSize = (Size)0);
   STATISTIC(trace->singleScanCount = (Count)0);
   STATISTIC(trace->singleScanSize = (Size)0);
   STATISTIC(trace->singleCopiedSize = (Size)0);
-  STATISTIC(trace->fixRefCount = (Count)0);
+  trace->fixRefCount = (Count)0;
   STATISTIC(trace->segRefCount = (Count)0);
-  STATISTIC(trace->whiteSegRefCount = (Count)0);
+  trace->whiteSegRefCount = (Count)0;
   STATISTIC(trace->nailCount = (Count)0);
   STATISTIC(trace->snapCount = (Count)0);
   STATISTIC(trace->readBarrierHitCount = (Count)0);
   STATISTIC(trace->pointlessScanCount = (Count)0);
+  trace->genSkipCount = (Count)0;
   STATISTIC(trace->forwardedCount = (Count)0);
   trace->forwardedSize = (Size)0; /* see .message.data */
   STATISTIC(trace->preservedInPlaceCount = (Count)0);
@@ -831,6 +871,7 @@ static void traceDestroyCommon(Trace trace)
   trace->sig = SigInvalid;
   trace->arena->busyTraces = TraceSetDel(trace->arena->busyTraces, trace);
   trace->arena->flippedTraces = TraceSetDel(trace->arena->flippedTraces, trace);
+  traceUpdateReadBarrier(trace->arena, FALSE);
 }
 
 
@@ -861,7 +902,7 @@ void TraceDestroyFinished(Trace trace)
   AVERT(Trace, trace);
   AVER(trace->state == TraceFINISHED);
 
-  STATISTIC(EVENT14(TraceStatScan, trace, trace->arena,
+  STATISTIC(EVENT15(TraceStatScan, trace, trace->arena,
                     trace->rootScanCount, trace->rootScanSize,
                     trace->rootCopiedSize,
                     trace->segScanCount, trace->segScanSize,
@@ -869,7 +910,7 @@ void TraceDestroyFinished(Trace trace)
                     trace->singleScanCount, trace->singleScanSize,
                     trace->singleCopiedSize,
                     trace->readBarrierHitCount, trace->greySegMax,
-                    trace->pointlessScanCount));
+                    trace->pointlessScanCount, trace->rootSkippedSize));
   STATISTIC(EVENT11(TraceStatFix, trace, trace->arena,
                     trace->fixRefCount, trace->segRefCount,
                     trace->whiteSegRefCount,
@@ -880,6 +921,16 @@ void TraceDestroyFinished(Trace trace)
   STATISTIC(EVENT4(TraceStatReclaim, trace, trace->arena,
                    trace->reclaimCount, trace->reclaimSize));
 
+  /* Report how well the zone check filtered references, so that the
+     effect of zone recycling <code/policy.c#zone.recycle> can be
+     measured without a statistics variety. */
+  EVENT7(TraceZoneFilter, trace, trace->arena, trace->white,
+         trace->fixRefCount, trace->whiteSegRefCount,
+         trace->arena->freeZones, trace->genSkipCount);
+  trace->arena->fixRefCount += trace->fixRefCount;
+  trace->arena->whiteSegRefCount += trace->whiteSegRefCount;
+  trace->arena->genSkipCount += trace->genSkipCount;
+
   traceDestroyCommon(trace);
 }
 
@@ -890,10 +941,10 @@ static void traceReclaim(Trace trace)
 {
   Arena arena;
   Ring genNode, genNext;
+  Clock start = ClockNow();
 
   AVER(trace->state == TraceRECLAIM);
 
-
   arena = trace->arena;
   EVENT2(TraceReclaim, trace, arena);
   RING_FOR(genNode, &trace->genRing, genNext) {
@@ -936,6 +987,8 @@ static void traceReclaim(Trace trace)
   TracePostMessage(trace);  /* trace end */
   /* Immediately pre-allocate messages for next time; failure is okay */
   (void)TraceIdMessagesCreate(arena, trace->ti);
+
+  HistogramAdd(&arena->reclaimHistogram, ClockNow() - start);
 }
 
 /* TraceRankForAccess -- Returns rank to scan at if we hit a barrier.
@@ -946,7 +999,8 @@ static void traceReclaim(Trace trace)
  * .scan.conservative: It's safe to scan at EXACT unless the band is
  * WEAK and in that case the segment should be weak.
  *
- * If the trace band is EXACT then we scan EXACT. This might prevent
+ * If the trace band is AMBIG (the trace has flipped but not yet looked
+ * for grey segments) or EXACT then we scan EXACT. This might prevent
  * finalisation messages and may preserve objects pointed to only by weak
  * references but tough luck -- the mutator wants to look.
  *
@@ -985,8 +1039,9 @@ Rank TraceRankForAccess(Arena arena, Seg seg)
   rankSet = SegRankSet(seg);
   switch(band) {
   case RankAMBIG:
-    NOTREACHED;
-    break;
+    /* The trace has flipped but hasn't yet looked for grey segments,
+       so it's still in its first band. Scan at EXACT, as in the EXACT
+       band. */
   case RankEXACT:
     return RankEXACT;
   case RankFINAL:
@@ -1171,6 +1226,36 @@ void ScanStateUpdateSummary(ScanState ss, Seg seg, Bool wasTotal)
   SegSetSummary(seg, summary);
 }
 
+/* .gen.summary: Generation summaries
+ *
+ * Zone sets are coarse: once several generations share zones, the
+ * summary of an old segment intersects the white set of every minor
+ * collection, and so the segment is scanned every time even if it
+ * has no references to young objects.
+ *
+ * So while scanning a segment, TraceFix also notes the generation of
+ * each segment that a reference passing the zone check points to
+ * (ss->genSummary). After a total scan at an exact or weak rank with
+ * white set W, every reference in the segment either has a zone
+ * outside W, or refers to a segment in one of the noted generations.
+ * SegSetGenSummary records this with the segment. (Ambiguous
+ * references may point anywhere, and final references may outlive
+ * the pool of their object, so scans at those ranks are not used.) A later trace
+ * whose white set is a subset of W, and whose condemned generations
+ * (trace->whiteGens) are disjoint from the noted ones, can't find a
+ * reference to a white object in the segment, so TraceStart needn't
+ * make it grey.
+ *
+ * Any write to the segment passes through SegSetSummary (by way of the
+ * write barrier), which forgets the generation summary, so it is only
+ * recorded when the write barrier is raised. References to memory that
+ * is not in a generation are not noted: exact references must refer to
+ * valid objects, and that memory can't become part of a generation
+ * while it is referred to. Generations are noted by serial number
+ * modulo the word width, so distinct generations may alias, which is
+ * safe but imprecise.
+ */
+
 /* traceScanSegRes -- scan a segment to remove greyness
  *
  * @@@@ During scanning, the segment should be write-shielded to prevent
@@ -1228,8 +1313,10 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
 
     /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
-    /* Did the segment refer to the white set? */
-    if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
+    /* Did the segment refer to the white set?  References that merely
+       pass the zone check don't count: the segment may still get a
+       generation summary. See .gen.summary. */
+    if (ss->whiteSegRefCount == 0) {
       /* Boring scan.  One step closer to raising the write barrier. */
       if (seg->defer > 0)
         --seg->defer;
@@ -1240,6 +1327,8 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     }
 
     ScanStateUpdateSummary(ss, seg, res == ResOK && wasTotal);
+    if (res == ResOK && wasTotal && (rank == RankEXACT || rank == RankWEAK))
+      SegSetGenSummary(seg, white, ss->genSummary);
     ScanStateFinish(ss);
   }
 
@@ -1347,6 +1436,21 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
 }
 
 
+/* scanStateNoteGen -- note the generation of a referenced segment
+ *
+ * See .gen.summary.
+ */
+
+#define scanStateNoteGen(ss, seg) \
+  BEGIN \
+    if (IsA(GCSeg, seg)) { \
+      GenDesc _gen = CouldBeA(GCSeg, seg)->gen; \
+      if (_gen != NULL) \
+        (ss)->genSummary = GenSetAdd((ss)->genSummary, _gen); \
+    } \
+  END
+
+
 /* _mps_fix2 (a.k.a. "TraceFix") -- second stage of fixing a reference
  *
  * _mps_fix2 is on the [critical path](../design/critical-path.txt).  A
@@ -1382,7 +1486,7 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
                              ZoneSetAddAddr(ss->arena, ZoneSetEMPTY, ref)) !=
                 ZoneSetEMPTY);
 
-  STATISTIC(++ss->fixRefCount);
+  ++ss->fixRefCount;
   EVENT_CRITICAL4(TraceFix, ss, mps_ref_io, ref, ss->rank);
 
   /* This sequence of tests is equivalent to calling TractOfAddr(),
@@ -1423,11 +1527,12 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
       ++ss->segRefCount;
       EVENT_CRITICAL1(TraceFixSeg, seg);
     });
+    scanStateNoteGen(ss, seg);
     goto done;
   }
 
   STATISTIC(++ss->segRefCount);
-  STATISTIC(++ss->whiteSegRefCount);
+  ++ss->whiteSegRefCount;
   EVENT_CRITICAL1(TraceFixSeg, seg);
   res = (*ss->fix)(seg, ss, &ref);
   if (res != ResOK) {
@@ -1444,6 +1549,11 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
     return res;
   }
 
+  /* The object may have moved, so note the generation of its new
+     location. See .gen.summary. */
+  if (ref == (Ref)*mps_ref_io || SegOfAddr(&seg, ss->arena, ref))
+    scanStateNoteGen(ss, seg);
+
 done:
   /* <design/trace#.fix.fixed.all> */
   ss->fixedSummary = RefSetAdd(ss->arena, ss->fixedSummary, ref);
@@ -1641,12 +1751,20 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
         /* of references in the segment intersects with the */
         /* approximation to the white set. */
         if(ZoneSetInter(SegSummary(seg), trace->white) != ZoneSetEMPTY) {
-          /* Note: can a white seg get greyed as well?  At this point */
-          /* we still assume it may.  (This assumption runs out in */
-          /* PoolTrivGrey). */
-          SegGreyen(seg, trace);
-          if(TraceSetIsMember(SegGrey(seg), trace)) {
-            trace->foundation += size;
+          if (!TraceSetIsMember(SegWhite(seg), trace)
+              && SegGenSummaryExcludes(seg, trace->white, trace->whiteGens))
+          {
+            /* No references to the condemned generations: see
+               .gen.summary. */
+            ++trace->genSkipCount;
+          } else {
+            /* Note: can a white seg get greyed as well?  At this point */
+            /* we still assume it may.  (This assumption runs out in */
+            /* PoolTrivGrey). */
+            SegGreyen(seg, trace);
+            if(TraceSetIsMember(SegGrey(seg), trace)) {
+              trace->foundation += size;
+            }
           }
         }
 
@@ -1895,6 +2013,8 @@ Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth)
                "  rootScanSize $U\n", (WriteFU)trace->rootScanSize,
                STATISTIC_WRITE("  rootCopiedSize $U\n",
                                (WriteFU)trace->rootCopiedSize)
+               STATISTIC_WRITE("  rootSkippedSize $U\n",
+                               (WriteFU)trace->rootSkippedSize)
                "  segScanSize $U\n", (WriteFU)trace->segScanSize,
                STATISTIC_WRITE("  segCopiedSize $U\n",
                                (WriteFU)trace->segCopiedSize)
@@ -116,6 +116,7 @@ static MessageClassStruct TraceStartMessageClassStruct = {
   MessageNoGCLiveSize,           /* GCLiveSize */
   MessageNoGCCondemnedSize,      /* GCCondemnedSize */
   MessageNoGCNotCondemnedSize,   /* GCNotCondemnedSize */
+  MessageNoGCCensus,             /* GCCensus */
   TraceStartMessageWhy,          /* GCStartWhy */
   MessageClassSig                /* <design/message#.class.sig.double> */
 };
@@ -257,6 +258,8 @@ typedef struct TraceMessageStruct  {
   Size liveSize;
   Size condemnedSize;
   Size notCondemnedSize;
+  Count censusCount[CensusTYPES]; /* objects of each type, .census */
+  Size censusSize[CensusTYPES];   /* bytes of each type, .census */
   MessageStruct messageStruct;
 } TraceMessageStruct;
 
@@ -325,6 +328,20 @@ static Size TraceMessageNotCondemnedSize(Message message)
   return tMessage->notCondemnedSize;
 }
 
+static void TraceMessageCensus(Count *countReturn, Size *sizeReturn,
+                               Message message, Index type)
+{
+  TraceMessage tMessage;
+
+  AVERT(Message, message);
+  tMessage = MessageTraceMessage(message);
+  AVERT(TraceMessage, tMessage);
+  AVER(type < CensusTYPES);
+
+  *countReturn = tMessage->censusCount[type];
+  *sizeReturn = tMessage->censusSize[type];
+}
+
 static MessageClassStruct TraceMessageClassStruct = {
   MessageClassSig,               /* sig */
   "TraceGC",                     /* name */
@@ -334,12 +351,15 @@ static MessageClassStruct TraceMessageClassStruct = {
   TraceMessageLiveSize,          /* GCLiveSize */
   TraceMessageCondemnedSize,     /* GCCondemnedSize */
   TraceMessageNotCondemnedSize,  /* GCNotCondemnedSize */
+  TraceMessageCensus,            /* GCCensus */
   MessageNoGCStartWhy,           /* GCStartWhy */
   MessageClassSig                /* <design/message#.class.sig.double> */
 };
 
 static void traceMessageInit(Arena arena, TraceMessage tMessage)
 {
+  Index i;
+
   AVERT(Arena, arena);
 
   MessageInit(arena, TraceMessageMessage(tMessage),
@@ -347,6 +367,10 @@ static void traceMessageInit(Arena arena, TraceMessage tMessage)
   tMessage->liveSize = (Size)0;
   tMessage->condemnedSize = (Size)0;
   tMessage->notCondemnedSize = (Size)0;
+  for (i = 0; i < CensusTYPES; ++i) {
+    tMessage->censusCount[i] = 0;
+    tMessage->censusSize[i] = 0;
+  }
 
   tMessage->sig = TraceMessageSig;
   AVERT(TraceMessage, tMessage);
@@ -394,6 +418,43 @@ void TracePostMessage(Trace trace)
 
 
 
+/* TraceCensus -- count a preserved object in the census
+ *
+ * .census: If the format has a census method, pools call this for
+ * each object that they preserve (by copying it or by marking it)
+ * while the traces in ts are running, and the object is counted in
+ * the census of each trace's end message.  The census is accumulated
+ * directly in the pre-allocated message, so if there is no message
+ * there is no census.  Type ids that are out of range are counted as
+ * the last type.  obj is the client pointer to the object, and size
+ * is its size including any header.
+ */
+
+void TraceCensus(TraceSet ts, Arena arena, Format format,
+                 Addr obj, Size size)
+{
+  TraceId ti;
+  Trace trace;
+  Index type;
+
+  AVERT_CRITICAL(TraceSet, ts);
+  AVERT_CRITICAL(Format, format);
+  AVER_CRITICAL(format->census != NULL);
+
+  type = (Index)(*format->census)(obj);
+  if (type >= CensusTYPES)
+    type = CensusTYPES - 1;
+
+  TRACE_SET_ITER(ti, trace, ts, arena)
+    TraceMessage tMessage = arena->tMessage[ti];
+    if (tMessage != NULL) {
+      ++tMessage->censusCount[type];
+      tMessage->censusSize[type] += size;
+    }
+  TRACE_SET_ITER_END(ti, trace, ts, arena);
+}
+
+
 /* --------  TraceIdMessages  -------- */
 
 
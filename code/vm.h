@@ -45,10 +45,18 @@ extern Addr (VMBase)(VM vm);
 extern Addr (VMLimit)(VM vm);
 extern Res VMMap(VM vm, Addr base, Addr limit);
 extern void VMUnmap(VM vm, Addr base, Addr limit);
+extern void VMPrefault(VM vm, Addr base, Addr limit);
+extern Bool VMMapZeroes(void);
 extern Size (VMReserved)(VM vm);
 extern Size (VMMapped)(VM vm);
 extern void VMCopy(VM dest, VM src);
 
+/* Memory nodes.  <design/vm#.if.node.count> */
+
+extern Count VMNodeCount(void);
+extern Index VMCurrentNode(void);
+extern Res VMBind(VM vm, Addr base, Addr limit, Index node);
+
 
 #endif /* vm_h */
 
@@ -147,6 +147,45 @@ void VMUnmap(VM vm, Addr base, Addr limit)
 }
 
 
+/* VMPrefault -- nothing to do, since VMMap has written the memory */
+
+void VMPrefault(VM vm, Addr base, Addr limit)
+{
+  AVER(VMBase(vm) <= base);
+  AVER(base < limit);
+  AVER(limit <= VMLimit(vm));
+}
+
+
+/* VMMapZeroes -- no: VMMap fills the memory with junk */
+
+Bool VMMapZeroes(void)
+{
+  return FALSE;
+}
+
+
+/* Memory nodes -- there is only one.  <design/vm#.impl.an.node> */
+
+Count VMNodeCount(void)
+{
+  return 1;
+}
+
+Index VMCurrentNode(void)
+{
+  return 0;
+}
+
+Res VMBind(VM vm, Addr base, Addr limit, Index node)
+{
+  AVERT(VM, vm);
+  AVER(base < limit);
+  UNUSED(node);
+  return ResUNIMPL;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
@@ -51,6 +51,12 @@
 #include <sys/types.h> /* mmap, munmap */
 #include <unistd.h> /* getpagesize */
 
+#if defined(MPS_OS_LI)
+#include <limits.h> /* CHAR_BIT */
+#include <linux/mempolicy.h> /* MPOL_PREFERRED etc. */
+#include <sys/syscall.h> /* SYS_mbind etc. */
+#endif
+
 SRCID(vmix, "$Id$");
 
 
@@ -218,6 +224,131 @@ void VMUnmap(VM vm, Addr base, Addr limit)
 }
 
 
+/* VMPrefault -- fault in mapped memory before it is needed
+ *
+ * See <design/vm#.if.prefault>.  MADV_POPULATE_WRITE (Linux 5.14)
+ * populates the page tables in one call; without it, touch each page.
+ * The memory is freshly mapped, so writing zero changes nothing.
+ */
+
+void VMPrefault(VM vm, Addr base, Addr limit)
+{
+  Addr p;
+
+  AVERT(VM, vm);
+  AVER(base < limit);
+  AVER(base >= VMBase(vm));
+  AVER(limit <= VMLimit(vm));
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+
+#if defined(MADV_POPULATE_WRITE)
+  if (madvise((void *)base, (size_t)AddrOffset(base, limit),
+              MADV_POPULATE_WRITE) == 0)
+    return;
+#endif
+  for (p = base; p < limit; p = AddrAdd(p, vm->pageSize))
+    *(volatile Word *)p = 0;
+}
+
+
+/* VMMapZeroes -- yes: anonymous mappings are zero-filled */
+
+Bool VMMapZeroes(void)
+{
+  return TRUE;
+}
+
+
+/* Memory nodes
+ *
+ * See <design/vm#.impl.ix.node>.  .node.mask: The node masks passed
+ * to the kernel are arrays of unsigned long with room for
+ * VMIX_NODE_MAX nodes; nodes beyond that are treated as absent.
+ */
+
+#if defined(MPS_OS_LI)
+
+#define VMIX_NODE_MAX 1024
+#define VMIX_NODE_WORDS (VMIX_NODE_MAX / (sizeof(unsigned long) * CHAR_BIT))
+
+Count VMNodeCount(void)
+{
+  unsigned long mask[VMIX_NODE_WORDS];
+  Count count = 0;
+  size_t i;
+
+  if (syscall(SYS_get_mempolicy, NULL, mask, (unsigned long)VMIX_NODE_MAX,
+              NULL, (unsigned long)MPOL_F_MEMS_ALLOWED) != 0)
+    return 1;
+  for (i = 0; i < VMIX_NODE_WORDS; ++i) {
+    unsigned long w = mask[i];
+    while (w != 0) {
+      w &= w - 1;
+      ++count;
+    }
+  }
+  return count == 0 ? 1 : count;
+}
+
+Index VMCurrentNode(void)
+{
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0
+      || node >= VMIX_NODE_MAX)
+    return 0;
+  return (Index)node;
+}
+
+Res VMBind(VM vm, Addr base, Addr limit, Index node)
+{
+  unsigned long mask[VMIX_NODE_WORDS];
+  size_t bits = sizeof(unsigned long) * CHAR_BIT;
+  size_t i;
+
+  AVERT(VM, vm);
+  AVER(base < limit);
+  AVER(base >= VMBase(vm));
+  AVER(limit <= VMLimit(vm));
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+
+  if (node >= VMIX_NODE_MAX)
+    return ResPARAM;
+  for (i = 0; i < VMIX_NODE_WORDS; ++i)
+    mask[i] = 0;
+  mask[node / bits] = 1ul << (node % bits);
+
+  if (syscall(SYS_mbind, (void *)base, (unsigned long)AddrOffset(base, limit),
+              (unsigned long)MPOL_PREFERRED, mask,
+              (unsigned long)VMIX_NODE_MAX, 0ul) != 0)
+    return errno == ENOSYS ? ResUNIMPL : ResFAIL;
+  return ResOK;
+}
+
+#else /* !defined(MPS_OS_LI) */
+
+Count VMNodeCount(void)
+{
+  return 1;
+}
+
+Index VMCurrentNode(void)
+{
+  return 0;
+}
+
+Res VMBind(VM vm, Addr base, Addr limit, Index node)
+{
+  AVERT(VM, vm);
+  AVER(base < limit);
+  UNUSED(node);
+  return ResUNIMPL;
+}
+
+#endif /* defined(MPS_OS_LI) */
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
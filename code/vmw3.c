@@ -227,6 +227,56 @@ void VMUnmap(VM vm, Addr base, Addr limit)
 }
 
 
+/* VMPrefault -- fault in mapped memory before it is needed
+ *
+ * Committed pages are only backed on first touch, so touch each one.
+ */
+
+void VMPrefault(VM vm, Addr base, Addr limit)
+{
+  Addr p;
+
+  AVERT(VM, vm);
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+  AVER(VMBase(vm) <= base);
+  AVER(base < limit);
+  AVER(limit <= VMLimit(vm));
+
+  for (p = base; p < limit; p = AddrAdd(p, vm->pageSize))
+    *(volatile Word *)p = 0;
+}
+
+
+/* VMMapZeroes -- yes: committed pages are zero-filled */
+
+Bool VMMapZeroes(void)
+{
+  return TRUE;
+}
+
+
+/* Memory nodes -- there is only one.  <design/vm#.impl.w3.node> */
+
+Count VMNodeCount(void)
+{
+  return 1;
+}
+
+Index VMCurrentNode(void)
+{
+  return 0;
+}
+
+Res VMBind(VM vm, Addr base, Addr limit, Index node)
+{
+  AVERT(VM, vm);
+  AVER(base < limit);
+  UNUSED(node);
+  return ResUNIMPL;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2020 Ravenbrook Limited <https://www.ravenbrook.com/>.
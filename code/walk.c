@@ -455,7 +455,8 @@ static Res poolWalk(Arena arena, Pool pool, mps_area_scan_t area_scan, void *clo
   RING_FOR(node, &pool->segRing, nextNode) {
     Bool wasTotal;
     Seg seg = SegOfPoolRing(node);
-    Bool needSummary = SegRankSet(seg) != RankSetEMPTY;
+    /* The summary of a frozen segment is fixed: see <design/seg#.frozen>. */
+    Bool needSummary = SegRankSet(seg) != RankSetEMPTY && !SegFrozen(seg);
 
     if (needSummary)
       ScanStateSetSummary(&ss, RefSetEMPTY);
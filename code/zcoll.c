@@ -20,7 +20,8 @@
  *
  * [preliminary, incomplete, code still being written]
  * The commands are:
- *   Arena -- governs initial arena size, required, must be first
+ *   Arena -- governs initial arena size, and whether it is zoned,
+ *           required, must be first
  *   Make -- makes some objects, stores a proportion (chosen at
  *           random) in the specified myroot array slots, and
  *           drops the rest (which therefore become garbage)
@@ -28,6 +29,9 @@
  *           is a 40 MB 4-level tree of 10^5 objects; see .catalog;
  *           see also .catalog.broken.
  *   Collect -- request a synchronous full garbage collection
+ *   GenSkip -- makes a list of old objects and churns the nursery,
+ *           checking that minor collections skip the old segments
+ *           by their generation summaries; see .genskip.
  *
  *
  * CODE OVERVIEW
@@ -64,6 +68,7 @@
 #include "mpstd.h"
 
 #include <stdio.h> /* fflush, printf, putchar, puts, stdout */
+#include <string.h> /* strncmp */
 
 
 /* testChain -- generation parameters for the test */
@@ -587,6 +592,73 @@ static void StackScan(mps_arena_t arena, int on)
 }
 
 
+/* GenSkip -- check that minor collections skip old segments
+ *
+ * .genskip: Makes a list of objects, each referring to the one made
+ * before it and to a random earlier one, keeping only the head of
+ * the list in a root, and collects so that the list is no longer in
+ * the nursery. Then makes and drops small objects, so that the
+ * nursery is collected many times. The arena must be small and
+ * unzoned, so that the list overflows into chunks whose zones wrap
+ * around, and the random references give the list's segments zone
+ * summaries that intersect the nursery's. So only their generation
+ * summaries stop them being scanned by each minor collection. Checks
+ * that some segments were skipped, and that the list is intact.
+ */
+
+#define genSkipListSig MPS_WORD_CONST(0x0000115C)  /* LISt */
+
+static void GenSkip(mps_arena_t arena, mps_ap_t ap,
+                    unsigned objects, unsigned churn)
+{
+  mps_arena_stats_s stats;
+  size_t skipBefore;
+  mps_word_t v;
+  void *p;
+  unsigned i;
+
+  /* The list is also kept in myrootExact[1..objects] while it is
+     made, so that a random earlier object can be found. */
+  Insist(objects < myrootExactCOUNT);
+  Insist(myrootExact[0] == NULL);
+  for(i = 0; i < objects; ++i) {
+    die(make_dylan_vector(&v, ap, 4), "make_dylan_vector");
+    DYLAN_VECTOR_SLOT(v, 0) = DYLAN_INT(genSkipListSig);
+    DYLAN_VECTOR_SLOT(v, 1) = DYLAN_INT(i);
+    DYLAN_VECTOR_SLOT(v, 2) = (mps_word_t)myrootExact[0];
+    DYLAN_VECTOR_SLOT(v, 3) = (mps_word_t)myrootExact[1 + rnd() % (i + 1)];
+    myrootExact[0] = myrootExact[1 + i] = (void *)v;
+    get(arena);
+  }
+  for(i = 0; i < objects; ++i)
+    myrootExact[1 + i] = NULL;
+  stackwipe();
+  die(mps_arena_collect(arena), "mps_arena_collect");
+  mps_arena_release(arena);
+
+  stats.size = sizeof stats;
+  mps_arena_stats(&stats, arena);
+  skipBefore = stats.gen_skip;
+
+  for(i = 0; i < churn; ++i)
+    (void)MakeThing(arena, ap, 64);
+
+  mps_arena_stats(&stats, arena);
+  printf("  ...skipped %"PRIuLONGEST" segments while churning.\n",
+         (ulongest_t)(stats.gen_skip - skipBefore));
+  Insist(stats.gen_skip > skipBefore);
+
+  p = myrootExact[0];
+  for(i = objects; i > 0; --i) {
+    Insist(p != NULL);
+    Insist(DYLAN_VECTOR_SLOT(p, 0) == DYLAN_INT(genSkipListSig));
+    Insist(DYLAN_VECTOR_SLOT(p, 1) == DYLAN_INT(i - 1));
+    p = (void *)DYLAN_VECTOR_SLOT(p, 2);
+  }
+  Insist(p == NULL);
+}
+
+
 /* checksi -- check count of sscanf items is correct
  */
 
@@ -619,6 +691,17 @@ static void testscriptC(mps_arena_t arena, mps_ap_t ap, const char *script)
         mps_arena_release(arena);
         break;
       }
+      case 'G': {
+        unsigned objects = 0;
+        unsigned churn = 0;
+        si = sscanf(script, "GenSkip(objects %u, churn %u)%n",
+                    &objects, &churn, &sb);
+        checksi(si, 2, script, scriptAll);
+        script += sb;
+        printf("  GenSkip(objects %u, churn %u)\n", objects, churn);
+        GenSkip(arena, ap, objects, churn);
+        break;
+      }
       case 'K': {
         si = sscanf(script, "Katalog()%n",
                        &sb);
@@ -784,19 +867,28 @@ static void testscriptA(const char *script)
   mps_arena_t arena;
   int si, sb;  /* sscanf items, sscanf bytes */
   unsigned long arenasize = 0;
+  mps_bool_t zoned = TRUE;
   mps_thr_t thr;
   testDataStruct testData;
 
-  si = sscanf(script, "Arena(size %lu)%n", &arenasize, &sb);
+  si = sscanf(script, "Arena(size %lu%n", &arenasize, &sb);
   cdie(si == 1, "bad script command: Arena(size %%lu)");
   script += sb;
-  printf("  Create arena, size = %lu.\n", arenasize);
+  if(strncmp(script, ", unzoned", 9) == 0) {
+    zoned = FALSE;
+    script += 9;
+  }
+  cdie(*script == ')', "bad script command: Arena(size %%lu)");
+  script += 1;
+  printf("  Create arena, size = %lu%s.\n", arenasize,
+         zoned ? "" : ", unzoned");
 
   /* arena */
   MPS_ARGS_BEGIN(args) {
     /* Randomize pause time as a regression test for job004011. */
     MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, rnd_pause_time());
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arenasize);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
         "arena_create\n");
   } MPS_ARGS_END(args);
@@ -907,6 +999,10 @@ int main(int argc, char *argv[])
   testscriptA("Arena(size 16777216), BigdropSmall(big 28000, small E), Collect.");
   testscriptA("Arena(size 16777216), BigdropSmall(big 29000, small E), Collect.");
 
+  /* See .genskip. */
+  testscriptA("Arena(size 1048576, unzoned), "
+              "GenSkip(objects 20000, churn 200000), Collect.");
+
   /* 16<<20 == 16777216 == 16 Mebibyte */
   /* See .catalog.broken.
   testscriptA("Arena(size 16777216), Katalog(), Collect.");
@@ -39,6 +39,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <setjmp.h>
 #include <stdarg.h>
@@ -46,6 +47,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "mps.h"
 #include "mpsavm.h"
@@ -4231,6 +4234,415 @@ static void mps_chat(void)
 }
 
 
+/* IMAGES                                                       %%MPS
+ *
+ * An image is a snapshot of the Scheme heap, saved to a file by the
+ * `-s` option after loading the program's files. A later run of the
+ * interpreter with the `-i` option maps the image back into memory at
+ * its original addresses before creating the arena, so the objects in
+ * it can be used straight away without running the code that built
+ * them.
+ *
+ * The image is saved by parking the arena and walking the formatted
+ * areas of `obj_pool` with `mps_pool_walk`. See topic/pool. The areas
+ * are gathered into page-aligned spans, and the gaps between areas
+ * are filled with padding objects so that each span can be scanned
+ * by `obj_scan`. Only the objects are saved, not the MPS data
+ * structures that describe the pool, which refer to process-specific
+ * state. So the restored objects are outside the arena: they are
+ * never moved or recycled, and each span is registered as a
+ * protectable root so that the MPS can find the references from them
+ * to objects allocated after the image was restored. Because the
+ * spans are protected by a write barrier, a span that doesn't change
+ * costs almost nothing to keep as a root. See topic/root.
+ */
+
+#define IMAGE_MAGIC "MPSIMG1"
+
+/* image_span_s -- a block of memory saved in an image */
+
+typedef struct image_span_s {
+  char *base;                   /* original address of the block */
+  size_t size;                  /* size of the block in bytes */
+} image_span_s;
+
+/* image_header_s -- the header of an image file
+ *
+ * The header is followed by the span table, then the symbol table,
+ * then, starting at the next page boundary, the contents of each span
+ * in turn.
+ */
+
+typedef struct image_header_s {
+  char magic[sizeof IMAGE_MAGIC];
+  size_t page_size;             /* page size when saved */
+  mps_word_t text;              /* address of `image_map` when saved */
+  size_t spans;                 /* number of spans */
+  size_t symtab_size;           /* number of symbol table entries */
+  obj_t env, op_env;            /* global environments */
+  obj_t specials[LENGTH(sptab)];
+  obj_t symbols[LENGTH(isymtab)];
+} image_header_s;
+
+/* image_areas_s -- growable array of formatted areas */
+
+typedef struct image_areas_s {
+  size_t count;                 /* number of areas */
+  size_t size;                  /* number of areas allocated */
+  image_span_s *area;           /* the areas */
+} image_areas_s;
+
+static image_header_s image_header;     /* header of restored image */
+static image_span_s *image_spans;       /* spans restored, or NULL */
+static obj_t *image_symtab;             /* symbol table restored */
+static mps_root_t *image_roots;         /* roots for restored spans */
+static const char *image_output;        /* file to save image to */
+
+#define IMAGE_ALIGN_DOWN(p, align) \
+  ((char *)((mps_word_t)(p) & ~(mps_word_t)((align) - 1)))
+#define IMAGE_ALIGN_UP(p, align) \
+  IMAGE_ALIGN_DOWN((char *)(p) + (align) - 1, align)
+
+/* The flags for mapping a span. MAP_FIXED_NOREPLACE makes the mapping
+   fail rather than land somewhere else; without it, the address is a
+   hint, and `image_map` checks that it was honoured. */
+
+#ifdef MAP_FIXED_NOREPLACE
+#define IMAGE_MAP_FLAGS (MAP_PRIVATE | MAP_FIXED_NOREPLACE)
+#else
+#define IMAGE_MAP_FLAGS MAP_PRIVATE
+#endif
+
+
+static int image_areas_add(image_areas_s *areas, void *base, void *limit)
+{
+  if (areas->count == areas->size) {
+    size_t size = areas->size == 0 ? 64 : areas->size * 2;
+    image_span_s *area = realloc(areas->area, size * sizeof area[0]);
+    if (area == NULL)
+      return 0;
+    areas->area = area;
+    areas->size = size;
+  }
+  areas->area[areas->count].base = base;
+  areas->area[areas->count].size = (size_t)((char *)limit - (char *)base);
+  ++ areas->count;
+  return 1;
+}
+
+static int image_areas_compare(const void *a, const void *b)
+{
+  const image_span_s *area_a = a, *area_b = b;
+  if (area_a->base < area_b->base)
+    return -1;
+  return area_a->base > area_b->base;
+}
+
+
+/* image_area_scan -- record a formatted area for image_save    %%MPS
+ *
+ * This is the area scanning function passed to `mps_pool_walk`. It
+ * records the location of the area, and scans it as the protocol
+ * requires. It's called while the MPS holds the arena lock, so it
+ * mustn't call `error` (which would jump out of the MPS); it reports
+ * failure through its result instead. See topic/pool.
+ */
+
+static mps_res_t image_area_scan(mps_ss_t ss, void *base, void *limit,
+                                 void *closure)
+{
+  if (!image_areas_add(closure, base, limit))
+    return MPS_RES_MEMORY;
+  return obj_scan(ss, base, limit);
+}
+
+
+/* image_clean -- remove process-specific state from saved objects
+ *
+ * `base` and `limit` bound a copy of a formatted area that is about
+ * to be written to an image. Ports refer to open files, which don't
+ * survive into a new process, so they are saved closed.
+ */
+
+static void image_clean(char *base, char *limit)
+{
+  while (base < limit) {
+    obj_t obj = (obj_t)base;
+    if (TYPE(obj) == TYPE_PORT)
+      obj->port.stream = NULL;
+    base = obj_skip(base);
+  }
+}
+
+
+/* image_relocate -- adjust references to the program in restored objects
+ *
+ * Some objects refer to functions or string constants in the program,
+ * which may be loaded at a different address in this process (for
+ * example, because of address space layout randomization). The whole
+ * program moves together, so all these references move by the same
+ * amount as `image_map`.
+ */
+
+static void image_relocate(char *base, char *limit, mps_word_t delta)
+{
+  while (base < limit) {
+    obj_t obj = (obj_t)base;
+    switch (TYPE(obj)) {
+    case TYPE_SPECIAL:
+      obj->special.name =
+        (const char *)((mps_word_t)obj->special.name + delta);
+      break;
+    case TYPE_OPERATOR:
+      obj->operator.name =
+        (const char *)((mps_word_t)obj->operator.name + delta);
+      obj->operator.entry =
+        (entry_t)((mps_word_t)obj->operator.entry + delta);
+      break;
+    case TYPE_TABLE:
+      obj->table.hash = (hash_t)((mps_word_t)obj->table.hash + delta);
+      obj->table.cmp = (cmp_t)((mps_word_t)obj->table.cmp + delta);
+      break;
+    }
+    base = obj_skip(base);
+  }
+}
+
+
+/* image_map -- map an image file into memory                   %%MPS
+ *
+ * This must be called before the arena is created, so that the arena
+ * doesn't reserve the addresses that the image needs. It returns 0
+ * and sets `image_spans` if the image was mapped; otherwise it
+ * reports the problem on stderr and returns 1. The caller can then
+ * fall back to building the heap from scratch.
+ */
+
+static int image_map(const char *filename)
+{
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t i, spans_size, symtab_bytes, offset;
+  mps_word_t delta;
+  int fd;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Couldn't open image %s: %s\n", filename, strerror(errno));
+    return 1;
+  }
+  if (read(fd, &image_header, sizeof image_header)
+      != (ssize_t)sizeof image_header
+      || memcmp(image_header.magic, IMAGE_MAGIC, sizeof IMAGE_MAGIC) != 0
+      || image_header.page_size != page_size)
+  {
+    fprintf(stderr, "%s is not an image for this program\n", filename);
+    close(fd);
+    return 1;
+  }
+
+  spans_size = image_header.spans * sizeof image_spans[0];
+  symtab_bytes = image_header.symtab_size * sizeof image_symtab[0];
+  image_spans = malloc(spans_size);
+  image_symtab = malloc(symtab_bytes);
+  if (image_spans == NULL || image_symtab == NULL
+      || read(fd, image_spans, spans_size) != (ssize_t)spans_size
+      || read(fd, image_symtab, symtab_bytes) != (ssize_t)symtab_bytes)
+  {
+    fprintf(stderr, "Couldn't read image %s\n", filename);
+    goto failRead;
+  }
+
+  offset = sizeof image_header + spans_size + symtab_bytes;
+  offset = (offset + page_size - 1) / page_size * page_size;
+  for (i = 0; i < image_header.spans; ++i) {
+    void *p = mmap(image_spans[i].base, image_spans[i].size,
+                   PROT_READ | PROT_WRITE, IMAGE_MAP_FLAGS,
+                   fd, (off_t)offset);
+    if (p != image_spans[i].base) {
+      fprintf(stderr, "Couldn't map image %s at %p\n", filename,
+              (void *)image_spans[i].base);
+      if (p != MAP_FAILED)
+        munmap(p, image_spans[i].size);
+      goto failMap;
+    }
+    offset += image_spans[i].size;
+  }
+  close(fd);
+
+  delta = (mps_word_t)image_map - image_header.text;
+  if (delta != 0)
+    for (i = 0; i < image_header.spans; ++i)
+      image_relocate(image_spans[i].base,
+                     image_spans[i].base + image_spans[i].size, delta);
+  return 0;
+
+failMap:
+  while (i > 0) {
+    --i;
+    munmap(image_spans[i].base, image_spans[i].size);
+  }
+failRead:
+  free(image_symtab);
+  free(image_spans);
+  image_symtab = NULL;
+  image_spans = NULL;
+  close(fd);
+  return 1;
+}
+
+
+/* image_restore -- make the restored objects the initial heap  %%MPS
+ *
+ * Called once the arena exists. The location dependencies of hash
+ * tables refer to the arena that saved them, so they are reset: the
+ * restored keys never move, so the tables don't depend on their
+ * locations. Then each span is registered as a root, using the format
+ * scanner to find its references. See topic/location and topic/root.
+ */
+
+static void image_restore(void)
+{
+  size_t i;
+  mps_res_t res;
+
+  for (i = 0; i < image_header.spans; ++i) {
+    char *base = image_spans[i].base;
+    char *limit = base + image_spans[i].size;
+    while (base < limit) {
+      obj_t obj = (obj_t)base;
+      if (TYPE(obj) == TYPE_TABLE)
+        mps_ld_reset(&obj->table.ld, arena);
+      base = obj_skip(base);
+    }
+  }
+
+  image_roots = malloc(image_header.spans * sizeof image_roots[0]);
+  if (image_roots == NULL)
+    error("out of memory in image_restore");
+  for (i = 0; i < image_header.spans; ++i) {
+    res = mps_root_create_fmt(&image_roots[i], arena, mps_rank_exact(),
+                              MPS_RM_PROT, obj_scan, image_spans[i].base,
+                              image_spans[i].base + image_spans[i].size);
+    if (res != MPS_RES_OK)
+      error("Couldn't register image root");
+  }
+
+  for (i = 0; i < LENGTH(sptab); ++i)
+    *sptab[i].varp = image_header.specials[i];
+  for (i = 0; i < LENGTH(isymtab); ++i)
+    *isymtab[i].varp = image_header.symbols[i];
+}
+
+
+/* image_save -- save the heap to an image file                 %%MPS */
+
+static void image_save(const char *filename, obj_t env, obj_t op_env)
+{
+  image_areas_s areas = {0, 0, NULL};
+  image_header_s header;
+  image_span_s *span;
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t i, j, spans, offset;
+  FILE *stream;
+  mps_res_t res;
+
+  /* Collect the world, so that only live objects are saved. This
+     leaves the arena parked, so nothing moves while the image is
+     written. See topic/arena. */
+  res = mps_arena_collect(arena);
+  if (res != MPS_RES_OK)
+    error("Couldn't collect: %d", res);
+  res = mps_pool_walk(obj_pool, image_area_scan, &areas);
+  if (res != MPS_RES_OK) {
+    free(areas.area);
+    mps_arena_release(arena);
+    error("Couldn't walk obj pool: %d", res);
+  }
+
+  /* Objects restored from an image aren't in the pool, but they may
+     be referenced, so they must be saved too. */
+  if (image_spans != NULL)
+    for (i = 0; i < image_header.spans; ++i)
+      if (!image_areas_add(&areas, image_spans[i].base,
+                           image_spans[i].base + image_spans[i].size))
+        error("out of memory in image_save");
+
+  qsort(areas.area, areas.count, sizeof areas.area[0], image_areas_compare);
+  span = malloc((areas.count + 1) * sizeof span[0]);
+  if (span == NULL)
+    error("out of memory in image_save");
+  spans = 0;
+  for (i = 0; i < areas.count; ++i) {
+    char *base = IMAGE_ALIGN_DOWN(areas.area[i].base, page_size);
+    char *limit = IMAGE_ALIGN_UP(areas.area[i].base + areas.area[i].size,
+                                 page_size);
+    if (spans > 0 && base <= span[spans - 1].base + span[spans - 1].size) {
+      if (limit > span[spans - 1].base + span[spans - 1].size)
+        span[spans - 1].size = (size_t)(limit - span[spans - 1].base);
+    } else {
+      span[spans].base = base;
+      span[spans].size = (size_t)(limit - base);
+      ++ spans;
+    }
+  }
+
+  memset(&header, 0, sizeof header);
+  memcpy(header.magic, IMAGE_MAGIC, sizeof header.magic);
+  header.page_size = page_size;
+  header.text = (mps_word_t)image_map;
+  header.spans = spans;
+  header.symtab_size = symtab_size;
+  header.env = env;
+  header.op_env = op_env;
+  for (i = 0; i < LENGTH(sptab); ++i)
+    header.specials[i] = *sptab[i].varp;
+  for (i = 0; i < LENGTH(isymtab); ++i)
+    header.symbols[i] = *isymtab[i].varp;
+
+  stream = fopen(filename, "wb");
+  if (stream == NULL)
+    error("Couldn't open image %s: %s", filename, strerror(errno));
+  fwrite(&header, sizeof header, 1, stream);
+  fwrite(span, sizeof span[0], spans, stream);
+  fwrite(symtab, sizeof symtab[0], symtab_size, stream);
+  offset = sizeof header + spans * sizeof span[0]
+    + symtab_size * sizeof symtab[0];
+  for (; offset % page_size != 0; ++offset)
+    putc('\0', stream);
+
+  /* Write each span, filling the gaps between its areas with padding
+     objects so that the whole span is formatted. */
+  j = 0;
+  for (i = 0; i < spans; ++i) {
+    char *cursor = span[i].base;
+    char *limit = span[i].base + span[i].size;
+    char *copy = malloc(span[i].size);
+    if (copy == NULL)
+      error("out of memory in image_save");
+    memcpy(copy, span[i].base, span[i].size);
+    for (; j < areas.count && areas.area[j].base < limit; ++j) {
+      char *base = areas.area[j].base;
+      assert(cursor <= base);
+      if (cursor < base)
+        obj_pad(copy + (cursor - span[i].base), (size_t)(base - cursor));
+      cursor = base + areas.area[j].size;
+      image_clean(copy + (base - span[i].base),
+                  copy + (cursor - span[i].base));
+    }
+    if (cursor < limit)
+      obj_pad(copy + (cursor - span[i].base), (size_t)(limit - cursor));
+    fwrite(copy, span[i].size, 1, stream);
+    free(copy);
+  }
+
+  if (ferror(stream) | fclose(stream))
+    error("Couldn't write image %s", filename);
+  free(span);
+  free(areas.area);
+  mps_arena_release(arena);
+}
+
+
 /* start -- the main program                                    %%MPS
  *
  * This is the main body of the Scheme interpreter program, invoked by
@@ -4249,11 +4661,16 @@ static int start(int argc, char *argv[])
 
   total = (size_t)0;
 
-  symtab_size = 16;
-  symtab = malloc(sizeof(obj_t) * symtab_size);
-  if(symtab == NULL) error("out of memory");
-  for(i = 0; i < symtab_size; ++i)
-    symtab[i] = NULL;
+  if (image_spans != NULL) {
+    symtab_size = image_header.symtab_size;
+    symtab = image_symtab;
+  } else {
+    symtab_size = 16;
+    symtab = malloc(sizeof(obj_t) * symtab_size);
+    if(symtab == NULL) error("out of memory");
+    for(i = 0; i < symtab_size; ++i)
+      symtab[i] = NULL;
+  }
 
   /* Note that since the symbol table is an exact root we must register
      it with the MPS only after it has been initialized with scannable
@@ -4267,8 +4684,13 @@ static int start(int argc, char *argv[])
 
   error_handler = &jb;
   if(!setjmp(*error_handler)) {
-    for(i = 0; i < LENGTH(sptab); ++i)
-      *sptab[i].varp = make_special(sptab[i].name);
+    /* The objects restored from an image are outside the arena, so
+       they can be put into the globals before these are registered. */
+    if (image_spans != NULL)
+      image_restore();
+    else
+      for(i = 0; i < LENGTH(sptab); ++i)
+        *sptab[i].varp = make_special(sptab[i].name);
 
     /* By contrast with the symbol table, we *must* register the globals as
        roots before we start making things to put into them, because making
@@ -4280,20 +4702,25 @@ static int start(int argc, char *argv[])
                           globals_scan, NULL, 0);
     if (res != MPS_RES_OK) error("Couldn't register globals root");
 
-    for(i = 0; i < LENGTH(isymtab); ++i)
-      *isymtab[i].varp = intern(isymtab[i].name);
-    env = make_pair(obj_empty, obj_empty);
-    op_env = make_pair(obj_empty, obj_empty);
-    for(i = 0; i < LENGTH(funtab); ++i)
-      define(env,
-             intern(funtab[i].name),
-             make_operator(funtab[i].name, funtab[i].entry,
-                           obj_empty, obj_empty, env, op_env));
-    for(i = 0; i < LENGTH(optab); ++i)
-      define(op_env,
-             intern(optab[i].name),
-             make_operator(optab[i].name, optab[i].entry,
-                           obj_empty, obj_empty, env, op_env));
+    if (image_spans != NULL) {
+      env = image_header.env;
+      op_env = image_header.op_env;
+    } else {
+      for(i = 0; i < LENGTH(isymtab); ++i)
+        *isymtab[i].varp = intern(isymtab[i].name);
+      env = make_pair(obj_empty, obj_empty);
+      op_env = make_pair(obj_empty, obj_empty);
+      for(i = 0; i < LENGTH(funtab); ++i)
+        define(env,
+               intern(funtab[i].name),
+               make_operator(funtab[i].name, funtab[i].entry,
+                             obj_empty, obj_empty, env, op_env));
+      for(i = 0; i < LENGTH(optab); ++i)
+        define(op_env,
+               intern(optab[i].name),
+               make_operator(optab[i].name, optab[i].entry,
+                             obj_empty, obj_empty, env, op_env));
+    }
   } else {
     fflush(stdout);
     fprintf(stderr,
@@ -4313,6 +4740,8 @@ static int start(int argc, char *argv[])
       int a;
       for (a = 0; a < argc; ++a)
         load(env, op_env, make_string(strlen(argv[a]), argv[a]));
+      if (image_output != NULL)
+        image_save(image_output, env, op_env);
     }
   } else {
     /* Ask the MPS to tell us when it's garbage collecting so that we can
@@ -4350,6 +4779,9 @@ static int start(int argc, char *argv[])
   /* See comment at the end of `main` about cleaning up. */
   mps_root_destroy(symtab_root);
   mps_root_destroy(globals_root);
+  if (image_roots != NULL)
+    for (i = 0; i < image_header.spans; ++i)
+      mps_root_destroy(image_roots[i]);
   return exit_code;
 }
 
@@ -4389,9 +4821,10 @@ int main(int argc, char *argv[])
   mps_root_t reg_root;
   int exit_code;
   void *marker = &marker;
+  const char *image_input = NULL;
   int ch;
 
-  while ((ch = getopt(argc, argv, "m:")) != -1)
+  while ((ch = getopt(argc, argv, "i:m:s:")) != -1)
     switch (ch) {
     case 'm': {
         char *p;
@@ -4407,12 +4840,22 @@ int main(int argc, char *argv[])
         }
       }
       break;
+    case 'i':
+      image_input = optarg;
+      break;
+    case 's':
+      image_output = optarg;
+      break;
     default:
       fprintf(stderr,
               "Usage: %s [option...] [file...]\n"
               "Options:\n"
+              "  -i image\n"
+              "    Start from the heap saved in image.\n"
               "  -m n, --arena-size=n[KMG]?\n"
-              "    Initial size of arena (default %lu).\n",
+              "    Initial size of arena (default %lu).\n"
+              "  -s image\n"
+              "    Save the heap to image after loading the files.\n",
               argv[0],
               (unsigned long)arenasize);
       return EXIT_FAILURE;
@@ -4420,6 +4863,12 @@ int main(int argc, char *argv[])
   argc -= optind;
   argv += optind;
 
+  /* Map the image before creating the arena, so that the arena doesn't
+     take the addresses it needs. If it can't be mapped, build the heap
+     from scratch instead. */
+  if (image_input != NULL && image_map(image_input) != 0)
+    fprintf(stderr, "Starting without image.\n");
+
   /* Create an MPS arena.  There is usually only one of these in a process.
      It holds all the MPS "global" state and is where everything happens. */
   MPS_ARGS_BEGIN(args) {
@@ -0,0 +1,42 @@
+;;; test-image.scm -- tests for a heap image of the toy Scheme interpreter
+;;; $Id$
+;;;
+;;; Run this with an image saved after loading test-common.scm, for
+;;; example:
+;;;
+;;;     ./scheme -s test-common.img test-common.scm
+;;;     ./scheme -i test-common.img test-image.scm
+;;;
+;;; The definitions from test-common.scm (and r4rs.scm) must be
+;;; available without loading them again.
+
+;; Procedures and data restored from the image.
+(check '(church 1000 (lambda (a) (+ 1 a)) 0) 1000)
+(check '(sum (range 100)) 5050)
+(check '(map (lambda (x) (* x x)) (range 5)) '(1 4 9 16 25))
+(check '(all (list #t #t)) #t)
+
+;; Symbols restored from the image are still interned.
+(check '(eq? 'church (string->symbol "church")) #t)
+
+;; Restored objects can refer to new objects, which must survive
+;; collection.
+(define restored-list (range 10))
+(set-car! restored-list (make-string 20 #\x))
+(define (grow n) (if (eqv? n 0) '() (cons (make-vector 10 n) (grow (- n 1)))))
+(set! all (let ((old all) (junk (grow 100))) (lambda (l) (old l))))
+(gc)
+(check '(car restored-list) (make-string 20 #\x))
+(check '(all (list #t #f)) #f)
+
+;; Hashtables.
+(define ht (make-eq-hashtable))
+(for-each (lambda (n) (hashtable-set! ht (string->symbol (make-string n #\a)) n)) (range 50))
+(check '(hashtable-ref ht 'aaa #f) 3)
+(check '(hashtable-ref ht 'church #f) #f)
+(hashtable-set! ht 'church 'image)
+(gc)
+(check '(hashtable-ref ht 'church #f) 'image)
+
+(write-string "All tests pass.")
+(newline)
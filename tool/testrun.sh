@@ -110,12 +110,13 @@ for TESTCASE in $TEST_CASES; do
         "$TEST_DIR/mpseventcnv" -f "$MPS_TELEMETRY_FILENAME" > "$TELEMETRY.cnv"
         gzip "$MPS_TELEMETRY_FILENAME"
         "$TEST_DIR/mpseventtxt" < "$TELEMETRY.cnv" > "$TELEMETRY.txt"
+        "$TEST_DIR/mpseventtrace" < "$TELEMETRY.cnv" > "$TELEMETRY.json"
         if [ -x "$TEST_DIR/mpseventsql" ]; then
             MPS_TELEMETRY_DATABASE=$TELEMETRY.db
             export MPS_TELEMETRY_DATABASE
             "$TEST_DIR/mpseventsql" < "$TELEMETRY.cnv" >> "$LOGTEST" 2>&1
         fi
-        rm -f "$TELEMETRY.cnv" "$TELEMETRY.txt" "$TELEMETRY.db"
+        rm -f "$TELEMETRY.cnv" "$TELEMETRY.txt" "$TELEMETRY.json" "$TELEMETRY.db"
     fi
 done
 if [ $FAIL_COUNT = 0 ]; then